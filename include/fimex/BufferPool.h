@@ -0,0 +1,111 @@
+/*
+ * Fimex, BufferPool.h
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef FIMEX_BUFFERPOOL_H_
+#define FIMEX_BUFFERPOOL_H_
+
+#include <cstddef>
+
+namespace MetNoFimex {
+
+/**
+ * @headerfile fimex/BufferPool.h
+ */
+/**
+ * Recycling of large memory buffers.
+ *
+ * Reader chains allocate arrays of the same size for each slice and free them
+ * shortly after. make_shared_array() takes large arrays of numeric types from
+ * this pool, and the deleter of the shared_array returns them to the pool
+ * instead of freeing them, which saves the page-faults of fresh memory.
+ *
+ * Buffers are kept by size-class, where the classes are at most 1/8 larger than
+ * the requested size. Each thread keeps a few buffers in its own cache, the others
+ * go to a global cache. All cached buffers together are limited to
+ * getMaxCachedBytes(), buffers beyond that are freed.
+ */
+class BufferPool
+{
+public:
+    struct Statistics
+    {
+        size_t requests;    //!< number of allocate() calls
+        size_t reused;      //!< requests served from a cache
+        size_t released;    //!< number of release() calls
+        size_t freed;       //!< released buffers freed since the caches were full
+        size_t cachedBytes; //!< bytes currently kept in the caches
+    };
+
+    //! buffers smaller than this are not pooled by make_shared_array()
+    static const size_t MIN_POOLED_BYTES = 64 * 1024;
+
+    //! setMaxCachedBytes() value sizing the caches from the workload, the default
+    static const size_t AUTO_MAX_CACHED_BYTES = static_cast<size_t>(-1);
+
+    /**
+     * Get a buffer from the caches or allocate a new one.
+     *
+     * @param bytes size of the buffer
+     * @param reuse false to always allocate new memory, e.g. to place its pages by first touch
+     * @return uninitialized memory, aligned like operator new
+     */
+    static void* allocate(size_t bytes, bool reuse = true);
+
+    /**
+     * Return a buffer to the caches.
+     *
+     * @param buffer memory from allocate()
+     * @param bytes the size given to allocate()
+     */
+    static void release(void* buffer, size_t bytes);
+
+    /**
+     * Limit the bytes kept in the caches, 0 disables caching.
+     *
+     * With AUTO_MAX_CACHED_BYTES, the default, the limit is a quarter of the
+     * MemoryBudget limit, if any, otherwise 4 buffers of the largest size released
+     * so far, but at least 32MB. Cached buffers are not counted by the MemoryBudget.
+     */
+    static void setMaxCachedBytes(size_t maxBytes);
+
+    /**
+     * @return the current limit of the bytes kept in the caches
+     */
+    static size_t getMaxCachedBytes();
+
+    /**
+     * Free all buffers in the global cache and in the cache of the calling thread.
+     */
+    static void clear();
+
+    static Statistics statistics();
+
+    /**
+     * Write the statistics to the fimex.BufferPool logger, level INFO.
+     */
+    static void logStatistics();
+};
+
+} // namespace MetNoFimex
+
+#endif /* FIMEX_BUFFERPOOL_H_ */
@@ -30,6 +30,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace MetNoFimex
 {
@@ -57,6 +58,11 @@ private:
      */
     DataPtr getDataSlice_(const std::string& varName, const SliceBuilder& sb);
 
+    /**
+     * Split the request sb into the list of subslices of the input-reader, as used by getDataSlice_.
+     */
+    std::vector<SliceBuilder> getSubSlices_(const std::string& varName, const SliceBuilder& sb);
+
     //! all extractors need to have another Reader with input-data
     CDMExtractor() = delete;
 
@@ -66,6 +72,8 @@ public:
 
     DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos = 0) override;
     DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override;
+    size_t readInto(const std::string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst) override;
+    bool supportsConcurrentReading() const override;
 
     /**
      * @brief Remove a variable from the CDM
@@ -51,13 +51,23 @@ public:
 };
 
 class InterpolatorFill2d : public InterpolatorProcess2d {
+public:
+    /**
+     * iteration scheme of the fill
+     */
+    enum Method {
+        FILL2D_SERIAL,   //!< serial relaxation of mifi_fill2d_f
+        FILL2D_REDBLACK, //!< parallel red-black relaxation
+        FILL2D_MULTIGRID //!< parallel red-black relaxation, starting from the fill of coarser grids
+    };
 private:
     float relaxCrit_;
     float corrEff_;
     size_t maxLoop_;
+    Method method_;
 public:
-    InterpolatorFill2d(float relaxCrit, float corrEff, size_t maxLoop)
-        : relaxCrit_(relaxCrit), corrEff_(corrEff), maxLoop_(maxLoop) {}
+    InterpolatorFill2d(float relaxCrit, float corrEff, size_t maxLoop, Method method = FILL2D_SERIAL)
+        : relaxCrit_(relaxCrit), corrEff_(corrEff), maxLoop_(maxLoop), method_(method) {}
     void operator()(float* array, size_t nx, size_t ny) override;
 };
 
@@ -65,9 +75,13 @@ class InterpolatorCreepFill2d : public InterpolatorProcess2d {
 private:
     unsigned short repeat_;
     char setWeight_;
+    bool tiled_;
 public:
-    InterpolatorCreepFill2d(unsigned short repeat, char setWeight)
-        : repeat_(repeat), setWeight_(setWeight) {}
+    /**
+     * @param tiled scan tiles of rows in parallel instead of the serial mifi_creepfill2d_f
+     */
+    InterpolatorCreepFill2d(unsigned short repeat, char setWeight, bool tiled = false)
+        : repeat_(repeat), setWeight_(setWeight), tiled_(tiled) {}
     void operator()(float* array, size_t nx, size_t ny) override;
 };
 
@@ -76,9 +90,13 @@ private:
     unsigned short repeat_;
     char setWeight_;
     float defVal_;
+    bool tiled_;
 public:
-    InterpolatorCreepFillVal2d(unsigned short repeat, char setWeight, float defaultValue)
-        : repeat_(repeat), setWeight_(setWeight), defVal_(defaultValue) {}
+    /**
+     * @param tiled scan tiles of rows in parallel instead of the serial mifi_creepfillval2d_f
+     */
+    InterpolatorCreepFillVal2d(unsigned short repeat, char setWeight, float defaultValue, bool tiled = false)
+        : repeat_(repeat), setWeight_(setWeight), defVal_(defaultValue), tiled_(tiled) {}
     void operator()(float* array, size_t nx, size_t ny) override;
 };
 
@@ -134,6 +152,37 @@ private:
      */
     void warnUnlessAllXYSpatialVectorsHaveSameHorizontalId(const std::string& horizontalId) const;
 
+    /**
+     * run the pending generation of values of varName, if varName is a variable
+     * added by changeProjection, e.g. latitude and longitude
+     *
+     * @return the generated values of varName, or a 0-pointer if varName is not generated
+     */
+    DataPtr initVariable(const std::string& varName);
+
+    /**
+     * read and interpolate the input data of sb, including pre/postprocessing and vector reprojection
+     *
+     * The values are interpolated in their own datatype if the interpolation allows, e.g. nearest
+     * neighbor, else in double for double variables and in float otherwise.
+     *
+     * @param ci the CachedInterpolation used for the horizontalId
+     * @return interpolated values in the datatype of the variable with the fill value as undefined, or a 0-pointer if no data
+     */
+    DataPtr interpolateSlice(const std::string& varName, const std::string& horizontalId, const SliceBuilder& sb, CachedInterpolationInterface_p& ci);
+
+    /**
+     * read and interpolate the input data of several scalar variables with the same horizontalId,
+     * like interpolateSlice, but reading the variables concurrently and interpolating variables
+     * of the same size in one pass over the interpolation weights
+     *
+     * @param sbs the slices of the variables, in the order of varNames
+     * @param ci the CachedInterpolation used for the horizontalId
+     * @return interpolated values as from interpolateSlice, in the order of varNames
+     */
+    std::vector<DataPtr> interpolateSlices(const std::vector<std::string>& varNames, const std::string& horizontalId, const std::vector<SliceBuilder>& sbs,
+                                           CachedInterpolationInterface_p& ci);
+
 public:
     CDMInterpolator(CDMReader_p dataReader);
     virtual ~CDMInterpolator();
@@ -148,6 +197,18 @@ public:
      *
      */
     virtual DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb);
+    /**
+     * @brief retrieve data from the underlying dataReader and interpolate the values directly into dst
+     *
+     */
+    size_t readInto(const std::string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst) override;
+    /**
+     * @brief retrieve data of several variables from the underlying dataReader and interpolate
+     * the variables on the same horizontal grid together
+     *
+     */
+    std::vector<DataPtr> getDataSlices(const std::vector<std::string>& varNames, size_t unLimDimPos) override;
+    bool supportsConcurrentReading() const override;
 
     /**
      * @brief change the (main) projection of the dataReaders cdm to this new projection
@@ -274,6 +335,20 @@ public:
      * @param dist distance in meter
      */
     virtual void setDistanceOfInterest(double dist);
+    /**
+     * Set a directory to store the positions and vector-matrices computed by changeProjection(),
+     * to be reused by later processes interpolating between the same grids. The directory
+     * must exist, an empty string (the default) disables storing.
+     *
+     * Stored results are only reused by the same fimex and PROJ versions.
+     */
+    static void setCacheDirectory(const std::string& directory);
+    /**
+     * Set the maximum memory used by the process-wide cache of changeProjection() results, to
+     * reuse them for all CDMInterpolator instances of a process, e.g. those of a CDMMerger.
+     * The default is 256MB, 0 disables the memory cache.
+     */
+    static void setCacheMemoryLimit(size_t bytes);
     /**
      * add a process to the internal list of preprocesses, run on fields before interpolation
      *
@@ -63,6 +63,13 @@ public:
      * @warning does not handle fill-values unless those are NaNs
      */
     void deAccumulate(const std::string& varName);
+    /**
+     * store the slice cached for accumulation with less memory, by default
+     * DATA_PACKING_NONE. Packing loses precision, which adds up over the
+     * accumulated slices.
+     * @param packing the packing of the cached float and double data
+     */
+    void setCachePacking(DataPacking packing);
     /**
      * rotate the vector from direction in x/y axes to direction in lat/lon axes
      * @param toLatLon convert to latLon if true, otherwise, convert latLon to grid-axes
@@ -85,6 +92,7 @@ public:
     void rotateDirectionToLatLon(bool toLatLon, const std::vector<std::string>& varNames);
     using CDMReader::getDataSlice;
     virtual DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos);
+    bool supportsConcurrentReading() const override;
 
 private:
     struct CDMProcessorImpl;
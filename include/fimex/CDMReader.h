@@ -24,10 +24,12 @@
 #ifndef CDMREADER_H_
 #define CDMREADER_H_
 
+#include "fimex/CDMDataType.h"
 #include "fimex/CDMReaderDecl.h"
 #include "fimex/DataDecl.h"
 #include "fimex/UnitsConverterDecl.h"
 
+#include <future>
 #include <memory>
 #include <vector>
 
@@ -49,6 +51,30 @@ class SliceBuilder;
  * of the CDMReader and read the included data in the cdm or the data provided
  * through the implementation of the {@link CDMReader#getDataSlice}
  *
+ * Thread-safety: concurrent reading is only supported by the readers audited
+ * for it, FeltCDMReader, NetCDF_CDMReader, CDMExtractor, CDMInterpolator and
+ * CDMProcessor, and only if all readers below them are audited, too, see
+ * supportsConcurrentReading(). Once such a
+ * reader is fully set up, i.e. constructed and configured (e.g.
+ * CDMInterpolator::changeProjection(), CDMProcessor::accumulate(),
+ * CDMExtractor::reduceDimension()), the reading functions getData(),
+ * getDataSlice(), getScaledData*(), readInto() and getDataSliceAsync() may be
+ * called concurrently from several threads. Each call returns its own Data, which
+ * the caller may modify. Configuration must not run concurrently with reading, and
+ * getInternalCDM() / setInternalCDM() and putDataSlice() are not thread-safe.
+ *
+ * Other readers, e.g. the vertical and time interpolators, CDMMerger,
+ * NcmlCDMReader, GribCDMReader and the readers implemented in C or python, must
+ * be read from one thread at a time. The library reads such readers serially:
+ * getDataSlices(), the readAhead option of the writers and the parallel loops
+ * of the writers read concurrently only from readers supporting it, and only
+ * when the WorkerPool has more than one thread (see mifi_setNumThreads()).
+ * getDataSliceAsync() is not restricted, the caller must check.
+ *
+ * Implementations supporting concurrent reading must protect internal caches and
+ * non-reentrant libraries with a mutex (see OmpMutex), and must not return Data
+ * shared with a cache.
+ *
  * @see FeltCDMReader
  */
 class CDMReader
@@ -119,6 +145,66 @@ public:
      */
     virtual DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb);
 
+    /**
+     * @brief read a dataslice into memory provided by the caller
+     *
+     * The values are the same as returned by getDataSlice(const std::string&, const SliceBuilder&),
+     * i.e. unscaled, but converted to dataType and written directly to dst. Readers which
+     * can deliver data without an intermediate Data object should override this.
+     *
+     * @param varName name of the variable to read
+     * @param sb a SliceBuilder generated from this CDMReaders CDM
+     * @param dataType datatype of the values in dst, must be a numeric type
+     * @param dst destination array, must be able to hold all values of sb (see SliceBuilder::getDimensionSizes())
+     * @return the number of values written to dst, 0 if no data is available
+     * @throw CDMException on errors related to the CDM in combination with the underlying data-structure
+     * @warning This method has a default implementation depending on getDataSlice(const std::string&, const SliceBuilder&),
+     *       copying the data once more.
+     */
+    virtual size_t readInto(const std::string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst);
+
+    /**
+     * @brief asynchronous version of getDataSlice(const std::string&, size_t)
+     *
+     * The default implementation calls getDataSlice on the shared WorkerPool. The reader
+     * must stay alive until the future has been waited for.
+     *
+     * @return a future with the data, or with the exception thrown while reading
+     */
+    virtual std::future<DataPtr> getDataSliceAsync(const std::string& varName, size_t unLimDimPos);
+
+    /**
+     * @brief asynchronous version of getDataSlice(const std::string&, const SliceBuilder&)
+     *
+     * @see getDataSliceAsync(const std::string&, size_t)
+     */
+    virtual std::future<DataPtr> getDataSliceAsync(const std::string& varName, const SliceBuilder& sb);
+
+    /**
+     * @brief read slices of several variables at the same unlimited dimension position
+     *
+     * The values are the same as returned by getDataSlice(const std::string&, size_t) for each
+     * variable. The default implementation reads the variables concurrently on the shared
+     * WorkerPool if it has more than one thread and supportsConcurrentReading(), readers which can share work between variables, like the interpolation of
+     * variables on the same grid, should override this.
+     *
+     * @param varNames names of the variables to read
+     * @param unLimDimPos unlimited dimension position, see getDataSlice(const std::string&, size_t)
+     * @return the data, in the order of varNames
+     * @throw CDMException on errors, after all variables have been read
+     */
+    virtual std::vector<DataPtr> getDataSlices(const std::vector<std::string>& varNames, size_t unLimDimPos);
+
+    /**
+     * @brief check if the reading functions may be called from several threads at once
+     *
+     * Readers audited for concurrent reading override this, readers reading from
+     * other readers only return true if these support it, too.
+     *
+     * @return false by default
+     */
+    virtual bool supportsConcurrentReading() const;
+
     /**
      * @brief data-reading function to be called from the CDMWriter
      *
@@ -29,10 +29,16 @@
 #include "fimex/SliceBuilder.h"
 
 #include "fimex/SharedArray.h"
+#include "fimex/WeightMatrix.h"
+
+#include <cstdint>
+#include <vector>
 
 namespace MetNoFimex
 {
 
+class CachedVectorReprojection;
+
 /**
  * @headerfile fimex/CachedInterpolation.h
  */
@@ -60,6 +66,52 @@ public:
 
     virtual shared_array<float> interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const = 0;
 
+    /**
+     * Interpolate double values, with nan as undefined. The default implementation
+     * interpolates a float copy, subclasses override this to keep the precision.
+     */
+    virtual shared_array<double> interpolateValues(shared_array<double> inData, size_t size, size_t& newSize) const;
+
+    /**
+     * Interpolate the data in its own datatype, without conversion to float. This is only
+     * possible for interpolations selecting or comparing input values, e.g. nearest neighbor,
+     * and is the only way to keep integer values like masks, flags and categories exact.
+     *
+     * @param inData the input data of any numeric datatype
+     * @param badValue input values equal to badValue are undefined, undefined output values are set to badValue
+     * @param newSize return the size of the output data
+     * @return the interpolated data with the datatype of inData, or a 0-pointer if the interpolation
+     *         needs arithmetic on the values, use interpolateValues() then
+     */
+    virtual DataPtr interpolateData(DataPtr inData, double badValue, size_t& newSize) const;
+
+    /**
+     * Interpolate the x- and y-components of a vector field and rotate them to the output
+     * projection, with the same results as interpolateValues() for both components followed
+     * by CachedVectorReprojection::reprojectValues(), which is the default implementation.
+     *
+     * @param uData the input x-component
+     * @param vData the input y-component
+     * @param size the size of each of the input arrays
+     * @param cvr the rotation to the output projection
+     * @param uOut return the rotated output x-component
+     * @param vOut return the rotated output y-component
+     * @param newSize return the size of each of the output arrays
+     */
+    virtual void interpolateVectorValues(shared_array<float> uData, shared_array<float> vData, size_t size, const CachedVectorReprojection& cvr,
+                                         shared_array<float>& uOut, shared_array<float>& vOut, size_t& newSize) const;
+
+    /**
+     * Interpolate several fields of the same size, with the same results as interpolateValues()
+     * for each of them, which is the default implementation.
+     *
+     * @param inData the input fields, each of the given size
+     * @param size the size of each of the input arrays
+     * @param newSize return the size of each of the output arrays
+     * @return the interpolated fields, in the order of inData
+     */
+    virtual std::vector<shared_array<float>> interpolateBatch(const std::vector<shared_array<float>>& inData, size_t size, size_t& newSize) const;
+
     /** @return x-size of input array */
     size_t getInX() const { return inX; }
 
@@ -124,9 +176,21 @@ CachedInterpolationInterface_p createCachedInterpolation(const std::string& xDim
 class CachedInterpolation : public CachedInterpolationInterface
 {
 private:
-    shared_array<double> pointsOnXAxis;
-    shared_array<double> pointsOnYAxis;
-    int (*func)(const float* infield, float* outvalues, const double x, const double y, const int ix, const int iy, const int iz);
+    int method;
+
+    // output points with all input points inside the input layer, bilinear or bicubic
+    std::vector<std::uint32_t> innerOut; //!< position in the output layer
+    std::vector<std::uint32_t> innerIn;  //!< position of the first input point in the input layer
+    std::vector<float> innerXFrac;       //!< bilinear x-weight
+    std::vector<float> innerYFrac;       //!< bilinear y-weight
+    std::vector<float> innerXM;          //!< bicubic x-weights, the first 3 of 4 per point
+    std::vector<float> innerMY;          //!< bicubic y-weights, the first 3 of 4 per point
+
+    // all other output points, see borderValue()
+    std::vector<std::uint32_t> borderOut; //!< position in the output layer
+    std::vector<double> borderX;          //!< x-position in the input layer, bilinear only
+    std::vector<double> borderY;          //!< y-position in the input layer, bilinear only
+
 public:
     /**
      * @param funcType {@link interpolation.h} interpolation method
@@ -149,12 +213,109 @@ public:
      */
     shared_array<float> interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const override;
 
+    /**
+     * Interpolate double values with the same kernels, computing in double.
+     */
+    shared_array<double> interpolateValues(shared_array<double> inData, size_t size, size_t& newSize) const override;
+
+    /**
+     * Rotate each block of output points right after interpolating both components,
+     * while the values are still in the cache.
+     */
+    void interpolateVectorValues(shared_array<float> uData, shared_array<float> vData, size_t size, const CachedVectorReprojection& cvr,
+                                 shared_array<float>& uOut, shared_array<float>& vOut, size_t& newSize) const override;
+
+    /**
+     * Interpolate all fields on each block of output points, reusing the positions
+     * and weights while they are in the cache.
+     */
+    std::vector<shared_array<float>> interpolateBatch(const std::vector<shared_array<float>>& inData, size_t size, size_t& newSize) const override;
+
 private:
     /**
      * Create a reduced domain for later generation of a slicebuild to read a smaller domain.
      * It should be run immediately after creating the CachedInterpolation.
      */
+    void createReducedDomain(const std::string& xDimName, const std::string& yDimName, const double* pointsOnXAxis, const double* pointsOnYAxis);
+
+    /**
+     * Precompute the input positions and weights of all output points, after createReducedDomain().
+     * The positions are not kept, except for the border points.
+     */
+    void createWeights(const double* pointsOnXAxis, const double* pointsOnYAxis);
+
+    template <typename T>
+    shared_array<T> interpolateLayers(shared_array<T> inData, size_t size, size_t& newSize) const;
+
+    template <typename T>
+    void interpolateInner(const T* inLayer, T* outLayer, size_t begin, size_t end) const;
+
+    /**
+     * Value of the border point b (index in borderOut): as mifi_get_values_bilinear_f, nearest
+     * neighbor in the direction(s) without two input points, bicubic is undefined.
+     */
+    template <typename T>
+    T borderValue(const T* inLayer, size_t b) const;
+};
+
+/**
+ * Cached interpolation between grids where the x-position of an output point
+ * in the input grid depends only on its column and the y-position only on its
+ * row, e.g. two grids in the same projection. Positions and weights are kept
+ * per axis, i.e. O(outX+outY) instead of O(outX*outY), and each output row is
+ * computed by a loop over the columns without branches.
+ *
+ * The results are the same as with CachedInterpolation or CachedNNInterpolation
+ * for the positions of all outX*outY points.
+ */
+class CachedSeparableInterpolation : public CachedInterpolationInterface
+{
+private:
+    int method;
+    std::vector<double> pointsOnXAxis; //!< x-position of each output column
+    std::vector<double> pointsOnYAxis; //!< y-position of each output row
+
+    // the first input point and the weights of each column and row, only valid for the inner
+    // columns and rows, where all input points are inside the input layer, 0 for the others
+    std::vector<size_t> colIn;      //!< first input column, the nearest for nearest neighbor
+    std::vector<double> colW[4];    //!< x-weights, the fraction for bilinear
+    std::vector<char> colInner;     //!< 1 for inner columns
+    std::vector<size_t> borderCols; //!< all other columns
+    std::vector<size_t> rowIn;      //!< first input row, the nearest for nearest neighbor
+    std::vector<double> rowW[4];    //!< y-weights, the fraction for bilinear
+    std::vector<char> rowInner;     //!< 1 for inner rows
+
+public:
+    /**
+     * @param funcType MIFI_INTERPOL_BILINEAR, MIFI_INTERPOL_BICUBIC or MIFI_INTERPOL_NEAREST_NEIGHBOR
+     * @param pointsOnXAxis x-position of each output column in the current x-coordinate (size = outX)
+     * @param pointsOnYAxis y-position of each output row in the current y-coordinate (size = outY)
+     * @param inX size of current X axis
+     * @param inY size of current Y axis
+     * @param outX size of new X axis
+     * @param outY size of new Y axis
+     */
+    CachedSeparableInterpolation(const std::string& xDimName, const std::string& yDimName, int funcType, shared_array<double> pointsOnXAxis,
+                                 shared_array<double> pointsOnYAxis, size_t inX, size_t inY, size_t outX, size_t outY);
+
+    shared_array<float> interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const override;
+    shared_array<double> interpolateValues(shared_array<double> inData, size_t size, size_t& newSize) const override;
+
+    /**
+     * Copy the nearest input values in any datatype, only for nearest neighbor.
+     */
+    DataPtr interpolateData(DataPtr inData, double badValue, size_t& newSize) const override;
+
+private:
     void createReducedDomain(const std::string& xDimName, const std::string& yDimName);
+    void createWeights();
+
+    template <typename T>
+    shared_array<T> interpolateLayers(shared_array<T> inData, size_t size, size_t& newSize) const;
+
+    /** interpolate output rows begin..end of one layer */
+    template <typename T>
+    void interpolateRows(const T* inLayer, T* outLayer, size_t begin, size_t end) const;
 };
 
 /**
@@ -164,7 +325,7 @@ private:
 class CachedNNInterpolation : public CachedInterpolationInterface
 {
 private:
-    std::vector<size_t> pointsInIn;
+    WeightMatrix_p matrix; //!< one weight 1 per output point with an input point
 
 public:
     /**
@@ -186,6 +347,19 @@ public:
      * @param newSize return the size of the output-array
      */
     shared_array<float> interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const override;
+
+    shared_array<double> interpolateValues(shared_array<double> inData, size_t size, size_t& newSize) const override;
+
+    /**
+     * Copy the nearest input values in any datatype.
+     */
+    DataPtr interpolateData(DataPtr inData, double badValue, size_t& newSize) const override;
+
+    /**
+     * The nearest neighbors as sparse matrix from the (reduced) input layer to the output layer,
+     * with a single weight 1 in each row of an output point with an input point.
+     */
+    WeightMatrix_cp weightMatrix() const { return matrix; }
 };
 
 } // namespace MetNoFimex
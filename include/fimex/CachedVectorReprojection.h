@@ -26,6 +26,8 @@
 
 #include "fimex/SharedArray.h"
 
+#include <cstdint>
+
 namespace MetNoFimex {
 namespace reproject {
 struct Matrix;
@@ -50,6 +52,16 @@ public:
      */
     void reprojectValues(shared_array<float>& uValues, shared_array<float>& vValues, size_t size) const;
 
+    /**
+     * reproject the vector values at some points of one spatial plane
+     *
+     * @param uLayer the values in x-direction of the plane, changed in-place at the points xy
+     * @param vLayer the values in y-direction of the plane, changed in-place at the points xy
+     * @param xy the positions of the points in the plane
+     * @param n the number of points
+     */
+    void reprojectValues(float* uLayer, float* vLayer, const std::uint32_t* xy, size_t n) const;
+
     /**
      * reproject directions given in angles in degree
      * @param angles direction of vector in each grid-cell, given in degree
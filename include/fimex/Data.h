@@ -294,6 +294,39 @@ DataPtr createData(CDMDataType datatype, InputIterator first, InputIterator last
      */
 DataPtr createDataSlice(CDMDataType datatype, const Data& data, size_t dataStartPos, size_t dataSize);
 
+/**
+     * @brief create a read-only view on a multi-dimensional slice of another Data object
+     *
+     * Parameters and result are the same as for Data::slice(), but the values
+     * are not copied until the view is modified or getDataPtr() is called. The values
+     * of data must not be modified while the view is in use. Data which cannot
+     * be viewed, e.g. strings, is sliced.
+     */
+DataPtr createDataView(DataPtr data, const std::vector<size_t>& orgDimSize, const std::vector<size_t>& startDims, const std::vector<size_t>& outputDimSize);
+
+/**
+     * @brief create a read-only view on a one-dimensional slice of another Data object
+     *
+     * @param data the data to view, must not be modified while the view is in use
+     * @param dataStartPos the first element of data to view
+     * @param dataSize the size of the view
+     * @see createDataView(DataPtr, const std::vector<size_t>&, const std::vector<size_t>&, const std::vector<size_t>&)
+     */
+DataPtr createDataView(DataPtr data, size_t dataStartPos, size_t dataSize);
+
+/**
+     * @brief create a copy of data using less memory
+     *
+     * Float and double values are packed to 16 bits per value, which loses
+     * precision, and unpacked when read. NaN and fillValue are kept exactly.
+     * Other datatypes and DATA_PACKING_NONE return a clone of data.
+     *
+     * @param data the data to pack
+     * @param packing the packing to use
+     * @param fillValue the fill value of data
+     */
+DataPtr createPackedData(const Data& data, DataPacking packing, double fillValue);
+
 template <class T, class InputIterator>
 DataPtr createDataFromIterator(InputIterator first, InputIterator last)
 {
@@ -339,6 +372,16 @@ DataPtr createData(CDMDataType datatype, InputIterator first, InputIterator last
 
 DataPtr convertValues(const Data& data, CDMDataType newType);
 
+/**
+ * @brief copy the values of data, converted to newType, into a raw array
+ *
+ * @param data the data to read the values from
+ * @param newType datatype of the destination array, must be numeric
+ * @param dst destination array, must be able to hold data.size() values of newType
+ * @return the number of values copied, i.e. data.size()
+ */
+size_t copyValues(const Data& data, CDMDataType newType, void* dst);
+
 } // namespace MetNoFimex
 
 #endif /*DATA_H_*/
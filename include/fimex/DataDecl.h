@@ -41,6 +41,15 @@ namespace MetNoFimex
      * Pointer to Data, this is the preferred way to access Data
      */
     typedef std::shared_ptr<Data> DataPtr;
+
+    /**
+     * compact in-memory storage of float and double values, see createPackedData()
+     */
+    enum DataPacking {
+        DATA_PACKING_NONE,  ///< values are stored in their own type
+        DATA_PACKING_INT16, ///< 16bit integers with scale and offset from the range of the values
+        DATA_PACKING_FP16   ///< IEEE half precision, about 3 significant digits
+    };
 }
 
 
@@ -0,0 +1,120 @@
+/*
+ * Fimex, MemoryBudget.h
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef FIMEX_MEMORYBUDGET_H_
+#define FIMEX_MEMORYBUDGET_H_
+
+#include <cstddef>
+
+namespace MetNoFimex {
+
+/**
+ * @headerfile fimex/MemoryBudget.h
+ */
+/**
+ * Accounting of the memory held by arrays and a limit for it.
+ *
+ * make_shared_array() counts the bytes of all arrays of numeric types, which
+ * includes the arrays of all Data created by createData(). The counted bytes are
+ * live until the last shared_array is gone.
+ *
+ * With a limit, work is throttled while the live bytes exceed it: the outermost
+ * WorkerPool::parallelFor() loops do not start new iterations, and the writers
+ * do not read ahead. Work already running is never blocked, so the limit may be
+ * exceeded by the slices in progress, but fewer slices run concurrently.
+ */
+class MemoryBudget
+{
+public:
+    struct Statistics
+    {
+        size_t liveBytes; //!< bytes of arrays currently allocated
+        size_t peakBytes; //!< maximum of liveBytes since the start or resetPeak()
+        size_t limit;     //!< the limit, 0 if unlimited
+        size_t throttled; //!< number of times work had to wait for memory
+    };
+
+    /**
+     * Count an allocated array.
+     */
+    static void allocated(size_t bytes);
+
+    /**
+     * Count a freed array, waking up work waiting for memory.
+     */
+    static void freed(size_t bytes);
+
+    static size_t liveBytes();
+
+    static size_t peakBytes();
+
+    /**
+     * Set the peak to the current live bytes.
+     */
+    static void resetPeak();
+
+    /**
+     * Limit the live bytes, 0 (the default) disables throttling.
+     */
+    static void setLimit(size_t bytes);
+
+    static size_t getLimit();
+
+    /**
+     * @return true if there is a limit and the live bytes exceed it
+     */
+    static bool exceeded();
+
+    /**
+     * @return true if the current thread runs inside a Scope
+     */
+    static bool inScope();
+
+    static Statistics statistics();
+
+    /**
+     * Write the statistics to the fimex.MemoryBudget logger, level INFO.
+     */
+    static void logStatistics();
+
+    /**
+     * Mark a unit of work, e.g. one slice, running in the current thread.
+     *
+     * The constructor waits while the limit is exceeded and other work is
+     * running. Units nested in a unit running in the same thread never wait.
+     */
+    class Scope
+    {
+    public:
+        Scope();
+        ~Scope();
+
+    private:
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+} // namespace MetNoFimex
+
+#endif /* FIMEX_MEMORYBUDGET_H_ */
@@ -29,10 +29,18 @@
 
 #ifdef _OPENMP
 #include <omp.h>
+#else
+#include <mutex>
 #endif
 
 namespace MetNoFimex {
 
+/**
+ * Mutex usable both from OpenMP regions and from plain threads.
+ *
+ * Without OpenMP, this is a std::mutex, since readers might be called
+ * concurrently from other threads, e.g. the WorkerPool.
+ */
 class OmpMutex
 {
 public:
@@ -58,6 +66,8 @@ public:
 #ifdef _OPENMP
         omp_set_lock(&lock_);
 #pragma omp flush
+#else
+        lock_.lock();
 #endif
     }
 
@@ -66,12 +76,16 @@ public:
 #ifdef _OPENMP
 #pragma omp flush
         omp_unset_lock(&lock_);
+#else
+        lock_.unlock();
 #endif
     }
 
 private:
 #ifdef _OPENMP
     omp_lock_t lock_;
+#else
+    std::mutex lock_;
 #endif
 };
 
@@ -31,21 +31,78 @@
 #ifndef FIMEX_SHARED_ARRAY_H
 #define FIMEX_SHARED_ARRAY_H
 
+#include "fimex/BufferPool.h"
+#include "fimex/MemoryBudget.h"
+
 #include <memory>
+#include <type_traits>
 
 namespace MetNoFimex {
 
 template <typename T>
 using shared_array = std::shared_ptr<T[]>;
 
-template <typename T>
-inline shared_array<T> make_shared_array(size_t size)
+namespace detail {
+
+template <typename T, bool pooled = std::is_arithmetic<T>::value>
+struct SharedArrayAllocator
 {
+    static shared_array<T> allocate(size_t size, bool /* reuse */ = true)
+    {
 #if __cplusplus >= 201703L
-    return std::shared_ptr<T[]>(new T[size]);
+        return std::shared_ptr<T[]>(new T[size]);
 #else
-    return std::shared_ptr<T[]>(new T[size], std::default_delete<T[]>());
+        return std::shared_ptr<T[]>(new T[size], std::default_delete<T[]>());
 #endif
+    }
+};
+
+// arrays of numbers are counted by the MemoryBudget, large ones are recycled through the BufferPool
+template <typename T>
+struct SharedArrayAllocator<T, true>
+{
+    static shared_array<T> allocate(size_t size, bool reuse = true)
+    {
+        const size_t bytes = size * sizeof(T);
+        shared_array<T> array;
+        if (bytes < BufferPool::MIN_POOLED_BYTES) {
+            array = std::shared_ptr<T[]>(new T[size], [bytes](T* p) {
+                delete[] p;
+                MemoryBudget::freed(bytes);
+            });
+        } else {
+            array = std::shared_ptr<T[]>(static_cast<T*>(BufferPool::allocate(bytes, reuse)), [bytes](T* p) {
+                BufferPool::release(p, bytes);
+                MemoryBudget::freed(bytes);
+            });
+        }
+        MemoryBudget::allocated(bytes);
+        return array;
+    }
+};
+
+} // namespace detail
+
+/**
+ * Allocate an uninitialized array. Arrays of arithmetic types are counted by the
+ * MemoryBudget, large ones are taken from the BufferPool and returned to it when
+ * the last shared_array is gone.
+ */
+template <typename T>
+inline shared_array<T> make_shared_array(size_t size)
+{
+    return detail::SharedArrayAllocator<T>::allocate(size);
+}
+
+/**
+ * Allocate an uninitialized array like make_shared_array(), but never reuse a
+ * buffer from the BufferPool, whose pages may already be placed on another NUMA
+ * node. The array is returned to the BufferPool when the last shared_array is gone.
+ */
+template <typename T>
+inline shared_array<T> make_shared_array_fresh(size_t size)
+{
+    return detail::SharedArrayAllocator<T>::allocate(size, false);
 }
 
 } // namespace MetNoFimex
@@ -34,13 +34,21 @@ extern "C" {
 /**
   * @brief Set the number of threads.
   *
-  * This function may not be set from a parallel region.
+  * This sets the size of the library-wide worker pool, which is shared by
+  * all parallel parts of fimex, and the number of OpenMP threads.
+  *
+  * This function may not be set from a parallel region or a worker thread.
   *
   * @param n the number of threads, if 0, use the number of processors
   * @return MIFI_OK or MIFI_ERROR
   */
 extern int mifi_setNumThreads(int n);
 
+/**
+  * @brief Get the number of threads of the library-wide worker pool.
+  */
+extern int mifi_getNumThreads();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,128 @@
+/*
+ * Fimex, WeightMatrix.h
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef FIMEX_WEIGHTMATRIX_H_
+#define FIMEX_WEIGHTMATRIX_H_
+
+#include "fimex/SharedArray.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace MetNoFimex {
+
+/**
+ * @headerfile fimex/WeightMatrix.h
+ */
+/**
+ * Sparse matrix in compressed sparse row (CSR) format, mapping an input layer
+ * to an output layer: each output point (row) is the weighted sum of a few
+ * input points (columns).
+ *
+ * CachedNNInterpolation stores its nearest neighbors as such a matrix, see
+ * CachedNNInterpolation::weightMatrix(). Weights of 1 are not stored, so a
+ * nearest-neighbor matrix takes two 32-bit integers per output point and
+ * apply() copies the values.
+ */
+class WeightMatrix
+{
+public:
+    /**
+     * Create an empty matrix, rows are added with addWeight() and endRow().
+     *
+     * @param columns the size of the input layer, must be less than 2^32
+     */
+    explicit WeightMatrix(size_t columns);
+
+    /**
+     * Add a weight to the current row. At most 2^32-1 weights can be added.
+     */
+    void addWeight(size_t column, float weight);
+
+    /**
+     * Finish the current row. A row without weights gives an undefined output value.
+     */
+    void endRow();
+
+    /** @return the number of finished rows, i.e. the size of the output layer */
+    size_t rows() const { return rowStart_.size() - 1; }
+
+    /** @return the size of the input layer */
+    size_t columns() const { return columns_; }
+
+    /** @return the number of weights */
+    size_t nonZeros() const { return columnIndex_.size(); }
+
+    /** @return the position of the first weight of a row in columnIndices() and weights(), rows()+1 values */
+    const std::vector<std::uint32_t>& rowStart() const { return rowStart_; }
+
+    const std::vector<std::uint32_t>& columnIndices() const { return columnIndex_; }
+
+    /** @return the weights, empty if all weights are 1 */
+    const std::vector<float>& weights() const { return weights_; }
+
+    /**
+     * Apply the matrix to nLayers consecutive layers.
+     *
+     * A nan input value makes the output nan, as do rows without weights.
+     *
+     * @param in nLayers*columns() input values
+     * @param out nLayers*rows() output values
+     */
+    void apply(const float* in, float* out, size_t nLayers) const;
+
+    /**
+     * Apply the matrix to nLayers consecutive layers of double values.
+     */
+    void apply(const double* in, double* out, size_t nLayers) const;
+
+    /**
+     * Apply the matrix to all layers in an array, with the signature of
+     * CachedInterpolationInterface::interpolateValues().
+     */
+    shared_array<float> apply(shared_array<float> inData, size_t size, size_t& newSize) const;
+    shared_array<double> apply(shared_array<double> inData, size_t size, size_t& newSize) const;
+
+private:
+    template <typename T>
+    void applyRows(const T* in, T* out, size_t begin, size_t end) const;
+
+    template <typename T>
+    void applyLayers(const T* in, T* out, size_t nLayers) const;
+
+    template <typename T>
+    shared_array<T> applyArray(shared_array<T> inData, size_t size, size_t& newSize) const;
+
+    size_t columns_;
+    std::vector<std::uint32_t> rowStart_;
+    std::vector<std::uint32_t> columnIndex_;
+    std::vector<float> weights_; //!< empty while all weights are 1
+};
+
+typedef std::shared_ptr<WeightMatrix> WeightMatrix_p;
+typedef std::shared_ptr<const WeightMatrix> WeightMatrix_cp;
+
+} // namespace MetNoFimex
+
+#endif /* FIMEX_WEIGHTMATRIX_H_ */
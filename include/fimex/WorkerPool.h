@@ -0,0 +1,233 @@
+/*
+ * Fimex, WorkerPool.h
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef FIMEX_WORKERPOOL_H_
+#define FIMEX_WORKERPOOL_H_
+
+#include "fimex/SharedArray.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace MetNoFimex {
+
+/**
+ * @headerfile fimex/WorkerPool.h
+ */
+/**
+ * A task-based pool of worker threads with work stealing.
+ *
+ * Each worker has its own task queue: tasks submitted from within a worker
+ * go to the queue of this worker, tasks submitted from other threads go to
+ * a common queue. Idle workers steal tasks from the queues of other workers.
+ *
+ * The number of workers is the concurrency budget of the library: the shared()
+ * pool is used for asynchronous reading (CDMReader::getDataSliceAsync()) and for
+ * the parallel loops of the library (parallelFor()), and it is sized by
+ * mifi_setNumThreads(). It has a single worker, i.e. the loops run serially, until
+ * mifi_setNumThreads() or, with OpenMP, omp_get_max_threads() asks for more.
+ * Parallel loops may be nested, inner loops get the workers not used by the
+ * outer loops.
+ *
+ * Tasks waiting for other tasks of the same pool must use wait() or get()
+ * instead of std::future::wait(), so that the waiting thread runs the tasks
+ * it submitted itself if no worker has started them yet.
+ */
+class WorkerPool
+{
+public:
+    /**
+     * Placement of the worker threads on the cores.
+     */
+    enum Affinity {
+        AFFINITY_NONE,    //!< leave the placement to the operating system
+        AFFINITY_COMPACT, //!< pin the workers to the cores, filling one NUMA node after the other
+        AFFINITY_SPREAD   //!< pin the workers to the cores, alternating between the NUMA nodes
+    };
+
+    /**
+     * @param nThreads number of worker threads, 0 means the number of available cores
+     */
+    explicit WorkerPool(size_t nThreads = 0);
+
+    /**
+     * Finish all queued tasks and stop the worker threads.
+     */
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * Queue a task for execution.
+     *
+     * @param task a function without arguments
+     * @return a future with the result or the exception of the task
+     */
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F task)
+    {
+        typedef typename std::result_of<F()>::type result_type;
+        auto ptask = std::make_shared<std::packaged_task<result_type()>>(std::move(task));
+        std::future<result_type> result = ptask->get_future();
+        push([ptask]() { (*ptask)(); });
+        return result;
+    }
+
+    /**
+     * Wait for a future, running queued tasks of the caller's submit group while waiting.
+     *
+     * A task belongs to the submit group of the code submitting it, i.e. of the task or
+     * parallelFor() chunk running in the calling thread, or of the thread itself. Only
+     * these tasks, usually including the awaited one, are run here, never unrelated tasks
+     * which might re-enter the caller. When none is left, this blocks until the future
+     * is ready, since no new task of the group can be queued meanwhile.
+     */
+    template <typename T>
+    void wait(std::future<T>& f)
+    {
+        while (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!runGroupTask()) {
+                f.wait();
+                return;
+            }
+        }
+    }
+
+    /**
+     * Wait for a shared future like wait(std::future<T>&).
+     */
+    template <typename T>
+    void wait(const std::shared_future<T>& f)
+    {
+        while (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!runGroupTask()) {
+                f.wait();
+                return;
+            }
+        }
+    }
+
+    /**
+     * Wait for a future like wait() and return its result.
+     */
+    template <typename T>
+    T get(std::future<T>& f)
+    {
+        wait(f);
+        return f.get();
+    }
+
+    /**
+     * Run body(i) for all i in [begin, end).
+     *
+     * The range is split into chunks of at least grain indices. The calling thread
+     * works on the chunks, too, and idle workers steal the remaining chunks. The
+     * first exception thrown by body is rethrown after all started chunks have
+     * finished, remaining chunks are skipped then.
+     *
+     * The function may be called from within tasks of the pool, i.e. nested.
+     */
+    void parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& body, size_t grain = 1);
+
+    /**
+     * @return the number of worker threads
+     */
+    size_t size() const;
+
+    /**
+     * Change the number of worker threads. All queued tasks are finished before
+     * the workers are restarted.
+     *
+     * This must not be called from a worker thread or while other threads submit
+     * tasks.
+     *
+     * @param nThreads number of worker threads, 0 means the number of available cores
+     */
+    void resize(size_t nThreads);
+
+    /**
+     * Pin the worker threads to cores. The policy is kept when resizing the pool.
+     *
+     * Pinning is only available on linux, the policy is ignored elsewhere.
+     */
+    void setAffinity(Affinity affinity);
+
+    /**
+     * @return the current placement policy of the workers
+     */
+    Affinity getAffinity() const;
+
+    /**
+     * @return true if the calling thread is a worker of any WorkerPool
+     */
+    static bool isWorkerThread();
+
+    /**
+     * The pool shared by all readers, created on first use.
+     */
+    static WorkerPool& shared();
+
+private:
+    void push(std::function<void()> task);
+    bool runGroupTask();
+
+    struct Impl;
+    std::unique_ptr<Impl> p_;
+};
+
+/**
+ * Allocate an array and initialize it in parallel on the shared() pool.
+ *
+ * Memory pages are placed on the NUMA node of the thread touching them first.
+ * Arrays allocated with make_shared_array() and filled by a single thread end up
+ * on one node, while with this function they are spread over the nodes of the
+ * workers, like the parallel loops processing them later. The array is never
+ * a recycled buffer of the BufferPool, which would already be placed.
+ *
+ * @param size number of elements
+ * @param value initial value of all elements
+ */
+template <typename T>
+shared_array<T> make_shared_array_parallel(size_t size, T value = T())
+{
+    shared_array<T> array = make_shared_array_fresh<T>(size);
+    T* data = array.get();
+    const size_t pageSize = std::max(size_t(1), 4096 / sizeof(T));
+    if (size < 256 * pageSize) {
+        std::fill(data, data + size, value);
+    } else {
+        WorkerPool::shared().parallelFor(0, (size + pageSize - 1) / pageSize, [data, size, pageSize, value](size_t page) {
+            std::fill(data + page * pageSize, data + std::min(size, (page + 1) * pageSize), value);
+        }, 16);
+    }
+    return array;
+}
+
+} // namespace MetNoFimex
+
+#endif /* FIMEX_WORKERPOOL_H_ */
@@ -347,6 +347,10 @@ size_t mifi_compute_vertical_velocity(size_t nx, size_t ny, size_t nz, double dx
  * @return 0 (in fimex < 0.61, this was possibly the number of conversions, but it was never strict)
  */
 extern size_t mifi_bad2nanf(float* posPtr, float* endPtr, float badVal);
+/**
+ * Convert bad-values to nan in a double array. See #mifi_bad2nanf
+ */
+extern size_t mifi_bad2nand(double* posPtr, double* endPtr, double badVal);
 /**
  * Convert nan back to bad-values. See #mifi_bad2nanf
  *
@@ -36,6 +36,8 @@ struct Matrix
     enum { stride = 3 };
 
     Matrix(int sizex, int sizey);
+    /** use an existing matrix of sizex*sizey*stride values */
+    Matrix(int sizex, int sizey, MetNoFimex::shared_array<double> matrix);
 
     const double* mtx() const { return matrix.get(); }
     double* mtx() { return matrix.get(); }
@@ -226,6 +228,11 @@ void reproject_values(const std::string& proj_input, const std::string& proj_out
 void reproject_axes(const std::string& proj_input, const std::string& proj_output, const double* in_x_axis, const double* in_y_axis, const int ix, const int iy,
                     double* out_xproj_axis, double* out_yproj_axis);
 
+/**
+ * @return the release of the PROJ library used, e.g. to invalidate stored projection results
+ */
+std::string proj_version();
+
 } // namespace reproject
 } // namespace MetNoFimex
 
@@ -25,6 +25,7 @@
  */
 
 #include "fimex/CDM.h"
+#include "fimex/CDMException.h"
 #include "fimex/CDMFileReaderFactory.h"
 #include "fimex/CDMReader.h"
 #include "fimex/Data.h"
@@ -32,9 +33,23 @@
 
 #include "pyfimex0_helpers.h"
 
+#include <chrono>
+#include <deque>
+#include <future>
+
 #define PY_GIL_ACQUIRE py::gil_scoped_acquire acquire
 #define PY_GIL_RELEASE py::gil_scoped_release release
 
+// call the python implementation of pyname, or else the CDMReader implementation without
+// holding the GIL, as it might wait for other threads calling back into python
+#define PY_OVERLOAD_OR_BASE(pyname, name, ...)                                                          \
+    {                                                                                                 \
+        PY_GIL_ACQUIRE;                                                                               \
+        if (py::function overload = py::get_overload(static_cast<const CDMReader*>(this), pyname)) \
+            return overload(__VA_ARGS__).cast<DataPtr>();                                             \
+    }                                                                                                 \
+    return CDMReader::name(__VA_ARGS__)
+
 using namespace MetNoFimex;
 namespace py = pybind11;
 
@@ -115,6 +130,100 @@ DataPtr CDMReader__getScaledDataSliceInUnitSB(CDMReader_p reader, const std::str
     return reader->getScaledDataSliceInUnit(varName, unit, sb);
 }
 
+// wrapper for futures, keeps the reader alive and waits without holding the GIL
+class DataSliceFuture
+{
+public:
+    DataSliceFuture(CDMReader_p reader, std::future<DataPtr>&& future)
+        : reader_(reader)
+        , future_(std::move(future))
+    {
+    }
+    ~DataSliceFuture()
+    {
+        if (future_.valid() && !ready()) {
+            PY_GIL_RELEASE;
+            future_.wait();
+        }
+    }
+    DataPtr get()
+    {
+        if (!future_.valid())
+            throw CDMException("DataSliceFuture.get() can only be called once");
+        PY_GIL_RELEASE;
+        return future_.get();
+    }
+    bool ready() const { return future_.valid() && future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+
+private:
+    CDMReader_p reader_;
+    std::future<DataPtr> future_;
+};
+
+DataSliceFuture* CDMReader__getDataSliceAsyncUL(CDMReader_p reader, const std::string& varName, int unLimDimPos)
+{
+    return new DataSliceFuture(reader, reader->getDataSliceAsync(varName, unLimDimPos));
+}
+DataSliceFuture* CDMReader__getDataSliceAsyncSB(CDMReader_p reader, const std::string& varName, const SliceBuilder& sb)
+{
+    return new DataSliceFuture(reader, reader->getDataSliceAsync(varName, sb));
+}
+
+// iterate over the unlimited-dimension slices of a variable, reading up to readAhead slices in advance
+class DataSliceIterator
+{
+public:
+    DataSliceIterator(CDMReader_p reader, const std::string& varName, size_t readAhead)
+        : reader_(reader)
+        , varName_(varName)
+        , readAhead_(readAhead)
+        , next_(0)
+        , nextRead_(0)
+    {
+        const CDM& cdm = reader_->getCDM();
+        const CDMDimension* unLimDim = cdm.getUnlimitedDim();
+        size_ = (unLimDim && cdm.hasUnlimitedDim(cdm.getVariable(varName_))) ? unLimDim->getLength() : 1;
+    }
+    ~DataSliceIterator()
+    {
+        if (!inFlight_.empty()) {
+            PY_GIL_RELEASE;
+            for (std::future<DataPtr>& f : inFlight_)
+                f.wait();
+        }
+    }
+    DataPtr next()
+    {
+        if (next_ >= size_)
+            throw py::stop_iteration();
+        for (; nextRead_ < size_ && nextRead_ <= next_ + readAhead_; ++nextRead_)
+            inFlight_.push_back(reader_->getDataSliceAsync(varName_, nextRead_));
+        std::future<DataPtr> f = std::move(inFlight_.front());
+        inFlight_.pop_front();
+        next_ += 1;
+        PY_GIL_RELEASE;
+        return f.get();
+    }
+
+private:
+    CDMReader_p reader_;
+    std::string varName_;
+    size_t readAhead_;
+    size_t size_;
+    size_t next_;
+    size_t nextRead_;
+    std::deque<std::future<DataPtr>> inFlight_;
+};
+
+DataSliceIterator* CDMReader__iterDataSlices3(CDMReader_p reader, const std::string& varName, size_t readAhead)
+{
+    return new DataSliceIterator(reader, varName, readAhead);
+}
+DataSliceIterator* CDMReader__iterDataSlices2(CDMReader_p reader, const std::string& varName)
+{
+    return CDMReader__iterDataSlices3(reader, varName, 2);
+}
+
 // wrappers for default arguments
 CDMReader_p createFileReader4(const std::string& fileType, const std::string& fileName,
         const std::string& configFile, const std::vector<std::string>& args)
@@ -140,20 +249,11 @@ public:
     {
     }
 
-    DataPtr getData(const std::string& varName) override
-    {
-        PY_GIL_ACQUIRE;
-        PYBIND11_OVERLOAD(DataPtr, CDMReader, getData, varName);
-    }
-    DataPtr getScaledData(const std::string& varName) override
-    {
-        PY_GIL_ACQUIRE;
-        PYBIND11_OVERLOAD(DataPtr, CDMReader, getScaledData, varName);
-    }
+    DataPtr getData(const std::string& varName) override { PY_OVERLOAD_OR_BASE("getData", getData, varName); }
+    DataPtr getScaledData(const std::string& varName) override { PY_OVERLOAD_OR_BASE("getScaledData", getScaledData, varName); }
     DataPtr getScaledDataInUnit(const std::string& varName, const std::string& unit) override
     {
-        PY_GIL_ACQUIRE;
-        PYBIND11_OVERLOAD(DataPtr, CDMReader, getScaledDataInUnit, varName, unit);
+        PY_OVERLOAD_OR_BASE("getScaledDataInUnit", getScaledDataInUnit, varName, unit);
     }
 
     DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos) override
@@ -163,29 +263,21 @@ public:
     }
     DataPtr getScaledDataSlice(const std::string& varName, size_t unLimDimPos) override
     {
-        PY_GIL_ACQUIRE;
-        PYBIND11_OVERLOAD(DataPtr, CDMReader, getScaledDataSlice, varName, unLimDimPos);
+        PY_OVERLOAD_OR_BASE("getScaledDataSlice", getScaledDataSlice, varName, unLimDimPos);
     }
     DataPtr getScaledDataSliceInUnit(const std::string& varName, const std::string& unit, size_t unLimDimPos) override
     {
-        PY_GIL_ACQUIRE;
-        PYBIND11_OVERLOAD(DataPtr, CDMReader, getScaledDataSliceInUnit, varName, unit, unLimDimPos);
+        PY_OVERLOAD_OR_BASE("getScaledDataSliceInUnit", getScaledDataSliceInUnit, varName, unit, unLimDimPos);
     }
 
-    DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override
-    {
-        PY_GIL_ACQUIRE;
-        PYBIND11_OVERLOAD_NAME(DataPtr, CDMReader, "getDataSliceSB", getDataSlice, varName, sb);
-    }
+    DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override { PY_OVERLOAD_OR_BASE("getDataSliceSB", getDataSlice, varName, sb); }
     DataPtr getScaledDataSlice(const std::string& varName, const SliceBuilder& sb) override
     {
-        PY_GIL_ACQUIRE;
-        PYBIND11_OVERLOAD_NAME(DataPtr, CDMReader, "getScaledDataSliceSB", getScaledDataSlice, varName, sb);
+        PY_OVERLOAD_OR_BASE("getScaledDataSliceSB", getScaledDataSlice, varName, sb);
     }
     DataPtr getScaledDataSliceInUnit(const std::string& varName, const std::string& unit, const SliceBuilder& sb) override
     {
-        PY_GIL_ACQUIRE;
-        PYBIND11_OVERLOAD_NAME(DataPtr, CDMReader, "getScaledDataSliceInUnitSB", getScaledDataSliceInUnit, varName, unit, sb);
+        PY_OVERLOAD_OR_BASE("getScaledDataSliceInUnitSB", getScaledDataSliceInUnit, varName, unit, sb);
     }
 };
 
@@ -205,6 +297,14 @@ void pyfimex0_CDMReader(py::module m)
         .def("getDimensionStartPositions", SliceBuilder__getDimensionStartPositions)
         .def("getDimensionSizes", SliceBuilder__getDimensionSizes);
 
+    py::class_<DataSliceFuture>(m, "DataSliceFuture")
+        .def("get", &DataSliceFuture::get)
+        .def("ready", &DataSliceFuture::ready);
+
+    py::class_<DataSliceIterator>(m, "DataSliceIterator")
+        .def("__iter__", [](DataSliceIterator& it) -> DataSliceIterator& { return it; }, py::return_value_policy::reference_internal)
+        .def("__next__", &DataSliceIterator::next);
+
     py::class_<CDMReader, PyCDMReader, CDMReader_p>(m, "CDMReader")
         .def(py::init<>())
         .def("getData", CDMReader__getData)
@@ -216,6 +316,10 @@ void pyfimex0_CDMReader(py::module m)
         .def("getDataSliceSB", CDMReader__getDataSliceSB)
         .def("getScaledDataSliceSB", CDMReader__getScaledDataSliceSB)
         .def("getScaledDataSliceInUnitSB", CDMReader__getScaledDataSliceInUnitSB)
+        .def("getDataSliceAsync", CDMReader__getDataSliceAsyncUL)
+        .def("getDataSliceSBAsync", CDMReader__getDataSliceAsyncSB)
+        .def("iterDataSlices", CDMReader__iterDataSlices3)
+        .def("iterDataSlices", CDMReader__iterDataSlices2)
         .def("getCDM", &CDMReader::getCDM, py::return_value_policy::reference_internal)
         .def("getInternalCDM", &CDMReader::getInternalCDM, py::return_value_policy::reference_internal)
         .def("setInternalCDM", &CDMReader::setInternalCDM);
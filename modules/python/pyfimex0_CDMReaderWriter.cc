@@ -39,12 +39,14 @@ namespace {
 // wrapper for overload
 void CDMReaderWriter__putDataSlice2(CDMReaderWriter_p reader, const std::string& varName, size_t unLimDimPos, const DataPtr data)
 {
+    py::gil_scoped_release release;
     reader->putDataSlice(varName, unLimDimPos, data);
 }
 
 // wrapper for overload
 void CDMReaderWriter__putScaledDataSlice2(CDMReaderWriter_p reader, const std::string& varName, size_t unLimDimPos, const DataPtr data)
 {
+    py::gil_scoped_release release;
     reader->putScaledDataSlice(varName, unLimDimPos, data);
 }
 
@@ -52,6 +54,7 @@ void CDMReaderWriter__putScaledDataSlice2(CDMReaderWriter_p reader, const std::s
 void CDMReaderWriter__putScaledDataSliceInUnit2(CDMReaderWriter_p rw, const std::string& varName, const std::string& unit, size_t unLimDimPos,
                                                 const DataPtr data)
 {
+    py::gil_scoped_release release;
     rw->putScaledDataSliceInUnit(varName, unit, unLimDimPos, data);
 }
 
@@ -43,6 +43,8 @@ void createNetCDFWriter_4(CDMReader_p reader, const std::string& filename, const
         throw CDMException("pyfimex createNetCDFWriter only supports version 3 or 4");
 
     const std::string filetype = (version == 4) ? "nc4" : "netcdf";
+    // python readers are called from the writer, maybe from other threads
+    py::gil_scoped_release release;
     createWriter(reader, filetype, filename, configfile);
 }
 
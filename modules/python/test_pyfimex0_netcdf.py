@@ -88,5 +88,18 @@ class TestNetcdfReader(unittest.TestCase):
 
         self.assertEqual(['x', 'y', 'ensemble_member', 'height7', 'time'], v_xwind10m.getShape())
 
+    def test_DataSliceAsync(self):
+        test_ncfile = os.path.join(test_srcdir, 'testdata_vertical_ensemble_in.nc')
+        r = pyfimex0.createFileReader('netcdf', test_ncfile)
+
+        f = r.getDataSliceAsync('upward_air_velocity_ml', 0)
+        self.assertEqual(f.get().values()[0], 305)
+
+        n_time = r.getCDM().getDimension('time').getLength()
+        slices = [d.values() for d in r.iterDataSlices('upward_air_velocity_ml', 3)]
+        self.assertEqual(n_time, len(slices))
+        for t in range(n_time):
+            numpy.testing.assert_array_equal(r.getDataSlice('upward_air_velocity_ml', t).values(), slices[t])
+
 if __name__ == '__main__':
     unittest.main()
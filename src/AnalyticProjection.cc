@@ -0,0 +1,924 @@
+/*
+ * Fimex, AnalyticProjection.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "AnalyticProjection.h"
+
+#include "ScaleKernels.h"
+
+#include "fimex/StringUtils.h"
+#include "fimex/mifi_constants.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FIMEX_PROJ_X86 1
+#define FIMEX_PROJ_INLINE inline __attribute__((always_inline))
+#define FIMEX_PROJ_TARGET(isa) __attribute__((target(isa)))
+#else
+#define FIMEX_PROJ_INLINE inline
+#endif
+
+namespace MetNoFimex {
+namespace reproject {
+
+namespace {
+
+const double PI = MIFI_PI;
+const double PI_2 = MIFI_PI / 2;
+const double PI_4 = MIFI_PI / 4;
+const double DEG_TO_RAD = MIFI_PI / 180;
+const double RAD_TO_DEG = 180 / MIFI_PI;
+
+// tolerances of proj
+const double EPS10 = 1e-10;
+const double LAT_EPS = 1e-12;    // latitude over-range of the input
+const double MAX_LAM = 10;       // longitude over-range of the input, radians
+const double STERE_TOL = 1e-8;   // opposite pole of the spherical polar stereographic
+const double ATAN2_TOL = 1e-50;  // aatan2 returns 0 for smaller arguments
+
+bool enabledFromEnvironment()
+{
+    const char* env = getenv("FIMEX_ANALYTIC_TRANSFORMS");
+    return env && std::string(env) == "1";
+}
+
+std::atomic<bool>& enabledFlag()
+{
+    static std::atomic<bool> enabled(enabledFromEnvironment());
+    return enabled;
+}
+
+// ---------------------------------------------------------------------------
+// Elementary functions, written branch-free and inlined such that the loops of
+// the kernels below are vectorized. The libm functions are calls which stop the
+// vectorizer. Polynomials from fdlibm (sin, cos) and cephes (atan, log, exp),
+// accurate to a few ulp in the ranges used here.
+
+// 1.5 * 2^52: adding and subtracting it rounds to the nearest integer, for |x| < 2^51
+const double ROUND_MAGIC = 6755399441055744.0;
+
+FIMEX_PROJ_INLINE std::uint64_t asBits(double d)
+{
+    std::uint64_t u;
+    std::memcpy(&u, &d, sizeof(u));
+    return u;
+}
+
+FIMEX_PROJ_INLINE double fromBits(std::uint64_t u)
+{
+    double d;
+    std::memcpy(&d, &u, sizeof(d));
+    return d;
+}
+
+/** sin and cos, reduced to [-pi/4, pi/4] with a 3-part pi/2 */
+FIMEX_PROJ_INLINE void vsincos(double x, double& s, double& c)
+{
+    const double PIO2_1 = 1.57079632673412561417e+00, PIO2_2 = 6.07710050630396597660e-11, PIO2_3 = 2.02226624871116645580e-21;
+    const double S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03, S3 = -1.98412698298579493134e-04, S4 = 2.75573137070700676789e-06,
+                 S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+    const double C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03, C3 = 2.48015872894767294178e-05, C4 = -2.75573143513906633035e-07,
+                 C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+
+    const double t = x * (2 / PI) + ROUND_MAGIC;
+    const double q = t - ROUND_MAGIC;
+    const std::uint64_t quadrant = asBits(t); // the lowest bits are q modulo 4
+    const double r = ((x - q * PIO2_1) - q * PIO2_2) - q * PIO2_3;
+    const double z = r * r;
+    const double sr = r + r * z * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+    const double cr = 1 - 0.5 * z + z * z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+    const bool swap = (quadrant & 1) != 0;
+    const double sv = swap ? cr : sr;
+    const double cv = swap ? sr : cr;
+    s = (quadrant & 2) ? -sv : sv;
+    c = ((quadrant + 1) & 2) ? -cv : cv;
+}
+
+FIMEX_PROJ_INLINE double vatan(double x)
+{
+    const double P0 = -8.750608600031904122785e-01, P1 = -1.615753718733365076637e+01, P2 = -7.500855792314704667340e+01,
+                 P3 = -1.228866684490136173410e+02, P4 = -6.485021904942025371773e+01;
+    const double Q0 = 2.485846490142306297962e+01, Q1 = 1.650270098316988542046e+02, Q2 = 4.328810604912902668951e+02, Q3 = 4.853903996359136964868e+02,
+                 Q4 = 1.945506571482613964425e+02;
+    const double T3P8 = 2.41421356237309504880; // tan(3 pi/8)
+    const double MOREBITS = 6.123233995736765886130e-17;
+
+    const double ax = std::fabs(x);
+    const bool big = ax > T3P8;
+    const bool mid = ax > 0.66;
+    const double xr = big ? -1 / ax : (mid ? (ax - 1) / (ax + 1) : ax);
+    const double y0 = big ? PI_2 : (mid ? PI_4 : 0.);
+    const double more = big ? MOREBITS : (mid ? 0.5 * MOREBITS : 0.);
+    const double z = xr * xr;
+    const double p = (((P0 * z + P1) * z + P2) * z + P3) * z + P4;
+    const double q = ((((z + Q0) * z + Q1) * z + Q2) * z + Q3) * z + Q4;
+    const double r = y0 + ((xr * z * p / q + xr) + more);
+    return std::copysign(r, x);
+}
+
+/** atan2 like proj's aatan2, 0 for tiny arguments */
+FIMEX_PROJ_INLINE double vatan2(double y, double x)
+{
+    const double a = vatan(y / x);
+    double r = (x < 0) ? a + std::copysign(PI, y) : a;
+    r = (x == 0) ? std::copysign(PI_2, y) : r;
+    // one comparison on the sum, gcc does not vectorize the combination of two
+    return (std::fabs(x) + std::fabs(y) < ATAN2_TOL) ? 0. : r;
+}
+
+/** asin like proj's aasin, clamped to +-pi/2 */
+FIMEX_PROJ_INLINE double vasin(double x)
+{
+    const double c = (x > 1) ? 1. : ((x < -1) ? -1. : x);
+    return vatan2(c, std::sqrt((1 - c) * (1 + c)));
+}
+
+FIMEX_PROJ_INLINE double vlog(double x)
+{
+    const double P0 = 1.01875663804580931796e-04, P1 = 4.97494994976747001425e-01, P2 = 4.70579119878881725854e+00, P3 = 1.44989225341610930846e+01,
+                 P4 = 1.79368678507819816313e+01, P5 = 7.70838733755885391666e+00;
+    const double Q0 = 1.12873587189167450590e+01, Q1 = 4.52279145837532221105e+01, Q2 = 8.29875266912776603211e+01, Q3 = 7.11544750618563894466e+01,
+                 Q4 = 2.31251620126765340583e+01;
+    const double SQRTH = 0.70710678118654752440;
+
+    // x = m * 2^e with m in [0.5, 1), the exponent converted to double through the bits of 2^52 + exponent
+    const std::uint64_t bits = asBits(x);
+    double e = fromBits(((bits >> 52) & 0x7ff) | 0x4330000000000000ULL) - (4503599627370496.0 + 1022);
+    const double m = fromBits((bits & 0x000fffffffffffffULL) | 0x3fe0000000000000ULL);
+    const bool small = m < SQRTH;
+    e = small ? e - 1 : e;
+    const double f = small ? m + m - 1 : m - 1;
+    const double z = f * f;
+    const double p = ((((P0 * f + P1) * f + P2) * f + P3) * f + P4) * f + P5;
+    const double q = ((((f + Q0) * f + Q1) * f + Q2) * f + Q3) * f + Q4;
+    double y = f * (z * p / q);
+    y = y - e * 2.121944400546905827679e-4;
+    y = y - 0.5 * z;
+    double r = (f + y) + e * 0.693359375;
+    r = (x == 0) ? -HUGE_VAL : r;
+    r = (x == HUGE_VAL) ? x : r;
+    return ((x < 0) | (x != x)) ? std::numeric_limits<double>::quiet_NaN() : r;
+}
+
+FIMEX_PROJ_INLINE double vexp(double x)
+{
+    const double P0 = 1.26177193074810590878e-04, P1 = 3.02994407707441961300e-02, P2 = 9.99999999999999999910e-01;
+    const double Q0 = 3.00198505138664455042e-06, Q1 = 2.52448340349684104192e-03, Q2 = 2.27265548208155028766e-01, Q3 = 2.00000000000000000009e+00;
+    const double LOG2E = 1.4426950408889634073599;
+    const double C1 = 6.93145751953125e-01, C2 = 1.42860682030941723212e-06;
+    const double MAXLOG = 7.09782712893383996843e2, MINLOG = -7.08396418532264106224e2;
+
+    const double px = (x * LOG2E + ROUND_MAGIC) - ROUND_MAGIC;
+    double r = (x - px * C1) - px * C2;
+    const double rr = r * r;
+    const double pp = r * ((P0 * rr + P1) * rr + P2);
+    const double qq = ((Q0 * rr + Q1) * rr + Q2) * rr + Q3;
+    r = 1 + 2 * (pp / (qq - pp));
+    // 2^px from the bits of 2^52 + 1023 + px
+    const double k = (px < -1022) ? -1022. : ((px > 1023) ? 1023. : px);
+    r *= fromBits(asBits(k + (4503599627370496.0 + 1023)) << 52);
+    r = (x > MAXLOG) ? HUGE_VAL : r;
+    return (x < MINLOG) ? 0. : r;
+}
+
+/** proj's adjlon, longitude to [-pi, pi] */
+FIMEX_PROJ_INLINE double adjlon(double lam)
+{
+    const double l = lam + PI;
+    const double adjusted = l - 2 * PI * std::floor(l / (2 * PI)) - PI;
+    return (std::fabs(lam) < PI + 1e-12) ? lam : adjusted;
+}
+
+// ---------------------------------------------------------------------------
+// Projections
+
+enum CrsKind { CRS_LATLONG, CRS_STERE, CRS_LCC, CRS_OB_TRAN };
+
+/** parameters of a crs, and the constants derived from them like in proj */
+struct CrsParams
+{
+    CrsKind kind;
+
+    // earth
+    bool hasEarth;
+    double a, es, e;
+    bool hasTowgs84;
+    std::vector<double> towgs84; //!< 7 values
+
+    double lam0, x0, y0, k0;
+    double phi2Coeff[4]; //!< conformal to geodetic latitude series
+
+    // stere
+    double akm1;
+    bool south;
+
+    // lcc
+    double n, c, rho0;
+
+    // ob_tran
+    double sphip, cphip, lamp;
+};
+
+/** proj's pj_tsfn */
+double tsfn(double phi, double sinphi, double e)
+{
+    const double es = e * sinphi;
+    return std::tan(0.5 * (PI_2 - phi)) / std::pow((1 - es) / (1 + es), 0.5 * e);
+}
+
+/** proj's pj_msfn */
+double msfn(double sinphi, double cosphi, double es)
+{
+    return cosphi / std::sqrt(1 - es * sinphi * sinphi);
+}
+
+/**
+ * Geodetic from conformal latitude chi, series in sin(2 k chi) up to e^8
+ * (Snyder, Map Projections - A Working Manual, 3-5), summed with Clenshaw.
+ * The truncation error is below 1e-11 radian on earth ellipsoids.
+ */
+FIMEX_PROJ_INLINE double conformalToGeodetic(double chi, double b0, double b1, double b2, double b3)
+{
+    double s2, c2;
+    vsincos(2 * chi, s2, c2);
+    const double t = 2 * c2;
+    const double u4 = b3;
+    const double u3 = b2 + t * u4;
+    const double u2 = b1 + t * u3 - u4;
+    const double u1 = b0 + t * u2 - u3;
+    return chi + u1 * s2;
+}
+
+/** log of pj_tsfn, log(tan(pi/4 - phi/2) * ((1 + e sin(phi)) / (1 - e sin(phi)))^(e/2)) */
+template <bool ELLIPSOID>
+FIMEX_PROJ_INLINE double logTsfn(double phi, double e)
+{
+    double sh, ch;
+    vsincos(PI_4 - 0.5 * phi, sh, ch);
+    double lts = vlog(sh / ch);
+    if (ELLIPSOID) {
+        double sinphi, cosphi;
+        vsincos(phi, sinphi, cosphi);
+        const double es = e * sinphi;
+        lts -= 0.5 * e * vlog((1 - es) / (1 + es));
+    }
+    return lts;
+}
+
+/** common members of the projected kernels */
+struct ProjectedOp
+{
+    explicit ProjectedOp(const CrsParams& p)
+        : lam0(p.lam0)
+        , e(p.e)
+        , a(p.a)
+        , ra(1 / p.a)
+        , x0(p.x0)
+        , y0(p.y0)
+        , b0(p.phi2Coeff[0])
+        , b1(p.phi2Coeff[1])
+        , b2(p.phi2Coeff[2])
+        , b3(p.phi2Coeff[3])
+    {
+    }
+    double lam0, e, a, ra, x0, y0;
+    double b0, b1, b2, b3; // conformal to geodetic latitude series
+};
+
+/** polar stereographic, lon/lat in degree to x/y */
+template <bool ELLIPSOID>
+struct StereFwd : ProjectedOp
+{
+    explicit StereFwd(const CrsParams& p)
+        : ProjectedOp(p)
+        , akm1(p.akm1)
+        , sgn(p.south ? -1. : 1.)
+    {
+    }
+    FIMEX_PROJ_INLINE void operator()(double& x, double& y) const
+    {
+        const double lonRad = x * DEG_TO_RAD;
+        const double phi = sgn * y * DEG_TO_RAD; // as on the northern hemisphere
+        const bool invalid = (std::fabs(phi) - PI_2 > LAT_EPS) | (std::fabs(lonRad) > MAX_LAM);
+        double sinlam, coslam;
+        vsincos(adjlon(lonRad - lam0), sinlam, coslam);
+        const double rho = akm1 * vexp(logTsfn<ELLIPSOID>(phi, e));
+        // the spherical formula fails at the opposite pole, the ellipsoidal gets huge
+        const bool bad = invalid | (!ELLIPSOID & (std::fabs(phi + PI_2) < STERE_TOL));
+        const double px = a * (rho * sinlam) + x0;
+        const double py = a * (-sgn * rho * coslam) + y0;
+        x = bad ? HUGE_VAL : px;
+        y = bad ? HUGE_VAL : py;
+    }
+    double akm1, sgn;
+};
+
+/** polar stereographic, x/y to lon/lat in degree */
+template <bool ELLIPSOID>
+struct StereInv : ProjectedOp
+{
+    explicit StereInv(const CrsParams& p)
+        : ProjectedOp(p)
+        , rakm1(1 / p.akm1)
+        , sgn(p.south ? -1. : 1.)
+    {
+    }
+    FIMEX_PROJ_INLINE void operator()(double& x, double& y) const
+    {
+        const bool bad = (x == HUGE_VAL) | (y == HUGE_VAL);
+        const double px = (x - x0) * ra;
+        const double py = -sgn * (y - y0) * ra;
+        const double rho = std::sqrt(px * px + py * py);
+        const double chi = PI_2 - 2 * vatan(rho * rakm1);
+        const double phi = ELLIPSOID ? conformalToGeodetic(chi, b0, b1, b2, b3) : chi;
+        const double lam = ((px == 0) & (py == 0)) ? 0. : vatan2(px, py);
+        const double lon = RAD_TO_DEG * adjlon(lam + lam0);
+        const double lat = RAD_TO_DEG * sgn * phi;
+        x = bad ? HUGE_VAL : lon;
+        y = bad ? HUGE_VAL : lat;
+    }
+    double rakm1, sgn;
+};
+
+/** lambert conformal conic, lon/lat in degree to x/y */
+template <bool ELLIPSOID>
+struct LccFwd : ProjectedOp
+{
+    explicit LccFwd(const CrsParams& p)
+        : ProjectedOp(p)
+        , n(p.n)
+        , ck0(p.c * p.k0)
+        , rho0k0(p.rho0 * p.k0)
+    {
+    }
+    FIMEX_PROJ_INLINE void operator()(double& x, double& y) const
+    {
+        const double lonRad = x * DEG_TO_RAD;
+        const double phi = y * DEG_TO_RAD;
+        const bool invalid = (std::fabs(phi) - PI_2 > LAT_EPS) | (std::fabs(lonRad) > MAX_LAM);
+        const bool atPole = std::fabs(std::fabs(phi) - PI_2) < EPS10;
+        const bool bad = invalid | (atPole & (phi * n <= 0));
+        const double rho = atPole ? 0. : ck0 * vexp(n * logTsfn<ELLIPSOID>(phi, e));
+        double sinlam, coslam;
+        vsincos(n * adjlon(lonRad - lam0), sinlam, coslam);
+        const double px = a * (rho * sinlam) + x0;
+        const double py = a * (rho0k0 - rho * coslam) + y0;
+        x = bad ? HUGE_VAL : px;
+        y = bad ? HUGE_VAL : py;
+    }
+    double n, ck0, rho0k0;
+};
+
+/** lambert conformal conic, x/y to lon/lat in degree */
+template <bool ELLIPSOID>
+struct LccInv : ProjectedOp
+{
+    explicit LccInv(const CrsParams& p)
+        : ProjectedOp(p)
+        , n(p.n)
+        , rn(1 / p.n)
+        , rc(1 / p.c)
+        , rho0(p.rho0)
+        , rk0(1 / p.k0)
+        , nsgn(p.n < 0 ? -1. : 1.)
+    {
+    }
+    FIMEX_PROJ_INLINE void operator()(double& x, double& y) const
+    {
+        const bool bad = (x == HUGE_VAL) | (y == HUGE_VAL);
+        const double px = nsgn * (x - x0) * ra * rk0;
+        const double py = nsgn * (rho0 - (y - y0) * ra * rk0);
+        const double rho = nsgn * std::sqrt(px * px + py * py);
+        const double chi = PI_2 - 2 * vatan(vexp(rn * vlog(rho * rc)));
+        double phi = ELLIPSOID ? conformalToGeodetic(chi, b0, b1, b2, b3) : chi;
+        double lam = vatan2(px, py) * rn;
+        const bool atPole = (rho == 0);
+        phi = atPole ? nsgn * PI_2 : phi;
+        lam = atPole ? 0. : lam;
+        const double lon = RAD_TO_DEG * adjlon(lam + lam0);
+        const double lat = RAD_TO_DEG * phi;
+        x = bad ? HUGE_VAL : lon;
+        y = bad ? HUGE_VAL : lat;
+    }
+    double n, rn, rc, rho0, rk0, nsgn;
+};
+
+/** rotated pole, lon/lat in degree to rotated lon/lat in degree */
+struct ObTranFwd
+{
+    explicit ObTranFwd(const CrsParams& p)
+        : lam0(p.lam0)
+        , lamp(p.lamp)
+        , sphip(p.sphip)
+        , cphip(p.cphip)
+    {
+    }
+    FIMEX_PROJ_INLINE void operator()(double& x, double& y) const
+    {
+        const double lonRad = x * DEG_TO_RAD;
+        const double phi = y * DEG_TO_RAD;
+        const bool invalid = (std::fabs(phi) - PI_2 > LAT_EPS) | (std::fabs(lonRad) > MAX_LAM);
+        double sinlam, coslam, sinphi, cosphi;
+        vsincos(adjlon(lonRad - lam0), sinlam, coslam);
+        vsincos(phi, sinphi, cosphi);
+        const double rlam = adjlon(vatan2(cosphi * sinlam, sphip * cosphi * coslam + cphip * sinphi) + lamp);
+        const double rphi = vasin(sphip * sinphi - cphip * cosphi * coslam);
+        x = invalid ? HUGE_VAL : RAD_TO_DEG * rlam;
+        y = invalid ? HUGE_VAL : RAD_TO_DEG * rphi;
+    }
+    double lam0, lamp, sphip, cphip;
+};
+
+/** rotated pole, rotated lon/lat in degree to lon/lat in degree */
+struct ObTranInv
+{
+    explicit ObTranInv(const CrsParams& p)
+        : lam0(p.lam0)
+        , lamp(p.lamp)
+        , sphip(p.sphip)
+        , cphip(p.cphip)
+    {
+    }
+    FIMEX_PROJ_INLINE void operator()(double& x, double& y) const
+    {
+        const bool bad = (x == HUGE_VAL) | (y == HUGE_VAL);
+        double sinlam, coslam, sinphi, cosphi;
+        vsincos(x * DEG_TO_RAD - lamp, sinlam, coslam);
+        vsincos(y * DEG_TO_RAD, sinphi, cosphi);
+        const double phi = vasin(sphip * sinphi + cphip * cosphi * coslam);
+        const double lam = vatan2(cosphi * sinlam, sphip * cosphi * coslam - cphip * sinphi);
+        const double lon = RAD_TO_DEG * adjlon(lam + lam0);
+        const double lat = RAD_TO_DEG * phi;
+        x = bad ? HUGE_VAL : lon;
+        y = bad ? HUGE_VAL : lat;
+    }
+    double lam0, lamp, sphip, cphip;
+};
+
+// ---------------------------------------------------------------------------
+// Kernels, compiled for several instruction sets like the scale kernels
+
+template <class Op>
+FIMEX_PROJ_INLINE void applyLoop(const Op op, double* __restrict x, double* __restrict y, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        double xi = x[i], yi = y[i];
+        op(xi, yi);
+        x[i] = xi;
+        y[i] = yi;
+    }
+}
+
+template <class Op>
+void applyDefault(const Op& op, double* x, double* y, size_t n)
+{
+    applyLoop(op, x, y, n);
+}
+
+#ifdef FIMEX_PROJ_X86
+template <class Op>
+FIMEX_PROJ_TARGET("sse4.2")
+void applySSE4(const Op& op, double* x, double* y, size_t n)
+{
+    applyLoop(op, x, y, n);
+}
+
+template <class Op>
+FIMEX_PROJ_TARGET("avx2,fma")
+void applyAVX2(const Op& op, double* x, double* y, size_t n)
+{
+    applyLoop(op, x, y, n);
+}
+
+template <class Op>
+FIMEX_PROJ_TARGET("avx512f,avx512bw,avx512vl,avx512dq")
+void applyAVX512(const Op& op, double* x, double* y, size_t n)
+{
+    applyLoop(op, x, y, n);
+}
+#endif // FIMEX_PROJ_X86
+
+template <class Op>
+void apply(const Op& op, double* x, double* y, size_t n)
+{
+    switch (getScaleKernelIsa()) {
+#ifdef FIMEX_PROJ_X86
+    case SCALE_ISA_AVX512:
+        applyAVX512(op, x, y, n);
+        break;
+    case SCALE_ISA_AVX2:
+        applyAVX2(op, x, y, n);
+        break;
+    case SCALE_ISA_SSE4:
+        applySSE4(op, x, y, n);
+        break;
+#endif
+    default:
+        applyDefault(op, x, y, n);
+        break;
+    }
+}
+
+/** lon/lat in degree to the coordinates of p */
+void fromLonLat(const CrsParams& p, size_t n, double* x, double* y)
+{
+    const bool ellipsoid = (p.es != 0);
+    switch (p.kind) {
+    case CRS_STERE:
+        if (ellipsoid)
+            apply(StereFwd<true>(p), x, y, n);
+        else
+            apply(StereFwd<false>(p), x, y, n);
+        break;
+    case CRS_LCC:
+        if (ellipsoid)
+            apply(LccFwd<true>(p), x, y, n);
+        else
+            apply(LccFwd<false>(p), x, y, n);
+        break;
+    case CRS_OB_TRAN:
+        apply(ObTranFwd(p), x, y, n);
+        break;
+    case CRS_LATLONG:
+        break;
+    }
+}
+
+/** coordinates of p to lon/lat in degree */
+void toLonLat(const CrsParams& p, size_t n, double* x, double* y)
+{
+    const bool ellipsoid = (p.es != 0);
+    switch (p.kind) {
+    case CRS_STERE:
+        if (ellipsoid)
+            apply(StereInv<true>(p), x, y, n);
+        else
+            apply(StereInv<false>(p), x, y, n);
+        break;
+    case CRS_LCC:
+        if (ellipsoid)
+            apply(LccInv<true>(p), x, y, n);
+        else
+            apply(LccInv<false>(p), x, y, n);
+        break;
+    case CRS_OB_TRAN:
+        apply(ObTranInv(p), x, y, n);
+        break;
+    case CRS_LATLONG:
+        break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Parsing of proj-strings
+
+typedef std::map<std::string, std::string> ProjParams;
+
+bool toDouble(const std::string& s, double& v)
+{
+    std::istringstream in(s);
+    in.imbue(std::locale::classic());
+    in >> v;
+    return !in.fail() && in.eof() && std::isfinite(v);
+}
+
+bool getDouble(const ProjParams& params, const std::string& key, double& v)
+{
+    ProjParams::const_iterator it = params.find(key);
+    return (it != params.end()) && toDouble(it->second, v);
+}
+
+/** @return false if params contains other keys than the allowed ones */
+bool onlyKeys(const ProjParams& params, const char* const* allowed)
+{
+    for (const auto& kv : params) {
+        bool found = false;
+        for (const char* const* k = allowed; *k && !found; ++k)
+            found = (kv.first == *k);
+        if (!found)
+            return false;
+    }
+    return true;
+}
+
+bool parseEarth(const ProjParams& params, CrsParams& p)
+{
+    p.hasEarth = false;
+    p.a = 0;
+    p.es = 0;
+    double rf = 0;
+
+    ProjParams::const_iterator it = params.find("datum");
+    if (it != params.end()) {
+        if (it->second != "WGS84")
+            return false;
+        p.hasEarth = true;
+        p.a = 6378137;
+        rf = 298.257223563;
+        if (params.find("towgs84") == params.end()) {
+            p.hasTowgs84 = true;
+            p.towgs84.assign(7, 0.);
+        }
+    }
+    it = params.find("ellps");
+    if (it != params.end()) {
+        p.hasEarth = true;
+        rf = 0;
+        if (it->second == "WGS84") {
+            p.a = 6378137;
+            rf = 298.257223563;
+        } else if (it->second == "GRS80") {
+            p.a = 6378137;
+            rf = 298.257222101;
+        } else if (it->second == "sphere") {
+            p.a = 6370997;
+        } else {
+            return false;
+        }
+    }
+    if (rf != 0)
+        p.es = (2 - 1 / rf) / rf;
+
+    double v;
+    if (params.count("a")) {
+        if (!getDouble(params, "a", p.a))
+            return false;
+        if (getDouble(params, "es", v)) {
+            p.es = v;
+        } else if (getDouble(params, "e", v)) {
+            p.es = v * v;
+        } else if (getDouble(params, "rf", v)) {
+            p.es = (2 - 1 / v) / v;
+        } else if (getDouble(params, "f", v)) {
+            p.es = v * (2 - v);
+        } else if (getDouble(params, "b", v)) {
+            p.es = 1 - (v * v) / (p.a * p.a);
+        } else if (!p.hasEarth) {
+            return false; // the shape is not obvious
+        }
+        p.hasEarth = true;
+    } else if (params.count("es") || params.count("e") || params.count("rf") || params.count("f") || params.count("b")) {
+        return false;
+    }
+    if (params.count("R")) {
+        if (!getDouble(params, "R", p.a))
+            return false;
+        p.es = 0;
+        p.hasEarth = true;
+    }
+    if (p.hasEarth && !(p.a > 0 && p.es >= 0 && p.es < 1))
+        return false;
+    p.e = std::sqrt(p.es);
+
+    it = params.find("towgs84");
+    if (it != params.end()) {
+        const std::vector<std::string> values = tokenize(it->second, ",");
+        if (values.size() != 3 && values.size() != 7)
+            return false;
+        p.hasTowgs84 = true;
+        p.towgs84.assign(7, 0.);
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (!toDouble(values[i], p.towgs84[i]))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool parseCrs(const std::string& proj4, CrsParams& p)
+{
+    ProjParams params;
+    for (const std::string& token : tokenize(proj4, " \t\n\r")) {
+        if (token.size() < 2 || token[0] != '+')
+            return false;
+        const size_t eq = token.find('=');
+        const std::string key = token.substr(1, eq == std::string::npos ? std::string::npos : eq - 1);
+        const std::string value = (eq == std::string::npos) ? std::string() : token.substr(eq + 1);
+        if (!params.insert(std::make_pair(key, value)).second)
+            return false;
+    }
+    // no defaults are read for these projections, and the type does not change the crs
+    params.erase("no_defs");
+    params.erase("type");
+
+    p = CrsParams();
+    p.hasTowgs84 = false;
+    p.k0 = 1;
+    if (!parseEarth(params, p))
+        return false;
+    if (!p.hasEarth) {
+        // latlong and ob_tran do not depend on the earth
+        p.a = 1;
+        p.es = p.e = 0;
+    }
+
+    const double es = p.es;
+    const double es2 = es * es, es3 = es2 * es, es4 = es3 * es;
+    p.phi2Coeff[0] = es / 2 + 5 * es2 / 24 + es3 / 12 + 13 * es4 / 360;
+    p.phi2Coeff[1] = 7 * es2 / 48 + 29 * es3 / 240 + 811 * es4 / 11520;
+    p.phi2Coeff[2] = 7 * es3 / 120 + 81 * es4 / 1120;
+    p.phi2Coeff[3] = 4279 * es4 / 161280;
+
+    double v;
+    const std::string proj = params["proj"];
+    const std::string units = params.count("units") ? params["units"] : "m";
+    if (units != "m")
+        return false;
+    if (params.count("lon_0")) {
+        if (!getDouble(params, "lon_0", v))
+            return false;
+        p.lam0 = v * DEG_TO_RAD;
+    }
+    if ((params.count("x_0") && !getDouble(params, "x_0", p.x0)) || (params.count("y_0") && !getDouble(params, "y_0", p.y0)))
+        return false;
+    const char* k0Key = params.count("k_0") ? "k_0" : "k";
+    if (params.count(k0Key) && !(getDouble(params, k0Key, p.k0) && p.k0 > 0))
+        return false;
+
+    if (proj == "latlong" || proj == "longlat" || proj == "latlon" || proj == "lonlat") {
+        static const char* const allowed[] = {"proj", "a", "b", "e", "es", "f", "rf", "R", "ellps", "datum", "towgs84", 0};
+        p.kind = CRS_LATLONG;
+        return onlyKeys(params, allowed);
+    } else if (proj == "ob_tran") {
+        static const char* const allowed[] = {"proj", "o_proj", "o_lat_p", "o_lon_p", "lon_0", "a", "b", "e", "es", "f", "rf", "R", "ellps", "datum", "towgs84", 0};
+        const std::string oProj = params["o_proj"];
+        if (!(oProj == "latlong" || oProj == "longlat" || oProj == "latlon" || oProj == "lonlat"))
+            return false;
+        double phip = 0, lamp = 0;
+        if (!getDouble(params, "o_lat_p", phip) || (params.count("o_lon_p") && !getDouble(params, "o_lon_p", lamp)))
+            return false;
+        p.kind = CRS_OB_TRAN;
+        p.lamp = lamp * DEG_TO_RAD;
+        phip *= DEG_TO_RAD;
+        // proj switches to the transverse formulas, which are the same with phip = 0
+        p.sphip = (std::fabs(phip) > EPS10) ? std::sin(phip) : 0.;
+        p.cphip = (std::fabs(phip) > EPS10) ? std::cos(phip) : 1.;
+        return onlyKeys(params, allowed);
+    } else if (proj == "stere") {
+        static const char* const allowed[] = {"proj",  "lat_0", "lon_0", "lat_ts", "k",    "k_0",   "x_0",     "y_0",   "units", "a",
+                                              "b",     "e",     "es",    "f",      "rf",   "R",     "ellps",   "datum", "towgs84", 0};
+        double phi0;
+        if (!p.hasEarth || !getDouble(params, "lat_0", phi0) || std::fabs(std::fabs(phi0) - 90) > 1e-8)
+            return false;
+        p.kind = CRS_STERE;
+        p.south = (phi0 < 0);
+        double phits = PI_2;
+        if (params.count("lat_ts")) {
+            if (!getDouble(params, "lat_ts", phits))
+                return false;
+            // proj takes the pole from the sign of lat_ts (variant B), leave the odd case to proj
+            if ((phits < 0) != p.south)
+                return false;
+            phits = std::fabs(phits * DEG_TO_RAD);
+        }
+        if (std::fabs(phits - PI_2) < EPS10) {
+            p.akm1 = 2 * p.k0 / std::sqrt(std::pow(1 + p.e, 1 + p.e) * std::pow(1 - p.e, 1 - p.e));
+        } else {
+            const double sinphits = std::sin(phits);
+            const double t = p.e * sinphits;
+            p.akm1 = std::cos(phits) / tsfn(phits, sinphits, p.e) / std::sqrt(1 - t * t);
+        }
+        return onlyKeys(params, allowed);
+    } else if (proj == "lcc") {
+        static const char* const allowed[] = {"proj", "lat_0", "lat_1", "lat_2", "lon_0", "k",     "k_0",   "x_0",     "y_0", "units",
+                                              "a",    "b",     "e",     "es",    "f",     "rf",    "R",     "ellps",   "datum", "towgs84", 0};
+        double phi1, phi2, phi0 = 0;
+        if (!p.hasEarth || !getDouble(params, "lat_1", phi1))
+            return false;
+        if (params.count("lat_2")) {
+            if (!getDouble(params, "lat_2", phi2))
+                return false;
+        } else {
+            phi2 = phi1;
+            if (!params.count("lat_0"))
+                phi0 = phi1;
+        }
+        if (params.count("lat_0") && !getDouble(params, "lat_0", phi0))
+            return false;
+        phi0 *= DEG_TO_RAD;
+        phi1 *= DEG_TO_RAD;
+        phi2 *= DEG_TO_RAD;
+        if (std::fabs(phi1 + phi2) < EPS10)
+            return false;
+        p.kind = CRS_LCC;
+        const double sinphi1 = std::sin(phi1);
+        const double m1 = msfn(sinphi1, std::cos(phi1), p.es);
+        const double ml1 = tsfn(phi1, sinphi1, p.e);
+        p.n = sinphi1;
+        if (std::fabs(phi1 - phi2) >= EPS10) { // secant cone
+            const double sinphi2 = std::sin(phi2);
+            p.n = std::log(m1 / msfn(sinphi2, std::cos(phi2), p.es)) / std::log(ml1 / tsfn(phi2, sinphi2, p.e));
+        }
+        if (!(std::fabs(p.n) > EPS10))
+            return false;
+        p.c = m1 * std::pow(ml1, -p.n) / p.n;
+        p.rho0 = (std::fabs(std::fabs(phi0) - PI_2) < EPS10) ? 0. : p.c * std::pow(tsfn(phi0, std::sin(phi0), p.e), p.n);
+        return onlyKeys(params, allowed);
+    }
+    return false;
+}
+
+/**
+ * proj shifts the datum if both crs have towgs84 parameters, and otherwise
+ * uses the latitude/longitude values unchanged
+ */
+bool withoutDatumShift(const CrsParams& src, const CrsParams& dst)
+{
+    if (!(src.hasTowgs84 && dst.hasTowgs84))
+        return true;
+    return src.hasEarth && dst.hasEarth && src.a == dst.a && std::fabs(src.es - dst.es) < 1e-15 && src.towgs84 == dst.towgs84;
+}
+
+} // namespace
+
+struct AnalyticTransform::Crs : public CrsParams
+{
+    explicit Crs(const CrsParams& p)
+        : CrsParams(p)
+    {
+    }
+};
+
+std::unique_ptr<AnalyticTransform> AnalyticTransform::create(const std::string& proj_input, const std::string& proj_output)
+{
+    CrsParams src, dst;
+    if (!parseCrs(proj_input, src) || !parseCrs(proj_output, dst) || !withoutDatumShift(src, dst))
+        return std::unique_ptr<AnalyticTransform>();
+    return std::unique_ptr<AnalyticTransform>(new AnalyticTransform(std::unique_ptr<Crs>(new Crs(src)), std::unique_ptr<Crs>(new Crs(dst))));
+}
+
+AnalyticTransform::AnalyticTransform(std::unique_ptr<Crs> src, std::unique_ptr<Crs> dst)
+    : src_(std::move(src))
+    , dst_(std::move(dst))
+{
+}
+
+AnalyticTransform::~AnalyticTransform() {}
+
+bool AnalyticTransform::src_is_angular() const
+{
+    return src_->kind == CRS_LATLONG || src_->kind == CRS_OB_TRAN;
+}
+
+bool AnalyticTransform::dst_is_angular() const
+{
+    return dst_->kind == CRS_LATLONG || dst_->kind == CRS_OB_TRAN;
+}
+
+void AnalyticTransform::transform(const Crs& from, const Crs& to, size_t count, double* x, double* y) const
+{
+    toLonLat(from, count, x, y);
+    fromLonLat(to, count, x, y);
+}
+
+void AnalyticTransform::fwd(size_t count, double* x, double* y) const
+{
+    transform(*src_, *dst_, count, x, y);
+}
+
+void AnalyticTransform::inv(size_t count, double* x, double* y) const
+{
+    transform(*dst_, *src_, count, x, y);
+}
+
+bool analyticTransformsEnabled()
+{
+    return enabledFlag().load();
+}
+
+bool setAnalyticTransformsEnabled(bool enabled)
+{
+    return enabledFlag().exchange(enabled);
+}
+
+} // namespace reproject
+} // namespace MetNoFimex
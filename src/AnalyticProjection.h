@@ -0,0 +1,98 @@
+/*
+ * Fimex, AnalyticProjection.h
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef FIMEX_ANALYTICPROJECTION_H_
+#define FIMEX_ANALYTICPROJECTION_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace MetNoFimex {
+namespace reproject {
+
+/**
+ * This is a private header file, used by reproject.cc.
+ *
+ * Closed-form transformation between two crs given as proj-strings, for the
+ * projections written by RotatedLatitudeLongitudeProjection (ob_tran with
+ * o_proj=longlat), PolarStereographicProjection (stere with lat_0=+-90),
+ * LambertConformalConicProjection (lcc) and LatitudeLongitudeProjection
+ * (latlong), on a sphere or an ellipsoid.
+ *
+ * The formulas are those of proj, evaluated in branch-free loops with inlined
+ * elementary functions, such that the loops are vectorized for the instruction
+ * set selected for the scale kernels. Points proj cannot transform are set to
+ * HUGE_VAL like proj_trans_generic does.
+ *
+ * Only pairs not needing a datum shift are accepted. reproject uses these
+ * transformations only if enabled, and compares a fixed subset of the points of
+ * each call with proj; a crs pair differing from proj is left to proj from then on.
+ */
+class AnalyticTransform
+{
+public:
+    /**
+     * @return the transformation, or null if one of the proj-strings contains
+     * anything but the supported projections and parameters, or if a datum
+     * shift would be needed
+     */
+    static std::unique_ptr<AnalyticTransform> create(const std::string& proj_input, const std::string& proj_output);
+    ~AnalyticTransform();
+
+    /** true if the input coordinates are longitude/latitude or rotated longitude/latitude in degree */
+    bool src_is_angular() const;
+    /** true if the output coordinates are longitude/latitude or rotated longitude/latitude in degree */
+    bool dst_is_angular() const;
+
+    /** transform count points from proj_input to proj_output, in place */
+    void fwd(size_t count, double* x, double* y) const;
+    /** transform count points from proj_output to proj_input, in place */
+    void inv(size_t count, double* x, double* y) const;
+
+private:
+    struct Crs;
+    AnalyticTransform(std::unique_ptr<Crs> src, std::unique_ptr<Crs> dst);
+    void transform(const Crs& from, const Crs& to, size_t count, double* x, double* y) const;
+
+    std::unique_ptr<Crs> src_;
+    std::unique_ptr<Crs> dst_;
+};
+
+/**
+ * @return true if reproject uses AnalyticTransform where possible; false by default,
+ * unless the environment variable FIMEX_ANALYTIC_TRANSFORMS is set to 1
+ */
+bool analyticTransformsEnabled();
+
+/**
+ * Enable or disable the use of AnalyticTransform in reproject, for tests and benchmarks.
+ *
+ * @return the previous setting
+ */
+bool setAnalyticTransformsEnabled(bool enabled);
+
+} // namespace reproject
+} // namespace MetNoFimex
+
+#endif /* FIMEX_ANALYTICPROJECTION_H_ */
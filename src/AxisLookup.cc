@@ -0,0 +1,230 @@
+/*
+ * Fimex, AxisLookup.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "AxisLookup.h"
+
+#include "fimex/interpolation.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace MetNoFimex {
+
+namespace {
+
+const double HALF_CIRCLE_ANGLE = 180;
+
+// position of undefined points, as in mifi_points2position
+const double OUTSIDE_POSITION = -999.;
+
+// maximum deviation of a regular axis from start + i*step, in steps; keeps the arithmetic guess within one cell
+const double REGULAR_TOLERANCE = 0.25;
+
+// cells walked from the previous point before falling back to a search
+const ptrdiff_t SWEEP_STEPS = 8;
+
+// values are swept if at most this fraction of the steps between them changes direction
+const size_t SWEEP_TURNS = 16;
+
+bool mostlySorted(const double* points, size_t n)
+{
+    size_t up = 0, down = 0;
+    for (size_t i = 1; i < n; ++i) {
+        up += (points[i] > points[i - 1]);
+        down += (points[i] < points[i - 1]);
+    }
+    return std::min(up, down) * SWEEP_TURNS <= n;
+}
+
+} // namespace
+
+AxisLookup::AxisLookup(const double* axis, size_t num, int axisType)
+    : axis_(axis, axis + num)
+    , keys_(num)
+    , axisType_(axisType)
+    , descending_(num > 1 && axis[0] > axis[num - 1])
+    , monotonic_(num > 1)
+    , regular_(false)
+    , circular_(false)
+    , start_(0)
+    , step_(0)
+{
+    for (size_t i = 0; i < num; ++i)
+        keys_[i] = descending_ ? -axis[i] : axis[i];
+    for (size_t i = 1; i < num && monotonic_; ++i)
+        monotonic_ = (keys_[i - 1] < keys_[i]);
+    if (!monotonic_ || !std::isfinite(keys_[0]) || !std::isfinite(keys_[num - 1])) {
+        monotonic_ = false;
+        return;
+    }
+
+    start_ = keys_[0];
+    step_ = (keys_[num - 1] - keys_[0]) / (num - 1);
+    regular_ = true;
+    for (size_t i = 1; i < num && regular_; ++i)
+        regular_ = (std::fabs(keys_[i] - (start_ + i * step_)) <= REGULAR_TOLERANCE * step_);
+
+    if (axisType_ == MIFI_LONGITUDE) {
+        // same test as mifi_points2position
+        double nextOnAxis = axis[num - 1] + (axis[1] - axis[0]) * 1.01;
+        if (descending_) {
+            nextOnAxis += 2 * HALF_CIRCLE_ANGLE;
+            circular_ = (nextOnAxis <= axis[0]);
+        } else {
+            nextOnAxis -= 2 * HALF_CIRCLE_ANGLE;
+            circular_ = (nextOnAxis >= axis[0]);
+        }
+    }
+}
+
+void AxisLookup::positions(double* points, size_t n) const
+{
+    if (!monotonic_) {
+        mifi_points2position(points, n, &axis_[0], axis_.size(), axisType_);
+        return;
+    }
+
+    if (axisType_ == MIFI_LONGITUDE) {
+        if (axis_.front() < 0 || axis_.back() < 0) {
+            for (size_t i = 0; i < n; ++i)
+                if (points[i] > HALF_CIRCLE_ANGLE)
+                    points[i] -= 2 * HALF_CIRCLE_ANGLE;
+        } else {
+            for (size_t i = 0; i < n; ++i)
+                if (points[i] < 0)
+                    points[i] += 2 * HALF_CIRCLE_ANGLE;
+        }
+    }
+
+    const double sign = descending_ ? -1 : 1;
+    if (regular_) {
+        for (size_t i = 0; i < n; ++i)
+            points[i] = std::isfinite(points[i]) ? position(points[i], regularIndex(sign * points[i])) : OUTSIDE_POSITION;
+    } else if (mostlySorted(points, n)) {
+        ptrdiff_t idx = -1;
+        bool first = true;
+        for (size_t i = 0; i < n; ++i) {
+            if (!std::isfinite(points[i])) {
+                points[i] = OUTSIDE_POSITION;
+                continue;
+            }
+            const double key = sign * points[i];
+            idx = first ? searchIndex(key) : sweepIndex(key, idx);
+            first = false;
+            points[i] = position(points[i], idx);
+        }
+    } else {
+        for (size_t i = 0; i < n; ++i)
+            points[i] = std::isfinite(points[i]) ? position(points[i], searchIndex(sign * points[i])) : OUTSIDE_POSITION;
+    }
+}
+
+std::pair<size_t, size_t> AxisLookup::neighbors(float x) const
+{
+    // find_closest_neighbor_distinct_elements gives no levels at and before the first level,
+    // and extrapolates from the last two levels after the last level
+    const size_t num = keys_.size();
+    const double key = descending_ ? -double(x) : double(x);
+    if (!(key > keys_[0]))
+        return std::make_pair(0, 0);
+    if (key >= keys_[num - 1])
+        return std::make_pair(num - 1, num - 2);
+
+    const size_t idx = index(key);
+    if (!descending_)
+        return std::make_pair(idx, idx + 1);
+    if (keys_[idx] == key)
+        return std::make_pair(idx, idx - 1);
+    return std::make_pair(idx + 1, idx);
+}
+
+/** @return the last position with keys_[pos] <= key, or -1 */
+ptrdiff_t AxisLookup::index(double key) const
+{
+    return regular_ ? regularIndex(key) : searchIndex(key);
+}
+
+ptrdiff_t AxisLookup::regularIndex(double key) const
+{
+    const ptrdiff_t last = keys_.size() - 1;
+    const double guess = std::min(std::max(std::floor((key - start_) / step_), -1.), double(last));
+    ptrdiff_t idx = static_cast<ptrdiff_t>(guess);
+    if (idx >= 0 && keys_[idx] > key)
+        --idx;
+    else if (idx < last && keys_[idx + 1] <= key)
+        ++idx;
+    return idx;
+}
+
+ptrdiff_t AxisLookup::searchIndex(double key) const
+{
+    const double* keys = &keys_[0];
+    size_t base = 0, len = keys_.size();
+    while (len > 1) {
+        const size_t half = len / 2;
+        base = (keys[base + half] <= key) ? base + half : base;
+        len -= half;
+    }
+    return (keys[base] <= key) ? static_cast<ptrdiff_t>(base) : -1;
+}
+
+ptrdiff_t AxisLookup::sweepIndex(double key, ptrdiff_t idx) const
+{
+    const ptrdiff_t last = keys_.size() - 1;
+    for (ptrdiff_t step = 0; step <= SWEEP_STEPS; ++step) {
+        if (idx < last && keys_[idx + 1] <= key)
+            ++idx;
+        else if (idx >= 0 && keys_[idx] > key)
+            --idx;
+        else
+            return idx;
+    }
+    return searchIndex(key);
+}
+
+/** linear fit between the axis values around idx, as in mifi_points2position */
+double AxisLookup::position(double point, ptrdiff_t idx) const
+{
+    if (idx >= 0 && axis_[idx] == point)
+        return idx;
+
+    const int num = axis_.size();
+    int nPos = idx + 1;
+    if (nPos == num) {
+        nPos--; // extrapolate to the right
+    } else if (nPos == 0) {
+        nPos++; // extrapolate to the left
+    }
+    const double slope = axis_[nPos] - axis_[nPos - 1];
+    const double offset = axis_[nPos] - (slope * nPos);
+    double arrayPos = (point - offset) / slope;
+    if (circular_ && arrayPos <= -0.5) {
+        arrayPos += num;
+    }
+    if (circular_ && arrayPos > (num - 0.5)) {
+        arrayPos -= num;
+    }
+    return arrayPos;
+}
+
+} // namespace MetNoFimex
@@ -0,0 +1,98 @@
+/*
+ * Fimex, AxisLookup.h
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef FIMEX_AXISLOOKUP_H_
+#define FIMEX_AXISLOOKUP_H_
+
+#include "fimex/mifi_constants.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace MetNoFimex {
+
+/**
+ * This is a private header file, used by CDMInterpolator, reproject and
+ * CDMVerticalInterpolator.
+ *
+ * Positions of values on a strictly monotonic axis. The cell of a value is
+ * found by arithmetic and at most one correction step on (nearly) regular
+ * axes, by sweeping along the axis from the previous cell when the values are
+ * mostly sorted, and by a branch-free binary search otherwise.
+ *
+ * The results are identical to mifi_points2position and to
+ * find_closest_neighbor_distinct_elements. Axes which are not strictly
+ * monotonic are handed to mifi_points2position.
+ */
+class AxisLookup
+{
+public:
+    /**
+     * @param axis the axis values, copied
+     * @param num number of axis values
+     * @param axisType MIFI_LONGITUDE, MIFI_LATITUDE or MIFI_PROJ_AXIS, as for mifi_points2position
+     */
+    AxisLookup(const double* axis, size_t num, int axisType = MIFI_PROJ_AXIS);
+
+    /** true if the axis has at least two values, strictly ascending or descending */
+    bool isMonotonic() const { return monotonic_; }
+
+    /** true if the cells are found by arithmetic */
+    bool isRegular() const { return regular_; }
+
+    /**
+     * Translate values on the axis to array positions, in place, the same
+     * as mifi_points2position(points, n, axis, num, axisType).
+     */
+    void positions(double* points, size_t n) const;
+
+    /**
+     * Find the two levels to interpolate x from, the same as
+     * find_closest_neighbor_distinct_elements on the axis values as floats.
+     * Only for monotonic axes.
+     *
+     * @return the pair of positions, equal positions if no levels are found
+     */
+    std::pair<size_t, size_t> neighbors(float x) const;
+
+private:
+    ptrdiff_t index(double key) const;
+    ptrdiff_t regularIndex(double key) const;
+    ptrdiff_t searchIndex(double key) const;
+    ptrdiff_t sweepIndex(double key, ptrdiff_t previous) const;
+    double position(double point, ptrdiff_t idx) const;
+
+    std::vector<double> axis_;
+    std::vector<double> keys_; //!< axis values, negated for descending axes
+    int axisType_;
+    bool descending_;
+    bool monotonic_;
+    bool regular_;
+    bool circular_;
+    double start_, step_; //!< first key and mean distance of keys, for regular axes
+};
+
+} // namespace MetNoFimex
+
+#endif /* FIMEX_AXISLOOKUP_H_ */
@@ -0,0 +1,249 @@
+/*
+ * Fimex, BufferPool.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "fimex/BufferPool.h"
+
+#include "fimex/Logger.h"
+#include "fimex/MemoryBudget.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace MetNoFimex {
+
+static Logger_p logger = getLogger("fimex.BufferPool");
+
+namespace {
+
+const size_t THREAD_CACHE_BUFFERS = 4;
+// automatic limit without a MemoryBudget limit: at least this, or this many of the largest buffers
+const size_t AUTO_MIN_CACHED_BYTES = size_t(32) * 1024 * 1024;
+const size_t AUTO_CACHED_BUFFERS = 4;
+
+/**
+ * @return the size-class of a buffer, at most 1/8 larger than bytes
+ */
+size_t sizeClass(size_t bytes)
+{
+    size_t pow2 = 1;
+    while (pow2 <= bytes / 2)
+        pow2 *= 2;
+    const size_t step = (pow2 >= 8) ? pow2 / 8 : 1;
+    return ((bytes + step - 1) / step) * step;
+}
+
+typedef std::vector<std::pair<size_t, void*>> Buffers; // size-class, buffer
+
+struct GlobalCache
+{
+    std::mutex mutex;
+    std::multimap<size_t, void*> buffers;
+    std::atomic<size_t> maxBytes;
+    std::atomic<size_t> largestReleased;
+    std::atomic<size_t> cachedBytes;
+    std::atomic<size_t> requests;
+    std::atomic<size_t> reused;
+    std::atomic<size_t> released;
+    std::atomic<size_t> freed;
+
+    GlobalCache()
+        : maxBytes(BufferPool::AUTO_MAX_CACHED_BYTES)
+        , largestReleased(0)
+        , cachedBytes(0)
+        , requests(0)
+        , reused(0)
+        , released(0)
+        , freed(0)
+    {
+    }
+};
+
+GlobalCache& globalCache()
+{
+    // never destroyed, buffers might be released during static destruction
+    static GlobalCache* cache = new GlobalCache;
+    return *cache;
+}
+
+size_t maxCachedBytes(const GlobalCache& gc)
+{
+    const size_t maxBytes = gc.maxBytes;
+    if (maxBytes != BufferPool::AUTO_MAX_CACHED_BYTES)
+        return maxBytes;
+    if (const size_t limit = MemoryBudget::getLimit())
+        return limit / 4;
+    return std::max(AUTO_MIN_CACHED_BYTES, AUTO_CACHED_BUFFERS * gc.largestReleased);
+}
+
+void freeBuffer(void* buffer)
+{
+    ::operator delete(buffer);
+}
+
+// set when the cache of this thread is gone, e.g. during thread exit
+thread_local bool threadCacheDestroyed = false;
+
+struct ThreadCache
+{
+    Buffers buffers;
+
+    ~ThreadCache()
+    {
+        GlobalCache& gc = globalCache();
+        for (const auto& b : buffers) {
+            gc.cachedBytes -= b.first;
+            freeBuffer(b.second);
+        }
+        threadCacheDestroyed = true;
+    }
+};
+
+Buffers* threadBuffers()
+{
+    if (threadCacheDestroyed)
+        return nullptr;
+    thread_local ThreadCache cache;
+    return &cache.buffers;
+}
+
+} // namespace
+
+void* BufferPool::allocate(size_t bytes, bool reuse)
+{
+    GlobalCache& gc = globalCache();
+    const size_t cls = sizeClass(bytes);
+    ++gc.requests;
+    if (!reuse)
+        return ::operator new(cls);
+    if (Buffers* tb = threadBuffers()) {
+        for (auto it = tb->begin(); it != tb->end(); ++it) {
+            if (it->first == cls) {
+                void* buffer = it->second;
+                tb->erase(it);
+                gc.cachedBytes -= cls;
+                ++gc.reused;
+                return buffer;
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(gc.mutex);
+        auto it = gc.buffers.find(cls);
+        if (it != gc.buffers.end()) {
+            void* buffer = it->second;
+            gc.buffers.erase(it);
+            gc.cachedBytes -= cls;
+            ++gc.reused;
+            return buffer;
+        }
+    }
+    return ::operator new(cls);
+}
+
+void BufferPool::release(void* buffer, size_t bytes)
+{
+    if (!buffer)
+        return;
+    GlobalCache& gc = globalCache();
+    const size_t cls = sizeClass(bytes);
+    ++gc.released;
+    // the largest size-class so far, for the automatic limit
+    size_t largest = gc.largestReleased;
+    while (largest < cls && !gc.largestReleased.compare_exchange_weak(largest, cls)) {
+    }
+    // reserve the bytes before caching the buffer, such that concurrent releases stay below the limit
+    const size_t maxBytes = maxCachedBytes(gc);
+    size_t cached = gc.cachedBytes;
+    do {
+        if (cached + cls > maxBytes) {
+            ++gc.freed;
+            freeBuffer(buffer);
+            return;
+        }
+    } while (!gc.cachedBytes.compare_exchange_weak(cached, cached + cls));
+    if (Buffers* tb = threadBuffers()) {
+        if (tb->size() < THREAD_CACHE_BUFFERS) {
+            tb->push_back(std::make_pair(cls, buffer));
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(gc.mutex);
+    gc.buffers.insert(std::make_pair(cls, buffer));
+}
+
+void BufferPool::setMaxCachedBytes(size_t maxBytes)
+{
+    globalCache().maxBytes = maxBytes;
+    if (globalCache().cachedBytes > getMaxCachedBytes())
+        clear();
+}
+
+size_t BufferPool::getMaxCachedBytes()
+{
+    return maxCachedBytes(globalCache());
+}
+
+void BufferPool::clear()
+{
+    GlobalCache& gc = globalCache();
+    if (Buffers* tb = threadBuffers()) {
+        for (const auto& b : *tb) {
+            gc.cachedBytes -= b.first;
+            freeBuffer(b.second);
+        }
+        tb->clear();
+    }
+    std::lock_guard<std::mutex> lock(gc.mutex);
+    for (const auto& b : gc.buffers) {
+        gc.cachedBytes -= b.first;
+        freeBuffer(b.second);
+    }
+    gc.buffers.clear();
+}
+
+BufferPool::Statistics BufferPool::statistics()
+{
+    const GlobalCache& gc = globalCache();
+    Statistics stats;
+    stats.requests = gc.requests;
+    stats.reused = gc.reused;
+    stats.released = gc.released;
+    stats.freed = gc.freed;
+    stats.cachedBytes = gc.cachedBytes;
+    return stats;
+}
+
+void BufferPool::logStatistics()
+{
+    const Statistics stats = statistics();
+    LOG4FIMEX(logger, Logger::INFO,
+              "buffer pool: " << stats.requests << " requests, " << stats.reused << " reused, " << stats.released << " released, " << stats.freed
+                              << " freed, " << (stats.cachedBytes / (1024 * 1024)) << " MB cached");
+}
+
+} // namespace MetNoFimex
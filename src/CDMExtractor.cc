@@ -97,7 +97,7 @@ DataPtr joinSlices(CDMReader_p reader, std::string varName, const std::vector<Sl
     return retData;
 }
 
-DataPtr CDMExtractor::getDataSlice_(const std::string& varName, const SliceBuilder& sb)
+std::vector<SliceBuilder> CDMExtractor::getSubSlices_(const std::string& varName, const SliceBuilder& sb)
 {
     std::vector<SliceBuilder> slices;
     // translate slice-variable size where dimensions have been transformed, (via data.slice)
@@ -165,8 +165,13 @@ DataPtr CDMExtractor::getDataSlice_(const std::string& varName, const SliceBuild
             }
         }
     }
+    return slices;
+}
+
+DataPtr CDMExtractor::getDataSlice_(const std::string& varName, const SliceBuilder& sb)
+{
     // read
-    DataPtr data = joinSlices(dataReader_, varName, slices);
+    DataPtr data = joinSlices(dataReader_, varName, getSubSlices_(varName, sb));
     return data;
 }
 
@@ -208,7 +213,7 @@ DataPtr CDMExtractor::getDataSlice(const std::string& varName, const SliceBuilde
         if (data->size() == 0) {
             return data;
         } else {
-            return data->slice(sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
+            return createDataView(data, sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
         }
     }
 
@@ -219,6 +224,43 @@ DataPtr CDMExtractor::getDataSlice(const std::string& varName, const SliceBuilde
     return getDataSlice_(varName, sb);
 }
 
+bool CDMExtractor::supportsConcurrentReading() const
+{
+    return dataReader_->supportsConcurrentReading();
+}
+
+size_t CDMExtractor::readInto(const std::string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst)
+{
+    const CDMVariable& variable = cdm_->getVariable(varName);
+    if (variable.hasData()) {
+        return CDMReader::readInto(varName, sb, dataType, dst);
+    }
+
+    if (dimSlices_.empty()) {
+        // no further slicing of dimensions
+        return dataReader_->readInto(varName, sb, dataType, dst);
+    }
+
+    // read the sub-slices one after another into dst, like joinSlices
+    const std::vector<SliceBuilder> slices = getSubSlices_(varName, sb);
+    const size_t typeSize = createData(dataType, 0)->bytes_for_one();
+    char* out = reinterpret_cast<char*>(dst);
+    size_t dataPos = 0;
+    for (const SliceBuilder& slice : slices) {
+        const std::vector<std::size_t>& dimSizes = slice.getDimensionSizes();
+        const size_t sliceSize = std::accumulate(dimSizes.begin(), dimSizes.end(), 1ul, std::multiplies<size_t>());
+        const size_t read = dataReader_->readInto(varName, slice, dataType, out + dataPos * typeSize);
+        if (read == 0 && sliceSize > 0) {
+            // no data in this slice, use fill-values
+            copyValues(*createData(dataType, sliceSize, cdm_->getFillValue(varName)), dataType, out + dataPos * typeSize);
+        } else {
+            assert(read == sliceSize);
+        }
+        dataPos += sliceSize;
+    }
+    return dataPos;
+}
+
 void CDMExtractor::removeVariable(const std::string& variable)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "removing variable "<< variable);
@@ -21,13 +21,13 @@
  * USA.
  */
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
 // fimex
 //
+#include "AxisLookup.h"
 #include "CachedForwardInterpolation.h"
+#include "Fill2d.h"
+#include "InterpolationCache.h"
+#include "LatLonBuckets.h"
 #include "fimex/CDM.h"
 #include "fimex/CDMException.h"
 #include "fimex/CDMFileReaderFactory.h"
@@ -40,6 +40,7 @@
 #include "fimex/SpatialAxisSpec.h"
 #include "fimex/StringUtils.h"
 #include "fimex/Type2String.h"
+#include "fimex/WorkerPool.h"
 #include "fimex/coordSys/CoordinateAxis.h"
 #include "fimex/coordSys/CoordinateSystem.h"
 #include "fimex/coordSys/Projection.h"
@@ -56,9 +57,12 @@
 #include <ctime>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iterator>
 #include <limits>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <regex>
 #include <set>
@@ -71,26 +75,79 @@ using namespace std;
 typedef std::shared_ptr<CachedInterpolationInterface> CachedInterpolationInterface_p;
 typedef std::shared_ptr<CachedVectorReprojection> CachedVectorReprojection_p;
 
+namespace {
+// number of rotated vector components kept for the request of their counterpart
+const size_t MAX_VECTOR_PARTNERS = 8;
+} // namespace
+
 InterpolatorProcess2d::~InterpolatorProcess2d() {}
 
 void InterpolatorFill2d::operator()(float* array, size_t nx, size_t ny)
 {
     size_t nChanged;
-    mifi_fill2d_f(nx, ny, array, relaxCrit_, corrEff_, maxLoop_, &nChanged);
+    if (method_ == FILL2D_REDBLACK)
+        fill2dRedBlack(nx, ny, array, relaxCrit_, corrEff_, maxLoop_);
+    else if (method_ == FILL2D_MULTIGRID)
+        fill2dMultigrid(nx, ny, array, relaxCrit_, corrEff_, maxLoop_);
+    else
+        mifi_fill2d_f(nx, ny, array, relaxCrit_, corrEff_, maxLoop_, &nChanged);
 }
 
 void InterpolatorCreepFill2d::operator()(float* array, size_t nx, size_t ny)
 {
     size_t nChanged;
-    mifi_creepfill2d_f(nx, ny, array, repeat_, setWeight_, &nChanged);
+    if (tiled_)
+        creepfill2dTiled(nx, ny, array, repeat_, setWeight_);
+    else
+        mifi_creepfill2d_f(nx, ny, array, repeat_, setWeight_, &nChanged);
 }
 
 void InterpolatorCreepFillVal2d::operator()(float* array, size_t nx, size_t ny)
 {
     size_t nChanged;
-    mifi_creepfillval2d_f(nx, ny, array, defVal_, repeat_, setWeight_, &nChanged);
+    if (tiled_)
+        creepfillval2dTiled(nx, ny, array, defVal_, repeat_, setWeight_);
+    else
+        mifi_creepfillval2d_f(nx, ny, array, defVal_, repeat_, setWeight_, &nChanged);
 }
 
+namespace {
+/** a setup deferred until the first data request, shared by all keys it serves */
+struct PendingSetup
+{
+    explicit PendingSetup(const std::function<void()>& setup)
+        : setup(setup)
+    {
+    }
+    std::function<void()> setup;
+    // valid while the setup runs on some thread
+    std::shared_future<void> running;
+};
+typedef std::shared_ptr<PendingSetup> PendingSetup_p;
+
+/** values of the variables added by changeProjection, generated on their first request */
+class GeneratedValues
+{
+public:
+    void set(const std::string& varName, DataPtr data)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        values_[varName] = data;
+    }
+    DataPtr get(const std::string& varName) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, DataPtr>::const_iterator it = values_.find(varName);
+        return (it != values_.end()) ? it->second : DataPtr();
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, DataPtr> values_;
+};
+typedef std::shared_ptr<GeneratedValues> GeneratedValues_p;
+} // namespace
+
 struct CDMInterpolator::Impl
 {
     CDMReader_p dataReader;
@@ -108,8 +165,171 @@ struct CDMInterpolator::Impl
     // horizontalId, cachedVectorReprojection
     typedef map<string, CachedVectorReprojection_p> cachedVectorReprojection_t;
     cachedVectorReprojection_t cachedVectorReprojection;
+    // setup deferred until the first data request, by horizontalId or by generated variable name
+    typedef map<string, PendingSetup_p> pendingSetup_t;
+    pendingSetup_t pendingInterpolation;
+    pendingSetup_t pendingVariables;
+    // guards the pending setups and the maps they fill, never held while a setup runs
+    std::mutex pendingMutex;
+    // values of the generated variables, the CDM itself is not changed after changeProjection
+    GeneratedValues_p generatedValues = std::make_shared<GeneratedValues>();
+    // rotated values of a vector component, interpolated together with its counterpart
+    struct VectorPartner
+    {
+        std::string varName;
+        std::string horizontalId;
+        std::vector<std::string> dimNames;
+        std::vector<size_t> dimStarts;
+        std::vector<size_t> dimSizes;
+        shared_array<float> values;
+        size_t size;
+    };
+    // rotated values of the most recent slices, oldest first; several slices
+    // are in flight when the writers read concurrently
+    typedef std::list<VectorPartner> vectorPartners_t;
+    vectorPartners_t vectorPartners;
+    std::mutex partnerMutex;
+
+    /**
+     * run and remove the pending setup of key, if any; other threads requesting the
+     * same setup wait for it to finish
+     */
+    void runPending(pendingSetup_t& pending, const std::string& key);
+    void clearPending();
+
+    void setInterpolation(const std::string& horizontalId, CachedInterpolationInterface_p ci);
+    void setVectorReprojection(const std::string& horizontalId, CachedVectorReprojection_p cvr);
+    /** @return the cached interpolation of horizontalId, and its vector reprojection, if any */
+    CachedInterpolationInterface_p interpolation(const std::string& horizontalId, CachedVectorReprojection_p* cvr = 0);
+
+    /**
+     * keep the rotated values of varName for a later request of the same slice,
+     * dropping the oldest kept slice if more than MAX_VECTOR_PARTNERS are kept
+     */
+    void storeVectorPartner(const std::string& varName, const std::string& horizontalId, const SliceBuilder& sb, shared_array<float> values, size_t size);
+    /** take the values kept by storeVectorPartner for this slice, if any */
+    bool takeVectorPartner(const std::string& varName, const std::string& horizontalId, const SliceBuilder& sb, shared_array<float>& values, size_t& size);
 };
 
+void CDMInterpolator::Impl::runPending(pendingSetup_t& pending, const std::string& key)
+{
+    PendingSetup_p ps;
+    std::shared_future<void> running;
+    std::promise<void> done;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingSetup_t::iterator it = pending.find(key);
+        if (it == pending.end())
+            return;
+        ps = it->second;
+        if (ps->running.valid())
+            running = ps->running;
+        else
+            ps->running = done.get_future().share();
+    }
+    if (running.valid()) {
+        // started by another thread, WorkerPool::wait() never runs unrelated tasks
+        // which might request it again on this thread
+        WorkerPool::shared().wait(running);
+        running.get();
+        return;
+    }
+
+    try {
+        ps->setup();
+    } catch (...) {
+        {
+            // a failed setup is retried by the next request
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            ps->running = std::shared_future<void>();
+        }
+        done.set_exception(std::current_exception());
+        throw;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (pendingSetup_t::iterator it = pending.begin(); it != pending.end();) {
+            if (it->second == ps)
+                it = pending.erase(it);
+            else
+                ++it;
+        }
+    }
+    done.set_value();
+}
+
+void CDMInterpolator::Impl::clearPending()
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingInterpolation.clear();
+        pendingVariables.clear();
+        generatedValues = std::make_shared<GeneratedValues>();
+    }
+    std::lock_guard<std::mutex> lock(partnerMutex);
+    vectorPartners.clear();
+}
+
+void CDMInterpolator::Impl::setInterpolation(const std::string& horizontalId, CachedInterpolationInterface_p ci)
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    cachedInterpolation[horizontalId] = ci;
+}
+
+void CDMInterpolator::Impl::setVectorReprojection(const std::string& horizontalId, CachedVectorReprojection_p cvr)
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    cachedVectorReprojection[horizontalId] = cvr;
+}
+
+CachedInterpolationInterface_p CDMInterpolator::Impl::interpolation(const std::string& horizontalId, CachedVectorReprojection_p* cvr)
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    cachedInterpolation_t::iterator itCI = cachedInterpolation.find(horizontalId);
+    if (itCI == cachedInterpolation.end())
+        throw CDMException("no cached interpolation for " + horizontalId);
+    if (cvr) {
+        cachedVectorReprojection_t::iterator itV = cachedVectorReprojection.find(horizontalId);
+        if (itV != cachedVectorReprojection.end())
+            *cvr = itV->second;
+    }
+    return itCI->second;
+}
+
+void CDMInterpolator::Impl::storeVectorPartner(const std::string& varName, const std::string& horizontalId, const SliceBuilder& sb, shared_array<float> values,
+                                               size_t size)
+{
+    VectorPartner partner;
+    partner.varName = varName;
+    partner.horizontalId = horizontalId;
+    partner.dimNames = sb.getDimensionNames();
+    partner.dimStarts = sb.getDimensionStartPositions();
+    partner.dimSizes = sb.getDimensionSizes();
+    partner.values = values;
+    partner.size = size;
+    std::lock_guard<std::mutex> lock(partnerMutex);
+    vectorPartners.push_back(partner);
+    if (vectorPartners.size() > MAX_VECTOR_PARTNERS)
+        vectorPartners.pop_front();
+}
+
+bool CDMInterpolator::Impl::takeVectorPartner(const std::string& varName, const std::string& horizontalId, const SliceBuilder& sb, shared_array<float>& values,
+                                              size_t& size)
+{
+    std::lock_guard<std::mutex> lock(partnerMutex);
+    for (vectorPartners_t::iterator it = vectorPartners.begin(); it != vectorPartners.end(); ++it) {
+        if (it->varName == varName && it->horizontalId == horizontalId && it->dimNames == sb.getDimensionNames() &&
+            it->dimStarts == sb.getDimensionStartPositions() && it->dimSizes == sb.getDimensionSizes()) {
+            values = it->values;
+            size = it->size;
+            // a kept slice is used at most once
+            vectorPartners.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
 namespace {
 const std::string LAT_LON_PROJSTR = MIFI_WGS84_LATLON_PROJ4;
 Logger_p logger = getLogger("fimex.CDMInterpolator");
@@ -119,8 +339,126 @@ bool unitIsDegree(const std::string& out_x_axis_unit, const std::string& out_y_a
     static const std::regex degree(".*degree.*");
     return std::regex_match(out_x_axis_unit, degree) || std::regex_match(out_y_axis_unit, degree);
 }
+
+/**
+ * Replace the positions x and y with size values from the InterpolationCache, or run
+ * compute and add the computed positions to the cache. The positions are shared with
+ * the cache and must not be modified afterwards.
+ */
+void cachedPositions(const InterpolationCacheKey& key, shared_array<double>& x, shared_array<double>& y, size_t size, const std::function<void()>& compute)
+{
+    InterpolationCache& cache = InterpolationCache::shared();
+    const std::string k = key.str();
+    std::vector<shared_array<double>> cached;
+    if (cache.find(k, cached, 2, size)) {
+        LOG4FIMEX(logger, Logger::DEBUG, "using cached interpolation positions " << k);
+        x = cached[0];
+        y = cached[1];
+        return;
+    }
+    compute();
+    cache.insert(k, {x, y}, size);
+}
+
+/**
+ * Get the vector reprojection matrix with sizeX*sizeY points from the InterpolationCache,
+ * or create it and add it to the cache.
+ */
+reproject::Matrix_cp cachedVectorMatrix(const InterpolationCacheKey& key, int sizeX, int sizeY, const std::function<reproject::Matrix_cp()>& create)
+{
+    InterpolationCache& cache = InterpolationCache::shared();
+    const std::string k = key.str();
+    const size_t size = size_t(sizeX) * sizeY * reproject::Matrix::stride;
+    std::vector<shared_array<double>> cached;
+    if (cache.find(k, cached, 1, size)) {
+        LOG4FIMEX(logger, Logger::DEBUG, "using cached vector reprojection matrix " << k);
+        return std::make_shared<reproject::Matrix>(sizeX, sizeY, cached[0]);
+    }
+    reproject::Matrix_cp created = create();
+    cache.insert(k, {created->matrix}, size);
+    return created;
+}
+
+/**
+ * Positions of the output grid in the input axes, if the x-position only depends
+ * on the output column and the y-position only on the row, e.g. for input and output
+ * in the same projection. This is checked on a sample of the output points.
+ *
+ * @param pointsOnXAxis return the position of each output column on the input x-axis
+ * @param pointsOnYAxis return the position of each output row on the input y-axis
+ * @return false if the positions are not separable
+ */
+bool separablePositions(const std::string& proj_input, const std::string& orgProjStr, const std::vector<double>& out_x_axis,
+                        const std::vector<double>& out_y_axis, const double* orgXAxis, size_t orgXAxisSize, int miupXAxis, const double* orgYAxis,
+                        size_t orgYAxisSize, int miupYAxis, shared_array<double>& pointsOnXAxis, shared_array<double>& pointsOnYAxis)
+{
+    const size_t nx = out_x_axis.size(), ny = out_y_axis.size();
+    if (nx == 0 || ny == 0)
+        return false;
+
+    // evenly spaced sample columns and rows, including the first and the last
+    const size_t SAMPLES = 17;
+    auto samples = [&](size_t n) {
+        std::vector<size_t> s;
+        for (size_t i = 0; i < SAMPLES; ++i)
+            s.push_back(i * (n - 1) / (SAMPLES - 1));
+        s.erase(std::unique(s.begin(), s.end()), s.end());
+        return s;
+    };
+    const std::vector<size_t> sx = samples(nx), sy = samples(ny);
+
+    // the first row, the first column and the sample points
+    const size_t n = nx + ny + sx.size() * sy.size();
+    std::vector<double> x(n), y(n);
+    for (size_t i = 0; i < nx; ++i) {
+        x[i] = out_x_axis[i];
+        y[i] = out_y_axis[0];
+    }
+    for (size_t j = 0; j < ny; ++j) {
+        x[nx + j] = out_x_axis[0];
+        y[nx + j] = out_y_axis[j];
+    }
+    size_t k = nx + ny;
+    for (size_t j : sy) {
+        for (size_t i : sx) {
+            x[k] = out_x_axis[i];
+            y[k] = out_y_axis[j];
+            ++k;
+        }
+    }
+    reproject::reproject_values(proj_input, orgProjStr, &x[0], &y[0], n);
+    AxisLookup(orgXAxis, orgXAxisSize, miupXAxis).positions(&x[0], n);
+    AxisLookup(orgYAxis, orgYAxisSize, miupYAxis).positions(&y[0], n);
+
+    const double tolerance = 1e-6; // grid cells
+    auto same = [tolerance](double a, double b) { return (mifi_isnan(a) && mifi_isnan(b)) || std::fabs(a - b) <= tolerance; };
+    k = nx + ny;
+    for (size_t j : sy) {
+        for (size_t i : sx) {
+            if (!same(x[k], x[i]) || !same(y[k], y[nx + j]))
+                return false;
+            ++k;
+        }
+    }
+
+    pointsOnXAxis = make_shared_array<double>(nx);
+    pointsOnYAxis = make_shared_array<double>(ny);
+    std::copy(x.begin(), x.begin() + nx, pointsOnXAxis.get());
+    std::copy(y.begin() + nx, y.begin() + nx + ny, pointsOnYAxis.get());
+    return true;
+}
 } // namespace
 
+void CDMInterpolator::setCacheDirectory(const std::string& directory)
+{
+    InterpolationCache::shared().setDirectory(directory);
+}
+
+void CDMInterpolator::setCacheMemoryLimit(size_t bytes)
+{
+    InterpolationCache::shared().setMemoryLimit(bytes);
+}
+
 CDMInterpolator::CDMInterpolator(CDMReader_p dataReader)
     : p_(new Impl())
 {
@@ -146,6 +484,11 @@ shared_array<float> data2InterpolationArray(const DataPtr& inData, double badVal
 
 DataPtr interpolationArray2Data(CDMDataType newType, shared_array<float> iData, size_t size, double badValue)
 {
+    if (newType == CDM_FLOAT) {
+        // no conversion of the values required
+        mifi_nanf2bad(&iData[0], &iData[size], static_cast<float>(badValue));
+        return createData(size, iData);
+    }
     DataPtr d = createData(size, iData);
     return d->convertDataType(MIFI_UNDEFINED_F, 1., 0., newType, badValue, 1., 0.);
 }
@@ -164,32 +507,67 @@ void processArray_(vector<InterpolatorProcess2d_p> processes, float* array, size
 {
     if (processes.size() == 0) return; // nothing to do
 
-    int nz = static_cast<int>(size / (nx*ny));
+    const size_t nz = size / (nx*ny);
     assert((nz*nx*ny) == size);
 
-#ifdef _OPENMP
-#pragma omp parallel default(shared) if (nz >= 4)
-    {
-#pragma omp for nowait
-#endif
-    for (int z = 0; z < nz; z++) { // using int instead of size_t because of openMP < 3.0
+    WorkerPool::shared().parallelFor(0, nz, [&](size_t z) {
         // find the start of the slice
         float* arrayPos = array + (z*nx*ny);
         for (size_t i = 0; i < processes.size(); i++) {
             processes[i]->operator()(arrayPos, nx, ny);
         }
+    });
+}
+/**
+ * interpolate data which needs no float-processing, keeping the datatype if possible
+ *
+ * @return the interpolated data in the given datatype, or a 0-pointer if the values must be interpolated as float
+ */
+DataPtr interpolateNative(const CachedInterpolationInterface& ci, const std::string& varName, DataPtr data, double badValue, CDMDataType dataType,
+                          size_t& newSize)
+{
+    if (DataPtr iData = ci.interpolateData(data, badValue, newSize)) {
+        LOG4FIMEX(logger, Logger::DEBUG, "interpolateData for: " << varName << "(slicebuilder)");
+        if (iData->getDataType() == dataType)
+            return iData;
+        return iData->convertDataType(badValue, 1., 0., dataType, badValue, 1., 0.);
     }
-#ifdef _OPENMP
+    if (dataType == CDM_DOUBLE) {
+        LOG4FIMEX(logger, Logger::DEBUG, "interpolateValues(double) for: " << varName << "(slicebuilder)");
+        auto array = data->asDouble();
+        mifi_bad2nand(&array[0], &array[data->size()], badValue);
+        auto iArray = ci.interpolateValues(array, data->size(), newSize);
+        mifi_nand2bad(&iArray[0], &iArray[newSize], badValue);
+        return createData(newSize, iArray);
     }
-#endif
-    return;
+    return DataPtr();
 }
+
+/** slice of varName at the unlimited dimension position, or the complete variable if it has no unlimited dimension */
+SliceBuilder unLimDimSlice(const CDM& cdm, const std::string& varName, size_t unLimDimPos)
+{
+    SliceBuilder sb(cdm, varName);
+    if (const CDMDimension* unlimDim = cdm.getUnlimitedDim()) {
+        if (cdm.hasUnlimitedDim(cdm.getVariable(varName)))
+            sb.setStartAndSize(unlimDim->getName(), unLimDimPos, 1);
+    }
+    return sb;
+}
+
 void extractValues(DataPtr data, shared_array<double>& values, size_t& size)
 {
     values = data->asDouble();
     size = data->size();
 }
 
+/** @return a copy of variable holding data, e.g. for getDataSliceFromMemory */
+CDMVariable withData(const CDMVariable& variable, DataPtr data)
+{
+    CDMVariable copy(variable);
+    copy.setData(data);
+    return copy;
+}
+
 shared_array<double> clone(shared_array<double> orig, size_t size)
 {
     auto copy = make_shared_array<double>(size);
@@ -198,10 +576,143 @@ shared_array<double> clone(shared_array<double> orig, size_t size)
 }
 } // namespace
 
+DataPtr CDMInterpolator::initVariable(const std::string& varName)
+{
+    p_->runPending(p_->pendingVariables, varName);
+    GeneratedValues_p generated;
+    {
+        std::lock_guard<std::mutex> lock(p_->pendingMutex);
+        generated = p_->generatedValues;
+    }
+    return generated->get(varName);
+}
+
+DataPtr CDMInterpolator::interpolateSlice(const std::string& varName, const std::string& horizontalId, const SliceBuilder& sb, CachedInterpolationInterface_p& ci)
+{
+    const CDMVariable& variable = cdm_->getVariable(varName);
+    CachedVectorReprojection_p cvr;
+    p_->runPending(p_->pendingInterpolation, horizontalId);
+    ci = p_->interpolation(horizontalId, &cvr);
+
+    const double badValue = cdm_->getFillValue(varName);
+    const CDMDataType dataType = variable.getDataType();
+    const CDMVariable::SpatialVectorDirection dir = variable.isSpatialVector() ? variable.getSpatialVectorDirection() : CDMVariable::SPATIAL_VECTOR_NONE;
+    const bool xyVector = (dir == CDMVariable::SPATIAL_VECTOR_X || dir == CDMVariable::SPATIAL_VECTOR_Y);
+
+    size_t newSize = 0;
+    shared_array<float> iArray;
+    if (xyVector && cvr && p_->takeVectorPartner(varName, horizontalId, sb, iArray, newSize)) {
+        // interpolated and rotated together with the counterpart
+        LOG4FIMEX(logger, Logger::DEBUG, "reusing implicit interpolateVectorValues for: " << varName << "(slicebuilder)");
+    } else {
+        DataPtr data = ci->getInputDataSlice(p_->dataReader, varName, sb);
+        if (data->size() == 0)
+            return DataPtr();
+
+        if (!xyVector && p_->preprocesses.empty() && p_->postprocesses.empty()) {
+            // no float-processing required, keep the datatype if possible
+            if (DataPtr iData = interpolateNative(*ci, varName, data, badValue, dataType, newSize))
+                return iData;
+        }
+
+        auto array = data2InterpolationArray(data, badValue);
+        processArray_(p_->preprocesses, array.get(), data->size(), ci->getInX(), ci->getInY());
+
+        bool can_reproject = false;
+        if (xyVector) {
+            // vector in x/y direction
+            const std::string& counterpart = variable.getSpatialVectorCounterpart();
+            Impl::projectionVariables_t::const_iterator itC = p_->projectionVariables.find(counterpart);
+            if (itC != p_->projectionVariables.end() && horizontalId == itC->second && cvr) {
+                // fetch the vector-data, interpolate and rotate both components in one pass,
+                // and keep the counterpart as it is usually requested next
+                auto counterPartArray = data2InterpolationArray(ci->getInputDataSlice(p_->dataReader, counterpart, sb), cdm_->getFillValue(counterpart));
+                processArray_(p_->preprocesses, counterPartArray.get(), data->size(), ci->getInX(), ci->getInY());
+                LOG4FIMEX(logger, Logger::DEBUG, "interpolateVectorValues for: " << varName << " and " << counterpart << "(slicebuilder)");
+                shared_array<float> counterpartiArray;
+                if (dir == CDMVariable::SPATIAL_VECTOR_X)
+                    ci->interpolateVectorValues(array, counterPartArray, data->size(), *cvr, iArray, counterpartiArray, newSize);
+                else
+                    ci->interpolateVectorValues(counterPartArray, array, data->size(), *cvr, counterpartiArray, iArray, newSize);
+                p_->storeVectorPartner(counterpart, horizontalId, sb, counterpartiArray, newSize);
+                can_reproject = true;
+            } else {
+                LOG4FIMEX(logger, Logger::WARN, "Cannot reproject vector " << variable.getName());
+            }
+        }
+        if (!can_reproject) {
+            LOG4FIMEX(logger, Logger::DEBUG, "interpolateValues for: " << varName << "(slicebuilder)");
+            iArray = ci->interpolateValues(array, data->size(), newSize);
+        }
+    }
+
+    processArray_(p_->postprocesses, iArray.get(), newSize, ci->getOutX(), ci->getOutY());
+    return interpolationArray2Data(dataType, iArray, newSize, badValue);
+}
+
+std::vector<DataPtr> CDMInterpolator::interpolateSlices(const std::vector<std::string>& varNames, const std::string& horizontalId,
+                                                        const std::vector<SliceBuilder>& sbs, CachedInterpolationInterface_p& ci)
+{
+    p_->runPending(p_->pendingInterpolation, horizontalId);
+    ci = p_->interpolation(horizontalId);
+
+    const size_t nVars = varNames.size();
+    std::vector<DataPtr> iData(nVars);
+    std::vector<shared_array<float>> arrays(nVars);
+    std::vector<size_t> sizes(nVars, 0);
+    const bool floatProcessing = !(p_->preprocesses.empty() && p_->postprocesses.empty());
+    // readers not supporting concurrent reading are read by this thread only
+    const size_t grain = p_->dataReader->supportsConcurrentReading() ? 1 : nVars;
+    WorkerPool::shared().parallelFor(0, nVars, [&](size_t i) {
+        const std::string& varName = varNames[i];
+        DataPtr data = ci->getInputDataSlice(p_->dataReader, varName, sbs[i]);
+        if (data->size() == 0)
+            return;
+        const double badValue = cdm_->getFillValue(varName);
+        if (!floatProcessing) {
+            size_t newSize = 0;
+            iData[i] = interpolateNative(*ci, varName, data, badValue, cdm_->getVariable(varName).getDataType(), newSize);
+            if (iData[i])
+                return;
+        }
+        arrays[i] = data2InterpolationArray(data, badValue);
+        sizes[i] = data->size();
+        processArray_(p_->preprocesses, arrays[i].get(), sizes[i], ci->getInX(), ci->getInY());
+    }, grain);
+
+    // size, variables interpolated in one pass
+    std::map<size_t, std::vector<size_t>> batches;
+    for (size_t i = 0; i < nVars; ++i) {
+        if (arrays[i])
+            batches[sizes[i]].push_back(i);
+    }
+    for (const auto& batch : batches) {
+        std::vector<shared_array<float>> inArrays;
+        for (size_t i : batch.second) {
+            inArrays.push_back(arrays[i]);
+            arrays[i].reset();
+        }
+        LOG4FIMEX(logger, Logger::DEBUG, "interpolateBatch for " << inArrays.size() << " variables of " << horizontalId);
+        size_t newSize = 0;
+        std::vector<shared_array<float>> outArrays = ci->interpolateBatch(inArrays, batch.first, newSize);
+        inArrays.clear();
+        for (size_t k = 0; k < batch.second.size(); ++k) {
+            const std::string& varName = varNames[batch.second[k]];
+            processArray_(p_->postprocesses, outArrays[k].get(), newSize, ci->getOutX(), ci->getOutY());
+            iData[batch.second[k]] =
+                interpolationArray2Data(cdm_->getVariable(varName).getDataType(), outArrays[k], newSize, cdm_->getFillValue(varName));
+            outArrays[k].reset();
+        }
+    }
+    return iData;
+}
+
 DataPtr CDMInterpolator::getDataSlice(const std::string& varName, const SliceBuilder& sb)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "interpolating '"<< varName << "' with sliceBuilder" );
     const CDMVariable& variable = cdm_->getVariable(varName);
+    if (DataPtr generated = initVariable(varName))
+        return getDataSliceFromMemory(withData(variable, generated), sb);
     if (variable.hasData())
         return getDataSliceFromMemory(variable, sb);
 
@@ -211,70 +722,89 @@ DataPtr CDMInterpolator::getDataSlice(const std::string& varName, const SliceBui
         return p_->dataReader->getDataSlice(varName, sb);
     }
 
-    const string& horizontalId = itP->second;
-    Impl::cachedInterpolation_t::iterator itCI = p_->cachedInterpolation.find(horizontalId);
-    if (itCI == p_->cachedInterpolation.end())
-        throw CDMException("no cached interpolation for " + varName + "(" + horizontalId + ")");
-
-    CachedInterpolationInterface_p ci = itCI->second;
-    DataPtr data = ci->getInputDataSlice(p_->dataReader, varName, sb);
-    if (data->size() == 0)
-        return data;
+    CachedInterpolationInterface_p ci;
+    DataPtr iData = interpolateSlice(varName, itP->second, sb, ci);
+    if (!iData)
+        return createData(variable.getDataType(), 0);
+    return ci->getOutputDataSlice(iData, sb);
+}
 
-    const double badValue = cdm_->getFillValue(varName);
-    auto array = data2InterpolationArray(data, badValue);
-    processArray_(p_->preprocesses, array.get(), data->size(), ci->getInX(), ci->getInY());
+size_t CDMInterpolator::readInto(const std::string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst)
+{
+    const CDMVariable& variable = cdm_->getVariable(varName);
+    if (initVariable(varName) || variable.hasData())
+        return CDMReader::readInto(varName, sb, dataType, dst);
 
-    size_t newSize = 0;
-    LOG4FIMEX(logger, Logger::DEBUG, "interpolateValues for: " << varName << "(slicebuilder)");
-    auto iArray = ci->interpolateValues(array, data->size(), newSize);
-
-    if (variable.isSpatialVector()) {
-        // vector in x/y direction
-        const CDMVariable::SpatialVectorDirection dir = variable.getSpatialVectorDirection();
-        if (dir == CDMVariable::SPATIAL_VECTOR_X || dir == CDMVariable::SPATIAL_VECTOR_Y) {
-            bool can_reproject = false;
-            const std::string& counterpart = variable.getSpatialVectorCounterpart();
-            Impl::projectionVariables_t::const_iterator itC = p_->projectionVariables.find(counterpart);
-            if (itC != p_->projectionVariables.end() && horizontalId == itC->second) {
-                Impl::cachedVectorReprojection_t::iterator itV = p_->cachedVectorReprojection.find(horizontalId);
-                if (itV != p_->cachedVectorReprojection.end()) {
-                    CachedVectorReprojection_p cvr = itV->second;
-                    // fetch and transpose vector-data
-                    // transposing needed once for each direction (or caching, but that needs to much memory)
-                    auto counterPartArray = data2InterpolationArray(ci->getInputDataSlice(p_->dataReader, counterpart, sb), cdm_->getFillValue(counterpart));
-                    processArray_(p_->preprocesses, counterPartArray.get(), data->size(), ci->getInX(), ci->getInY());
-                    LOG4FIMEX(logger, Logger::DEBUG, "implicit interpolateValues for: " << counterpart << "(slicebuilder)");
-                    auto counterpartiArray = ci->interpolateValues(counterPartArray, data->size(), newSize);
-                    if (dir == CDMVariable::SPATIAL_VECTOR_X)
-                        cvr->reprojectValues(iArray, counterpartiArray, newSize);
-                    else
-                        cvr->reprojectValues(counterpartiArray, iArray, newSize);
-                    can_reproject = true;
-                }
-            }
-            if (!can_reproject)
-                LOG4FIMEX(logger, Logger::WARN, "Cannot reproject vector " << variable.getName());
-        }
+    Impl::projectionVariables_t::const_iterator itP = p_->projectionVariables.find(varName);
+    if (itP == p_->projectionVariables.end()) {
+        // no projection, just forward
+        return p_->dataReader->readInto(varName, sb, dataType, dst);
     }
 
-    processArray_(p_->postprocesses, iArray.get(), newSize, ci->getOutX(), ci->getOutY());
+    CachedInterpolationInterface_p ci;
+    DataPtr iData = interpolateSlice(varName, itP->second, sb, ci);
+    if (!iData)
+        return 0;
 
-    return ci->getOutputDataSlice(interpolationArray2Data(variable.getDataType(), iArray, newSize, badValue), sb);
+    const vector<size_t>& dimSizes = sb.getDimensionSizes();
+    const size_t sbSize = std::accumulate(dimSizes.begin(), dimSizes.end(), size_t(1), std::multiplies<size_t>());
+    if (sbSize == iData->size()) {
+        // no x/y slicing of the output required, write the interpolated values directly
+        return copyValues(*iData, dataType, dst);
+    }
+    return copyValues(*ci->getOutputDataSlice(iData, sb), dataType, dst);
 }
 
 DataPtr CDMInterpolator::getDataSlice(const std::string& varName, size_t unLimDimPos)
 {
     const CDMVariable& variable = cdm_->getVariable(varName);
+    if (DataPtr generated = initVariable(varName))
+        return getDataSliceFromMemory(withData(variable, generated), unLimDimPos);
     if (variable.hasData())
         return getDataSliceFromMemory(variable, unLimDimPos);
 
-    SliceBuilder sb(*cdm_, varName);
-    if (const CDMDimension* unlimDim = cdm_->getUnlimitedDim()) {
-        if (cdm_->hasUnlimitedDim(variable))
-            sb.setStartAndSize(unlimDim->getName(), unLimDimPos, 1);
+    return getDataSlice(varName, unLimDimSlice(*cdm_, varName, unLimDimPos));
+}
+
+bool CDMInterpolator::supportsConcurrentReading() const
+{
+    return p_->dataReader->supportsConcurrentReading();
+}
+
+std::vector<DataPtr> CDMInterpolator::getDataSlices(const std::vector<std::string>& varNames, size_t unLimDimPos)
+{
+    std::vector<DataPtr> data(varNames.size());
+    // horizontalId, scalar variables interpolated together
+    std::map<std::string, std::vector<size_t>> batches;
+    for (size_t i = 0; i < varNames.size(); ++i) {
+        const std::string& varName = varNames[i];
+        const bool generated = bool(initVariable(varName));
+        const CDMVariable& variable = cdm_->getVariable(varName);
+        Impl::projectionVariables_t::const_iterator itP = p_->projectionVariables.find(varName);
+        if (generated || variable.hasData() || itP == p_->projectionVariables.end() || variable.isSpatialVector())
+            data[i] = getDataSlice(varName, unLimDimPos);
+        else
+            batches[itP->second].push_back(i);
     }
-    return getDataSlice(varName, sb);
+
+    for (const auto& batch : batches) {
+        std::vector<std::string> batchNames;
+        std::vector<SliceBuilder> sbs;
+        for (size_t i : batch.second) {
+            batchNames.push_back(varNames[i]);
+            sbs.push_back(unLimDimSlice(*cdm_, varNames[i], unLimDimPos));
+        }
+        CachedInterpolationInterface_p ci;
+        std::vector<DataPtr> iData = interpolateSlices(batchNames, batch.first, sbs, ci);
+        for (size_t k = 0; k < batch.second.size(); ++k) {
+            const size_t i = batch.second[k];
+            if (iData[k])
+                data[i] = ci->getOutputDataSlice(iData[k], sbs[k]);
+            else
+                data[i] = createData(cdm_->getVariable(varNames[i]).getDataType(), 0);
+        }
+    }
+    return data;
 }
 
 void CDMInterpolator::setLatitudeName(const std::string& latName) {
@@ -431,6 +961,7 @@ void CDMInterpolator::changeProjection(int method, const string& proj_input, con
     }
     *cdm_ = p_->dataReader->getCDM(); // reset previous changes
     p_->projectionVariables.clear(); // reset variables
+    p_->clearPending();
     switch (method) {
     case MIFI_INTERPOL_NEAREST_NEIGHBOR:
     case MIFI_INTERPOL_BILINEAR:
@@ -628,6 +1159,7 @@ void CDMInterpolator::changeProjection(int method, CDMReader_p tmplReader, const
     p_->projectionVariables.clear();  // reset variables
     p_->cachedInterpolation.clear();
     p_->cachedVectorReprojection.clear();
+    p_->clearPending();
 
     switch (method) {
         case MIFI_INTERPOL_NEAREST_NEIGHBOR:
@@ -723,6 +1255,41 @@ map<string, CoordinateSystem_cp> CDMInterpolator::findBestCoordinateSystemsAndPr
 }
 
 namespace {
+/**
+ * Add the longitude and latitude variables of the projection on the x/y axes, like
+ * CDM::generateProjectionCoordinates, but without computing their values.
+ *
+ * @param generated receives the values, the CDM is not changed after this call
+ * @return a setup computing the values, to be run before the values are read
+ */
+PendingSetup_p addProjectionCoordinates(CDM& cdm, const string& projectionVariable, const string& xDim, const string& yDim, const string& lonDim,
+                                        const string& latDim, GeneratedValues_p generated)
+{
+    const std::string projStr = Projection::create(cdm.getAttributes(projectionVariable))->getProj4String();
+    const vector<string> xyDims{xDim, yDim};
+    cdm.addVariable(CDMVariable(lonDim, CDM_DOUBLE, xyDims));
+    cdm.addVariable(CDMVariable(latDim, CDM_DOUBLE, xyDims));
+    cdm.addAttribute(lonDim, CDMAttribute("units", "degree_east"));
+    cdm.addAttribute(lonDim, CDMAttribute("long_name", "longitude"));
+    cdm.addAttribute(lonDim, CDMAttribute("standard_name", "longitude"));
+    cdm.addAttribute(latDim, CDMAttribute("units", "degree_north"));
+    cdm.addAttribute(latDim, CDMAttribute("long_name", "latitude"));
+    cdm.addAttribute(latDim, CDMAttribute("standard_name", "latitude"));
+
+    const DataPtr xData = cdm.getVariable(xDim).getData();
+    const DataPtr yData = cdm.getVariable(yDim).getData();
+    return std::make_shared<PendingSetup>([generated, xData, yData, projStr, xDim, yDim, lonDim, latDim]() {
+        const size_t fieldSize = xData->size() * yData->size();
+        auto lonVals = make_shared_array<double>(fieldSize);
+        auto latVals = make_shared_array<double>(fieldSize);
+        LOG4FIMEX(logger, Logger::DEBUG, "generating " << latDim << "(" << xDim << "," << yDim << ")," << lonDim << "(" << xDim << "," << yDim << ") using proj4: " << projStr);
+        reproject::reproject_axes(projStr, LAT_LON_PROJSTR, xData->asDouble().get(), yData->asDouble().get(), xData->size(), yData->size(), lonVals.get(),
+                                  latVals.get());
+        generated->set(latDim, createData(fieldSize, latVals));
+        generated->set(lonDim, createData(fieldSize, lonVals));
+    });
+}
+
 /**
  * make changes in the CDM structure to reflect the new projection (attributes, coordinates, projection-variable, dimensions)
  *
@@ -734,7 +1301,8 @@ namespace {
  */
 void changeCDM(CDM& cdm, const string& proj_input, const map<string, CoordinateSystem_cp>& csMap, map<string, string>& projectionVariables,
                const vector<double>& out_x_axis, const vector<double>& out_y_axis, const string& out_x_axis_unit, const string& out_y_axis_unit,
-               CDMDataType xAxisType, CDMDataType yAxisType, const string& longitudeName, const string& latitudeName)
+               CDMDataType xAxisType, CDMDataType yAxisType, const string& longitudeName, const string& latitudeName,
+               map<string, PendingSetup_p>& pendingVariables, GeneratedValues_p generatedValues)
 {
     string newProj = getProjectionName(proj_input);
     string newXAxis;
@@ -873,7 +1441,9 @@ void changeCDM(CDM& cdm, const string& proj_input, const map<string, CoordinateS
     if (newProj != "latlong") {
         lon = findUniqueVarName(cdm, lon);
         lat = findUniqueVarName(cdm, lat);
-        cdm.generateProjectionCoordinates(newProjection, newXAxis, newYAxis, lon, lat);
+        PendingSetup_p generate = addProjectionCoordinates(cdm, newProjection, newXAxis, newYAxis, lon, lat, generatedValues);
+        pendingVariables[lon] = generate;
+        pendingVariables[lat] = generate;
     }
 
     // find all reprojectable variables and change variable attributes grid_mapping and coordinates
@@ -950,6 +1520,37 @@ struct PointCloud
         }
 };
 
+// nanoflann result-set keeping only the closest point within a radius
+template <typename T>
+struct ClosestPointResultSet
+{
+    T dist;
+    size_t index;
+    bool found;
+
+    explicit ClosestPointResultSet(T radius)
+        : dist(radius)
+        , index(0)
+        , found(false)
+    {
+    }
+
+    inline size_t size() const { return found ? 1 : 0; }
+    inline bool full() const { return true; }
+    inline T worstDist() const { return dist; }
+    inline void addPoint(T d, size_t i)
+    {
+        if (d < dist) {
+            dist = d;
+            index = i;
+            found = true;
+        }
+    }
+};
+
+// points per task when querying the kd-tree
+const size_t KDTREE_QUERY_GRAIN = 4096;
+
 void flannTranslatePointsToClosestInputCell(double maxDist, shared_array<double> pointsOnXAxis /* degrees */, shared_array<double> pointsOnYAxis /* degrees */,
                                             size_t pointsSize, const double* lonVals /* degrees */, const double* latVals /* degrees */, size_t orgXDimSize,
                                             size_t orgYDimSize)
@@ -964,66 +1565,64 @@ void flannTranslatePointsToClosestInputCell(double maxDist, shared_array<double>
     maxDist /= MIFI_EARTH_RADIUS_M;
 
     time_t start = time(0);
+    // undefined lon/lat are left out of the tree, cloudPos maps tree index to input position
     PointCloud<double> cloud;
-    cloud.pts.resize(orgXDimSize*orgYDimSize);
-    for (size_t ix = 0; ix < orgXDimSize; ix++) {
-        for (size_t iy = 0; iy < orgYDimSize; iy++) {
-            const size_t pos = ix + iy * orgXDimSize;
-            if (!(std::isnan(latVals[pos]) || std::isnan(lonVals[pos]))) {
-                const double lat_rad = deg_to_rad(latVals[pos]);
-                const double lon_rad = deg_to_rad(lonVals[pos]);
-                const double sinLat = sin(lat_rad);
-                const double cosLat = cos(lat_rad);
-                const double sinLon = sin(lon_rad);
-                const double cosLon = cos(lon_rad);
-                cloud.pts[pos].x = cosLat * cosLon;
-                cloud.pts[pos].y = cosLat * sinLon;
-                cloud.pts[pos].z = sinLat;
-            } else {
-                cloud.pts[pos].x = MIFI_UNDEFINED_D;
-                cloud.pts[pos].y = MIFI_UNDEFINED_D;
-                cloud.pts[pos].z = MIFI_UNDEFINED_D;
-            }
+    std::vector<size_t> cloudPos;
+    cloud.pts.reserve(orgXDimSize * orgYDimSize);
+    cloudPos.reserve(orgXDimSize * orgYDimSize);
+    for (size_t pos = 0; pos < orgXDimSize * orgYDimSize; pos++) {
+        if (!(std::isnan(latVals[pos]) || std::isnan(lonVals[pos]))) {
+            const double lat_rad = deg_to_rad(latVals[pos]);
+            const double lon_rad = deg_to_rad(lonVals[pos]);
+            const double cosLat = cos(lat_rad);
+            PointCloud<double>::Point pt;
+            pt.x = cosLat * cos(lon_rad);
+            pt.y = cosLat * sin(lon_rad);
+            pt.z = sin(lat_rad);
+            cloud.pts.push_back(pt);
+            cloudPos.push_back(pos);
         }
     }
-    // construct a kd-tree index:
+    if (cloud.pts.empty()) {
+        LOG4FIMEX(logger, Logger::WARN, "no defined input points for nearest-neighbor search");
+        std::fill(pointsOnXAxis.get(), pointsOnXAxis.get() + pointsSize, -1000);
+        std::fill(pointsOnYAxis.get(), pointsOnYAxis.get() + pointsSize, -1000);
+        return;
+    }
+    // construct a kd-tree index, leaf size 16 was fastest for 1-nn queries on model grids
     typedef KDTreeSingleIndexAdaptor<L2_Simple_Adaptor<double, PointCloud<double> > ,
                                      PointCloud<double>,
                                      3 /* dim */> my_kd_tree_t;
-    my_kd_tree_t index(3 /*dim*/, cloud, KDTreeSingleIndexAdaptorParams(12 /* max leaf */) );
+    my_kd_tree_t index(3 /*dim*/, cloud, KDTreeSingleIndexAdaptorParams(16 /* max leaf */) );
     index.buildIndex();
-    LOG4FIMEX(logger, Logger::DEBUG, "finished loading kdTree after " << (time(0) - start) << "s");
+    LOG4FIMEX(logger, Logger::DEBUG, "finished loading kdTree with " << cloud.pts.size() << " points after " << (time(0) - start) << "s");
 
     // using square since distance is not sqrt
     const double search_radius = maxDist * maxDist;
-    nanoflann::SearchParams params;
-    params.sorted = true;
-    for (size_t i = 0; i < pointsSize; i++) {
-        const double lat_rad = deg_to_rad(pointsOnYAxis[i]);
-        const double lon_rad = deg_to_rad(pointsOnXAxis[i]);
-        const double sinLat = sin(lat_rad);
+    const nanoflann::SearchParams params;
+    double* pointsX = pointsOnXAxis.get();
+    double* pointsY = pointsOnYAxis.get();
+    WorkerPool::shared().parallelFor(0, pointsSize, [&](size_t i) {
+        const double lat_rad = deg_to_rad(pointsY[i]);
+        const double lon_rad = deg_to_rad(pointsX[i]);
         const double cosLat = cos(lat_rad);
-        const double sinLon = sin(lon_rad);
-        const double cosLon = cos(lon_rad);
-        const double query_pt[3] = { cosLat * cosLon,
-                                     cosLat * sinLon,
-                                     sinLat };
-
-        std::vector<std::pair<size_t,double> > ret_matches;
-        const size_t nMatches = index.radiusSearch(&query_pt[0], search_radius, ret_matches, params);
-        if (nMatches > 0) {
-            size_t pos = ret_matches.at(0).first; // pos = ix+orgXDimSize*iy =>
-            size_t ix = pos % orgXDimSize;
-            size_t iy = pos / orgXDimSize;
-            //LOG4FIMEX(logger, Logger::DEBUG, "found (" << RAD_TO_DEG*pointsOnXAxis[i] << "," << RAD_TO_DEG*pointsOnYAxis[i] << ") at (" << ix << "," << iy << ") dist: " << ret_matches.at(0).second);
-            pointsOnXAxis[i] = ix;
-            pointsOnYAxis[i] = iy;
+        const double query_pt[3] = { cosLat * cos(lon_rad),
+                                     cosLat * sin(lon_rad),
+                                     sin(lat_rad) };
+
+        ClosestPointResultSet<double> closest(search_radius);
+        if (!std::isnan(query_pt[0]))
+            index.findNeighbors(closest, &query_pt[0], params);
+        if (closest.found) {
+            const size_t pos = cloudPos[closest.index]; // pos = ix+orgXDimSize*iy
+            pointsX[i] = pos % orgXDimSize;
+            pointsY[i] = pos / orgXDimSize;
         } else {
             // set to any value outside the axes (0 - x/y-size)
-            pointsOnXAxis[i] = -1000;
-            pointsOnYAxis[i] = -1000;
+            pointsX[i] = -1000;
+            pointsY[i] = -1000;
         }
-    }
+    }, KDTREE_QUERY_GRAIN);
     LOG4FIMEX(logger, Logger::DEBUG, "finished flannKDTranslatePointsToClosestInputCell");
 }
 
@@ -1034,81 +1633,59 @@ double /* rad */ getGridDistance(const double* lonVals, // in degrees
     // try to determine a average grid-distance, take some example points, evaluate the max,
     // multiply that with a number slightly bigger than 1 (i use 1.414
     // and define that as grid distance
-    vector<double> samples;
-    int steps;
-    size_t stepSize;
-    if (orgXDimSize * orgYDimSize > 1000) {
+    const size_t size = orgXDimSize * orgYDimSize;
+    size_t steps, stepSize;
+    if (size > 1000) {
         steps = 53; // unusual grid-dimension
-        stepSize = orgXDimSize * orgYDimSize / steps;
+        stepSize = size / steps;
     } else {
         stepSize = 1;
-        steps = orgXDimSize * orgYDimSize;
+        steps = size;
     }
-#ifdef _OPENMP
-#pragma omp parallel default(none) firstprivate(steps, stepSize, orgXDimSize, orgYDimSize) shared(samples, lonVals, latVals) if (steps > 4)
-    {
-#pragma omp for nowait
-#endif
-    for (int ik = 0; ik < steps; ik++) { // using int instead of size_t because of openMP < 3.0
+
+    // unit vectors, the cosine of the great-circle distance is then the dot-product
+    std::vector<double> xyz(3 * size);
+    WorkerPool::shared().parallelFor(0, size, [&](size_t pos) {
+        const double lat = deg_to_rad(latVals[pos]);
+        const double lon = deg_to_rad(lonVals[pos]);
+        xyz[3 * pos] = cos(lat) * cos(lon);
+        xyz[3 * pos + 1] = cos(lat) * sin(lon);
+        xyz[3 * pos + 2] = sin(lat);
+    }, 16384);
+
+    // smallest distance (= max cosinus value) from each sample to any other point, nan for undefined samples
+    vector<double> samples(steps, MIFI_UNDEFINED_D);
+    WorkerPool::shared().parallelFor(0, steps, [&](size_t ik) {
         const size_t samplePos = ik * stepSize;
-        const double lon0 = deg_to_rad(lonVals[samplePos]);
-        const double lat0 = deg_to_rad(latVals[samplePos]);
-        if (!(std::isnan(lon0) || std::isnan(lat0))) {
-            double min_cos_d = -2; // max possible distance on unit-sphere has cos_d -1 -> d= pi * r
-            for (size_t ix = 0; ix < orgXDimSize; ix++) {
-                for (size_t iy = 0; iy < orgYDimSize; iy++) {
-                    // find smallest distance (= max cosinus value): http://en.wikipedia.org/wiki/Great-circle_distance
-                    const size_t pos = ix + iy * orgXDimSize;
-                    if (pos != samplePos) {
-                        const double lon1 = deg_to_rad(lonVals[pos]);
-                        const double lat1 = deg_to_rad(latVals[pos]);
-                        if (!(std::isnan(lon1) || std::isnan(lat1))) {
-                            const double dlon = lon0 - lon1;
-                            const double cos_d = cos(lat0) * cos(lat1) * cos(dlon) + sin(lat0) * sin(lat1);
-                            if (cos_d > min_cos_d) {
-                                min_cos_d = cos_d;
-                            }
-                        }
-                    }
-                }
-            }
-#ifdef _OPENMP
-#pragma omp critical (cdminterpolator_getgriddistance)
-            {
-#endif
-            samples.push_back(min_cos_d);
-#ifdef _OPENMP
-            }
-#endif
+        const double* p0 = &xyz[3 * samplePos];
+        if (std::isnan(p0[0]))
+            return;
+        double min_cos_d = -1; // max possible distance on unit-sphere has cos_d -1 -> d= pi * r
+        for (size_t pos = 0; pos < size; pos++) {
+            const double* p1 = &xyz[3 * pos];
+            const double cos_d = p0[0] * p1[0] + p0[1] * p1[1] + p0[2] * p1[2];
+            if (pos != samplePos && cos_d > min_cos_d) // false for undefined points
+                min_cos_d = cos_d;
+        }
+        samples[ik] = min_cos_d;
+    });
+
+    double min_cos_d = 1;
+    bool found = false;
+    for (double s : samples) {
+        if (!std::isnan(s)) {
+            min_cos_d = std::min(min_cos_d, s);
+            found = true;
         }
     }
-#ifdef _OPENMP
-    }
-#endif
-    const double max_grid_d = acos(*(min_element(samples.begin(), samples.end()))) * 1.414; // allow a bit larger extrapolation (diagonal = sqrt(2))
+    if (!found)
+        return 0;
+    const double max_grid_d = acos(min_cos_d) * 1.414; // allow a bit larger extrapolation (diagonal = sqrt(2))
     return std::min(max_grid_d, MIFI_PI);
 }
 
-// internal setup for binary search lat/long
-class LL_POINT {
-public:
-    double lat; //! in radians
-    double lon; //! in radians
-    double x;
-    double y;
-    LL_POINT() : lat(0), lon(0), x(-1.), y(-1.) {}
-    LL_POINT(double lat_deg, double lon_deg, double x, double y)
-        : lat(deg_to_rad(lat_deg))
-        , lon(deg_to_rad(lon_deg))
-        , x(x)
-        , y(y)
-    {
-    }
-    bool operator<(const LL_POINT& rhs) const { return (this->lat < rhs.lat); }
-};
-
 // translate all degree-values of pointsOnX/YAxis to the nearest index
-// in lonVals/latVals using a binary search in latitude-direction, otherwise brute-force
+// in lonVals/latVals using a bucket-grid on the sphere
 void fastTranslatePointsToClosestInputCell(shared_array<double> pointsOnXAxis /* degrees */, shared_array<double> pointsOnYAxis /* degrees */,
                                            size_t pointsSize, const double* lonVals /* degrees */, const double* latVals /* degrees */, size_t orgXDimSize,
                                            size_t orgYDimSize)
@@ -1117,76 +1694,22 @@ void fastTranslatePointsToClosestInputCell(shared_array<double> pointsOnXAxis /*
     const time_t start = time(0);
     const double max_grid_d = getGridDistance(&lonVals[0], &latVals[0], orgXDimSize, orgYDimSize);
     LOG4FIMEX(logger, Logger::DEBUG, "assuming a ROI of input-data as: "<< (max_grid_d*180/MIFI_PI) << "deg after " << (time(0) - start) << "s");
-    double min_grid_cos_d = cos(max_grid_d); // this is const, but declaring it const causes problems with OpenMP for some compilers
-
-    // 1. order lat/lon after latitude
-    // 2. search for closest latitude
-    // 3. go up and down in list as long as dlat < min_dist
-    std::vector<LL_POINT> latlons;
-    latlons.reserve(orgXDimSize*orgYDimSize);
-    for (size_t ix = 0; ix < orgXDimSize; ix++) {
-        for (size_t iy = 0; iy < orgYDimSize; iy++) {
-            size_t pos = ix+iy*orgXDimSize;
-            if (!(std::isnan(lonVals[pos]) || std::isnan(latVals[pos]))) {
-                latlons.push_back(LL_POINT(latVals[pos],lonVals[pos], ix, iy));
-            }
-        }
-    }
-    // sort latlons by latitudes
-    sort(latlons.begin(), latlons.end());
-#ifdef _OPENMP
-#pragma omp parallel default(none) shared(pointsOnXAxis, pointsOnYAxis, pointsSize, latlons, min_grid_cos_d)
-    {
-#pragma omp for nowait
-#endif
-    for (int i = 0; i < static_cast<int>(pointsSize); i++) { // using int instead of size_t because of openMP < 3.0
-        //         lat               lon
-        LL_POINT p(pointsOnYAxis[i], pointsOnXAxis[i], -1., -1.);
-        double min_cos_d = min_grid_cos_d; // max allowed distance
-        double min_d = acos(min_cos_d);
-        vector<LL_POINT>::const_iterator it = lower_bound(latlons.begin(), latlons.end(), p);
-        vector<LL_POINT>::const_iterator it2 = it;
-        // loop until end
-        while (it != latlons.end()) {
-            double dlon = it->lon - p.lon;
-            if (fabs(it->lat - p.lat) > min_d) {
-                it = latlons.end(); // all successing
-            } else {
-                double cos_d = cos(it->lat) * cos(p.lat) * cos(dlon) + sin(it->lat) * sin(p.lat);
-                if (cos_d > min_cos_d) { // closer distance
-                    min_cos_d = cos_d;
-                    min_d = acos(min_cos_d);
-                    p.x = it->x;
-                    p.y = it->y;
-                }
-                it++;
-            }
-        }
-        // loop until beginning
-        if (it2 != latlons.begin()) {
-            do {
-                it2--;
-                double dlon = it2->lon - p.lon;
-                if (fabs(it2->lat - p.lat) > min_d) {
-                    it2 = latlons.begin(); // all successing
-                } else {
-                    double cos_d = cos(it2->lat) * cos(p.lat) * cos(dlon) + sin(it2->lat) * sin(p.lat);
-                    if (cos_d > min_cos_d) { // closer distance
-                        min_cos_d = cos_d;
-                        min_d = acos(min_cos_d);
-                        p.x = it2->x;
-                        p.y = it2->y;
-                    }
-                }
-            } while (it2 != latlons.begin());
-        }
 
-        pointsOnYAxis[i] = p.y;
-        pointsOnXAxis[i] = p.x;
-    }
-#ifdef _OPENMP
-    }
-#endif
+    const LatLonBuckets buckets(lonVals, latVals, orgXDimSize * orgYDimSize, max_grid_d);
+    LOG4FIMEX(logger, Logger::DEBUG, "sorted " << buckets.size() << " points into buckets after " << (time(0) - start) << "s");
+
+    double* pointsX = pointsOnXAxis.get();
+    double* pointsY = pointsOnYAxis.get();
+    WorkerPool::shared().parallelFor(0, pointsSize, [&](size_t i) {
+        const size_t pos = buckets.closest(pointsX[i], pointsY[i], max_grid_d);
+        if (pos != LatLonBuckets::NOT_FOUND) {
+            pointsX[i] = pos % orgXDimSize;
+            pointsY[i] = pos / orgXDimSize;
+        } else {
+            pointsX[i] = -1;
+            pointsY[i] = -1;
+        }
+    }, 1024);
 }
 } // namespace
 
@@ -1205,71 +1728,79 @@ void CDMInterpolator::changeProjectionByForwardInterpolation(int method, const s
     changeCDM(*cdm_.get(), proj_input, csMap, p_->projectionVariables,
               out_x_axis, out_y_axis, out_x_axis_unit, out_y_axis_unit,
               out_x_axis_type, out_y_axis_type,
-              getLongitudeName(), getLatitudeName());
+              getLongitudeName(), getLatitudeName(), p_->pendingVariables, p_->generatedValues);
 
     for (map<string, CoordinateSystem_cp>::iterator csIt = csMap.begin(); csIt != csMap.end(); ++csIt) {
+        const std::string horizontalId = csIt->first;
         CoordinateSystem_cp cs = csIt->second;
-        const CoordinateAxis_cp axis_lat = cs->findAxisOfType(CoordinateAxis::Lat);
-        const CoordinateAxis_cp axis_lon = cs->findAxisOfType(CoordinateAxis::Lon);
-        const CoordinateAxis_cp axis_geo_y = cs->findAxisOfType(CoordinateAxis::GeoY);
-        const CoordinateAxis_cp axis_geo_x = cs->findAxisOfType(CoordinateAxis::GeoX);
-
-        const string& name_lat = axis_lat->getName();
-        const string& name_lon = axis_lon->getName();
-        const std::string name_geo_y = (axis_geo_y ? axis_geo_y->getName() : std::string());
-        const std::string name_geo_x = (axis_geo_x ? axis_geo_x->getName() : std::string());
-
-        shared_array<double> orgLonVals, orgLatVals;
-        size_t orgLatSize, orgLonSize;
-        extractValues(p_->dataReader->getScaledData(name_lon), orgLonVals, orgLonSize);
-        extractValues(p_->dataReader->getScaledData(name_lat), orgLatVals, orgLatSize);
-
-        const std::vector<string>& shape_lat = p_->dataReader->getCDM().getVariable(name_lat).getShape();
-        const std::vector<string>& shape_lon = p_->dataReader->getCDM().getVariable(name_lon).getShape();
-
-        string orgXDimName, orgYDimName;
-        if (axis_geo_y && axis_geo_x) {
-            orgXDimName = name_geo_x;
-            orgYDimName = name_geo_y;
-            LOG4FIMEX(logger, Logger::DEBUG, "x and y axis from GeoX/GeoY: " << orgXDimName << "," << orgYDimName);
-        } else if (shape_lat.size() == 1 && shape_lon.size() == 1) {
-            // x and y axis not properly defined, guessing
-            orgXDimName = shape_lon.front();
-            orgYDimName = shape_lat.front();
-            LOG4FIMEX(logger, Logger::INFO, "guessed x axis from lon and y axis from lat: " << orgXDimName << "," << orgYDimName);
-        } else if (shape_lat.size() == 2 && shape_lat == shape_lon) {
-            orgXDimName = shape_lat[0];
-            orgYDimName = shape_lat[1];
-            LOG4FIMEX(logger, Logger::INFO, "guessed x and y axis from 2D lon/lat: " << orgXDimName << "," << orgYDimName);
-        } else {
-            throw CDMException("unable to guess x/y from latitude variable");
-        }
-        const size_t orgXDimSize = p_->dataReader->getCDM().getDimension(orgXDimName).getLength();
-        const size_t orgYDimSize = p_->dataReader->getCDM().getDimension(orgYDimName).getLength();
-        size_t orgXYSize;
-        if (shape_lat.size() == 1) {
-            // create new latVals and lonVals as a matrix
-            lonLatVals2Matrix(orgLonVals, orgLatVals, orgXDimSize, orgYDimSize);
-            orgXYSize = orgLonSize * orgLatSize;
-        } else if (shape_lat.size() != 2) {
-            throw CDMException("need lat and lon with 1 or 2 dimensions");
-        } else {
-            orgXYSize = orgLonSize;
-        }
-
-        // translate all input points to output-coordinates, stored in lonVals and latVals
-        LOG4FIMEX(logger, Logger::DEBUG, "start reprojection of coordinates");
-        reproject::reproject_values(LAT_LON_PROJSTR, proj_input, &orgLonVals[0], &orgLatVals[0], orgXYSize);
-
-        // translate the converted input-coordinates (lonvals and latvals) to cell-positions in output
-        LOG4FIMEX(logger, Logger::DEBUG, "start calculating positions");
-        mifi_points2position(&orgLonVals[0], orgXYSize, &out_x_axis[0], out_x_axis.size(), miupXAxis);
-        mifi_points2position(&orgLatVals[0], orgXYSize, &out_y_axis[0], out_y_axis.size(), miupYAxis);
+        p_->pendingInterpolation[horizontalId] = std::make_shared<PendingSetup>([=]() {
+            const CoordinateAxis_cp axis_lat = cs->findAxisOfType(CoordinateAxis::Lat);
+            const CoordinateAxis_cp axis_lon = cs->findAxisOfType(CoordinateAxis::Lon);
+            const CoordinateAxis_cp axis_geo_y = cs->findAxisOfType(CoordinateAxis::GeoY);
+            const CoordinateAxis_cp axis_geo_x = cs->findAxisOfType(CoordinateAxis::GeoX);
+
+            const string& name_lat = axis_lat->getName();
+            const string& name_lon = axis_lon->getName();
+            const std::string name_geo_y = (axis_geo_y ? axis_geo_y->getName() : std::string());
+            const std::string name_geo_x = (axis_geo_x ? axis_geo_x->getName() : std::string());
+
+            shared_array<double> orgLonVals, orgLatVals;
+            size_t orgLatSize, orgLonSize;
+            extractValues(p_->dataReader->getScaledData(name_lon), orgLonVals, orgLonSize);
+            extractValues(p_->dataReader->getScaledData(name_lat), orgLatVals, orgLatSize);
+
+            const std::vector<string>& shape_lat = p_->dataReader->getCDM().getVariable(name_lat).getShape();
+            const std::vector<string>& shape_lon = p_->dataReader->getCDM().getVariable(name_lon).getShape();
+
+            string orgXDimName, orgYDimName;
+            if (axis_geo_y && axis_geo_x) {
+                orgXDimName = name_geo_x;
+                orgYDimName = name_geo_y;
+                LOG4FIMEX(logger, Logger::DEBUG, "x and y axis from GeoX/GeoY: " << orgXDimName << "," << orgYDimName);
+            } else if (shape_lat.size() == 1 && shape_lon.size() == 1) {
+                // x and y axis not properly defined, guessing
+                orgXDimName = shape_lon.front();
+                orgYDimName = shape_lat.front();
+                LOG4FIMEX(logger, Logger::INFO, "guessed x axis from lon and y axis from lat: " << orgXDimName << "," << orgYDimName);
+            } else if (shape_lat.size() == 2 && shape_lat == shape_lon) {
+                orgXDimName = shape_lat[0];
+                orgYDimName = shape_lat[1];
+                LOG4FIMEX(logger, Logger::INFO, "guessed x and y axis from 2D lon/lat: " << orgXDimName << "," << orgYDimName);
+            } else {
+                throw CDMException("unable to guess x/y from latitude variable");
+            }
+            const size_t orgXDimSize = p_->dataReader->getCDM().getDimension(orgXDimName).getLength();
+            const size_t orgYDimSize = p_->dataReader->getCDM().getDimension(orgYDimName).getLength();
+            size_t orgXYSize;
+            if (shape_lat.size() == 1) {
+                // create new latVals and lonVals as a matrix
+                lonLatVals2Matrix(orgLonVals, orgLatVals, orgXDimSize, orgYDimSize);
+                orgXYSize = orgLonSize * orgLatSize;
+            } else if (shape_lat.size() != 2) {
+                throw CDMException("need lat and lon with 1 or 2 dimensions");
+            } else {
+                orgXYSize = orgLonSize;
+            }
 
-        // store the interpolation
-        LOG4FIMEX(logger, Logger::DEBUG, "creating cached forward interpolation matrix " << orgXDimSize << "x" << orgYDimSize << " => " << out_x_axis.size() << "x" << out_y_axis.size());
-        p_->cachedInterpolation[csIt->first] = std::make_shared<CachedForwardInterpolation>(orgXDimName, orgYDimName, method, orgLonVals, orgLatVals,
-                                                                                            orgXDimSize, orgYDimSize, out_x_axis.size(), out_y_axis.size());
+            InterpolationCacheKey key;
+            key.add("forward").add(proj_input).add(out_x_axis).add(out_y_axis).add(out_x_axis_unit).add(out_y_axis_unit);
+            key.add(orgLonVals.get(), orgXYSize).add(orgLatVals.get(), orgXYSize);
+            cachedPositions(key, orgLonVals, orgLatVals, orgXYSize, [&]() {
+                // translate all input points to output-coordinates, stored in lonVals and latVals
+                LOG4FIMEX(logger, Logger::DEBUG, "start reprojection of coordinates");
+                reproject::reproject_values(LAT_LON_PROJSTR, proj_input, &orgLonVals[0], &orgLatVals[0], orgXYSize);
+
+                // translate the converted input-coordinates (lonvals and latvals) to cell-positions in output
+                LOG4FIMEX(logger, Logger::DEBUG, "start calculating positions");
+                AxisLookup(&out_x_axis[0], out_x_axis.size(), miupXAxis).positions(&orgLonVals[0], orgXYSize);
+                AxisLookup(&out_y_axis[0], out_y_axis.size(), miupYAxis).positions(&orgLatVals[0], orgXYSize);
+            });
+
+            // store the interpolation
+            LOG4FIMEX(logger, Logger::DEBUG, "creating cached forward interpolation matrix " << orgXDimSize << "x" << orgYDimSize << " => " << out_x_axis.size() << "x" << out_y_axis.size());
+            p_->setInterpolation(horizontalId, std::make_shared<CachedForwardInterpolation>(orgXDimName, orgYDimName, method, orgLonVals, orgLatVals,
+                                                                                             orgXDimSize, orgYDimSize, out_x_axis.size(), out_y_axis.size()));
+        });
     }
     if (hasXYSpatialVectors()) {
         LOG4FIMEX(logger, Logger::WARN, "vector data found, but not possible to interpolate with forward-interpolation");
@@ -1285,68 +1816,83 @@ void CDMInterpolator::changeProjectionByCoordinates(int method, const string& pr
     changeCDM(*cdm_.get(), proj_input, csMap, p_->projectionVariables,
               out_x_axis, out_y_axis, out_x_axis_unit, out_y_axis_unit,
               out_x_axis_type, out_y_axis_type,
-              getLongitudeName(), getLatitudeName());
+              getLongitudeName(), getLatitudeName(), p_->pendingVariables, p_->generatedValues);
 
     // store projection changes to be used in data-section
     const std::regex degree(".*degree.*");
     const bool isDegree = std::regex_match(out_x_axis_unit, degree) || std::regex_match(out_y_axis_unit, degree);
 
+    double maxDistance = 0;
+    if (method == MIFI_INTERPOL_COORD_NN_KD) {
+        maxDistance = getMaxDistanceOfInterest(out_x_axis, out_y_axis);
+        if (isDegree) {
+            maxDistance *= MIFI_EARTH_RADIUS_M;
+        }
+    } else if (method != MIFI_INTERPOL_COORD_NN) {
+        throw CDMException("unkown interpolation method for coordinates: " + type2string(method));
+    }
+
     for (map<string, CoordinateSystem_cp>::iterator csIt = csMap.begin(); csIt != csMap.end(); ++csIt) {
+        const std::string horizontalId = csIt->first;
         CoordinateSystem_cp cs = csIt->second;
-        const std::string& latitude = cs->findAxisOfType(CoordinateAxis::Lat)->getName();
-        const std::string& longitude = cs->findAxisOfType(CoordinateAxis::Lon)->getName();
-
-        shared_array<double> latVals, lonVals;
-        size_t latSize, lonSize;
-        extractValues(p_->dataReader->getScaledData(latitude), latVals, latSize);
-        extractValues(p_->dataReader->getScaledData(longitude), lonVals, lonSize);
-
-        string orgXDimName, orgYDimName;
-        const bool latLonProj = (cs->hasProjection() && (cs->getProjection()->getName() == "latitude_longitude"));
-        if (!latLonProj && cs->getGeoYAxis()->getName() == latitude) {
-            // x and y axis not properly defined, guessing
-            const vector<string>& latShape = p_->dataReader->getCDM().getVariable(latitude).getShape();
-            if (latShape.size() != 2) {
-                throw CDMException("latitude needs 2 dims for forward interpolation");
+        p_->pendingInterpolation[horizontalId] = std::make_shared<PendingSetup>([=]() {
+            const std::string& latitude = cs->findAxisOfType(CoordinateAxis::Lat)->getName();
+            const std::string& longitude = cs->findAxisOfType(CoordinateAxis::Lon)->getName();
+
+            shared_array<double> latVals, lonVals;
+            size_t latSize, lonSize;
+            extractValues(p_->dataReader->getScaledData(latitude), latVals, latSize);
+            extractValues(p_->dataReader->getScaledData(longitude), lonVals, lonSize);
+
+            string orgXDimName, orgYDimName;
+            const bool latLonProj = (cs->hasProjection() && (cs->getProjection()->getName() == "latitude_longitude"));
+            if (!latLonProj && cs->getGeoYAxis()->getName() == latitude) {
+                // x and y axis not properly defined, guessing
+                const vector<string>& latShape = p_->dataReader->getCDM().getVariable(latitude).getShape();
+                if (latShape.size() != 2) {
+                    throw CDMException("latitude needs 2 dims for forward interpolation");
+                }
+                orgXDimName = latShape[0];
+                orgYDimName = latShape[1];
+            } else {
+                orgXDimName = cs->getGeoXAxis()->getName();
+                orgYDimName = cs->getGeoYAxis()->getName();
             }
-            orgXDimName = latShape[0];
-            orgYDimName = latShape[1];
-        } else {
-            orgXDimName = cs->getGeoXAxis()->getName();
-            orgYDimName = cs->getGeoYAxis()->getName();
-        }
-        LOG4FIMEX(logger, Logger::DEBUG, "x and y axis: " << orgXDimName << "," << orgYDimName);
-        const size_t orgXDimSize = p_->dataReader->getCDM().getDimension(orgXDimName).getLength();
-        const size_t orgYDimSize = p_->dataReader->getCDM().getDimension(orgYDimName).getLength();
-        if (latLonProj) {
-            // create new latVals and lonVals as a matrix
-            lonLatVals2Matrix(lonVals, latVals, orgXDimSize, orgYDimSize);
-        }
-
-        // get output axes expressed in latitude, longitude
-        const size_t fieldSize = out_x_axis.size() * out_y_axis.size();
-        auto pointsOnXAxis = make_shared_array<double>(fieldSize);
-        auto pointsOnYAxis = make_shared_array<double>(fieldSize);
-        reproject::reproject_axes(proj_input, LAT_LON_PROJSTR, &out_x_axis[0], &out_y_axis[0], out_x_axis.size(), out_y_axis.size(), &pointsOnXAxis[0],
-                                  &pointsOnYAxis[0]);
-        // here, pointOnX/YAxis is in degrees
-        if (method == MIFI_INTERPOL_COORD_NN) {
-            fastTranslatePointsToClosestInputCell(pointsOnXAxis, pointsOnYAxis, fieldSize, &lonVals[0], &latVals[0], orgXDimSize, orgYDimSize);
-        } else if (method == MIFI_INTERPOL_COORD_NN_KD) {
-            double maxDistance = getMaxDistanceOfInterest(out_x_axis, out_y_axis);
-            if (isDegree) {
-                maxDistance *= MIFI_EARTH_RADIUS_M;
+            LOG4FIMEX(logger, Logger::DEBUG, "x and y axis: " << orgXDimName << "," << orgYDimName);
+            const size_t orgXDimSize = p_->dataReader->getCDM().getDimension(orgXDimName).getLength();
+            const size_t orgYDimSize = p_->dataReader->getCDM().getDimension(orgYDimName).getLength();
+            if (latLonProj) {
+                // create new latVals and lonVals as a matrix
+                lonLatVals2Matrix(lonVals, latVals, orgXDimSize, orgYDimSize);
             }
-            flannTranslatePointsToClosestInputCell(maxDistance, pointsOnXAxis, pointsOnYAxis, fieldSize, &lonVals[0], &latVals[0], orgXDimSize, orgYDimSize);
-        } else {
-            throw CDMException("unkown interpolation method for coordinates: " + type2string(method));
-        }
 
-        LOG4FIMEX(logger, Logger::DEBUG,
-                  "creating cached coordinate interpolation matrix " << orgXDimSize << "x" << orgYDimSize << " => " << out_x_axis.size() << "x"
-                                                                     << out_y_axis.size());
-        p_->cachedInterpolation[csIt->first] = createCachedInterpolation(orgXDimName, orgYDimName, method, pointsOnXAxis, pointsOnYAxis, orgXDimSize,
-                                                                         orgYDimSize, out_x_axis.size(), out_y_axis.size());
+            // get output axes expressed in latitude, longitude
+            const size_t fieldSize = out_x_axis.size() * out_y_axis.size();
+            auto pointsOnXAxis = make_shared_array<double>(fieldSize);
+            auto pointsOnYAxis = make_shared_array<double>(fieldSize);
+
+            InterpolationCacheKey key;
+            key.add("coordinates").add(static_cast<long long>(method)).add(maxDistance);
+            key.add(proj_input).add(out_x_axis).add(out_y_axis).add(out_x_axis_unit).add(out_y_axis_unit);
+            key.add(static_cast<long long>(orgXDimSize)).add(lonVals.get(), orgXDimSize * orgYDimSize).add(latVals.get(), orgXDimSize * orgYDimSize);
+            cachedPositions(key, pointsOnXAxis, pointsOnYAxis, fieldSize, [&]() {
+                reproject::reproject_axes(proj_input, LAT_LON_PROJSTR, &out_x_axis[0], &out_y_axis[0], out_x_axis.size(), out_y_axis.size(), &pointsOnXAxis[0],
+                                          &pointsOnYAxis[0]);
+                // here, pointOnX/YAxis is in degrees
+                if (method == MIFI_INTERPOL_COORD_NN) {
+                    fastTranslatePointsToClosestInputCell(pointsOnXAxis, pointsOnYAxis, fieldSize, &lonVals[0], &latVals[0], orgXDimSize, orgYDimSize);
+                } else {
+                    flannTranslatePointsToClosestInputCell(maxDistance, pointsOnXAxis, pointsOnYAxis, fieldSize, &lonVals[0], &latVals[0], orgXDimSize,
+                                                           orgYDimSize);
+                }
+            });
+
+            LOG4FIMEX(logger, Logger::DEBUG,
+                      "creating cached coordinate interpolation matrix " << orgXDimSize << "x" << orgYDimSize << " => " << out_x_axis.size() << "x"
+                                                                         << out_y_axis.size());
+            p_->setInterpolation(horizontalId, createCachedInterpolation(orgXDimName, orgYDimName, method, pointsOnXAxis, pointsOnYAxis, orgXDimSize,
+                                                                          orgYDimSize, out_x_axis.size(), out_y_axis.size()));
+        });
     }
 
     if (hasXYSpatialVectors()) {
@@ -1360,61 +1906,87 @@ void CDMInterpolator::changeProjectionByProjectionParameters(int method, const s
     changeCDM(*cdm_.get(), proj_input, csMap, p_->projectionVariables,
               out_x_axis, out_y_axis, out_x_axis_unit, out_y_axis_unit,
               out_x_axis_type, out_y_axis_type,
-              getLongitudeName(), getLatitudeName());
+              getLongitudeName(), getLatitudeName(), p_->pendingVariables, p_->generatedValues);
 
     // store projection changes to be used in data-section
     const bool outIsDegree = unitIsDegree(out_x_axis_unit, out_y_axis_unit);
     const int outXAxisType = outIsDegree ? MIFI_LONGITUDE : MIFI_PROJ_AXIS;
     const int outYAxisType = outIsDegree ? MIFI_LATITUDE : MIFI_PROJ_AXIS;
+    const bool xyVectors = hasXYSpatialVectors();
 
     for (map<string, CoordinateSystem_cp>::iterator csIt = csMap.begin(); csIt != csMap.end(); ++csIt) {
+        const std::string horizontalId = csIt->first;
         CoordinateSystem_cp cs = csIt->second;
+        warnUnlessAllXYSpatialVectorsHaveSameHorizontalId(horizontalId);
+        p_->pendingInterpolation[horizontalId] = std::make_shared<PendingSetup>([=]() {
+
+            // translate axes to 'm' if given in other metric units
+            const bool isDegree = cs->getProjection()->isDegree();
+            const std::string orgUnit = isDegree ? "degree" : "m";
+            const std::string& orgXAxisName = cs->getGeoXAxis()->getName();
+            const std::string& orgYAxisName = cs->getGeoYAxis()->getName();
+
+            shared_array<double> orgXAxisValsArray, orgYAxisValsArray;
+            size_t orgXAxisSize, orgYAxisSize;
+            extractValues(p_->dataReader->getScaledDataInUnit(orgXAxisName, orgUnit), orgXAxisValsArray, orgXAxisSize);
+            extractValues(p_->dataReader->getScaledDataInUnit(orgYAxisName, orgUnit), orgYAxisValsArray, orgYAxisSize);
+
+            const std::string orgProjStr = cs->getProjection()->getProj4String();
+            const int miupXAxis = isDegree ? MIFI_LONGITUDE : MIFI_PROJ_AXIS;
+            const int miupYAxis = isDegree ? MIFI_LATITUDE : MIFI_PROJ_AXIS;
+
+            shared_array<double> columnsOnXAxis, rowsOnYAxis;
+            if (separablePositions(proj_input, orgProjStr, out_x_axis, out_y_axis, orgXAxisValsArray.get(), orgXAxisSize, miupXAxis, orgYAxisValsArray.get(),
+                                   orgYAxisSize, miupYAxis, columnsOnXAxis, rowsOnYAxis)) {
+                // e.g. the same projection, positions and weights per axis
+                LOG4FIMEX(logger, Logger::DEBUG,
+                          "creating separable projection interpolation " << orgXAxisSize << "x" << orgYAxisSize << " => " << out_x_axis.size() << "x"
+                                                                         << out_y_axis.size());
+                p_->setInterpolation(horizontalId, std::make_shared<CachedSeparableInterpolation>(
+                    orgXAxisName, orgYAxisName, method, columnsOnXAxis, rowsOnYAxis, orgXAxisSize, orgYAxisSize, out_x_axis.size(), out_y_axis.size()));
+            } else {
+                // calculate the mapping from the new projection points to the original axes pointsOnXAxis(x_new, y_new), pointsOnYAxis(x_new, y_new)
+                const size_t fieldSize = out_x_axis.size() * out_y_axis.size();
+                auto pointsOnXAxis = make_shared_array<double>(fieldSize);
+                auto pointsOnYAxis = make_shared_array<double>(fieldSize);
+                // the positions do not depend on the method
+                InterpolationCacheKey key;
+                key.add("projection").add(proj_input).add(out_x_axis).add(out_y_axis).add(out_x_axis_unit).add(out_y_axis_unit);
+                key.add(orgProjStr).add(orgUnit).add(orgXAxisValsArray.get(), orgXAxisSize).add(orgYAxisValsArray.get(), orgYAxisSize);
+                cachedPositions(key, pointsOnXAxis, pointsOnYAxis, fieldSize, [&]() {
+                    reproject::reproject_axes(proj_input, orgProjStr, &out_x_axis[0], &out_y_axis[0], out_x_axis.size(), out_y_axis.size(), &pointsOnXAxis[0],
+                                              &pointsOnYAxis[0]);
+                    LOG4FIMEX(logger, Logger::DEBUG,
+                              "mifi_project_axes: " << proj_input << "," << orgProjStr << "," << out_x_axis[0] << "," << out_y_axis[0] << " => "
+                                                    << pointsOnXAxis[0] << "," << pointsOnYAxis[0]);
+
+                    // translate coordinates (in deg or m) to indices
+                    AxisLookup(orgXAxisValsArray.get(), orgXAxisSize, miupXAxis).positions(&pointsOnXAxis[0], fieldSize);
+                    AxisLookup(orgYAxisValsArray.get(), orgYAxisSize, miupYAxis).positions(&pointsOnYAxis[0], fieldSize);
+                });
+
+                LOG4FIMEX(logger, Logger::DEBUG,
+                          "creating cached projection interpolation matrix " << orgXAxisSize << "x" << orgYAxisSize << " => " << out_x_axis.size() << "x"
+                                                                             << out_y_axis.size());
+                p_->setInterpolation(horizontalId, createCachedInterpolation(orgXAxisName, orgYAxisName, method, pointsOnXAxis, pointsOnYAxis,
+                                                                              orgXAxisSize, orgYAxisSize, out_x_axis.size(), out_y_axis.size()));
+            }
 
-        // translate axes to 'm' if given in other metric units
-        const bool isDegree = cs->getProjection()->isDegree();
-        const std::string orgUnit = isDegree ? "degree" : "m";
-        const std::string& orgXAxisName = cs->getGeoXAxis()->getName();
-        const std::string& orgYAxisName = cs->getGeoYAxis()->getName();
-
-        shared_array<double> orgXAxisValsArray, orgYAxisValsArray;
-        size_t orgXAxisSize, orgYAxisSize;
-        extractValues(p_->dataReader->getScaledDataInUnit(orgXAxisName, orgUnit), orgXAxisValsArray, orgXAxisSize);
-        extractValues(p_->dataReader->getScaledDataInUnit(orgYAxisName, orgUnit), orgYAxisValsArray, orgYAxisSize);
-
-        // calculate the mapping from the new projection points to the original axes pointsOnXAxis(x_new, y_new), pointsOnYAxis(x_new, y_new)
-        const size_t fieldSize = out_x_axis.size() * out_y_axis.size();
-        auto pointsOnXAxis = make_shared_array<double>(fieldSize);
-        auto pointsOnYAxis = make_shared_array<double>(fieldSize);
-        const std::string orgProjStr = cs->getProjection()->getProj4String();
-        reproject::reproject_axes(proj_input, orgProjStr, &out_x_axis[0], &out_y_axis[0], out_x_axis.size(), out_y_axis.size(), &pointsOnXAxis[0],
-                                  &pointsOnYAxis[0]);
-        LOG4FIMEX(logger, Logger::DEBUG,
-                  "mifi_project_axes: " << proj_input << "," << orgProjStr << "," << out_x_axis[0] << "," << out_y_axis[0] << " => " << pointsOnXAxis[0] << ","
-                                        << pointsOnYAxis[0]);
-
-        const int miupXAxis = isDegree ? MIFI_LONGITUDE : MIFI_PROJ_AXIS;
-        const int miupYAxis = isDegree ? MIFI_LATITUDE : MIFI_PROJ_AXIS;
-        // translate coordinates (in deg or m) to indices
-        mifi_points2position(&pointsOnXAxis[0], fieldSize, orgXAxisValsArray.get(), orgXAxisSize, miupXAxis);
-        mifi_points2position(&pointsOnYAxis[0], fieldSize, orgYAxisValsArray.get(), orgYAxisSize, miupYAxis);
-
-        LOG4FIMEX(logger, Logger::DEBUG,
-                  "creating cached projection interpolation matrix " << orgXAxisSize << "x" << orgYAxisSize << " => " << out_x_axis.size() << "x"
-                                                                     << out_y_axis.size());
-        p_->cachedInterpolation[csIt->first] = createCachedInterpolation(orgXAxisName, orgYAxisName, method, pointsOnXAxis, pointsOnYAxis, orgXAxisSize,
-                                                                         orgYAxisSize, out_x_axis.size(), out_y_axis.size());
-        warnUnlessAllXYSpatialVectorsHaveSameHorizontalId(csIt->first);
-
-        if (hasXYSpatialVectors()) {
-            // prepare interpolation of vectors
-            LOG4FIMEX(logger, Logger::DEBUG,
-                      "creating cached vector projection interpolation matrix " << orgXAxisSize << "x" << orgYAxisSize << " => " << out_x_axis.size() << "x"
-                                                                                << out_y_axis.size());
-            reproject::Matrix_cp matrix = reproject::get_vector_reproject_matrix(orgProjStr, proj_input, &out_x_axis[0], &out_y_axis[0], outXAxisType,
-                                                                                 outYAxisType, out_x_axis.size(), out_y_axis.size());
-            LOG4FIMEX(logger, Logger::DEBUG, "creating vector reprojection");
-            p_->cachedVectorReprojection[csIt->first] = std::make_shared<CachedVectorReprojection>(matrix);
-        }
+            if (xyVectors) {
+                // prepare interpolation of vectors
+                LOG4FIMEX(logger, Logger::DEBUG,
+                          "creating cached vector projection interpolation matrix " << orgXAxisSize << "x" << orgYAxisSize << " => " << out_x_axis.size() << "x"
+                                                                                    << out_y_axis.size());
+                InterpolationCacheKey vectorKey;
+                vectorKey.add("vector").add(orgProjStr).add(proj_input).add(out_x_axis).add(out_y_axis).add(static_cast<long long>(outIsDegree));
+                reproject::Matrix_cp matrix = cachedVectorMatrix(vectorKey, out_x_axis.size(), out_y_axis.size(), [&]() {
+                    return reproject::get_vector_reproject_matrix(orgProjStr, proj_input, &out_x_axis[0], &out_y_axis[0], outXAxisType, outYAxisType,
+                                                                  out_x_axis.size(), out_y_axis.size());
+                });
+                LOG4FIMEX(logger, Logger::DEBUG, "creating vector reprojection");
+                p_->setVectorReprojection(horizontalId, std::make_shared<CachedVectorReprojection>(matrix));
+            }
+        });
     }
 }
 
@@ -1626,57 +2198,71 @@ void CDMInterpolator::changeProjectionByProjectionParametersToLatLonTemplate(int
 
     auto lat_deg = tmplLatVals->asDouble();
     auto lon_deg = tmplLonVals->asDouble();
+    const bool xyVectors = hasXYSpatialVectors();
 
     for (const auto& csi : csMap) {
-        CSGridDefinition def = orgGrids[csi.first];
+        const std::string horizontalId = csi.first;
+        const CSGridDefinition def = orgGrids[horizontalId];
         Projection_cp csp = csi.second->getProjection();
         if (!csp)
             continue;
+        warnUnlessAllXYSpatialVectorsHaveSameHorizontalId(horizontalId);
+        p_->pendingInterpolation[horizontalId] = std::make_shared<PendingSetup>([=]() {
+
+            auto orgXAxisArray = def.xAxisData->asDouble();
+            auto orgYAxisArray = def.yAxisData->asDouble();
+
+            const std::string& orgProjStr = csp->getProj4String();
+
+            // store projection changes to be used in data-section
+            auto latY = clone(lat_deg, tmplLatVals->size());
+            auto lonX = clone(lon_deg, tmplLonVals->size());
+
+            // calculate the mapping from the new projection points to the original axes pointsOnXAxis(x_new, y_new), pointsOnYAxis(x_new, y_new)
+
+            InterpolationCacheKey key;
+            key.add("template").add(tmpl_proj_input).add(lon_deg.get(), tmplLonVals->size()).add(lat_deg.get(), tmplLatVals->size());
+            key.add(orgProjStr).add(static_cast<long long>(csp->isDegree()));
+            key.add(orgXAxisArray.get(), def.xAxisData->size()).add(orgYAxisArray.get(), def.yAxisData->size());
+            cachedPositions(key, lonX, latY, tmplLatVals->size(), [&]() {
+                // projects lat / lon from template to axis-projection found in model file
+                // we want to get template lat/long expressed in terms of the original projection
+                reproject::reproject_values(tmpl_proj_input, orgProjStr, &lonX[0], &latY[0], tmplLatVals->size());
+                LOG4FIMEX(logger, Logger::DEBUG,
+                          "mifi_project_values: " << tmpl_proj_input << "," << orgProjStr << "," << out_x_axis[0] << "," << out_y_axis[0] << " => " << lonX[0]
+                                                  << "," << latY[0]);
+
+                // now latVals and lonVals are given in original-input coordinates
+                // check if we have to translate original axes from deg2rad
+                const int miupXAxis = csp->isDegree() ? MIFI_LONGITUDE : MIFI_PROJ_AXIS;
+                const int miupYAxis = csp->isDegree() ? MIFI_LATITUDE : MIFI_PROJ_AXIS;
+
+                // translate coordinates (in degrees) to indices
+                AxisLookup(orgYAxisArray.get(), def.yAxisData->size(), miupYAxis).positions(&latY[0], tmplLatVals->size());
+                AxisLookup(orgXAxisArray.get(), def.xAxisData->size(), miupXAxis).positions(&lonX[0], tmplLonVals->size());
+            });
 
-        auto orgXAxisArray = def.xAxisData->asDouble();
-        auto orgYAxisArray = def.yAxisData->asDouble();
-
-        const std::string& orgProjStr = csp->getProj4String();
-
-        // store projection changes to be used in data-section
-        auto latY = clone(lat_deg, tmplLatVals->size());
-        auto lonX = clone(lon_deg, tmplLonVals->size());
-
-        // calculate the mapping from the new projection points to the original axes pointsOnXAxis(x_new, y_new), pointsOnYAxis(x_new, y_new)
-
-        // projects lat / lon from template to axis-projection found in model file
-        // we want to get template lat/long expressed in terms of the original projection
-        reproject::reproject_values(tmpl_proj_input, orgProjStr, &lonX[0], &latY[0], tmplLatVals->size());
-        LOG4FIMEX(logger, Logger::DEBUG,
-                  "mifi_project_values: " << tmpl_proj_input << "," << orgProjStr << "," << out_x_axis[0] << "," << out_y_axis[0] << " => " << lonX[0] << ","
-                                          << latY[0]);
-
-        // now latVals and lonVals are given in original-input coordinates
-        // check if we have to translate original axes from deg2rad
-        const int miupXAxis = csp->isDegree() ? MIFI_LONGITUDE : MIFI_PROJ_AXIS;
-        const int miupYAxis = csp->isDegree() ? MIFI_LATITUDE : MIFI_PROJ_AXIS;
-
-        // translate coordinates (in degrees) to indices
-        mifi_points2position(&latY[0], tmplLatVals->size(), orgYAxisArray.get(), def.yAxisData->size(), miupYAxis);
-        mifi_points2position(&lonX[0], tmplLonVals->size(), orgXAxisArray.get(), def.xAxisData->size(), miupXAxis);
-
-        LOG4FIMEX(logger, Logger::DEBUG,
-                  "creating cached projection interpolation matrix (" << csi.first << ") " << def.xAxisData->size() << "x" << def.yAxisData->size() << " => "
-                                                                      << out_x_axis.size() << "x" << out_y_axis.size());
-        p_->cachedInterpolation[csi.first] = createCachedInterpolation(def.xAxisName, def.yAxisName, method, lonX, latY, def.xAxisData->size(),
-                                                                       def.yAxisData->size(), out_x_axis.size(), out_y_axis.size());
-
-        warnUnlessAllXYSpatialVectorsHaveSameHorizontalId(csi.first);
-
-        if (hasXYSpatialVectors()) {
-            // std::string orgUnit = csi.second->getProjection()->isDegree() ? "rad" : "m";
-            LOG4FIMEX(logger, Logger::DEBUG, "creating cached vector projection interpolation matrix");
-            const size_t outSize = tmplLatVals->size();
-            // prepare interpolation of vectors
-            reproject::Matrix_cp matrix =
-                reproject::get_vector_reproject_matrix_points(orgProjStr, LAT_LON_PROJSTR, csp->isDegree() ? 0 : 1, &lon_deg[0], &lat_deg[0], outSize, 1);
-            p_->cachedVectorReprojection[csi.first] = std::make_shared<CachedVectorReprojection>(matrix);
-        }
+            LOG4FIMEX(logger, Logger::DEBUG,
+                      "creating cached projection interpolation matrix (" << horizontalId << ") " << def.xAxisData->size() << "x" << def.yAxisData->size() << " => "
+                                                                          << out_x_axis.size() << "x" << out_y_axis.size());
+            p_->setInterpolation(horizontalId, createCachedInterpolation(def.xAxisName, def.yAxisName, method, lonX, latY, def.xAxisData->size(),
+                                                                          def.yAxisData->size(), out_x_axis.size(), out_y_axis.size()));
+
+            if (xyVectors) {
+                // std::string orgUnit = csi.second->getProjection()->isDegree() ? "rad" : "m";
+                LOG4FIMEX(logger, Logger::DEBUG, "creating cached vector projection interpolation matrix");
+                const size_t outSize = tmplLatVals->size();
+                // prepare interpolation of vectors
+                InterpolationCacheKey vectorKey;
+                vectorKey.add("vector_points").add(orgProjStr).add(static_cast<long long>(csp->isDegree()));
+                vectorKey.add(lon_deg.get(), outSize).add(lat_deg.get(), outSize);
+                reproject::Matrix_cp matrix = cachedVectorMatrix(vectorKey, outSize, 1, [&]() {
+                    return reproject::get_vector_reproject_matrix_points(orgProjStr, LAT_LON_PROJSTR, csp->isDegree() ? 0 : 1, &lon_deg[0], &lat_deg[0], outSize,
+                                                                         1);
+                });
+                p_->setVectorReprojection(horizontalId, std::make_shared<CachedVectorReprojection>(matrix));
+            }
+        });
     }
 }
 
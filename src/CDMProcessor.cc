@@ -34,6 +34,7 @@
 #include "fimex/CachedVectorReprojection.h"
 #include "fimex/Data.h"
 #include "fimex/Logger.h"
+#include "fimex/MutexLock.h"
 #include "fimex/coordSys/CoordinateAxis.h"
 #include "fimex/coordSys/CoordinateSystem.h"
 #include "fimex/coordSys/verticalTransform/HybridSigmaPressure1.h"
@@ -99,7 +100,14 @@ struct CDMProcessor::CDMProcessorImpl
     // horizontalId -> cachedVectorReprojection
     map<string, CachedVectorReprojection_p> cachedVectorReprojection;
     SliceCache sliceCache;
+    OmpMutex sliceCacheMutex;
+    DataPacking cachePacking;
     VerticalVelocityComps vvComp;
+
+    CDMProcessorImpl()
+        : cachePacking(DATA_PACKING_NONE)
+    {
+    }
 };
 
 CachedVectorReprojection_p makeCachedVectorReprojection(CDMReader_p dataReader, CoordinateSystem_cp cs, bool toLatLon)
@@ -321,6 +329,11 @@ void CDMProcessor::addVerticalVelocity()
     p_->vvComp = vvcs.at(0);
 }
 
+void CDMProcessor::setCachePacking(DataPacking packing)
+{
+    p_->cachePacking = packing;
+}
+
 void CDMProcessor::accumulate(const std::string& varName)
 {
     const CDMVariable& variable = cdm_->getVariable(varName);
@@ -491,10 +504,15 @@ static void addDataP2Data(DataPtr& data, DataPtr& dataP, bool addingFirstTimeSte
         std::transform(&d[0], &d[0]+data->size(), &dp[0], &d[0], std::plus<double>());
         data = createData(data->size(), d);
     } else if (dataP->size() != 0) {
-        data = dataP; // data->size was 0
+        data = dataP->clone(); // data->size was 0, dataP might be shared with the cache
     }
 }
 
+bool CDMProcessor::supportsConcurrentReading() const
+{
+    return p_->dataReader->supportsConcurrentReading();
+}
+
 DataPtr CDMProcessor::getDataSlice(const std::string& varName, size_t unLimDimPos)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "getDataSlice for '" << varName << "' at " << unLimDimPos);
@@ -541,13 +559,19 @@ DataPtr CDMProcessor::getDataSlice(const std::string& varName, size_t unLimDimPo
         LOG4FIMEX(logger, Logger::DEBUG, varName << " at slice " << unLimDimPos << " accumulate");
         if (unLimDimPos > 0) { // cannot accumulate first
             size_t start = 0;
-            if (p_->sliceCache.varName == varName && p_->sliceCache.ulimDimPos <= unLimDimPos) {
-                start = p_->sliceCache.ulimDimPos + 1;
-                if (p_->sliceCache.ulimDimPos == unLimDimPos) {
-                    data = p_->sliceCache.data;
+            SliceCache cache;
+            {
+                // copy of the cache, other threads might replace it meanwhile
+                OmpScopedLock lock(p_->sliceCacheMutex);
+                cache = p_->sliceCache;
+            }
+            if (cache.varName == varName && cache.ulimDimPos <= unLimDimPos) {
+                start = cache.ulimDimPos + 1;
+                // the cached data is shared, never modify it
+                if (cache.ulimDimPos == unLimDimPos) {
+                    data = cache.data->clone();
                 } else {
-                    DataPtr dataP = p_->sliceCache.data;
-                    addDataP2Data(data, dataP, false);
+                    addDataP2Data(data, cache.data, false);
                 }
             }
             // data contains last slice + eventually cache
@@ -556,9 +580,10 @@ DataPtr CDMProcessor::getDataSlice(const std::string& varName, size_t unLimDimPo
                 addDataP2Data(data, dataP, i == 0);
             }
             // fill the cache
+            OmpScopedLock lock(p_->sliceCacheMutex);
             p_->sliceCache.varName = varName;
             p_->sliceCache.ulimDimPos = unLimDimPos;
-            p_->sliceCache.data = data;
+            p_->sliceCache.data = createPackedData(*data, p_->cachePacking, cdm_->getFillValue(varName));
         }
     }
 
@@ -596,18 +621,18 @@ DataPtr CDMProcessor::getDataSlice(const std::string& varName, size_t unLimDimPo
             xIsFirst = true;
             xData = data;
             xVar = varName;
-            yVar = p_->rotateLatLonVectorX[varName].first;
+            yVar = p_->rotateLatLonVectorX.at(varName).first;
             yData = p_->dataReader->getDataSlice(yVar, unLimDimPos);
-            csId = p_->rotateLatLonVectorX[varName].second;
+            csId = p_->rotateLatLonVectorX.at(varName).second;
         } else {
             xIsFirst = false;
             yData = data;
             yVar = varName;
-            xVar = p_->rotateLatLonVectorY[varName].first;
+            xVar = p_->rotateLatLonVectorY.at(varName).first;
             xData = p_->dataReader->getDataSlice(xVar, unLimDimPos);
-            csId = p_->rotateLatLonVectorY[varName].second;
+            csId = p_->rotateLatLonVectorY.at(varName).second;
         }
-        CachedVectorReprojection_p cvr = p_->cachedVectorReprojection[csId];
+        CachedVectorReprojection_p cvr = p_->cachedVectorReprojection.at(csId);
         auto xArray = data2InterpolationArray(xData, getCDM().getFillValue(xVar));
         auto yArray = data2InterpolationArray(yData, getCDM().getFillValue(yVar));
         if (xData->size() != yData->size()) {
@@ -626,10 +651,10 @@ DataPtr CDMProcessor::getDataSlice(const std::string& varName, size_t unLimDimPo
         if (p_->deaccumulateVars.find(varName) != p_->deaccumulateVars.end()) {
             LOG4FIMEX(logger, Logger::WARN, varName << " deaccumulate and rotated, this won't work as expected");
         }
-        const string& csId = p_->rotateLatLonDirection[varName];
+        const string& csId = p_->rotateLatLonDirection.at(varName);
         LOG4FIMEX(logger, Logger::DEBUG, "rotating direction " << varName << " with csId " << csId);
         assert(p_->cachedVectorReprojection.find(csId) != p_->cachedVectorReprojection.end());
-        CachedVectorReprojection_p cvr = p_->cachedVectorReprojection[csId];
+        CachedVectorReprojection_p cvr = p_->cachedVectorReprojection.at(csId);
         auto array = data2InterpolationArray(data, getCDM().getFillValue(varName));
         double addOffset = 0.;
         double scaleFactor = 1.;
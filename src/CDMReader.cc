@@ -30,6 +30,7 @@
 #include "fimex/Type2String.h"
 #include "fimex/Units.h"
 #include "fimex/UnitsConverter.h"
+#include "fimex/WorkerPool.h"
 #include "fimex/mifi_constants.h"
 
 #include <cassert>
@@ -92,7 +93,7 @@ DataPtr CDMReader::getDataSlice(const std::string& varName, const SliceBuilder&
     DataPtr retData;
     const CDMVariable& variable = cdm_->getVariable(varName);
     if (variable.hasData()) {
-        retData = variable.getData()->slice(sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
+        retData = createDataView(variable.getData(), sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
     } else {
         if (cdm_->hasUnlimitedDim(variable)) {
             string unLimDim = cdm_->getUnlimitedDim()->getName();
@@ -144,11 +145,56 @@ DataPtr CDMReader::getDataSlice(const std::string& varName, const SliceBuilder&
     return retData;
 }
 
+size_t CDMReader::readInto(const std::string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst)
+{
+    DataPtr data = getDataSlice(varName, sb);
+    if (!data)
+        return 0;
+    return copyValues(*data, dataType, dst);
+}
+
+std::future<DataPtr> CDMReader::getDataSliceAsync(const std::string& varName, size_t unLimDimPos)
+{
+    return WorkerPool::shared().submit([this, varName, unLimDimPos]() { return getDataSlice(varName, unLimDimPos); });
+}
+
+std::future<DataPtr> CDMReader::getDataSliceAsync(const std::string& varName, const SliceBuilder& sb)
+{
+    return WorkerPool::shared().submit([this, varName, sb]() { return getDataSlice(varName, sb); });
+}
+
+std::vector<DataPtr> CDMReader::getDataSlices(const std::vector<std::string>& varNames, size_t unLimDimPos)
+{
+    if (WorkerPool::shared().size() <= 1 || !supportsConcurrentReading()) {
+        // no concurrency wanted or possible
+        std::vector<DataPtr> data;
+        for (const std::string& varName : varNames)
+            data.push_back(getDataSlice(varName, unLimDimPos));
+        return data;
+    }
+    std::vector<std::future<DataPtr>> requests;
+    for (const std::string& varName : varNames)
+        requests.push_back(getDataSliceAsync(varName, unLimDimPos));
+    // do not leave requests running after errors
+    for (std::future<DataPtr>& f : requests)
+        WorkerPool::shared().wait(f);
+    std::vector<DataPtr> data;
+    for (std::future<DataPtr>& f : requests)
+        data.push_back(f.get());
+    return data;
+}
+
+bool CDMReader::supportsConcurrentReading() const
+{
+    return false;
+}
+
 DataPtr CDMReader::getData(const std::string& varName)
 {
     const CDMVariable& variable = cdm_->getVariable(varName);
     if (variable.hasData()) {
-        return variable.getData()->clone();
+        DataPtr data = variable.getData();
+        return createDataView(data, 0, data->size());
     } else {
         if (cdm_->hasUnlimitedDim(variable)) {
             const CDMDimension* udim = cdm_->getUnlimitedDim();
@@ -254,9 +300,11 @@ DataPtr CDMReader::getDataSliceFromMemory(const CDMVariable& variable, size_t un
             // cut out the unlimited dim data
             std::vector<size_t> dims = getDimsSlice(variable.getName());
             size_t sliceSize = accumulate(dims.begin(), dims.end(), 1, std::multiplies<size_t>());
+            if (data->getDataType() == variable.getDataType())
+                return createDataView(data, unLimDimPos * sliceSize, sliceSize);
             return createDataSlice(variable.getDataType(), *data, unLimDimPos * sliceSize, sliceSize);
         } else {
-            return data->clone();
+            return createDataView(data, 0, data->size());
         }
     } else {
         return DataPtr();
@@ -268,7 +316,7 @@ DataPtr CDMReader::getDataSliceFromMemory(const CDMVariable& variable, const Sli
     if (DataPtr data = variable.getData()) {
         if (data->size() == 0)
             return data;
-        return data->slice(sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
+        return createDataView(data, sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
     } else {
         return DataPtr();
     }
@@ -33,11 +33,13 @@
 #include "fimex/FindNeighborElements.h"
 #include "fimex/Logger.h"
 #include "fimex/StringUtils.h"
+#include "fimex/WorkerPool.h"
 #include "fimex/coordSys/CoordinateAxis.h"
 #include "fimex/coordSys/verticalTransform/ToVLevelConverter.h"
 #include "fimex/interpolation.h"
 #include "fimex/vertical_coordinate_transformations.h"
 
+#include "AxisLookup.h"
 #include "coordSys/CoordSysUtils.h"
 
 #include "fimex/ArrayLoop.h"
@@ -46,6 +48,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <memory>
 #include <regex>
 #include <string>
 #include <vector>
@@ -485,10 +488,19 @@ DataPtr CDMVerticalInterpolator::getLevelDataSlice(CoordinateSystem_cp csI, cons
     if (oVerticalData)
         oVerticalValues = oVerticalData->asFloat();
 
-#ifdef _OPENMP
-#pragma omp parallel for default(shared)
-#endif
-    for (size_t k = 0; k < nzo; k++) {
+    // input levels shared by all columns are searched with one lookup instead of a linear search per point
+    std::unique_ptr<AxisLookup> iLevels;
+    if (nzi > 1 && siVertical.length(geoZi) == nzi && siVertical.volume() == nzi) {
+        std::vector<double> levels(nzi);
+        for (size_t z = 0; z < nzi; ++z)
+            levels[z] = iVerticalValues[z * iverticalZdelta];
+        iLevels.reset(new AxisLookup(&levels[0], nzi));
+        if (!iLevels->isMonotonic())
+            iLevels.reset();
+    }
+
+    // the layers of oData are first touched, and thus placed on the NUMA node, by the worker computing them
+    WorkerPool::shared().parallelFor(0, nzo, [&](size_t k) {
 #ifdef ENABLE_LOG_DEBUG_IN_LOOPS
         LOG4FIMEX(logger, Logger::DEBUG, "k=" << k);
         size_t loopi = 0;
@@ -530,7 +542,11 @@ DataPtr CDMVerticalInterpolator::getLevelDataSlice(CoordinateSystem_cp csI, cons
             if (range) {
                 const leap_iterator<const float*> ivertical0(&iVerticalValues[loop[IN_VERTICAL]], iverticalZdelta);
                 const leap_iterator<const float*> ivertical1 = ivertical0 + nzi;
-                const pair<size_t, size_t> pos = find_closest_neighbor_distinct_elements(ivertical0, ivertical1, verticalOut);
+                pair<size_t, size_t> pos;
+                if (iLevels)
+                    pos = iLevels->neighbors(verticalOut);
+                else
+                    pos = find_closest_neighbor_distinct_elements(ivertical0, ivertical1, verticalOut);
                 if (pos.first != pos.second) {
                     const size_t idataZ0  = loop[IN] + idataZdelta * pos.first;
                     const size_t idataZ1  = loop[IN] + idataZdelta * pos.second;
@@ -546,7 +562,7 @@ DataPtr CDMVerticalInterpolator::getLevelDataSlice(CoordinateSystem_cp csI, cons
                 *interpolated = MIFI_UNDEFINED_F;
             }
         } while (loop.next());
-    }
+    });
 
     // correct data going out of bounds
     const double valid_min = cdm_->getValidMin(varName);
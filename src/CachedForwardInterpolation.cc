@@ -27,9 +27,11 @@
 #include "CachedForwardInterpolation.h"
 
 #include "fimex/CDMException.h"
+#include "fimex/Data.h"
 #include "fimex/Logger.h"
 #include "fimex/MathUtils.h"
 #include "fimex/Type2String.h"
+#include "fimex/WorkerPool.h"
 #include "fimex/interpolation.h"
 #include "fimex/min_max.h"
 
@@ -49,60 +51,50 @@ namespace {
 
 const size_t INVALID = ~0u;
 
-} // namespace
-
-struct Aggregator
-{
-    virtual ~Aggregator();
-    virtual void push(float f) = 0;
-    virtual float get_and_reset() = 0;
-};
+// output points per task
+const size_t OUT_BLOCK = 16384;
 
-Aggregator::~Aggregator() {}
+// the aggregators collect the input values of one output point, undefined if there are none
 
-struct AggSimple : Aggregator
+struct AggSum
 {
+    double val;
     size_t count;
-    float val;
-    AggSimple() { reset(0); }
-    float get_and_reset() override { return reset(val); }
-    float reset(float v)
+    void reset()
     {
         val = 0;
-        if (count == 0)
-            return MIFI_UNDEFINED_F;
         count = 0;
-        return v;
     }
-};
-
-struct AggSum : AggSimple
-{
-    void push(float f) override
+    void push(float f)
     {
         count += 1;
         val += f;
     }
+    float get() const { return (count == 0) ? MIFI_UNDEFINED_F : static_cast<float>(val); }
 };
 
 struct AggMean : AggSum
 {
-    float get_and_reset() override { return reset(count > 0 ? val / count : 0); }
+    float get() const { return (count == 0) ? MIFI_UNDEFINED_F : static_cast<float>(val / count); }
 };
 
-struct AggMin : AggSimple
+struct AggMin
 {
-    void push(float f) override
+    float val;
+    size_t count;
+    void reset() { count = 0; }
+    void push(float f)
     {
         if (count == 0 || f < val)
             val = f;
         count += 1;
     }
+    float get() const { return (count == 0) ? MIFI_UNDEFINED_F : val; }
 };
 
-struct AggMax : AggSimple
+struct AggMax : AggMin
 {
-    void push(float f) override
+    void push(float f)
     {
         if (count == 0 || f > val)
             val = f;
@@ -110,34 +102,74 @@ struct AggMax : AggSimple
     }
 };
 
-struct AggMedian : Aggregator
+struct AggMedian
 {
     std::vector<float> values;
-    AggMedian(size_t n) { values.reserve(n); }
-    void push(float f) override { values.push_back(f); }
-    float get_and_reset() override;
+    void reset() { values.clear(); }
+    void push(float f) { values.push_back(f); }
+    float get()
+    {
+        if (values.empty())
+            return MIFI_UNDEFINED_F;
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        return values[values.size() / 2];
+    }
 };
 
-float AggMedian::get_and_reset()
+template <class Agg>
+void reserveAggregator(Agg&, size_t)
 {
-    if (values.empty())
-        return MIFI_UNDEFINED_F;
+}
+
+void reserveAggregator(AggMedian& agg, size_t maxPoints)
+{
+    agg.values.reserve(maxPoints);
+}
 
-    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
-    const float median = values[values.size() / 2];
-    values.clear();
-    return median;
+/**
+ * Aggregate all layers, in parallel over layers and blocks of output points.
+ * Each output point is computed by one task from its input points in a fixed
+ * order, so the results do not depend on the number of threads.
+ */
+template <class Agg>
+void forwardAggregate(const vector<size_t>& pointsInInStart, const vector<size_t>& pointsInIn, size_t maxPointsInIn, bool undefAggr,
+                      size_t inLayerSize, size_t outLayerSize, size_t inZ, const float* inData, float* outData)
+{
+    const size_t nBlocks = std::max(size_t(1), (outLayerSize + OUT_BLOCK - 1) / OUT_BLOCK);
+    const size_t* start = pointsInInStart.data();
+    const size_t* points = pointsInIn.data();
+    WorkerPool::shared().parallelFor(0, inZ * nBlocks, [&](size_t task) {
+        const size_t z = task / nBlocks, block = task % nBlocks;
+        const float* in = inData + z * inLayerSize;
+        float* out = outData + z * outLayerSize;
+        Agg agg;
+        reserveAggregator(agg, maxPointsInIn);
+        for (size_t o = block * OUT_BLOCK, oEnd = std::min(outLayerSize, (block + 1) * OUT_BLOCK); o < oEnd; ++o) {
+            agg.reset();
+            for (size_t k = start[o]; k < start[o + 1]; ++k) {
+                const float val = in[points[k]];
+                if (undefAggr || !mifi_isnan(val))
+                    agg.push(val);
+            }
+            out[o] = agg.get();
+        }
+    });
 }
 
+} // namespace
+
 // pointsOnXAxis map each point in inData[y*inX+x] to a x-position in outData
 CachedForwardInterpolation::CachedForwardInterpolation(const std::string& xDimName, const std::string& yDimName, int funcType, shared_array<double> pOnX,
                                                        shared_array<double> pOnY, size_t inx, size_t iny, size_t outx, size_t outy)
     : CachedInterpolationInterface(xDimName, yDimName, inx, iny, outx, outy)
 {
+    // counting sort of the input points by output point, keeping the input order
     const size_t outLayerSize = outX * outY;
-    pointsInIn = make_shared_array<vector<size_t>>(outLayerSize);
+    const size_t inLayerSize = inX * inY;
+    std::vector<size_t> outOfIn(inLayerSize, INVALID);
+    pointsInInStart.assign(outLayerSize + 1, 0);
     size_t minInX = 0, maxInX = 0, minInY = 0, maxInY = 0;
-    maxPointsInIn = 0;
+    bool anyPoint = false;
     const RoundAndClamp roundX(0, outX - 1, INVALID);
     const RoundAndClamp roundY(0, outY - 1, INVALID);
     for (size_t iy = 0; iy < inY; ++iy) {
@@ -145,19 +177,32 @@ CachedForwardInterpolation::CachedForwardInterpolation(const std::string& xDimNa
             const size_t i = iy * inX + ix;
             const size_t px = roundX(pOnX[i]), py = roundY(pOnY[i]);
             if (px != INVALID && py != INVALID) {
-                if (maxPointsInIn == 0) {
+                if (!anyPoint) {
                     minInX = maxInX = ix;
                     minInY = maxInY = iy;
+                    anyPoint = true;
                 } else {
                     minimaximize(minInY, maxInY, iy);
                     minimaximize(minInX, maxInX, ix);
                 }
-                std::vector<size_t>& pi = pointsInIn[py * outX + px];
-                pi.push_back(i);
-                maximize(maxPointsInIn, pi.size());
+                outOfIn[i] = py * outX + px;
+                pointsInInStart[outOfIn[i] + 1] += 1;
             }
         }
     }
+    maxPointsInIn = 0;
+    for (size_t o = 0; o < outLayerSize; ++o) {
+        maximize(maxPointsInIn, pointsInInStart[o + 1]);
+        pointsInInStart[o + 1] += pointsInInStart[o];
+    }
+    pointsInIn.resize(pointsInInStart[outLayerSize]);
+    {
+        std::vector<size_t> next(pointsInInStart.begin(), pointsInInStart.end() - 1);
+        for (size_t i = 0; i < inLayerSize; ++i) {
+            if (outOfIn[i] != INVALID)
+                pointsInIn[next[outOfIn[i]]++] = i;
+        }
+    }
     LOG4FIMEX(logger, Logger::DEBUG, "maxPointsInIn=" << maxPointsInIn);
 
     // allow additional cells for pre/postprocessing
@@ -169,11 +214,9 @@ CachedForwardInterpolation::CachedForwardInterpolation(const std::string& xDimNa
     if ((minInX > 0 || minInY > 0 || maxInX < inX - 1 || maxInY < inY - 1) && (minInX + 2 * EXTEND <= maxInX) && (minInY + 2 * EXTEND <= maxInY)) {
         const size_t redInX = maxInX - minInX + 1;
         const size_t redInY = maxInY - minInY + 1;
-        for (size_t o = 0; o < outLayerSize; ++o) {
-            for (size_t& i : pointsInIn[o]) {
-                const size_t iy = i / inX - minInY, ix = i % inX - minInX;
-                i = iy * redInX + ix;
-            }
+        for (size_t& i : pointsInIn) {
+            const size_t iy = i / inX - minInY, ix = i % inX - minInX;
+            i = iy * redInX + ix;
         }
 
         reducedDomain_ = std::make_shared<ReducedInterpolationDomain>(xDimName, yDimName, minInX, minInY);
@@ -183,18 +226,19 @@ CachedForwardInterpolation::CachedForwardInterpolation(const std::string& xDimNa
     }
 
     undefAggr = false;
+    method = funcType;
     // clang-format off
     switch (funcType) {
-    case MIFI_INTERPOL_FORWARD_UNDEF_SUM: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_SUM: agg.reset(new AggSum()); break;
-    case MIFI_INTERPOL_FORWARD_UNDEF_MEAN: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_MEAN: agg.reset(new AggMean()); break;
-    case MIFI_INTERPOL_FORWARD_UNDEF_MEDIAN: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_MEDIAN: agg.reset(new AggMedian(maxPointsInIn)); break;
-    case MIFI_INTERPOL_FORWARD_UNDEF_MAX: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_MAX: agg.reset(new AggMax()); break;
-    case MIFI_INTERPOL_FORWARD_UNDEF_MIN: undefAggr = true; // fallthrough
-    case MIFI_INTERPOL_FORWARD_MIN: agg.reset(new AggMin()); break;
+    case MIFI_INTERPOL_FORWARD_UNDEF_SUM:
+    case MIFI_INTERPOL_FORWARD_UNDEF_MEAN:
+    case MIFI_INTERPOL_FORWARD_UNDEF_MEDIAN:
+    case MIFI_INTERPOL_FORWARD_UNDEF_MAX:
+    case MIFI_INTERPOL_FORWARD_UNDEF_MIN: undefAggr = true; break;
+    case MIFI_INTERPOL_FORWARD_SUM:
+    case MIFI_INTERPOL_FORWARD_MEAN:
+    case MIFI_INTERPOL_FORWARD_MEDIAN:
+    case MIFI_INTERPOL_FORWARD_MAX:
+    case MIFI_INTERPOL_FORWARD_MIN: break;
     default: throw CDMException("unknown forward interpolation method: " + type2string(funcType));
     }
     // clang-format on
@@ -204,23 +248,87 @@ CachedForwardInterpolation::~CachedForwardInterpolation() {}
 
 shared_array<float> CachedForwardInterpolation::interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const
 {
-    size_t outLayerSize = outX*outY;
-    size_t inLayerSize = inX * inY;
-    size_t inZ = size / inLayerSize;
+    const size_t outLayerSize = outX * outY;
+    const size_t inLayerSize = inX * inY;
+    const size_t inZ = size / inLayerSize;
     newSize = outLayerSize*inZ;
     auto outData = make_shared_array<float>(newSize);
-    for (size_t z = 0; z < inZ; ++z) {
-        float* outDataIt = &outData[z*outLayerSize];
-        for (size_t i = 0; i < outLayerSize; i++) {
-            for (size_t ii : pointsInIn[i]) {
-                const float val = inData[ii];
-                if (undefAggr || !mifi_isnan(val))
-                    agg->push(val);
+    const float* in = inData.get();
+    float* out = outData.get();
+    // clang-format off
+    switch (method) {
+    case MIFI_INTERPOL_FORWARD_SUM:
+    case MIFI_INTERPOL_FORWARD_UNDEF_SUM: forwardAggregate<AggSum>(pointsInInStart, pointsInIn, maxPointsInIn, undefAggr, inLayerSize, outLayerSize, inZ, in, out); break;
+    case MIFI_INTERPOL_FORWARD_MEAN:
+    case MIFI_INTERPOL_FORWARD_UNDEF_MEAN: forwardAggregate<AggMean>(pointsInInStart, pointsInIn, maxPointsInIn, undefAggr, inLayerSize, outLayerSize, inZ, in, out); break;
+    case MIFI_INTERPOL_FORWARD_MEDIAN:
+    case MIFI_INTERPOL_FORWARD_UNDEF_MEDIAN: forwardAggregate<AggMedian>(pointsInInStart, pointsInIn, maxPointsInIn, undefAggr, inLayerSize, outLayerSize, inZ, in, out); break;
+    case MIFI_INTERPOL_FORWARD_MAX:
+    case MIFI_INTERPOL_FORWARD_UNDEF_MAX: forwardAggregate<AggMax>(pointsInInStart, pointsInIn, maxPointsInIn, undefAggr, inLayerSize, outLayerSize, inZ, in, out); break;
+    case MIFI_INTERPOL_FORWARD_MIN:
+    case MIFI_INTERPOL_FORWARD_UNDEF_MIN: forwardAggregate<AggMin>(pointsInInStart, pointsInIn, maxPointsInIn, undefAggr, inLayerSize, outLayerSize, inZ, in, out); break;
+    }
+    // clang-format on
+    return outData;
+}
+
+namespace {
+
+template <typename T>
+DataPtr forwardMinMax(const vector<size_t>& pointsInInStart, const vector<size_t>& pointsInIn, bool isMax, size_t inLayerSize, size_t outLayerSize,
+                      DataPtr inData, double badValue, size_t& newSize)
+{
+    const size_t inZ = inData->size() / inLayerSize;
+    newSize = outLayerSize * inZ;
+    const T* in = static_cast<const T*>(inData->getDataPtr());
+    auto outData = make_shared_array<T>(newSize);
+    const T bad = data_caster<T, double>()(badValue);
+    WorkerPool::shared().parallelFor(0, inZ, [&](size_t z) {
+        const T* inLayer = in + z * inLayerSize;
+        T* outLayer = &outData[z * outLayerSize];
+        for (size_t o = 0; o < outLayerSize; ++o) {
+            bool found = false;
+            T val = bad;
+            for (size_t k = pointsInInStart[o]; k < pointsInInStart[o + 1]; ++k) {
+                const T v = inLayer[pointsInIn[k]];
+                if (v == bad || mifi_isnan(v))
+                    continue;
+                if (!found || (isMax ? (v > val) : (v < val))) {
+                    val = v;
+                    found = true;
+                }
             }
-            *outDataIt++ = agg->get_and_reset();
+            outLayer[o] = val;
         }
+    });
+    return createData(newSize, outData);
+}
+
+} // namespace
+
+DataPtr CachedForwardInterpolation::interpolateData(DataPtr inData, double badValue, size_t& newSize) const
+{
+    // the undef-variants keep the float behaviour of nan values
+    if (method != MIFI_INTERPOL_FORWARD_MAX && method != MIFI_INTERPOL_FORWARD_MIN)
+        return CachedInterpolationInterface::interpolateData(inData, badValue, newSize);
+
+    const bool isMax = (method == MIFI_INTERPOL_FORWARD_MAX);
+    const size_t inLayerSize = inX * inY, outLayerSize = outX * outY;
+    // clang-format off
+    switch (inData->getDataType()) {
+    case CDM_CHAR: return forwardMinMax<char>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    case CDM_SHORT: return forwardMinMax<short>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    case CDM_INT: return forwardMinMax<int>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    case CDM_INT64: return forwardMinMax<long long>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    case CDM_UCHAR: return forwardMinMax<unsigned char>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    case CDM_USHORT: return forwardMinMax<unsigned short>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    case CDM_UINT: return forwardMinMax<unsigned int>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    case CDM_UINT64: return forwardMinMax<unsigned long long>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    case CDM_FLOAT: return forwardMinMax<float>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    case CDM_DOUBLE: return forwardMinMax<double>(pointsInInStart, pointsInIn, isMax, inLayerSize, outLayerSize, inData, badValue, newSize);
+    default: return CachedInterpolationInterface::interpolateData(inData, badValue, newSize);
     }
-    return outData;
+    // clang-format on
 }
 
 } // namespace MetNoFimex
@@ -29,23 +29,31 @@
 
 #include "fimex/CachedInterpolation.h"
 
-namespace MetNoFimex {
+#include <vector>
 
-struct Aggregator;
+namespace MetNoFimex {
 
 class CachedForwardInterpolation : public CachedInterpolationInterface
 {
 private:
-    shared_array<std::vector<size_t>> pointsInIn;
+    //! input points of output point o are pointsInIn[pointsInInStart[o]] to pointsInIn[pointsInInStart[o+1]-1]
+    std::vector<size_t> pointsInInStart;
+    std::vector<size_t> pointsInIn;
     size_t maxPointsInIn;
-    std::unique_ptr<Aggregator> agg;
     bool undefAggr;
+    int method;
 
 public:
     CachedForwardInterpolation(const std::string& xDimName, const std::string& yDimName, int funcType, shared_array<double> pointsOnXAxis,
                                shared_array<double> pointsOnYAxis, size_t inX, size_t inY, size_t outX, size_t outY);
     ~CachedForwardInterpolation();
+    using CachedInterpolationInterface::interpolateValues;
     shared_array<float> interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const override;
+
+    /**
+     * Minimum and maximum in the datatype of inData, a 0-pointer for the other methods.
+     */
+    DataPtr interpolateData(DataPtr inData, double badValue, size_t& newSize) const override;
 };
 
 } // namespace MetNoFimex
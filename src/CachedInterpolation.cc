@@ -22,6 +22,7 @@
  */
 
 #include "fimex/CachedInterpolation.h"
+#include "fimex/CachedVectorReprojection.h"
 
 #include "fimex/CDM.h"
 #include "fimex/CDMException.h"
@@ -30,14 +31,16 @@
 #include "fimex/MathUtils.h"
 #include "fimex/SliceBuilder.h"
 #include "fimex/Type2String.h"
+#include "fimex/WorkerPool.h"
 #include "fimex/interpolation.h"
 #include "fimex/min_max.h"
 
 #include "fimex/Logger.h"
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
 
 namespace MetNoFimex
 {
@@ -65,6 +68,41 @@ CachedInterpolationInterface::CachedInterpolationInterface(const std::string& xD
 
 CachedInterpolationInterface::~CachedInterpolationInterface() {}
 
+shared_array<double> CachedInterpolationInterface::interpolateValues(shared_array<double> inData, size_t size, size_t& newSize) const
+{
+    auto floatData = make_shared_array<float>(size);
+    std::copy(inData.get(), inData.get() + size, floatData.get());
+    auto floatOut = interpolateValues(floatData, size, newSize);
+    auto outData = make_shared_array<double>(newSize);
+    std::copy(floatOut.get(), floatOut.get() + newSize, outData.get());
+    return outData;
+}
+
+void CachedInterpolationInterface::interpolateVectorValues(shared_array<float> uData, shared_array<float> vData, size_t size,
+                                                           const CachedVectorReprojection& cvr, shared_array<float>& uOut, shared_array<float>& vOut,
+                                                           size_t& newSize) const
+{
+    uOut = interpolateValues(uData, size, newSize);
+    vOut = interpolateValues(vData, size, newSize);
+    cvr.reprojectValues(uOut, vOut, newSize);
+}
+
+std::vector<shared_array<float>> CachedInterpolationInterface::interpolateBatch(const std::vector<shared_array<float>>& inData, size_t size,
+                                                                                size_t& newSize) const
+{
+    newSize = 0;
+    std::vector<shared_array<float>> outData;
+    for (const shared_array<float>& in : inData)
+        outData.push_back(interpolateValues(in, size, newSize));
+    return outData;
+}
+
+DataPtr CachedInterpolationInterface::interpolateData(DataPtr, double, size_t& newSize) const
+{
+    newSize = 0;
+    return DataPtr();
+}
+
 DataPtr CachedInterpolationInterface::getInputDataSlice(CDMReader_p reader, const std::string& varName, size_t unLimDimPos) const
 {
     DataPtr data;
@@ -149,66 +187,99 @@ CachedInterpolationInterface_p createCachedInterpolation(const std::string& xDim
 CachedInterpolation::CachedInterpolation(const std::string& xDimName, const std::string& yDimName, int funcType, shared_array<double> pointsOnXAxis,
                                          shared_array<double> pointsOnYAxis, size_t inx, size_t iny, size_t outx, size_t outy)
     : CachedInterpolationInterface(xDimName, yDimName, inx, iny, outx, outy)
-    , pointsOnXAxis(pointsOnXAxis)
-    , pointsOnYAxis(pointsOnYAxis)
 {
     // we do not round pointsOnXYAxis values here:
     // * mifi_get_values_bilinear_f and mifi_get_values_bicubic_f use floor/fraction
 
-    switch (funcType) {
-    case MIFI_INTERPOL_BILINEAR: this->func = mifi_get_values_bilinear_f; break;
-    case MIFI_INTERPOL_BICUBIC:  this->func = mifi_get_values_bicubic_f; break;
-#if 0
-    case MIFI_INTERPOL_NEAREST_NEIGHBOR:
-    case MIFI_INTERPOL_COORD_NN:
-    case MIFI_INTERPOL_COORD_NN_KD: this->func = mifi_get_values_f; break;
-#endif
-    default:
+    method = funcType;
+    if (funcType != MIFI_INTERPOL_BILINEAR && funcType != MIFI_INTERPOL_BICUBIC)
         throw CDMException("CachedInterpolation supports only bilinear and bicubic, not: " + type2string(funcType));
+
+    createReducedDomain(xDimName, yDimName, pointsOnXAxis.get(), pointsOnYAxis.get());
+    createWeights(pointsOnXAxis.get(), pointsOnYAxis.get());
+}
+
+namespace {
+
+/**
+ * Bicubic convolution weights for a = -0.5, as in mifi_get_values_bicubic_f:
+ * XM = X*M with X = (1, frac, frac^2, frac^3)
+ */
+void bicubicWeights(double frac, double* XM)
+{
+    double M[4][4] = {{0, 2, 0, 0}, {-1, 0, 1, 0}, {2, -5, 4, -1}, {-1, 3, -3, 1}};
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            M[i][j] *= .5;
+    double X[4];
+    X[0] = 1;
+    X[1] = frac;
+    X[2] = frac * frac;
+    X[3] = X[2] * frac;
+    for (int i = 0; i < 4; i++) {
+        XM[i] = 0;
+        for (int j = 0; j < 4; j++) {
+            XM[i] += X[j] * M[j][i];
+        }
     }
+}
 
-    createReducedDomain(xDimName, yDimName);
+/**
+ * Bicubic weights as stored in the weight tables: the first 3 weights rounded to float,
+ * the 4th follows from the sum of all weights, which is 1.
+ */
+void bicubicTableWeights(double frac, float* w)
+{
+    double XM[4];
+    bicubicWeights(frac, XM);
+    for (int i = 0; i < 3; i++)
+        w[i] = XM[i];
 }
 
-shared_array<float> CachedInterpolation::interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const
+/** the 4th of the bicubic weights stored by bicubicTableWeights() */
+inline double bicubicLastWeight(const float* w)
 {
-    const size_t outLayerSize = outX * outY;
-    const size_t inZ = size / (inX*inY);
-    newSize = outLayerSize*inZ;
-    auto outfield = make_shared_array<float>(newSize);
-
-#ifdef _OPENMP
-#pragma omp parallel default(shared)
-    {
-#endif
-        bool error = false;
-        std::unique_ptr<float[]> zValues(new float[inZ]);
-#ifdef _OPENMP
-#pragma omp for
-#endif
-    for (size_t xy = 0; xy < outLayerSize; ++xy) {
-        if (!error) {
-            float* outPos = &outfield[xy];
-            if (func(inData.get(), zValues.get(), pointsOnXAxis[xy], pointsOnYAxis[xy], inX, inY, inZ) != MIFI_ERROR) {
-                for (size_t z = 0; z < inZ; ++z) {
-                    *outPos = zValues[z];
-                    outPos += outLayerSize;
-                }
-            } else {
-                error = true;
+    return ((1. - w[0]) - w[1]) - w[2];
+}
+
+/**
+ * Bilinear value of a point near or outside the border: as mifi_get_values_bilinear_f,
+ * nearest neighbor in the direction(s) without two input points.
+ */
+template <typename T>
+T bilinearBorderValue(const T* inLayer, long long ix, long long iy, double x, double y)
+{
+    const T undefined = std::numeric_limits<T>::quiet_NaN();
+    if (mifi_isnan(x) || mifi_isnan(y))
+        return undefined;
+
+    const long long x0 = static_cast<long long>(std::floor(x));
+    const long long y0 = static_cast<long long>(std::floor(y));
+    const T xfrac = x - x0;
+    const T yfrac = y - y0;
+    if (0 <= x0 && x0 + 1 < ix) {
+        // linear interpolation in x, nearest neighbor in y
+        const long long yn = std::lround(y);
+        if (0 <= yn && yn < iy) {
+            const T* in = inLayer + yn * ix + x0;
+            return (T(1) - xfrac) * in[0] + xfrac * in[1];
+        }
+    } else {
+        const long long xn = std::lround(x);
+        if (0 <= xn && xn < ix) {
+            if (0 <= y0 && y0 + 1 < iy) {
+                // nearest neighbor in x, linear in y
+                const T* in = inLayer + y0 * ix + xn;
+                return (1 - yfrac) * in[0] + (yfrac * in[ix]);
             }
+            const long long yn = std::lround(y);
+            if (0 <= yn && yn < iy)
+                return inLayer[yn * ix + xn];
         }
     }
-    if (error)
-        throw CDMException("error during interpolation");
-#ifdef _OPENMP
-    }
-#endif
-
-    return outfield;
+    return undefined;
 }
 
-namespace {
 const long long EXTEND = 2;
 
 // adapt types
@@ -217,45 +288,282 @@ inline long long clamp_ex(long long low, double dvalue, long long extend, long l
     const long long value = (extend > 0 ? std::ceil(dvalue) : std::floor(dvalue)) + extend;
     return clamp(low, value, high);
 }
-} // namespace
 
-void CachedInterpolation::createReducedDomain(const std::string& xDimName, const std::string& yDimName)
+/**
+ * Input range needed for the positions x and y, with additional cells for
+ * interpolation (2 for bicubic).
+ *
+ * @param inX, inY the size of the input, changed to the size of the range
+ * @param minX, minY the offset of the range
+ * @return false if the range would not be useful, inX and inY are unchanged then
+ */
+bool reducedRange(const double* x, size_t nx, const double* y, size_t ny, size_t& inX, size_t& inY, long long& minX, long long& minY)
 {
-    // don't set twice
-    if (reducedDomain())
-        return;
-
-    const size_t outLayerSize = outX * outY;
-    const auto minmaxX = min_max_element(pointsOnXAxis.get(), pointsOnXAxis.get() + outLayerSize);
-    const auto minmaxY = min_max_element(pointsOnYAxis.get(), pointsOnYAxis.get() + outLayerSize);
+    const auto minmaxX = min_max_element(x, x + nx);
+    const auto minmaxY = min_max_element(y, y + ny);
 
-    // allow additional cells for interpolation (2 for bicubic)
-    const long long minX = clamp_ex(0, *minmaxX.first, -EXTEND, inX - 1);
-    const long long minY = clamp_ex(0, *minmaxY.first, -EXTEND, inY - 1);
+    minX = clamp_ex(0, *minmaxX.first, -EXTEND, inX - 1);
+    minY = clamp_ex(0, *minmaxY.first, -EXTEND, inY - 1);
     const long long maxX = clamp_ex(0, *minmaxX.second, +EXTEND, inX - 1);
     const long long maxY = clamp_ex(0, *minmaxY.second, +EXTEND, inY - 1);
 
     // make sure we still have a useful size
     if ((maxX - minX) < 1 || (maxY - minY) < 1)
-        return;
+        return false;
+
+    // reduce the expected input size
+    inX = maxX - minX + 1;
+    inY = maxY - minY + 1;
+    return true;
+}
+
+// output points per task of interpolateValues
+const size_t INNER_BLOCK = 16384;
 
-    // update the axes
-    for (size_t xy = 0; xy < outX * outY; ++xy) {
-        pointsOnXAxis[xy] -= minX;
-        pointsOnYAxis[xy] -= minY;
+// output points of several fields interpolated while their positions and weights are in the cache
+const size_t CACHE_BLOCK = 256;
+
+} // namespace
+
+void CachedInterpolation::createWeights(const double* pointsOnXAxis, const double* pointsOnYAxis)
+{
+    const size_t outLayerSize = outX * outY;
+    if (outLayerSize > std::numeric_limits<std::uint32_t>::max() || inX * inY > std::numeric_limits<std::uint32_t>::max())
+        throw CDMException("too many points for interpolation weights: " + type2string(inX * inY) + " -> " + type2string(outLayerSize));
+
+    // the positions relative to the reduced domain
+    const double minX = reducedDomain() ? reducedDomain()->xMin : 0;
+    const double minY = reducedDomain() ? reducedDomain()->yMin : 0;
+    const double ix = inX, iy = inY;
+    for (size_t xy = 0; xy < outLayerSize; ++xy) {
+        const double x = pointsOnXAxis[xy] - minX;
+        const double y = pointsOnYAxis[xy] - minY;
+        // same conditions as mifi_get_values_bilinear_f / mifi_get_values_bicubic_f, false for nan
+        const double x0 = std::floor(x);
+        const double y0 = std::floor(y);
+        if (method == MIFI_INTERPOL_BILINEAR && 0 <= x0 && x0 + 1 < ix && 0 <= y0 && y0 + 1 < iy) {
+            innerOut.push_back(xy);
+            innerIn.push_back(static_cast<size_t>(y0) * inX + static_cast<size_t>(x0));
+            innerXFrac.push_back(x - x0);
+            innerYFrac.push_back(y - y0);
+        } else if (method == MIFI_INTERPOL_BICUBIC && 1 <= x0 && x0 + 2 < ix && 1 <= y0 && y0 + 2 < iy) {
+            innerOut.push_back(xy);
+            innerIn.push_back(static_cast<size_t>(y0 - 1) * inX + static_cast<size_t>(x0 - 1));
+            float w[3];
+            bicubicTableWeights(x - x0, w);
+            innerXM.insert(innerXM.end(), w, w + 3);
+            bicubicTableWeights(y - y0, w);
+            innerMY.insert(innerMY.end(), w, w + 3);
+        } else {
+            borderOut.push_back(xy);
+            if (method == MIFI_INTERPOL_BILINEAR) {
+                borderX.push_back(x);
+                borderY.push_back(y);
+            }
+        }
     }
+    LOG4FIMEX(logger, Logger::DEBUG, "interpolation weights for " << innerOut.size() << " inner and " << borderOut.size() << " border points");
+}
 
-    reducedDomain_ = std::make_shared<ReducedInterpolationDomain>(xDimName, yDimName, minX, minY);
+template <typename T>
+void CachedInterpolation::interpolateInner(const T* inLayer, T* outLayer, size_t begin, size_t end) const
+{
+    // the arithmetic is the same as in mifi_get_values_bilinear_f and mifi_get_values_bicubic_f,
+    // such that the results are identical for bilinear float, bicubic has float weights
+    const std::uint32_t* outPos = innerOut.data();
+    const std::uint32_t* inPos = innerIn.data();
+    if (method == MIFI_INTERPOL_BILINEAR) {
+        const size_t ix = inX;
+        const float* xFrac = innerXFrac.data();
+        const float* yFrac = innerYFrac.data();
+        for (size_t i = begin; i < end; ++i) {
+            const T* in = inLayer + inPos[i];
+            const T xfrac = xFrac[i], yfrac = yFrac[i];
+            // Missing values: NANs will be propagated by IEEE
+            outLayer[outPos[i]] = (T(1) - yfrac) * ((T(1) - xfrac) * in[0] + xfrac * in[1]) + yfrac * ((T(1) - xfrac) * in[ix] + xfrac * in[ix + 1]);
+        }
+    } else {
+        const float* XM = innerXM.data();
+        const float* MY = innerMY.data();
+        for (size_t i = begin; i < end; ++i) {
+            const T* in = inLayer + inPos[i];
+            const float* xmi = XM + 3 * i;
+            const float* myi = MY + 3 * i;
+            const double xm[4] = {xmi[0], xmi[1], xmi[2], bicubicLastWeight(xmi)};
+            const double my[4] = {myi[0], myi[1], myi[2], bicubicLastWeight(myi)};
+            T out = 0;
+            for (int r = 0; r < 4; r++) {
+                const T* row = in + r * inX;
+                const double xmf = ((xm[0] * row[0] + xm[1] * row[1]) + xm[2] * row[2]) + xm[3] * row[3];
+                out += xmf * my[r];
+            }
+            outLayer[outPos[i]] = out;
+        }
+    }
+}
 
-    // reduce the expected input size
-    inX = maxX-minX+1;
-    inY = maxY-minY+1;
+template <typename T>
+T CachedInterpolation::borderValue(const T* inLayer, size_t b) const
+{
+    if (method != MIFI_INTERPOL_BILINEAR)
+        return std::numeric_limits<T>::quiet_NaN();
+    return bilinearBorderValue(inLayer, inX, inY, borderX[b], borderY[b]);
+}
+
+template <typename T>
+shared_array<T> CachedInterpolation::interpolateLayers(shared_array<T> inData, size_t size, size_t& newSize) const
+{
+    const size_t inLayerSize = inX * inY;
+    const size_t outLayerSize = outX * outY;
+    const size_t inZ = size / inLayerSize;
+    newSize = outLayerSize * inZ;
+    auto outfield = make_shared_array<T>(newSize);
+
+    // layer-major: each task interpolates a block of output points of one layer
+    // from the precomputed weights, reading only that input layer
+    const size_t nBlocks = std::max(size_t(1), (innerOut.size() + INNER_BLOCK - 1) / INNER_BLOCK);
+    WorkerPool::shared().parallelFor(0, inZ * nBlocks, [&](size_t task) {
+        const size_t z = task / nBlocks;
+        const size_t block = task % nBlocks;
+        const T* inLayer = &inData[z * inLayerSize];
+        T* outLayer = &outfield[z * outLayerSize];
+        interpolateInner(inLayer, outLayer, block * INNER_BLOCK, std::min(innerOut.size(), (block + 1) * INNER_BLOCK));
+        if (block == 0) {
+            for (size_t b = 0; b < borderOut.size(); ++b)
+                outLayer[borderOut[b]] = borderValue(inLayer, b);
+        }
+    });
+
+    return outfield;
+}
+
+shared_array<float> CachedInterpolation::interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const
+{
+    return interpolateLayers(inData, size, newSize);
+}
+
+shared_array<double> CachedInterpolation::interpolateValues(shared_array<double> inData, size_t size, size_t& newSize) const
+{
+    return interpolateLayers(inData, size, newSize);
+}
+
+void CachedInterpolation::interpolateVectorValues(shared_array<float> uData, shared_array<float> vData, size_t size, const CachedVectorReprojection& cvr,
+                                                  shared_array<float>& uOut, shared_array<float>& vOut, size_t& newSize) const
+{
+    if (cvr.getXSize() != outX || cvr.getYSize() != outY) {
+        CachedInterpolationInterface::interpolateVectorValues(uData, vData, size, cvr, uOut, vOut, newSize);
+        return;
+    }
+
+    const size_t inLayerSize = inX * inY;
+    const size_t outLayerSize = outX * outY;
+    const size_t inZ = size / inLayerSize;
+    newSize = outLayerSize * inZ;
+    uOut = make_shared_array<float>(newSize);
+    vOut = make_shared_array<float>(newSize);
+
+    // the same tasks as interpolateLayers, rotating each small block of points
+    // right after interpolating both components
+    const size_t nBlocks = std::max(size_t(1), (innerOut.size() + INNER_BLOCK - 1) / INNER_BLOCK);
+    WorkerPool::shared().parallelFor(0, inZ * nBlocks, [&](size_t task) {
+        const size_t z = task / nBlocks;
+        const size_t block = task % nBlocks;
+        const float* uIn = &uData[z * inLayerSize];
+        const float* vIn = &vData[z * inLayerSize];
+        float* uLayer = &uOut[z * outLayerSize];
+        float* vLayer = &vOut[z * outLayerSize];
+        const size_t end = std::min(innerOut.size(), (block + 1) * INNER_BLOCK);
+        for (size_t begin = block * INNER_BLOCK; begin < end; begin += CACHE_BLOCK) {
+            const size_t stop = std::min(end, begin + CACHE_BLOCK);
+            interpolateInner(uIn, uLayer, begin, stop);
+            interpolateInner(vIn, vLayer, begin, stop);
+            cvr.reprojectValues(uLayer, vLayer, &innerOut[begin], stop - begin);
+        }
+        if (block == 0) {
+            for (size_t b = 0; b < borderOut.size(); ++b) {
+                uLayer[borderOut[b]] = borderValue(uIn, b);
+                vLayer[borderOut[b]] = borderValue(vIn, b);
+            }
+            cvr.reprojectValues(uLayer, vLayer, borderOut.data(), borderOut.size());
+        }
+    });
+}
+
+std::vector<shared_array<float>> CachedInterpolation::interpolateBatch(const std::vector<shared_array<float>>& inData, size_t size, size_t& newSize) const
+{
+    const size_t inLayerSize = inX * inY;
+    const size_t outLayerSize = outX * outY;
+    const size_t inZ = size / inLayerSize;
+    newSize = outLayerSize * inZ;
+    std::vector<shared_array<float>> outData;
+    for (size_t v = 0; v < inData.size(); ++v)
+        outData.push_back(make_shared_array<float>(newSize));
+
+    // the same tasks as interpolateLayers, running all fields on each small block of points
+    const size_t nBlocks = std::max(size_t(1), (innerOut.size() + INNER_BLOCK - 1) / INNER_BLOCK);
+    WorkerPool::shared().parallelFor(0, inZ * nBlocks, [&](size_t task) {
+        const size_t z = task / nBlocks;
+        const size_t block = task % nBlocks;
+        const size_t end = std::min(innerOut.size(), (block + 1) * INNER_BLOCK);
+        for (size_t begin = block * INNER_BLOCK; begin < end; begin += CACHE_BLOCK) {
+            const size_t stop = std::min(end, begin + CACHE_BLOCK);
+            for (size_t v = 0; v < inData.size(); ++v)
+                interpolateInner(&inData[v][z * inLayerSize], &outData[v][z * outLayerSize], begin, stop);
+        }
+        if (block == 0) {
+            for (size_t v = 0; v < inData.size(); ++v) {
+                const float* inLayer = &inData[v][z * inLayerSize];
+                float* outLayer = &outData[v][z * outLayerSize];
+                for (size_t b = 0; b < borderOut.size(); ++b)
+                    outLayer[borderOut[b]] = borderValue(inLayer, b);
+            }
+        }
+    });
+    return outData;
+}
+
+void CachedInterpolation::createReducedDomain(const std::string& xDimName, const std::string& yDimName, const double* pointsOnXAxis,
+                                              const double* pointsOnYAxis)
+{
+    // don't set twice
+    if (reducedDomain())
+        return;
+
+    // the positions are shifted by createWeights(), they might be shared, e.g. with the InterpolationCache
+    const size_t outLayerSize = outX * outY;
+    long long minX, minY;
+    if (!reducedRange(pointsOnXAxis, outLayerSize, pointsOnYAxis, outLayerSize, inX, inY, minX, minY))
+        return;
+
+    reducedDomain_ = std::make_shared<ReducedInterpolationDomain>(xDimName, yDimName, minX, minY);
 }
 
 namespace {
 
 const size_t INVALID = ~0u;
 
+/**
+ * Extend the range of input points used by nearest neighbor by additional cells
+ * for pre/postprocessing.
+ *
+ * @return true if the extended range is smaller than the input and still useful
+ */
+bool extendNearestRange(size_t inX, size_t inY, size_t& minInX, size_t& maxInX, size_t& minInY, size_t& maxInY)
+{
+    const size_t EXTEND = 2;
+    if (minInX > EXTEND)
+        minInX -= EXTEND;
+    else
+        minInX = 0;
+    if (minInY > EXTEND)
+        minInY -= EXTEND;
+    else
+        minInY = 0;
+    maxInX = std::min(inX - 1, maxInX + EXTEND);
+    maxInY = std::min(inY - 1, maxInY + EXTEND);
+    return (minInX > 0 || minInY > 0 || maxInX < inX - 1 || maxInY < inY - 1) && (minInX + 2 * EXTEND <= maxInX) && (minInY + 2 * EXTEND <= maxInY);
+}
+
 } // namespace
 
 // pointsOnXAxis map each point in inData[y*inX+x] to a x-position in outData
@@ -264,7 +572,7 @@ CachedNNInterpolation::CachedNNInterpolation(const std::string& xDimName, const
     : CachedInterpolationInterface(xDimName, yDimName, inx, iny, outx, outy)
 {
     const size_t outLayerSize = outX * outY;
-    pointsInIn = std::vector<size_t>(outLayerSize, INVALID);
+    std::vector<size_t> pointsInIn(outLayerSize, INVALID);
     size_t minInX = inX, maxInX = 0, minInY = inY, maxInY = 0;
     const RoundAndClamp roundX(0, inX - 1, INVALID);
     const RoundAndClamp roundY(0, inY - 1, INVALID);
@@ -284,19 +592,7 @@ CachedNNInterpolation::CachedNNInterpolation(const std::string& xDimName, const
     }
     LOG4FIMEX(logger, Logger::DEBUG, "ranges: x=" << minInX << "..." << maxInX << " y=" << minInY << "..." << maxInY);
 
-    // allow additional cells for pre/postprocessing
-    const size_t EXTEND = 2;
-    if (minInX > EXTEND)
-        minInX -= EXTEND;
-    else
-        minInX = 0;
-    if (minInY > EXTEND)
-        minInY -= EXTEND;
-    else
-        minInY = 0;
-    maxInX = std::min(inX - 1, maxInX + EXTEND);
-    maxInY = std::min(inY - 1, maxInY + EXTEND);
-    if ((minInX > 0 || minInY > 0 || maxInX < inX - 1 || maxInY < inY - 1) && (minInX + 2 * EXTEND <= maxInX) && (minInY + 2 * EXTEND <= maxInY)) {
+    if (extendNearestRange(inX, inY, minInX, maxInX, minInY, maxInY)) {
         const size_t redInX = maxInX - minInX + 1;
         const size_t redInY = maxInY - minInY + 1;
         for (size_t o = 0; o < outLayerSize; ++o) {
@@ -312,28 +608,348 @@ CachedNNInterpolation::CachedNNInterpolation(const std::string& xDimName, const
         inX = redInX;
         inY = redInY;
     }
+
+    matrix = std::make_shared<WeightMatrix>(inX * inY);
+    for (size_t i : pointsInIn) {
+        if (i != INVALID)
+            matrix->addWeight(i, 1);
+        matrix->endRow();
+    }
 }
 
 shared_array<float> CachedNNInterpolation::interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const
 {
-    const size_t outLayerSize = outX * outY;
+    // a single weight 1 per row, the values are copied exactly
+    return matrix->apply(inData, size, newSize);
+}
+
+shared_array<double> CachedNNInterpolation::interpolateValues(shared_array<double> inData, size_t size, size_t& newSize) const
+{
+    return matrix->apply(inData, size, newSize);
+}
+
+namespace {
+
+template <typename T>
+DataPtr copyNearest(const WeightMatrix& matrix, DataPtr inData, double badValue, size_t& newSize)
+{
+    const size_t nRows = matrix.rows(), nColumns = matrix.columns();
+    const size_t nLayers = (nColumns > 0) ? inData->size() / nColumns : 0;
+    newSize = nLayers * nRows;
+    const T* in = static_cast<const T*>(inData->getDataPtr());
+    auto out = make_shared_array<T>(newSize);
+    const T bad = data_caster<T, double>()(badValue);
+    const std::uint32_t* rs = matrix.rowStart().data();
+    const std::uint32_t* col = matrix.columnIndices().data();
+    WorkerPool::shared().parallelFor(0, nLayers, [&](size_t z) {
+        const T* inLayer = in + z * nColumns;
+        T* outLayer = &out[z * nRows];
+        for (size_t r = 0; r < nRows; ++r)
+            outLayer[r] = (rs[r] == rs[r + 1]) ? bad : inLayer[col[rs[r]]];
+    });
+    return createData(newSize, out);
+}
+
+} // namespace
+
+DataPtr CachedNNInterpolation::interpolateData(DataPtr inData, double badValue, size_t& newSize) const
+{
+    // clang-format off
+    switch (inData->getDataType()) {
+    case CDM_CHAR: return copyNearest<char>(*matrix, inData, badValue, newSize);
+    case CDM_SHORT: return copyNearest<short>(*matrix, inData, badValue, newSize);
+    case CDM_INT: return copyNearest<int>(*matrix, inData, badValue, newSize);
+    case CDM_INT64: return copyNearest<long long>(*matrix, inData, badValue, newSize);
+    case CDM_UCHAR: return copyNearest<unsigned char>(*matrix, inData, badValue, newSize);
+    case CDM_USHORT: return copyNearest<unsigned short>(*matrix, inData, badValue, newSize);
+    case CDM_UINT: return copyNearest<unsigned int>(*matrix, inData, badValue, newSize);
+    case CDM_UINT64: return copyNearest<unsigned long long>(*matrix, inData, badValue, newSize);
+    case CDM_FLOAT: return copyNearest<float>(*matrix, inData, badValue, newSize);
+    case CDM_DOUBLE: return copyNearest<double>(*matrix, inData, badValue, newSize);
+    default: return CachedInterpolationInterface::interpolateData(inData, badValue, newSize);
+    }
+    // clang-format on
+}
+
+
+CachedSeparableInterpolation::CachedSeparableInterpolation(const std::string& xDimName, const std::string& yDimName, int funcType,
+                                                           shared_array<double> pointsOnXAxis, shared_array<double> pointsOnYAxis, size_t inx, size_t iny,
+                                                           size_t outx, size_t outy)
+    : CachedInterpolationInterface(xDimName, yDimName, inx, iny, outx, outy)
+    , method(funcType)
+    , pointsOnXAxis(pointsOnXAxis.get(), pointsOnXAxis.get() + outx)
+    , pointsOnYAxis(pointsOnYAxis.get(), pointsOnYAxis.get() + outy)
+{
+    if (funcType != MIFI_INTERPOL_BILINEAR && funcType != MIFI_INTERPOL_BICUBIC && funcType != MIFI_INTERPOL_NEAREST_NEIGHBOR)
+        throw CDMException("CachedSeparableInterpolation supports only bilinear, bicubic and nearest neighbor, not: " + type2string(funcType));
+
+    createReducedDomain(xDimName, yDimName);
+    createWeights();
+}
+
+void CachedSeparableInterpolation::createReducedDomain(const std::string& xDimName, const std::string& yDimName)
+{
+    if (method == MIFI_INTERPOL_NEAREST_NEIGHBOR) {
+        // the nearest input points are found before reducing the domain, as in CachedNNInterpolation
+        const RoundAndClamp roundX(0, inX - 1, INVALID);
+        const RoundAndClamp roundY(0, inY - 1, INVALID);
+        colIn.resize(outX);
+        rowIn.resize(outY);
+        size_t minInX = inX, maxInX = 0, minInY = inY, maxInY = 0;
+        for (size_t c = 0; c < outX; ++c) {
+            colIn[c] = roundX(pointsOnXAxis[c]);
+            if (colIn[c] != INVALID) {
+                minInX = std::min(minInX, colIn[c]);
+                maxInX = std::max(maxInX, colIn[c]);
+            }
+        }
+        for (size_t r = 0; r < outY; ++r) {
+            rowIn[r] = roundY(pointsOnYAxis[r]);
+            if (rowIn[r] != INVALID) {
+                minInY = std::min(minInY, rowIn[r]);
+                maxInY = std::max(maxInY, rowIn[r]);
+            }
+        }
+        if (minInX > maxInX || minInY > maxInY) {
+            // no output point with both an input column and row
+            minInX = inX;
+            maxInX = 0;
+            minInY = inY;
+            maxInY = 0;
+        }
+        if (extendNearestRange(inX, inY, minInX, maxInX, minInY, maxInY)) {
+            for (size_t& c : colIn)
+                if (c != INVALID)
+                    c -= minInX;
+            for (size_t& r : rowIn)
+                if (r != INVALID)
+                    r -= minInY;
+            reducedDomain_ = std::make_shared<ReducedInterpolationDomain>(xDimName, yDimName, minInX, minInY);
+            inX = maxInX - minInX + 1;
+            inY = maxInY - minInY + 1;
+        }
+        return;
+    }
+
+    long long minX, minY;
+    if (!reducedRange(pointsOnXAxis.data(), outX, pointsOnYAxis.data(), outY, inX, inY, minX, minY))
+        return;
+    for (double& x : pointsOnXAxis)
+        x -= minX;
+    for (double& y : pointsOnYAxis)
+        y -= minY;
+    reducedDomain_ = std::make_shared<ReducedInterpolationDomain>(xDimName, yDimName, minX, minY);
+}
+
+namespace {
+
+/**
+ * First input point and weights of the positions along one axis, with the same
+ * conditions for inner points as CachedInterpolation::createWeights().
+ */
+void axisWeights(int method, const std::vector<double>& points, size_t in, std::vector<size_t>& first, std::vector<double>* w, std::vector<char>& inner)
+{
+    const size_t n = points.size();
+    first.assign(n, 0);
+    inner.assign(n, 0);
+    for (int k = 0; k < 4; ++k)
+        w[k].assign(n, 0.);
+    for (size_t i = 0; i < n; ++i) {
+        const double p = points[i];
+        const double p0 = std::floor(p);
+        if (method == MIFI_INTERPOL_BILINEAR && 0 <= p0 && p0 + 1 < in) {
+            inner[i] = 1;
+            first[i] = static_cast<size_t>(p0);
+            w[0][i] = static_cast<float>(p - p0);
+        } else if (method == MIFI_INTERPOL_BICUBIC && 1 <= p0 && p0 + 2 < in) {
+            inner[i] = 1;
+            first[i] = static_cast<size_t>(p0 - 1);
+            float XM[3];
+            bicubicTableWeights(p - p0, XM);
+            for (int k = 0; k < 3; ++k)
+                w[k][i] = XM[k];
+            w[3][i] = bicubicLastWeight(XM);
+        }
+    }
+}
+
+/** copy the nearest input values of rows begin..end, or bad */
+template <typename T>
+void copyNearestRows(const T* inLayer, T* outLayer, size_t inX, size_t outX, const size_t* colIn, const std::vector<size_t>& borderCols, const size_t* rowIn,
+                     const char* rowValid, size_t begin, size_t end, T bad)
+{
+    for (size_t r = begin; r < end; ++r) {
+        T* out = outLayer + r * outX;
+        if (!rowValid[r]) {
+            std::fill(out, out + outX, bad);
+            continue;
+        }
+        const T* in = inLayer + rowIn[r] * inX;
+        for (size_t c = 0; c < outX; ++c)
+            out[c] = in[colIn[c]];
+        for (size_t c : borderCols)
+            out[c] = bad;
+    }
+}
+
+} // namespace
+
+void CachedSeparableInterpolation::createWeights()
+{
+    if (method == MIFI_INTERPOL_NEAREST_NEIGHBOR) {
+        colInner.assign(outX, 1);
+        rowInner.assign(outY, 1);
+        for (size_t c = 0; c < outX; ++c) {
+            if (colIn[c] == INVALID) {
+                colIn[c] = 0;
+                colInner[c] = 0;
+            }
+        }
+        for (size_t r = 0; r < outY; ++r) {
+            if (rowIn[r] == INVALID) {
+                rowIn[r] = 0;
+                rowInner[r] = 0;
+            }
+        }
+    } else {
+        axisWeights(method, pointsOnXAxis, inX, colIn, colW, colInner);
+        axisWeights(method, pointsOnYAxis, inY, rowIn, rowW, rowInner);
+    }
+    for (size_t c = 0; c < outX; ++c)
+        if (!colInner[c])
+            borderCols.push_back(c);
+    LOG4FIMEX(logger, Logger::DEBUG, "separable interpolation weights for " << outX << " columns (" << borderCols.size() << " border) and " << outY << " rows");
+}
+
+template <typename T>
+void CachedSeparableInterpolation::interpolateRows(const T* inLayer, T* outLayer, size_t begin, size_t end) const
+{
+    const T undefined = std::numeric_limits<T>::quiet_NaN();
+    if (method == MIFI_INTERPOL_NEAREST_NEIGHBOR) {
+        copyNearestRows(inLayer, outLayer, inX, outX, colIn.data(), borderCols, rowIn.data(), rowInner.data(), begin, end, undefined);
+        return;
+    }
+
+    // the arithmetic is the same as in CachedInterpolation::interpolateInner, the inner loops
+    // run over all columns with the clamped input columns, border columns are overwritten after
+    const bool innerCols = borderCols.size() < outX;
+    const size_t* x0 = colIn.data();
+    const double* w0 = colW[0].data();
+    const double* w1 = colW[1].data();
+    const double* w2 = colW[2].data();
+    const double* w3 = colW[3].data();
+    for (size_t r = begin; r < end; ++r) {
+        T* out = outLayer + r * outX;
+        if (method == MIFI_INTERPOL_BILINEAR) {
+            if (rowInner[r] && innerCols) {
+                const T* in0 = inLayer + rowIn[r] * inX;
+                const T* in1 = in0 + inX;
+                const T yfrac = rowW[0][r];
+                for (size_t c = 0; c < outX; ++c) {
+                    const T xfrac = w0[c];
+                    const size_t x = x0[c];
+                    out[c] = (T(1) - yfrac) * ((T(1) - xfrac) * in0[x] + xfrac * in0[x + 1]) + yfrac * ((T(1) - xfrac) * in1[x] + xfrac * in1[x + 1]);
+                }
+                for (size_t c : borderCols)
+                    out[c] = bilinearBorderValue(inLayer, inX, inY, pointsOnXAxis[c], pointsOnYAxis[r]);
+            } else {
+                for (size_t c = 0; c < outX; ++c)
+                    out[c] = bilinearBorderValue(inLayer, inX, inY, pointsOnXAxis[c], pointsOnYAxis[r]);
+            }
+        } else {
+            if (rowInner[r] && innerCols) {
+                std::fill(out, out + outX, T(0));
+                for (int k = 0; k < 4; k++) {
+                    const T* row = inLayer + (rowIn[r] + k) * inX;
+                    const double my = rowW[k][r];
+                    for (size_t c = 0; c < outX; ++c) {
+                        const size_t x = x0[c];
+                        const double xmf = ((w0[c] * row[x] + w1[c] * row[x + 1]) + w2[c] * row[x + 2]) + w3[c] * row[x + 3];
+                        out[c] += xmf * my;
+                    }
+                }
+                for (size_t c : borderCols)
+                    out[c] = undefined;
+            } else {
+                std::fill(out, out + outX, undefined);
+            }
+        }
+    }
+}
+
+template <typename T>
+shared_array<T> CachedSeparableInterpolation::interpolateLayers(shared_array<T> inData, size_t size, size_t& newSize) const
+{
     const size_t inLayerSize = inX * inY;
+    const size_t outLayerSize = outX * outY;
     const size_t inZ = size / inLayerSize;
     newSize = outLayerSize * inZ;
+    auto outfield = make_shared_array<T>(newSize);
 
-    auto outData = make_shared_array<float>(newSize);
-    std::fill(outData.get(), outData.get() + newSize, MIFI_UNDEFINED_F);
+    // layer-major, each task interpolates a block of rows of about INNER_BLOCK points
+    const size_t rowsPerBlock = std::max(size_t(1), INNER_BLOCK / std::max(size_t(1), outX));
+    const size_t nBlocks = std::max(size_t(1), (outY + rowsPerBlock - 1) / rowsPerBlock);
+    WorkerPool::shared().parallelFor(0, inZ * nBlocks, [&](size_t task) {
+        const size_t z = task / nBlocks;
+        const size_t block = task % nBlocks;
+        interpolateRows(&inData[z * inLayerSize], &outfield[z * outLayerSize], block * rowsPerBlock, std::min(outY, (block + 1) * rowsPerBlock));
+    });
 
-    for (size_t z = 0; z < inZ; ++z) {
-        const float* inDataZ = &inData[z * inLayerSize];
-        float* outDataZ = &outData[z * outLayerSize];
-        for (size_t o = 0; o < outLayerSize; o++) {
-            const size_t i = pointsInIn[o];
-            if (i != INVALID)
-                outDataZ[o] = inDataZ[i];
-        }
+    return outfield;
+}
+
+shared_array<float> CachedSeparableInterpolation::interpolateValues(shared_array<float> inData, size_t size, size_t& newSize) const
+{
+    return interpolateLayers(inData, size, newSize);
+}
+
+shared_array<double> CachedSeparableInterpolation::interpolateValues(shared_array<double> inData, size_t size, size_t& newSize) const
+{
+    return interpolateLayers(inData, size, newSize);
+}
+
+namespace {
+
+template <typename T>
+DataPtr copyNearestSeparable(DataPtr inData, double badValue, size_t inX, size_t inY, size_t outX, size_t outY, const size_t* colIn,
+                             const std::vector<size_t>& borderCols, const size_t* rowIn, const char* rowValid, size_t& newSize)
+{
+    const size_t inLayerSize = inX * inY, outLayerSize = outX * outY;
+    const size_t nLayers = (inLayerSize > 0) ? inData->size() / inLayerSize : 0;
+    newSize = nLayers * outLayerSize;
+    const T* in = static_cast<const T*>(inData->getDataPtr());
+    auto out = make_shared_array<T>(newSize);
+    const T bad = data_caster<T, double>()(badValue);
+    WorkerPool::shared().parallelFor(0, nLayers, [&](size_t z) {
+        copyNearestRows(in + z * inLayerSize, &out[z * outLayerSize], inX, outX, colIn, borderCols, rowIn, rowValid, 0, outY, bad);
+    });
+    return createData(newSize, out);
+}
+
+} // namespace
+
+DataPtr CachedSeparableInterpolation::interpolateData(DataPtr inData, double badValue, size_t& newSize) const
+{
+    if (method != MIFI_INTERPOL_NEAREST_NEIGHBOR)
+        return CachedInterpolationInterface::interpolateData(inData, badValue, newSize);
+
+#define FIMEX_COPY_NEAREST(T) copyNearestSeparable<T>(inData, badValue, inX, inY, outX, outY, colIn.data(), borderCols, rowIn.data(), rowInner.data(), newSize)
+    // clang-format off
+    switch (inData->getDataType()) {
+    case CDM_CHAR: return FIMEX_COPY_NEAREST(char);
+    case CDM_SHORT: return FIMEX_COPY_NEAREST(short);
+    case CDM_INT: return FIMEX_COPY_NEAREST(int);
+    case CDM_INT64: return FIMEX_COPY_NEAREST(long long);
+    case CDM_UCHAR: return FIMEX_COPY_NEAREST(unsigned char);
+    case CDM_USHORT: return FIMEX_COPY_NEAREST(unsigned short);
+    case CDM_UINT: return FIMEX_COPY_NEAREST(unsigned int);
+    case CDM_UINT64: return FIMEX_COPY_NEAREST(unsigned long long);
+    case CDM_FLOAT: return FIMEX_COPY_NEAREST(float);
+    case CDM_DOUBLE: return FIMEX_COPY_NEAREST(double);
+    default: return CachedInterpolationInterface::interpolateData(inData, badValue, newSize);
     }
-    return outData;
+    // clang-format on
+#undef FIMEX_COPY_NEAREST
 }
 
 } // namespace MetNoFimex
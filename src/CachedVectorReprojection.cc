@@ -46,6 +46,21 @@ void CachedVectorReprojection::reprojectValues(shared_array<float>& uValues, sha
     reproject::vector_reproject_values_by_matrix_f(matrix, &uValues[0], &vValues[0], oz);
 }
 
+void CachedVectorReprojection::reprojectValues(float* uLayer, float* vLayer, const std::uint32_t* xy, size_t n) const
+{
+    // the same arithmetic as vector_reproject_values_by_matrix_f
+    const double* mtx = matrix->mtx();
+    for (size_t i = 0; i < n; i++) {
+        const size_t pos = xy[i];
+        const double c = mtx[pos * reproject::Matrix::stride + 0];
+        const double s = mtx[pos * reproject::Matrix::stride + 1];
+        const double u_new = uLayer[pos] * c - vLayer[pos] * s;
+        const double v_new = uLayer[pos] * s + vLayer[pos] * c;
+        uLayer[pos] = u_new;
+        vLayer[pos] = v_new;
+    }
+}
+
 void CachedVectorReprojection::reprojectDirectionValues(shared_array<float>& angles, size_t size) const
 {
     const size_t oz = size / (getXSize() * getYSize());
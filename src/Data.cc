@@ -24,6 +24,7 @@
 #include "fimex/Data.h"
 
 #include "DataImpl.h"
+#include "DataView.h"
 #include "NativeData.h"
 #include "StringData.h"
 
@@ -145,6 +146,60 @@ DataPtr createDataSlice(CDMDataType datatype, const Data& data, size_t dataStart
     return d;
 }
 
+namespace {
+
+template <typename T>
+DataPtr createDataViewT(DataPtr data, const std::vector<size_t>& orgDimSize, const std::vector<size_t>& startDims, const std::vector<size_t>& outputDimSize)
+{
+    if (dynamic_cast<DataView<T>*>(data.get()))
+        return data->slice(orgDimSize, startDims, outputDimSize);
+    DataImpl<T>* impl = dynamic_cast<DataImpl<T>*>(data.get());
+    if (!impl || orgDimSize.size() == 0)
+        return data->slice(orgDimSize, startDims, outputDimSize);
+
+    size_t orgSize = 1;
+    for (size_t d : orgDimSize)
+        orgSize *= d;
+    if (orgSize != data->size())
+        throw CDMException("dimension-mismatch: " + type2string(data->size()) + "!=" + type2string(orgSize));
+    return DataView<T>::create(impl->asBase(), data->getDataType(), 0, orgDimSize, startDims, outputDimSize);
+}
+
+} // namespace
+
+DataPtr createDataView(DataPtr data, const std::vector<size_t>& orgDimSize, const std::vector<size_t>& startDims, const std::vector<size_t>& outputDimSize)
+{
+    // clang-format off
+    switch (data->getDataType()) {
+    case CDM_DOUBLE:  return createDataViewT<double>            (data, orgDimSize, startDims, outputDimSize);
+    case CDM_FLOAT:   return createDataViewT<float>             (data, orgDimSize, startDims, outputDimSize);
+    case CDM_INT64:   return createDataViewT<long long>         (data, orgDimSize, startDims, outputDimSize);
+    case CDM_INT:     return createDataViewT<int>               (data, orgDimSize, startDims, outputDimSize);
+    case CDM_SHORT:   return createDataViewT<short>             (data, orgDimSize, startDims, outputDimSize);
+    case CDM_CHAR:    return createDataViewT<char>              (data, orgDimSize, startDims, outputDimSize);
+    case CDM_UINT64:  return createDataViewT<unsigned long long>(data, orgDimSize, startDims, outputDimSize);
+    case CDM_UINT:    return createDataViewT<unsigned int>      (data, orgDimSize, startDims, outputDimSize);
+    case CDM_USHORT:  return createDataViewT<unsigned short>    (data, orgDimSize, startDims, outputDimSize);
+    case CDM_UCHAR:   return createDataViewT<unsigned char>     (data, orgDimSize, startDims, outputDimSize);
+    default: return data->slice(orgDimSize, startDims, outputDimSize);
+    }
+    // clang-format on
+}
+
+DataPtr createDataView(DataPtr data, size_t dataStartPos, size_t dataSize)
+{
+    switch (data->getDataType()) {
+    case CDM_STRING:
+    case CDM_STRINGS:
+    case CDM_NAT:
+        if (dataStartPos == 0 && dataSize == data->size())
+            return data->clone();
+        return createDataSlice(data->getDataType(), *data, dataStartPos, dataSize);
+    default:
+        return createDataView(data, std::vector<size_t>(1, data->size()), std::vector<size_t>(1, dataStartPos), std::vector<size_t>(1, dataSize));
+    }
+}
+
 template<>
 void DataImpl<char>::setValues(size_t startPos, const Data& data, size_t first, size_t last) {
     copyData(startPos, data.asChar(), data.size(), first, last);
@@ -240,4 +295,39 @@ DataPtr convertValues(const Data& data, CDMDataType newType)
     throw CDMException("cannot convert unknown datatype");
 }
 
+namespace {
+template <typename T>
+size_t copyArray(shared_array<T> values, size_t size, void* dst)
+{
+    std::copy(values.get(), values.get() + size, reinterpret_cast<T*>(dst));
+    return size;
+}
+} // namespace
+
+size_t copyValues(const Data& data, CDMDataType newType, void* dst)
+{
+    const size_t size = data.size();
+    if (size == 0)
+        return 0;
+
+    // clang-format off
+    switch (newType) {
+    case CDM_CHAR:   return copyArray(data.asChar(), size, dst);
+    case CDM_SHORT:  return copyArray(data.asShort(), size, dst);
+    case CDM_INT:    return copyArray(data.asInt(), size, dst);
+    case CDM_UCHAR:  return copyArray(data.asUChar(), size, dst);
+    case CDM_USHORT: return copyArray(data.asUShort(), size, dst);
+    case CDM_UINT:   return copyArray(data.asUInt(), size, dst);
+    case CDM_INT64:  return copyArray(data.asInt64(), size, dst);
+    case CDM_UINT64: return copyArray(data.asUInt64(), size, dst);
+    case CDM_FLOAT:  return copyArray(data.asFloat(), size, dst);
+    case CDM_DOUBLE: return copyArray(data.asDouble(), size, dst);
+    case CDM_STRING:
+    case CDM_STRINGS:
+    case CDM_NAT: throw CDMException("cannot copy " + type2string(newType) + " datatype");
+    }
+    // clang-format on
+    throw CDMException("cannot copy unknown datatype");
+}
+
 } // namespace MetNoFimex
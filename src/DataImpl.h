@@ -32,6 +32,8 @@
 #include "fimex/RecursiveSliceCopy.h"
 #include "fimex/Type2String.h"
 
+#include "ScaleKernels.h"
+
 #include <algorithm>
 #include <cmath>
 #include <iterator>
@@ -85,7 +87,7 @@ class DataImpl : public Data
 public:
     /// constructor where the array will be automatically allocated
     explicit DataImpl(long length)
-        : length(length), theData(new C[length]) {}
+        : length(length), theData(make_shared_array<C>(length)) {}
     explicit DataImpl(shared_array<C> array, long length)
         : length(length)
         , theData(array)
@@ -161,7 +163,7 @@ private:
 // (template definitions should be in header files (depending on compiler))
 template<typename C>
 DataImpl<C>::DataImpl(const DataImpl<C>& rhs)
-    : length(rhs.length), theData(new C[rhs.length])
+    : length(rhs.length), theData(make_shared_array<C>(rhs.length))
 {
     std::copy(&rhs.theData[0], &rhs.theData[0] + rhs.length, &theData[0]);
 }
@@ -281,18 +283,39 @@ void DataImpl<C>::setValues(InputIterator begin, InputIterator end, size_t dataS
     std::transform(begin, end, &theData[dataStartPos], data_caster<C, typename InputIterator::value_type>());
 }
 
+/**
+ * Convert length values from inData into outData, as Data::convertDataType().
+ * inData and outData may be the same array if IN and OUT are the same type.
+ */
 template <typename OUT, typename IN>
-shared_array<OUT> convertArrayType(const shared_array<IN>& inData, size_t length, double oldFill, double oldScale, double oldOffset,
-                                   UnitsConverter_p unitsConverter, double newFill, double newScale, double newOffset)
+void convertArrayInto(const IN* inData, size_t length, OUT* outData, double oldFill, double oldScale, double oldOffset, UnitsConverter_p unitsConverter,
+                      double newFill, double newScale, double newOffset)
 {
-    auto outData = make_shared_array<OUT>(length);
+    if (!unitsConverter || unitsConverter->isLinear()) {
+        // fill, scale, offset and units in one vectorized pass
+        double unitScale = 1, unitOffset = 0;
+        if (unitsConverter)
+            unitsConverter->getScaleOffset(unitScale, unitOffset);
+        const double scale = oldScale * unitScale / newScale;
+        const double offset = (unitScale * oldOffset + unitOffset - newOffset) / newScale;
+        if (scaleValues(ScaleKernelType<IN>::type, inData, length, oldFill, scale, offset, ScaleKernelType<OUT>::type, outData, newFill))
+            return;
+    }
     if (!unitsConverter) {
         ScaleValue<IN, OUT> sv(oldFill, oldScale, oldOffset, newFill, newScale, newOffset);
-        std::transform(&inData[0], &inData[length], &outData[0], sv);
+        std::transform(inData, inData + length, outData, sv);
     } else {
         ScaleValueUnits<IN, OUT> sv(oldFill, oldScale, oldOffset, unitsConverter, newFill, newScale, newOffset);
-        std::transform(&inData[0], &inData[length], &outData[0], sv);
+        std::transform(inData, inData + length, outData, sv);
     }
+}
+
+template <typename OUT, typename IN>
+shared_array<OUT> convertArrayType(const shared_array<IN>& inData, size_t length, double oldFill, double oldScale, double oldOffset,
+                                   UnitsConverter_p unitsConverter, double newFill, double newScale, double newOffset)
+{
+    auto outData = make_shared_array<OUT>(length);
+    convertArrayInto(inData.get(), length, outData.get(), oldFill, oldScale, oldOffset, unitsConverter, newFill, newScale, newOffset);
     return outData;
 }
 
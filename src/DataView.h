@@ -0,0 +1,342 @@
+/*
+  Fimex, src/DataView.h
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  Project Info:  https://wiki.met.no/fimex/start
+
+  This library is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+  USA.
+*/
+
+#ifndef FIMEX_DATAVIEW_H
+#define FIMEX_DATAVIEW_H
+
+#include "DataImpl.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+namespace MetNoFimex {
+
+/**
+ * @headerfile "DataView.h"
+ */
+
+/**
+ * This is a private header file, use createDataView() from Data.h.
+ *
+ * Read-only view on the array of another Data, given by an offset and a stride for
+ * each dimension (first dimension fastest moving). Reading values and slicing do not
+ * copy the array. The values are copied into an own DataImpl on the first call to
+ * getDataPtr(), to one of the functions changing values, or when requesting the
+ * array in its own type (e.g. asFloat() for float data), since callers may change
+ * the values through that array like with DataImpl. The viewed array is never modified.
+ *
+ * Like DataImpl, the const functions may be called from several threads at once; the
+ * copy is made only once and is visible to all threads.
+ */
+template <typename C>
+class DataView : public Data
+{
+public:
+    /**
+     * @param base the viewed array
+     * @param dataType the CDMDataType of base
+     * @param offset position of the first value in base
+     * @param dims size of the view in each dimension
+     * @param strides distance in base between neighbouring values in each dimension
+     */
+    DataView(const shared_array<C>& base, CDMDataType dataType, size_t offset, const std::vector<size_t>& dims, const std::vector<size_t>& strides)
+        : base_(base)
+        , dataType_(dataType)
+        , offset_(offset)
+        , dims_(dims)
+        , strides_(strides)
+        , length_(1)
+    {
+        for (size_t d : dims_)
+            length_ *= d;
+    }
+
+    /**
+     * View on a slice of a dense array, parameters as in Data::slice().
+     */
+    static std::shared_ptr<DataView<C>> create(const shared_array<C>& base, CDMDataType dataType, size_t offset, const std::vector<size_t>& orgDimSize,
+                                               const std::vector<size_t>& startDims, const std::vector<size_t>& outputDimSize)
+    {
+        std::vector<size_t> strides(orgDimSize.size());
+        size_t stride = 1;
+        for (size_t i = 0; i < orgDimSize.size(); ++i) {
+            if (orgDimSize[i] < (startDims[i] + outputDimSize[i]))
+                throw CDMException("dimension-size error, start+size > orgSize: " + type2string(startDims[i] + outputDimSize[i]) + ">" +
+                                   type2string(orgDimSize[i]));
+            strides[i] = stride;
+            offset += startDims[i] * stride;
+            stride *= orgDimSize[i];
+        }
+        return std::make_shared<DataView<C>>(base, dataType, offset, outputDimSize, strides);
+    }
+
+    size_t size() const override { return length_; }
+    int bytes_for_one() const override { return sizeof(C); }
+    void* getDataPtr() override { return materialize()->getDataPtr(); }
+    void toStream(std::ostream& os, const std::string& separator = "") const override;
+
+    shared_array<char> asChar() const override { return as<char>(); }
+    shared_array<short> asShort() const override { return as<short>(); }
+    shared_array<int> asInt() const override { return as<int>(); }
+    shared_array<long long> asInt64() const override { return as<long long>(); }
+    shared_array<unsigned char> asUChar() const override { return as<unsigned char>(); }
+    shared_array<unsigned short> asUShort() const override { return as<unsigned short>(); }
+    shared_array<unsigned int> asUInt() const override { return as<unsigned int>(); }
+    shared_array<unsigned long long> asUInt64() const override { return as<unsigned long long>(); }
+    shared_array<std::string> asStrings() const override { return as<std::string>(); }
+    shared_array<float> asFloat() const override { return as<float>(); }
+    shared_array<double> asDouble() const override { return as<double>(); }
+    std::string asString(const std::string& separator = "") const override;
+
+    double getDouble(size_t pos) override
+    {
+        return materialized() ? data_->getDouble(pos) : data_caster<double, C>()(base_[index(pos)]);
+    }
+    long long getLongLong(size_t pos) override
+    {
+        return materialized() ? data_->getLongLong(pos) : data_caster<long long, C>()(base_[index(pos)]);
+    }
+    void setValue(size_t pos, double val) override { materialize()->setValue(pos, val); }
+    void setValues(size_t startPos, const Data& data, size_t first = 0, size_t last = -1) override { materialize()->setValues(startPos, data, first, last); }
+    void setAllValues(double val) override;
+    DataPtr clone() const override;
+    DataPtr slice(const std::vector<size_t>& orgDimSize, const std::vector<size_t>& startDims, const std::vector<size_t>& outputDimSize) override;
+    DataPtr convertDataType(double oldFill, double oldScale, double oldOffset, CDMDataType newType, double newFill, double newScale, double newOffset) override
+    {
+        return convertDataType(oldFill, oldScale, oldOffset, UnitsConverter_p(), newType, newFill, newScale, newOffset);
+    }
+    DataPtr convertDataType(double oldFill, double oldScale, double oldOffset, UnitsConverter_p unitConverter, CDMDataType newType, double newFill,
+                            double newScale, double newOffset) override;
+    CDMDataType getDataType() const override { return dataType_; }
+
+    /// @brief true if the values of this view are stored without gaps in the viewed array
+    bool isContiguous() const;
+
+private:
+    template <typename T>
+    shared_array<T> as() const;
+
+    size_t index(size_t pos) const;
+
+    /// copy the values of the view into a new array
+    shared_array<C> copy() const;
+
+    /// the values as DataImpl, must not be modified
+    std::shared_ptr<DataImpl<C>> values() const;
+
+    /// true once data_ has been set, data_ must not be read before
+    bool materialized() const { return materialized_.load(std::memory_order_acquire); }
+
+    /// copy the values into data_, if not done yet
+    std::shared_ptr<DataImpl<C>> materialize() const;
+
+    /// the viewed array, kept after materializing as other threads may still read it
+    shared_array<C> base_;
+    CDMDataType dataType_;
+    size_t offset_;
+    std::vector<size_t> dims_;
+    std::vector<size_t> strides_;
+    size_t length_;
+    mutable std::shared_ptr<DataImpl<C>> data_;
+    mutable std::once_flag materializeOnce_;
+    mutable std::atomic<bool> materialized_{false};
+};
+
+template <typename C>
+bool DataView<C>::isContiguous() const
+{
+    size_t stride = 1;
+    for (size_t i = 0; i < dims_.size(); ++i) {
+        if (dims_[i] > 1 && strides_[i] != stride)
+            return false;
+        stride *= dims_[i];
+    }
+    return true;
+}
+
+template <typename C>
+size_t DataView<C>::index(size_t pos) const
+{
+    size_t idx = offset_;
+    for (size_t i = 0; i < dims_.size(); ++i) {
+        idx += (pos % dims_[i]) * strides_[i];
+        pos /= dims_[i];
+    }
+    return idx;
+}
+
+template <typename C>
+shared_array<C> DataView<C>::copy() const
+{
+    shared_array<C> out = make_shared_array<C>(length_);
+    if (length_ == 0)
+        return out;
+    const C* in = base_.get();
+    if (isContiguous()) {
+        std::copy(in + offset_, in + offset_ + length_, out.get());
+        return out;
+    }
+    // odometer over all but the first (fastest) dimension
+    const size_t nDims = dims_.size();
+    std::vector<size_t> pos(nDims, 0);
+    size_t start = offset_;
+    C* o = out.get();
+    while (true) {
+        if (strides_[0] == 1) {
+            o = std::copy(in + start, in + start + dims_[0], o);
+        } else {
+            for (size_t i = 0; i < dims_[0]; ++i)
+                *o++ = in[start + i * strides_[0]];
+        }
+        size_t d = 1;
+        for (; d < nDims; ++d) {
+            start += strides_[d];
+            if (++pos[d] < dims_[d])
+                break;
+            start -= pos[d] * strides_[d];
+            pos[d] = 0;
+        }
+        if (d >= nDims)
+            break;
+    }
+    return out;
+}
+
+template <typename C>
+std::shared_ptr<DataImpl<C>> DataView<C>::values() const
+{
+    if (materialized())
+        return data_;
+    if (isContiguous()) {
+        // aliasing the viewed array, no copy
+        return std::make_shared<DataImpl<C>>(shared_array<C>(base_, base_.get() + offset_), length_);
+    }
+    return std::make_shared<DataImpl<C>>(copy(), length_);
+}
+
+template <typename C>
+std::shared_ptr<DataImpl<C>> DataView<C>::materialize() const
+{
+    std::call_once(materializeOnce_, [this] {
+        data_ = std::make_shared<DataImpl<C>>(copy(), length_);
+        materialized_.store(true, std::memory_order_release);
+    });
+    return data_;
+}
+
+template <typename C>
+template <typename T>
+shared_array<T> DataView<C>::as() const
+{
+    if (materialized() || std::is_same<T, C>::value)
+        return materialize()->template as<T>();
+    if (!isContiguous())
+        return ArrayTypeConverter<T, C>(copy(), length_)();
+    // the converter creates a new array, the viewed array is not modified
+    return ArrayTypeConverter<T, C>(shared_array<C>(base_, base_.get() + offset_), length_)();
+}
+
+template <typename C>
+void DataView<C>::toStream(std::ostream& os, const std::string& separator) const
+{
+    values()->toStream(os, separator);
+}
+
+template <typename C>
+std::string DataView<C>::asString(const std::string& separator) const
+{
+    std::ostringstream o;
+    toStream(o, separator);
+    return o.str();
+}
+
+template <typename C>
+void DataView<C>::setAllValues(double val)
+{
+    std::call_once(materializeOnce_, [this] {
+        data_ = std::make_shared<DataImpl<C>>(length_);
+        materialized_.store(true, std::memory_order_release);
+    });
+    data_->setAllValues(val);
+}
+
+template <typename C>
+DataPtr DataView<C>::clone() const
+{
+    if (materialized())
+        return data_->clone();
+    return std::make_shared<DataImpl<C>>(copy(), length_);
+}
+
+template <typename C>
+DataPtr DataView<C>::slice(const std::vector<size_t>& orgDimSize, const std::vector<size_t>& startDims, const std::vector<size_t>& outputDimSize)
+{
+    if (materialized() || orgDimSize.size() == 0)
+        return values()->slice(orgDimSize, startDims, outputDimSize);
+
+    size_t orgSize = 1;
+    for (size_t d : orgDimSize)
+        orgSize *= d;
+    if (orgSize != size())
+        throw CDMException("dimension-mismatch: " + type2string(size()) + "!=" + type2string(orgSize));
+
+    if (orgDimSize == dims_) {
+        size_t offset = offset_;
+        for (size_t i = 0; i < dims_.size(); ++i) {
+            if (orgDimSize[i] < (startDims[i] + outputDimSize[i]))
+                throw CDMException("dimension-size error, start+size > orgSize: " + type2string(startDims[i] + outputDimSize[i]) + ">" +
+                                   type2string(orgDimSize[i]));
+            offset += startDims[i] * strides_[i];
+        }
+        return std::make_shared<DataView<C>>(base_, dataType_, offset, outputDimSize, strides_);
+    } else if (isContiguous()) {
+        return create(base_, dataType_, offset_, orgDimSize, startDims, outputDimSize);
+    } else {
+        return values()->slice(orgDimSize, startDims, outputDimSize);
+    }
+}
+
+template <typename C>
+DataPtr DataView<C>::convertDataType(double oldFill, double oldScale, double oldOffset, UnitsConverter_p unitConverter, CDMDataType newType,
+                                     double newFill, double newScale, double newOffset)
+{
+    if (newType == dataType_ && oldFill == newFill && oldScale == newScale && oldOffset == newOffset && !unitConverter)
+        return clone();
+    // the conversion creates a new array, the values are not modified
+    return values()->convertDataType(oldFill, oldScale, oldOffset, unitConverter, newType, newFill, newScale, newOffset);
+}
+
+} // namespace MetNoFimex
+
+#endif // FIMEX_DATAVIEW_H
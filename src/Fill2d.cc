@@ -0,0 +1,332 @@
+/*
+ * Fimex, Fill2d.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "Fill2d.h"
+
+#include "fimex/WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace MetNoFimex {
+
+namespace {
+
+// points per task in the relaxation and creep sweeps, at least
+const size_t SWEEP_GRAIN = 16384;
+
+// rows of the creepfill tiles, fixed to keep the results independent of the number of threads
+const size_t CREEP_TILE_ROWS = 32;
+
+// grids smaller than this in x or y are not coarsened further by the multigrid fill
+const size_t MULTIGRID_MIN_SIZE = 16;
+
+size_t rowGrain(size_t nx)
+{
+    return std::max<size_t>(1, SWEEP_GRAIN / std::max<size_t>(1, nx));
+}
+
+/** @return the number of undefined values, and the mean of the defined values in average */
+size_t countUndefined(const float* field, size_t size, double& average)
+{
+    size_t nChanged = 0;
+    double sum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (std::isnan(field[i]))
+            nChanged++;
+        else
+            sum += field[i];
+    }
+    average = (nChanged < size) ? sum / (size - nChanged) : 0;
+    return nChanged;
+}
+
+/**
+ * Set the relaxation weights and the first guess as mifi_fill2d_f: 0 for defined points,
+ * 1 for undefined border points and corrEff for undefined inner points.
+ *
+ * @param guess first guess of the undefined values, average if null
+ * @return the mean absolute deviation of the defined values from average
+ */
+double initRelaxation(size_t nx, size_t ny, float* field, float* weights, double average, float corrEff, const float* guess)
+{
+    double stddev = 0;
+    size_t nUnchanged = 0;
+    for (size_t y = 0; y < ny; ++y) {
+        const bool innerRow = (y > 0 && y + 1 < ny);
+        for (size_t x = 0; x < nx; ++x) {
+            const size_t i = y * nx + x;
+            if (std::isnan(field[i])) {
+                field[i] = guess ? guess[i] : average;
+                weights[i] = (innerRow && x > 0 && x + 1 < nx) ? corrEff : 1.;
+            } else {
+                stddev += std::fabs(field[i] - average);
+                nUnchanged++;
+                weights[i] = 0.;
+            }
+        }
+    }
+    return stddev / nUnchanged;
+}
+
+/**
+ * The iteration of mifi_fill2d_f, with the inner points updated in a red and a
+ * black half-sweep, each parallel over rows.
+ */
+void relaxRedBlack(size_t nx, size_t ny, float* field, const float* weights, double crit, float corrEff, size_t maxLoop)
+{
+    if (nx < 2 || ny < 2)
+        return;
+    const size_t nxm1 = nx - 1;
+    const size_t nym1 = ny - 1;
+    const float crtest = crit * corrEff;
+    const size_t grain = rowGrain(nx);
+    std::vector<char> rowBad(ny, 0);
+
+    for (size_t n = 0; n < maxLoop; n++) {
+        const bool testConvergence = (n + 5 < maxLoop) && (n % 10 == 0);
+        for (size_t colour = 0; colour < 2; ++colour) {
+            // points with (x + y) % 2 == colour only have neighbours of the other colour
+            WorkerPool::shared().parallelFor(1, nym1, [&](size_t y) {
+                float* f = &field[y * nx];
+                const float* w = &weights[y * nx];
+                bool bad = false;
+                for (size_t x = 1 + (y + colour + 1) % 2; x < nxm1; x += 2) {
+                    const float e = (f[x + 1] + f[x - 1] + f[x + nx] + f[x - nx]) * 0.25 - f[x];
+                    f[x] += e * w[x];
+                    bad |= (std::fabs(e * w[x]) > crtest);
+                }
+                rowBad[y] = (colour == 0) ? bad : (rowBad[y] || bad);
+            }, grain);
+        }
+
+        // Test convergence now and then
+        if (testConvergence && std::find(rowBad.begin(), rowBad.end(), 1) == rowBad.end())
+            return;
+
+        // some work on the borders
+        for (size_t y = 1; y < nym1; y++) {
+            field[y * nx + 0] += (field[y * nx + 1] - field[y * nx + 0]) * weights[y * nx + 0];
+            field[y * nx + (nx - 1)] += (field[y * nx + (nx - 2)] - field[y * nx + (nx - 1)]) * weights[y * nx + (nx - 1)];
+        }
+        for (size_t x = 0; x < nx; x++) {
+            field[0 * nx + x] += (field[1 * nx + x] - field[0 * nx + x]) * weights[0 * nx + x];
+            field[nym1 * nx + x] += (field[(nym1 - 1) * nx + x] - field[nym1 * nx + x]) * weights[nym1 * nx + x];
+        }
+    }
+}
+
+/** mean of the defined values of 2x2 blocks, undefined for blocks without defined values */
+std::vector<float> coarsen(size_t nx, size_t ny, const float* field, size_t cnx, size_t cny)
+{
+    std::vector<float> coarse(cnx * cny);
+    WorkerPool::shared().parallelFor(0, cny, [&](size_t cy) {
+        for (size_t cx = 0; cx < cnx; ++cx) {
+            double sum = 0;
+            size_t count = 0;
+            for (size_t y = 2 * cy; y < std::min(ny, 2 * cy + 2); ++y) {
+                for (size_t x = 2 * cx; x < std::min(nx, 2 * cx + 2); ++x) {
+                    const float v = field[y * nx + x];
+                    if (!std::isnan(v)) {
+                        sum += v;
+                        count++;
+                    }
+                }
+            }
+            coarse[cy * cnx + cx] = count ? static_cast<float>(sum / count) : NAN;
+        }
+    }, rowGrain(cnx));
+    return coarse;
+}
+
+/** bilinear interpolation of the block centres of coarse to all points of the fine grid */
+std::vector<float> refine(const std::vector<float>& coarse, size_t cnx, size_t cny, size_t nx, size_t ny)
+{
+    std::vector<float> fine(nx * ny);
+    WorkerPool::shared().parallelFor(0, ny, [&](size_t y) {
+        const double cy = std::min(std::max((y - 0.5) * 0.5, 0.), double(cny - 1));
+        const size_t y0 = static_cast<size_t>(cy), y1 = std::min(y0 + 1, cny - 1);
+        const double ty = cy - y0;
+        for (size_t x = 0; x < nx; ++x) {
+            const double cx = std::min(std::max((x - 0.5) * 0.5, 0.), double(cnx - 1));
+            const size_t x0 = static_cast<size_t>(cx), x1 = std::min(x0 + 1, cnx - 1);
+            const double tx = cx - x0;
+            const double v0 = coarse[y0 * cnx + x0] * (1 - tx) + coarse[y0 * cnx + x1] * tx;
+            const double v1 = coarse[y1 * cnx + x0] * (1 - tx) + coarse[y1 * cnx + x1] * tx;
+            fine[y * nx + x] = v0 * (1 - ty) + v1 * ty;
+        }
+    }, rowGrain(nx));
+    return fine;
+}
+
+} // namespace
+
+size_t fill2dRedBlack(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop)
+{
+    const size_t totalSize = nx * ny;
+    double average;
+    const size_t nChanged = countUndefined(field, totalSize, average);
+    if (nChanged == 0 || nChanged == totalSize)
+        return nChanged; // nothing to do
+
+    std::vector<float> weights(totalSize);
+    const double stddev = initRelaxation(nx, ny, field, &weights[0], average, corrEff, nullptr);
+    relaxRedBlack(nx, ny, field, &weights[0], relaxCrit * stddev, corrEff, maxLoop);
+    return nChanged;
+}
+
+size_t fill2dMultigrid(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop)
+{
+    const size_t totalSize = nx * ny;
+    double average;
+    const size_t nChanged = countUndefined(field, totalSize, average);
+    if (nChanged == 0 || nChanged == totalSize)
+        return nChanged; // nothing to do
+
+    std::vector<float> guess;
+    if (nx >= 2 * MULTIGRID_MIN_SIZE && ny >= 2 * MULTIGRID_MIN_SIZE) {
+        // the smooth part of the solution converges slowly on the fine grid, solve it on a coarse grid
+        const size_t cnx = (nx + 1) / 2, cny = (ny + 1) / 2;
+        std::vector<float> coarse = coarsen(nx, ny, field, cnx, cny);
+        fill2dMultigrid(cnx, cny, &coarse[0], relaxCrit, corrEff, maxLoop);
+        guess = refine(coarse, cnx, cny, nx, ny);
+    }
+
+    std::vector<float> weights(totalSize);
+    const double stddev = initRelaxation(nx, ny, field, &weights[0], average, corrEff, guess.empty() ? nullptr : &guess[0]);
+    relaxRedBlack(nx, ny, field, &weights[0], relaxCrit * stddev, corrEff, maxLoop);
+    return nChanged;
+}
+
+size_t creepfillval2dTiled(size_t nx, size_t ny, float* field, float defaultVal, unsigned short repeat, char setWeight)
+{
+    const size_t totalSize = nx * ny;
+    double average;
+    const size_t nChanged = countUndefined(field, totalSize, average);
+    const size_t nUnchanged = totalSize - nChanged;
+    if (nUnchanged == 0 || nChanged == 0)
+        return nChanged; // nothing to do
+
+    // working fields as in mifi_creepfillval2d_f: weights of the values, and number of changes
+    std::vector<char> wField(totalSize);
+    std::vector<unsigned short> rField(totalSize);
+    for (size_t i = 0; i < totalSize; ++i) {
+        if (std::isnan(field[i])) {
+            wField[i] = 0;
+            rField[i] = 0;
+            field[i] = defaultVal;
+        } else {
+            wField[i] = setWeight;
+            rField[i] = repeat;
+        }
+    }
+    if (ny < 2)
+        return nChanged;
+
+    const size_t nxm1 = nx - 1;
+    const size_t nym1 = ny - 1;
+    const size_t nTiles = (nx < 3) ? 0 : (nym1 - 1 + CREEP_TILE_ROWS - 1) / CREEP_TILE_ROWS;
+    std::vector<size_t> changedInTile(nTiles);
+    const size_t tileGrain = std::max<size_t>(1, SWEEP_GRAIN / (nx * CREEP_TILE_ROWS));
+
+    // scan of the inner rows of a tile, as the scan of all inner rows in mifi_creepfillval2d_f
+    auto scanTile = [&](size_t tile) {
+        size_t changed = 0;
+        const size_t yEnd = std::min(nym1, 1 + (tile + 1) * CREEP_TILE_ROWS);
+        for (size_t y = 1 + tile * CREEP_TILE_ROWS; y < yEnd; y++) {
+            float* f = &field[y * nx];
+            unsigned short* r = &rField[y * nx];
+            char* w = &wField[y * nx];
+            for (size_t x = 1; x < nxm1; x++) {
+                if (r[x] < repeat) {
+                    // undefined value or changed enough
+                    const size_t wFieldSum = w[x + 1] + w[x - 1] + w[x + nx] + w[x - nx];
+                    if (wFieldSum != 0) {
+                        // weight defaultVal of neigbouring cells, with double weight on original values
+                        f[x] += w[x + 1] * f[x + 1] + w[x - 1] * f[x - 1] + w[x + nx] * f[x + nx] + w[x - nx] * f[x - nx];
+                        f[x] /= (1 + wFieldSum);
+                        w[x] = 1; // this is a implicit defined field
+                        r[x]++;   // it has been changed
+                        changed++;
+                    }
+                }
+            }
+        }
+        changedInTile[tile] = changed;
+    };
+
+    // and the loop, with a maximum of nUnchanged rounds
+    size_t l = 0;
+    size_t changedInLoop = nTiles;
+    while ((changedInLoop > 0) && (l < nUnchanged)) {
+        l++;
+        // even tiles, then odd tiles; tiles of one group do not touch each other
+        for (size_t group = 0; group < 2; ++group) {
+            WorkerPool::shared().parallelFor(0, (nTiles + 1 - group) / 2, [&](size_t i) { scanTile(2 * i + group); }, tileGrain);
+        }
+        changedInLoop = 0;
+        for (size_t changed : changedInTile)
+            changedInLoop += changed;
+    }
+
+    // simple calculations at the borders
+    for (size_t l = 0; l < repeat; l++) {
+        for (size_t y = 1; y < nym1; y++) {
+            if (rField[y * nx + 0] < repeat) { // unset
+                field[y * nx + 0] += field[y * nx + 1] * wField[y * nx + 1];
+                field[y * nx + 0] /= (1 + wField[y * nx + 1]);
+                wField[y * nx + 0] = 1;
+            }
+            if (rField[y * nx + (nx - 1)] < repeat) { // unset
+                field[y * nx + (nx - 1)] += field[y * nx + (nx - 2)] * wField[y * nx + (nx - 2)];
+                field[y * nx + (nx - 1)] /= (1 + wField[y * nx + (nx - 2)]);
+                wField[y * nx + (nx - 1)] = 1;
+            }
+        }
+        for (size_t x = 0; x < nx; x++) {
+            if (rField[0 * nx + x] < repeat) { // unset
+                field[0 * nx + x] += field[1 * nx + x] * wField[1 * nx + x];
+                field[0 * nx + x] /= (1 + wField[1 * nx + x]);
+                wField[0 * nx + x] = 1;
+            }
+            if (rField[nym1 * nx + x] < repeat) { // unset
+                field[nym1 * nx + x] += field[(nym1 - 1) * nx + x] * wField[(nym1 - 1) * nx + x];
+                field[nym1 * nx + x] /= (1 + wField[(nym1 - 1) * nx + x]);
+                wField[nym1 * nx + x] = 1;
+            }
+        }
+    }
+    return nChanged;
+}
+
+size_t creepfill2dTiled(size_t nx, size_t ny, float* field, unsigned short repeat, char setWeight)
+{
+    double average;
+    const size_t nChanged = countUndefined(field, nx * ny, average);
+    if (nChanged == nx * ny)
+        return nChanged;
+    return creepfillval2dTiled(nx, ny, field, static_cast<float>(average), repeat, setWeight);
+}
+
+} // namespace MetNoFimex
@@ -0,0 +1,78 @@
+/*
+ * Fimex, Fill2d.h
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef FIMEX_FILL2D_H_
+#define FIMEX_FILL2D_H_
+
+#include <cstddef>
+
+namespace MetNoFimex {
+
+/*
+ * This is a private header file, used by CDMInterpolator.
+ *
+ * Parallel variants of mifi_fill2d_f and mifi_creepfill2d_f, running on the
+ * shared WorkerPool. The results do not depend on the number of threads, but
+ * differ slightly from the serial functions as the points are updated in
+ * another order.
+ */
+
+/**
+ * Fill undefined values like mifi_fill2d_f, with the same first guess,
+ * weights and convergence test, but relaxing the points of a checkerboard
+ * in two parallel half-sweeps.
+ *
+ * @return the number of changed values
+ */
+size_t fill2dRedBlack(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop);
+
+/**
+ * Fill undefined values like fill2dRedBlack, starting from a first guess
+ * interpolated from the same problem filled on a grid of half the resolution,
+ * recursively. Only a few sweeps are needed on each grid, even for large
+ * undefined areas.
+ *
+ * @return the number of changed values
+ */
+size_t fill2dMultigrid(size_t nx, size_t ny, float* field, float relaxCrit, float corrEff, size_t maxLoop);
+
+/**
+ * Fill undefined values like mifi_creepfillval2d_f, scanning tiles of rows
+ * in parallel. Tiles alternate between two groups, the tiles of one group
+ * are scanned in parallel as they share no neighbours.
+ *
+ * @return the number of changed values
+ */
+size_t creepfillval2dTiled(size_t nx, size_t ny, float* field, float defaultVal, unsigned short repeat, char setWeight);
+
+/**
+ * Fill undefined values like mifi_creepfill2d_f, i.e. creepfillval2dTiled
+ * with the mean of the defined values.
+ *
+ * @return the number of changed values
+ */
+size_t creepfill2dTiled(size_t nx, size_t ny, float* field, unsigned short repeat, char setWeight);
+
+} // namespace MetNoFimex
+
+#endif /* FIMEX_FILL2D_H_ */
@@ -32,6 +32,7 @@
 #include "fimex/Logger.h"
 #include "fimex/SliceBuilder.h"
 #include "fimex/TokenizeDotted.h"
+#include "fimex/WorkerPool.h"
 #include "fimex/XMLDoc.h"
 
 #include <algorithm>
@@ -192,24 +193,21 @@ FillWriter::FillWriter(CDMReader_p in, CDMReaderWriter_p io, std::string configF
         }
     }
 
-    // process variables
+    // process variables, readers not supporting concurrent reading are read by this thread only
     const auto iVars = iCdm.getVariables();
-    const int varVecSize = iVars.size();
-#ifdef _OPENMP
-#pragma omp parallel for default(shared)
-#endif
-    for (int iVar = 0; iVar < varVecSize; iVar++) {
+    const size_t grain = in->supportsConcurrentReading() ? 1 : iVars.size();
+    WorkerPool::shared().parallelFor(0, iVars.size(), [&](size_t iVar) {
         const auto& iv = iVars.at(iVar);
         LOG4FIMEX(logger, Logger::DEBUG, "processing variable  '" << iv.getName() << "'");
         if (!oCdm.hasVariable(iv.getName())) {
             LOG4FIMEX(logger, Logger::WARN, "new variable '" << iv.getName() << "': omitting");
-            continue;
+            return;
         }
         const auto& iShape = iv.getShape();
         const auto badDim = findFirstUnusableDimension(unusableIDims, iShape);
         if (!badDim.empty()) {
             LOG4FIMEX(logger, Logger::ERROR, "Cannot fill-write '" << iv.getName() << "' due to bad dimension: '" << badDim << "'");
-            continue;
+            return;
         }
         const auto& oVar = oCdm.getVariable(iv.getName());
         const auto& oShape = oVar.getShape();
@@ -224,7 +222,7 @@ FillWriter::FillWriter(CDMReader_p in, CDMReaderWriter_p io, std::string configF
         // simple test of equal shapes (omitting translated dims)
         if (!equal(iTestShape.begin(), iTestShape.end(), oTestShape.begin())) {
             LOG4FIMEX(logger, Logger::WARN, "variable '" << iv.getName() << "' has different shape: omitting");
-            continue;
+            return;
         }
 
         typedef vector<pair<SliceBuilder, SliceBuilder> > SlicePairs;
@@ -280,7 +278,7 @@ FillWriter::FillWriter(CDMReader_p in, CDMReaderWriter_p io, std::string configF
             DataPtr inData = in->getDataSlice(iv.getName(), slice.first);
             io->putDataSlice(iv.getName(), slice.second, inData);
         }
-    }
+    }, grain);
     if (!unusableIDims.empty())
         throw CDMException("FillWriter finished with errors in dimension-mapping");
 }
@@ -0,0 +1,270 @@
+/*
+ * Fimex, InterpolationCache.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "InterpolationCache.h"
+
+#include "fimex/CDMconstants.h"
+#include "fimex/Logger.h"
+#include "fimex/reproject.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+namespace MetNoFimex {
+
+static Logger_p logger = getLogger("fimex.InterpolationCache");
+
+namespace {
+
+const char FILE_MAGIC[8] = {'F', 'I', 'M', 'E', 'X', 'I', 'C', '2'};
+const char FILE_SUFFIX[] = ".fimexcache";
+
+inline std::uint64_t rotl(std::uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+} // namespace
+
+InterpolationCacheKey::InterpolationCacheKey()
+    : h1_(14695981039346656037ull)
+    , h2_(0x9e3779b97f4a7c15ull)
+{
+    add(fimexVersion()).add(reproject::proj_version()).add(INTERPOLATION_CACHE_REVISION);
+}
+
+void InterpolationCacheKey::addWord(std::uint64_t word)
+{
+    // fnv-1a on words, and a multiply-rotate hash with other constants
+    h1_ = (h1_ ^ word) * 1099511628211ull;
+    h2_ = rotl(h2_ + word * 0x9e3779b97f4a7c15ull, 31) * 0xc2b2ae3d27d4eb4full;
+}
+
+InterpolationCacheKey& InterpolationCacheKey::add(const std::string& text)
+{
+    addWord(text.size());
+    for (size_t i = 0; i < text.size(); i += sizeof(std::uint64_t)) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, text.data() + i, std::min(sizeof(word), text.size() - i));
+        addWord(word);
+    }
+    return *this;
+}
+
+InterpolationCacheKey& InterpolationCacheKey::add(long long value)
+{
+    addWord(static_cast<std::uint64_t>(value));
+    return *this;
+}
+
+InterpolationCacheKey& InterpolationCacheKey::add(double value)
+{
+    return add(&value, 1);
+}
+
+InterpolationCacheKey& InterpolationCacheKey::add(const double* values, size_t size)
+{
+    addWord(size);
+    for (size_t i = 0; i < size; ++i) {
+        std::uint64_t word;
+        std::memcpy(&word, &values[i], sizeof(word));
+        addWord(word);
+    }
+    return *this;
+}
+
+std::string InterpolationCacheKey::str() const
+{
+    std::ostringstream out;
+    out << std::hex << std::setfill('0') << std::setw(16) << h1_ << std::setw(16) << h2_;
+    return out.str();
+}
+
+InterpolationCache& InterpolationCache::shared()
+{
+    static InterpolationCache cache;
+    return cache;
+}
+
+InterpolationCache::InterpolationCache()
+    : memoryLimit_(DEFAULT_MEMORY_LIMIT)
+    , memoryUsed_(0)
+{
+}
+
+void InterpolationCache::setDirectory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+}
+
+std::string InterpolationCache::getDirectory() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return directory_;
+}
+
+void InterpolationCache::setMemoryLimit(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    memoryLimit_ = bytes;
+    while (memoryUsed_ > memoryLimit_)
+        evict();
+}
+
+void InterpolationCache::evict()
+{
+    memoryUsed_ -= entries_.back().bytes();
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+}
+
+void InterpolationCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    memoryUsed_ = 0;
+}
+
+std::string InterpolationCache::fileName(const std::string& key) const
+{
+    return directory_ + "/" + key + FILE_SUFFIX;
+}
+
+bool InterpolationCache::find(const std::string& key, std::vector<shared_array<double>>& arrays, size_t nArrays, size_t size)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto it = index_.find(key);
+    if (it != index_.end() && it->second->arrays.size() == nArrays && it->second->size == size) {
+        // move to front
+        entries_.splice(entries_.begin(), entries_, it->second);
+        arrays = it->second->arrays;
+        LOG4FIMEX(logger, Logger::DEBUG, "found " << key << " in memory");
+        return true;
+    }
+    if (directory_.empty())
+        return false;
+    const std::string file = fileName(key);
+    lock.unlock();
+
+    std::ifstream in(file.c_str(), std::ios::binary);
+    if (!in)
+        return false;
+    char magic[sizeof(FILE_MAGIC)];
+    std::uint64_t fileArrays = 0, arraySize = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&fileArrays), sizeof(fileArrays));
+    in.read(reinterpret_cast<char*>(&arraySize), sizeof(arraySize));
+    if (!in || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 || fileArrays != nArrays || arraySize != size) {
+        LOG4FIMEX(logger, Logger::WARN, "ignoring unexpected cache file '" << file << "'");
+        return false;
+    }
+    Entry entry;
+    entry.key = key;
+    entry.size = size;
+    for (size_t a = 0; a < nArrays; ++a) {
+        entry.arrays.push_back(make_shared_array<double>(size));
+        in.read(reinterpret_cast<char*>(entry.arrays.back().get()), size * sizeof(double));
+    }
+    if (!in) {
+        LOG4FIMEX(logger, Logger::WARN, "ignoring truncated cache file '" << file << "'");
+        return false;
+    }
+    arrays = entry.arrays;
+    LOG4FIMEX(logger, Logger::DEBUG, "read " << key << " from '" << file << "'");
+
+    lock.lock();
+    insertInMemory(std::move(entry));
+    return true;
+}
+
+void InterpolationCache::insert(const std::string& key, const std::vector<shared_array<double>>& arrays, size_t size)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::string directory = directory_;
+    const std::string file = fileName(key);
+    lock.unlock();
+
+    if (!directory.empty()) {
+        // write to a temporary file first, such that other processes never see a partial file
+        std::ostringstream tmp;
+        tmp << file << ".tmp" << ::getpid() << "_" << std::hash<std::thread::id>()(std::this_thread::get_id());
+        const std::string tmpFile = tmp.str();
+        {
+            std::ofstream out(tmpFile.c_str(), std::ios::binary | std::ios::trunc);
+            const std::uint64_t nArrays = arrays.size(), arraySize = size;
+            out.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+            out.write(reinterpret_cast<const char*>(&nArrays), sizeof(nArrays));
+            out.write(reinterpret_cast<const char*>(&arraySize), sizeof(arraySize));
+            for (const shared_array<double>& a : arrays)
+                out.write(reinterpret_cast<const char*>(a.get()), size * sizeof(double));
+            out.close();
+            if (!out) {
+                LOG4FIMEX(logger, Logger::WARN, "cannot write cache file '" << tmpFile << "'");
+                std::remove(tmpFile.c_str());
+            } else if (std::rename(tmpFile.c_str(), file.c_str()) != 0) {
+                LOG4FIMEX(logger, Logger::WARN, "cannot rename cache file '" << tmpFile << "' to '" << file << "'");
+                std::remove(tmpFile.c_str());
+            } else {
+                LOG4FIMEX(logger, Logger::DEBUG, "wrote " << key << " to '" << file << "'");
+            }
+        }
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.arrays = arrays;
+    entry.size = size;
+    lock.lock();
+    insertInMemory(std::move(entry));
+}
+
+void InterpolationCache::insertInMemory(Entry&& entry)
+{
+    const size_t bytes = entry.bytes();
+    if (bytes > memoryLimit_)
+        return;
+
+    const auto it = index_.find(entry.key);
+    if (it != index_.end()) {
+        memoryUsed_ -= it->second->bytes();
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+    while (!entries_.empty() && memoryUsed_ + bytes > memoryLimit_)
+        evict();
+    const std::string key = entry.key;
+    entries_.push_front(std::move(entry));
+    index_[key] = entries_.begin();
+    memoryUsed_ += bytes;
+}
+
+} // namespace MetNoFimex
@@ -0,0 +1,142 @@
+/*
+ * Fimex, InterpolationCache.h
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef FIMEX_INTERPOLATIONCACHE_H_
+#define FIMEX_INTERPOLATIONCACHE_H_
+
+#include "fimex/SharedArray.h"
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MetNoFimex {
+
+/**
+ * Hash of everything the result of an interpolation setup depends on, e.g.
+ * projections, axes and method. Two independent 64 bit hashes are combined
+ * to make collisions unlikely also for the files in a cache directory.
+ *
+ * Each key starts with the fimex and PROJ versions and INTERPOLATION_CACHE_REVISION,
+ * so results of other releases are never reused.
+ */
+class InterpolationCacheKey
+{
+public:
+    /** the revision of the algorithms computing cached results, to be increased when they change */
+    static const long long INTERPOLATION_CACHE_REVISION = 1;
+
+    InterpolationCacheKey();
+
+    InterpolationCacheKey& add(const std::string& text);
+    InterpolationCacheKey& add(long long value);
+    InterpolationCacheKey& add(double value);
+    InterpolationCacheKey& add(const double* values, size_t size);
+    InterpolationCacheKey& add(const std::vector<double>& values) { return add(values.data(), values.size()); }
+
+    /** @return the key as 32 hex digits, usable as file name */
+    std::string str() const;
+
+private:
+    void addWord(std::uint64_t word);
+
+    std::uint64_t h1_, h2_;
+};
+
+/**
+ * Process-wide cache of the arrays computed when setting up an interpolation,
+ * e.g. the positions of the output points in the input grid, which are expensive
+ * to compute (PROJ, axis search, kd-tree) but the same for all CDMInterpolator
+ * instances and fimex runs on the same grids.
+ *
+ * Arrays are optionally kept in memory up to a limit, least recently used first
+ * out, and optionally stored in a directory to be reused by later processes. The
+ * arrays are shared with the users of the cache, which must not modify them.
+ */
+class InterpolationCache
+{
+public:
+    /** default of setMemoryLimit(), the positions of several large grids */
+    static const size_t DEFAULT_MEMORY_LIMIT = size_t(256) * 1024 * 1024;
+
+    static InterpolationCache& shared();
+
+    /**
+     * Directory for storing arrays between processes, empty (the default) disables it.
+     * The directory must exist.
+     */
+    void setDirectory(const std::string& directory);
+    std::string getDirectory() const;
+
+    /**
+     * Maximum bytes kept in memory, DEFAULT_MEMORY_LIMIT by default, 0 disables the memory cache.
+     */
+    void setMemoryLimit(size_t bytes);
+
+    /**
+     * Get the cached arrays.
+     *
+     * @param key the key of the values
+     * @param arrays set to nArrays arrays of size values each, which must not be modified
+     * @return false if no values with this key and sizes are cached, arrays are unchanged
+     */
+    bool find(const std::string& key, std::vector<shared_array<double>>& arrays, size_t nArrays, size_t size);
+
+    /**
+     * Keep the arrays, all of size values, which must not be modified afterwards.
+     */
+    void insert(const std::string& key, const std::vector<shared_array<double>>& arrays, size_t size);
+
+    /** remove all values from memory, not from the directory */
+    void clear();
+
+private:
+    InterpolationCache();
+
+    struct Entry
+    {
+        std::string key;
+        std::vector<shared_array<double>> arrays;
+        size_t size;
+        size_t bytes() const { return arrays.size() * size * sizeof(double); }
+    };
+    typedef std::list<Entry> entries_t;
+
+    void insertInMemory(Entry&& entry);
+    void evict();
+    std::string fileName(const std::string& key) const;
+
+    mutable std::mutex mutex_;
+    std::string directory_;
+    size_t memoryLimit_;
+    size_t memoryUsed_;
+    entries_t entries_; // most recently used first
+    std::map<std::string, entries_t::iterator> index_;
+};
+
+} // namespace MetNoFimex
+
+#endif /* FIMEX_INTERPOLATIONCACHE_H_ */
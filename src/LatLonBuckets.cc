@@ -0,0 +1,174 @@
+/*
+ * Fimex, LatLonBuckets.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "LatLonBuckets.h"
+
+#include "fimex/MathUtils.h"
+#include "fimex/WorkerPool.h"
+#include "fimex/mifi_constants.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace MetNoFimex {
+
+namespace {
+
+// smallest bucket size in radians (about 6m), keeps the number of buckets in uint64
+const double MIN_BUCKET_SIZE = 1e-6;
+
+// added to the search distance when selecting buckets, for rounding errors
+const double BUCKET_MARGIN = 1e-9;
+
+// points per task when sorting points into buckets
+const size_t BUCKET_GRAIN = 16384;
+
+const std::uint64_t UNDEFINED_BUCKET = std::numeric_limits<std::uint64_t>::max();
+
+inline void unitVector(double lonRad, double latRad, double* xyz)
+{
+    const double cosLat = std::cos(latRad);
+    xyz[0] = cosLat * std::cos(lonRad);
+    xyz[1] = cosLat * std::sin(lonRad);
+    xyz[2] = std::sin(latRad);
+}
+
+} // namespace
+
+const size_t LatLonBuckets::NOT_FOUND;
+
+LatLonBuckets::LatLonBuckets(const double* lonVals, const double* latVals, size_t size, double bucketSize)
+{
+    if (!(bucketSize > MIN_BUCKET_SIZE)) // also for nan
+        bucketSize = MIN_BUCKET_SIZE;
+    rows_ = std::max(size_t(1), static_cast<size_t>(MIFI_PI / bucketSize));
+    columns_ = std::max(size_t(1), static_cast<size_t>(2 * MIFI_PI / bucketSize));
+    rowHeight_ = MIFI_PI / rows_;
+    columnWidth_ = 2 * MIFI_PI / columns_;
+
+    std::vector<std::uint64_t> buckets(size);
+    std::vector<double> xyz(3 * size);
+    WorkerPool::shared().parallelFor(0, size, [&](size_t i) {
+        if (std::isnan(lonVals[i]) || std::isnan(latVals[i])) {
+            buckets[i] = UNDEFINED_BUCKET;
+        } else {
+            const double lonRad = deg_to_rad(lonVals[i]), latRad = deg_to_rad(latVals[i]);
+            buckets[i] = row(latRad) * columns_ + column(lonRad);
+            unitVector(lonRad, latRad, &xyz[3 * i]);
+        }
+    }, BUCKET_GRAIN);
+
+    std::vector<size_t> order;
+    order.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        if (buckets[i] != UNDEFINED_BUCKET)
+            order.push_back(i);
+    }
+    // stable to keep the input order within a bucket
+    std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) { return buckets[a] < buckets[b]; });
+
+    bucket_.resize(order.size());
+    xyz_.resize(3 * order.size());
+    pos_.swap(order);
+    for (size_t k = 0; k < pos_.size(); ++k) {
+        const size_t i = pos_[k];
+        bucket_[k] = buckets[i];
+        std::copy(&xyz[3 * i], &xyz[3 * i + 3], &xyz_[3 * k]);
+    }
+}
+
+size_t LatLonBuckets::row(double latRad) const
+{
+    const double r = std::floor((latRad + MIFI_PI / 2) / rowHeight_);
+    return (r <= 0) ? 0 : std::min(rows_ - 1, static_cast<size_t>(r));
+}
+
+size_t LatLonBuckets::column(double lonRad) const
+{
+    const double lon = lonRad - 2 * MIFI_PI * std::floor(lonRad / (2 * MIFI_PI)); // [0, 2pi]
+    const double c = std::floor(lon / columnWidth_);
+    return (c <= 0) ? 0 : std::min(columns_ - 1, static_cast<size_t>(c));
+}
+
+void LatLonBuckets::search(std::uint64_t firstBucket, std::uint64_t lastBucket, const double* q, double& bestCos, size_t& best) const
+{
+    const auto begin = std::lower_bound(bucket_.begin(), bucket_.end(), firstBucket);
+    const auto end = std::upper_bound(begin, bucket_.end(), lastBucket);
+    for (size_t k = begin - bucket_.begin(), kEnd = end - bucket_.begin(); k < kEnd; ++k) {
+        // cosine of the great-circle distance
+        const double* p = &xyz_[3 * k];
+        const double cosD = p[0] * q[0] + p[1] * q[1] + p[2] * q[2];
+        // the lowest position wins for equal distances, independent of the bucket order
+        if (cosD > bestCos || (cosD == bestCos && best != NOT_FOUND && pos_[k] < best)) {
+            bestCos = cosD;
+            best = pos_[k];
+        }
+    }
+}
+
+size_t LatLonBuckets::closest(double lon, double lat, double maxDist) const
+{
+    if (std::isnan(lon) || std::isnan(lat) || pos_.empty())
+        return NOT_FOUND;
+
+    const double lonRad = deg_to_rad(lon), latRad = deg_to_rad(lat);
+    double q[3];
+    unitVector(lonRad, latRad, q);
+
+    double bestCos = std::cos(maxDist);
+    size_t best = NOT_FOUND;
+
+    // all points within maxDist are within this latitude band, and within dLon
+    // if the band does not contain a pole
+    const double dist = maxDist + BUCKET_MARGIN;
+    const double latLow = latRad - dist, latHigh = latRad + dist;
+    bool allColumns = (latLow <= -MIFI_PI / 2) || (latHigh >= MIFI_PI / 2);
+    long long colLow = 0, colHigh = 0;
+    if (!allColumns) {
+        const double dLon = std::asin(std::min(1., std::sin(dist) / std::cos(latRad)));
+        const double lonN = lonRad - 2 * MIFI_PI * std::floor(lonRad / (2 * MIFI_PI));
+        colLow = static_cast<long long>(std::floor((lonN - dLon) / columnWidth_));
+        colHigh = static_cast<long long>(std::floor((lonN + dLon) / columnWidth_));
+        allColumns = (colHigh - colLow + 1 >= static_cast<long long>(columns_));
+    }
+
+    const long long nCols = columns_;
+    for (size_t r = row(std::max(latLow, -MIFI_PI / 2)), rEnd = row(std::min(latHigh, MIFI_PI / 2)); r <= rEnd; ++r) {
+        const std::uint64_t first = r * columns_;
+        if (allColumns) {
+            search(first, first + nCols - 1, q, bestCos, best);
+        } else if (colLow < 0) {
+            search(first + colLow + nCols, first + nCols - 1, q, bestCos, best);
+            search(first, first + colHigh, q, bestCos, best);
+        } else if (colHigh >= nCols) {
+            search(first + colLow, first + nCols - 1, q, bestCos, best);
+            search(first, first + colHigh - nCols, q, bestCos, best);
+        } else {
+            search(first + colLow, first + colHigh, q, bestCos, best);
+        }
+    }
+    return best;
+}
+
+} // namespace MetNoFimex
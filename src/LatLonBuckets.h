@@ -0,0 +1,84 @@
+/*
+ * Fimex, LatLonBuckets.h
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef FIMEX_LATLONBUCKETS_H_
+#define FIMEX_LATLONBUCKETS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MetNoFimex {
+
+/**
+ * Points on the sphere sorted into the buckets of a regular latitude/longitude
+ * grid, to find the closest point within a maximum distance by looking only at
+ * the buckets around the query point.
+ *
+ * Buckets are identified by row * columns + column, and the points are sorted
+ * by bucket, so the buckets of one row within a longitude range are found with
+ * a binary search. Longitudes wrap around, and rows touching a pole are
+ * searched completely.
+ */
+class LatLonBuckets
+{
+public:
+    /** returned by closest() when no point is within the distance */
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    /**
+     * @param lonVals longitudes in degrees
+     * @param latVals latitudes in degrees
+     * @param size number of points, points with undefined lon or lat are skipped
+     * @param bucketSize minimum bucket size in radians, usually the search distance
+     */
+    LatLonBuckets(const double* lonVals, const double* latVals, size_t size, double bucketSize);
+
+    /**
+     * Find the closest point.
+     *
+     * @param lon longitude in degrees
+     * @param lat latitude in degrees
+     * @param maxDist maximum great-circle distance on the unit sphere, i.e. in radians
+     * @return the position of the point in lonVals/latVals, or NOT_FOUND
+     */
+    size_t closest(double lon, double lat, double maxDist) const;
+
+    /** number of defined points */
+    size_t size() const { return pos_.size(); }
+
+private:
+    size_t row(double latRad) const;
+    size_t column(double lonRad) const;
+    void search(std::uint64_t firstBucket, std::uint64_t lastBucket, const double* q, double& bestCos, size_t& best) const;
+
+    size_t rows_, columns_;
+    double rowHeight_, columnWidth_;
+    std::vector<std::uint64_t> bucket_; //!< bucket of each point, sorted
+    std::vector<double> xyz_;           //!< unit vectors of the points, in bucket order
+    std::vector<size_t> pos_;           //!< position of the points in the input, in bucket order
+};
+
+} // namespace MetNoFimex
+
+#endif /* FIMEX_LATLONBUCKETS_H_ */
@@ -0,0 +1,190 @@
+/*
+ * Fimex, MemoryBudget.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "fimex/MemoryBudget.h"
+
+#include "fimex/Logger.h"
+#include "fimex/Type2String.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace MetNoFimex {
+
+static Logger_p logger = getLogger("fimex.MemoryBudget");
+
+namespace {
+
+struct Budget
+{
+    std::atomic<size_t> live;
+    std::atomic<size_t> peak;
+    std::atomic<size_t> limit;
+    std::atomic<size_t> active;  // outermost scopes running
+    std::atomic<size_t> waiting; // scopes waiting for memory
+    std::atomic<size_t> throttled;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    Budget()
+        : live(0)
+        , peak(0)
+        , limit(0)
+        , active(0)
+        , waiting(0)
+        , throttled(0)
+    {
+    }
+
+    bool exceeded() const
+    {
+        const size_t l = limit;
+        return l > 0 && live > l;
+    }
+
+    void wakeWaiting()
+    {
+        if (waiting > 0) {
+            // lock to not lose the notification between a check and the wait
+            { std::lock_guard<std::mutex> lock(mutex); }
+            cond.notify_all();
+        }
+    }
+};
+
+Budget& budget()
+{
+    // never destroyed, arrays might be freed during static destruction
+    static Budget* b = new Budget;
+    return *b;
+}
+
+thread_local size_t scopeDepth = 0;
+
+} // namespace
+
+void MemoryBudget::allocated(size_t bytes)
+{
+    Budget& b = budget();
+    const size_t now = (b.live += bytes);
+    size_t peak = b.peak;
+    while (now > peak && !b.peak.compare_exchange_weak(peak, now)) {
+    }
+}
+
+void MemoryBudget::freed(size_t bytes)
+{
+    Budget& b = budget();
+    b.live -= bytes;
+    if (!b.exceeded())
+        b.wakeWaiting();
+}
+
+size_t MemoryBudget::liveBytes()
+{
+    return budget().live;
+}
+
+size_t MemoryBudget::peakBytes()
+{
+    return budget().peak;
+}
+
+void MemoryBudget::resetPeak()
+{
+    Budget& b = budget();
+    b.peak = b.live.load();
+}
+
+void MemoryBudget::setLimit(size_t bytes)
+{
+    budget().limit = bytes;
+    budget().wakeWaiting();
+}
+
+size_t MemoryBudget::getLimit()
+{
+    return budget().limit;
+}
+
+bool MemoryBudget::exceeded()
+{
+    return budget().exceeded();
+}
+
+bool MemoryBudget::inScope()
+{
+    return scopeDepth > 0;
+}
+
+MemoryBudget::Statistics MemoryBudget::statistics()
+{
+    const Budget& b = budget();
+    Statistics stats;
+    stats.liveBytes = b.live;
+    stats.peakBytes = b.peak;
+    stats.limit = b.limit;
+    stats.throttled = b.throttled;
+    return stats;
+}
+
+void MemoryBudget::logStatistics()
+{
+    const Statistics stats = statistics();
+    const size_t MB = 1024 * 1024;
+    LOG4FIMEX(logger, Logger::INFO,
+              "memory: " << (stats.peakBytes / MB) << " MB peak, " << (stats.liveBytes / MB) << " MB live, limit "
+                         << (stats.limit > 0 ? type2string(stats.limit / MB) + " MB" : std::string("none")) << ", throttled " << stats.throttled << " times");
+}
+
+MemoryBudget::Scope::Scope()
+{
+    if (scopeDepth++ > 0)
+        return;
+    Budget& b = budget();
+    if (b.exceeded()) {
+        ++b.throttled;
+        ++b.waiting;
+        std::unique_lock<std::mutex> lock(b.mutex);
+        // at least one scope must run, otherwise nothing frees memory
+        while (b.exceeded() && b.active > 0)
+            b.cond.wait_for(lock, std::chrono::milliseconds(10));
+        --b.waiting;
+        ++b.active; // while locked, so only one of the waiting scopes starts when none is running
+    } else {
+        ++b.active;
+    }
+}
+
+MemoryBudget::Scope::~Scope()
+{
+    if (--scopeDepth > 0)
+        return;
+    Budget& b = budget();
+    --b.active;
+    b.wakeWaiting();
+}
+
+} // namespace MetNoFimex
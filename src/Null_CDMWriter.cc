@@ -31,6 +31,7 @@
 #include "fimex/MutexLock.h"
 #include "fimex/SharedArray.h"
 #include "fimex/Type2String.h"
+#include "fimex/WorkerPool.h"
 
 #include "fimex_config.h"
 #ifdef HAVE_MPI
@@ -113,16 +114,17 @@ Null_CDMWriter::Null_CDMWriter(const CDMReader_p cdmReader, const std::string& o
     // write data
     const CDMDimension* unLimDim = cdm.getUnlimitedDim();
     const long long maxUnLim = (unLimDim ? unLimDim->getLength() : 0);
-#ifdef _OPENMP
-#pragma omp parallel for default(shared)
-#endif
-    for (long long unLimDimPos = -1; unLimDimPos < maxUnLim; ++unLimDimPos) {
+    // step -1 for the variables without unlimited dimension,
+    // readers not supporting concurrent reading are read by this thread only
+    const size_t grain = cdmReader->supportsConcurrentReading() ? 1 : maxUnLim + 1;
+    WorkerPool::shared().parallelFor(0, maxUnLim + 1, [&](size_t step) {
+        const long long unLimDimPos = static_cast<long long>(step) - 1;
 #ifdef HAVE_MPI
         if (mifi_mpi_initialized()) {
             // only work on variables which belong to this mpi-process (modulo-base)
             if ((unLimDimPos % mifi_mpi_size) != mifi_mpi_rank) {
                 LOG4FIMEX(logger, Logger::DEBUG, "processor " << mifi_mpi_rank << " skipping on unLimDimPos " << unLimDimPos);
-                continue;
+                return;
             } else {
                 LOG4FIMEX(logger, Logger::DEBUG, "processor " << mifi_mpi_rank << " working on unLimDimPos " << unLimDimPos);
             }
@@ -143,7 +145,7 @@ Null_CDMWriter::Null_CDMWriter(const CDMReader_p cdmReader, const std::string& o
                                    ", datatype: " + type2string(cdmVar.getDataType()));
             }
         }
-    }
+    }, grain);
 }
 
 Null_CDMWriter::~Null_CDMWriter()
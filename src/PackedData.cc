@@ -0,0 +1,328 @@
+/*
+  Fimex, src/PackedData.cc
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  Project Info:  https://wiki.met.no/fimex/start
+
+  This library is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+  USA.
+*/
+
+#include "PackedData.h"
+
+#include "fimex/CDMException.h"
+#include "fimex/MathUtils.h"
+#include "fimex/WorkerPool.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace MetNoFimex {
+
+namespace {
+
+// INT16: values are stored as q + 32768, the two lowest codes are reserved
+const std::uint16_t INT16_NAN = 0;
+const std::uint16_t INT16_FILL = 1;
+const int INT16_MIN_Q = -32766;
+const int INT16_MAX_Q = 32767;
+
+// FP16: nan is kept as nan, the fill value as a nan with a different payload
+const std::uint16_t FP16_FILL = 0x7e01;
+
+// values unpacked per block when unpacking the whole array
+const size_t UNPACK_BLOCK = 16384;
+
+std::uint32_t floatBits(float f)
+{
+    std::uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+float bitsFloat(std::uint32_t u)
+{
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/**
+ * float to half, round to nearest even, overflow to infinity
+ */
+std::uint16_t floatToHalf(float f)
+{
+    const std::uint32_t f32infty = 255u << 23;
+    const std::uint32_t f16max = (127u + 16) << 23;
+    const std::uint32_t denormMagic = ((127u - 15) + (23 - 10) + 1) << 23;
+
+    std::uint32_t u = floatBits(f);
+    const std::uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    std::uint16_t o;
+    if (u >= f16max) {
+        o = (u > f32infty) ? 0x7e00 : 0x7c00; // nan or inf
+    } else if (u < (113u << 23)) {
+        // subnormal half, let the float addition do the rounding
+        const float r = bitsFloat(u) + bitsFloat(denormMagic);
+        o = static_cast<std::uint16_t>(floatBits(r) - denormMagic);
+    } else {
+        const std::uint32_t mantOdd = (u >> 13) & 1;
+        u += ((15u - 127) << 23) + 0xfff;
+        u += mantOdd;
+        o = static_cast<std::uint16_t>(u >> 13);
+    }
+    return static_cast<std::uint16_t>(o | (sign >> 16));
+}
+
+/**
+ * half to float, exact
+ */
+float halfToFloat(std::uint16_t h)
+{
+    const std::uint32_t shiftedExp = 0x7c00u << 13;
+    std::uint32_t o = (h & 0x7fffu) << 13;
+    const std::uint32_t exp = shiftedExp & o;
+    o += (127u - 15) << 23;
+    if (exp == shiftedExp) {
+        o += (128u - 16) << 23; // inf or nan
+    } else if (exp == 0) {
+        o += 1u << 23; // subnormal
+        o = floatBits(bitsFloat(o) - bitsFloat(113u << 23));
+    }
+    return bitsFloat(o | ((h & 0x8000u) << 16));
+}
+
+} // namespace
+
+PackedData::PackedData(const Data& data, DataPacking packing, double fillValue)
+    : packing_(packing)
+    , dataType_(data.getDataType())
+    , length_(data.size())
+    , fillValue_(fillValue)
+    , scale_(1)
+    , offset_(0)
+    , packed_(make_shared_array<std::uint16_t>(data.size()))
+{
+    if (dataType_ != CDM_FLOAT && dataType_ != CDM_DOUBLE)
+        throw CDMException("cannot pack data of type " + type2string(dataType_));
+    if (packing_ != DATA_PACKING_INT16 && packing_ != DATA_PACKING_FP16)
+        throw CDMException("unknown data packing " + type2string(packing_));
+
+    const shared_array<double> values = data.asDouble();
+    const bool fillIsNan = mifi_isnan(fillValue_);
+    auto isFill = [&](double v) { return !fillIsNan && v == fillValue_; };
+
+    if (packing_ == DATA_PACKING_FP16) {
+        const double floatMax = std::numeric_limits<float>::max();
+        for (size_t i = 0; i < length_; ++i) {
+            // doubles beyond the float range overflow to infinity, without an undefined cast
+            const double v = values[i];
+            const double f = (std::fabs(v) > floatMax) ? std::copysign(std::numeric_limits<double>::infinity(), v) : v;
+            packed_[i] = isFill(v) ? FP16_FILL : floatToHalf(static_cast<float>(f));
+        }
+    } else {
+        double vMin = std::numeric_limits<double>::max();
+        double vMax = -vMin;
+        for (size_t i = 0; i < length_; ++i) {
+            const double v = values[i];
+            if (!(mifi_isnan(v) || isFill(v) || std::isinf(v))) {
+                vMin = std::min(vMin, v);
+                vMax = std::max(vMax, v);
+            }
+        }
+        if (vMax > vMin) {
+            // divided first, vMax - vMin might overflow
+            scale_ = vMax / (INT16_MAX_Q - INT16_MIN_Q) - vMin / (INT16_MAX_Q - INT16_MIN_Q);
+            offset_ = vMin - INT16_MIN_Q * scale_;
+        } else if (vMax == vMin) {
+            offset_ = vMin;
+        }
+        for (size_t i = 0; i < length_; ++i) {
+            const double v = values[i];
+            const double q = (v - offset_) / scale_;
+            if (mifi_isnan(v)) {
+                packed_[i] = INT16_NAN;
+            } else if (isFill(v) || !std::isfinite(q)) {
+                // infinity cannot be packed
+                packed_[i] = INT16_FILL;
+            } else {
+                // clamped before rounding, rounding errors might leave the range
+                const long r = ::lround(clamp<double>(INT16_MIN_Q, q, INT16_MAX_Q));
+                packed_[i] = static_cast<std::uint16_t>(r + 32768);
+            }
+        }
+    }
+}
+
+int PackedData::bytes_for_one() const
+{
+    return (dataType_ == CDM_FLOAT) ? sizeof(float) : sizeof(double);
+}
+
+double PackedData::unpack(size_t pos) const
+{
+    const std::uint16_t p = packed_[pos];
+    if (packing_ == DATA_PACKING_FP16) {
+        return (p == FP16_FILL) ? fillValue_ : halfToFloat(p);
+    } else {
+        if (p == INT16_NAN)
+            return std::numeric_limits<double>::quiet_NaN();
+        if (p == INT16_FILL)
+            return fillValue_;
+        const double v = (static_cast<int>(p) - 32768) * scale_ + offset_;
+        return (dataType_ == CDM_FLOAT) ? static_cast<float>(v) : v;
+    }
+}
+
+template <typename T>
+shared_array<T> PackedData::unpackAll() const
+{
+    shared_array<T> out = make_shared_array<T>(length_);
+    const size_t nBlocks = (length_ + UNPACK_BLOCK - 1) / UNPACK_BLOCK;
+    auto unpackBlock = [&](size_t b) {
+        const size_t end = std::min(length_, (b + 1) * UNPACK_BLOCK);
+        for (size_t i = b * UNPACK_BLOCK; i < end; ++i)
+            out[i] = data_caster<T, double>()(unpack(i));
+    };
+    if (nBlocks > 1)
+        WorkerPool::shared().parallelFor(0, nBlocks, unpackBlock);
+    else if (nBlocks == 1)
+        unpackBlock(0);
+    return out;
+}
+
+DataPtr PackedData::values() const
+{
+    if (data_)
+        return data_;
+    if (dataType_ == CDM_FLOAT)
+        return createData(length_, unpackAll<float>());
+    return createData(length_, unpackAll<double>());
+}
+
+DataPtr PackedData::materialize()
+{
+    if (!data_) {
+        data_ = values();
+        packed_.reset();
+    }
+    return data_;
+}
+
+void PackedData::toStream(std::ostream& os, const std::string& separator) const
+{
+    values()->toStream(os, separator);
+}
+
+std::string PackedData::asString(const std::string& separator) const
+{
+    std::ostringstream o;
+    toStream(o, separator);
+    return o.str();
+}
+
+shared_array<char> PackedData::asChar() const
+{
+    return data_ ? data_->asChar() : unpackAll<char>();
+}
+
+shared_array<short> PackedData::asShort() const
+{
+    return data_ ? data_->asShort() : unpackAll<short>();
+}
+
+shared_array<int> PackedData::asInt() const
+{
+    return data_ ? data_->asInt() : unpackAll<int>();
+}
+
+shared_array<long long> PackedData::asInt64() const
+{
+    return data_ ? data_->asInt64() : unpackAll<long long>();
+}
+
+shared_array<unsigned char> PackedData::asUChar() const
+{
+    return data_ ? data_->asUChar() : unpackAll<unsigned char>();
+}
+
+shared_array<unsigned short> PackedData::asUShort() const
+{
+    return data_ ? data_->asUShort() : unpackAll<unsigned short>();
+}
+
+shared_array<unsigned int> PackedData::asUInt() const
+{
+    return data_ ? data_->asUInt() : unpackAll<unsigned int>();
+}
+
+shared_array<unsigned long long> PackedData::asUInt64() const
+{
+    return data_ ? data_->asUInt64() : unpackAll<unsigned long long>();
+}
+
+shared_array<float> PackedData::asFloat() const
+{
+    return data_ ? data_->asFloat() : unpackAll<float>();
+}
+
+shared_array<double> PackedData::asDouble() const
+{
+    return data_ ? data_->asDouble() : unpackAll<double>();
+}
+
+shared_array<std::string> PackedData::asStrings() const
+{
+    return values()->asStrings();
+}
+
+double PackedData::getDouble(size_t pos)
+{
+    return data_ ? data_->getDouble(pos) : unpack(pos);
+}
+
+long long PackedData::getLongLong(size_t pos)
+{
+    return data_ ? data_->getLongLong(pos) : data_caster<long long, double>()(unpack(pos));
+}
+
+DataPtr PackedData::clone() const
+{
+    if (data_)
+        return data_->clone();
+    // the packed values are never modified and can be shared
+    return DataPtr(new PackedData(*this));
+}
+
+DataPtr createPackedData(const Data& data, DataPacking packing, double fillValue)
+{
+    if (packing == DATA_PACKING_NONE || (data.getDataType() != CDM_FLOAT && data.getDataType() != CDM_DOUBLE))
+        return data.clone();
+    return std::make_shared<PackedData>(data, packing, fillValue);
+}
+
+} // namespace MetNoFimex
@@ -0,0 +1,126 @@
+/*
+  Fimex, src/PackedData.h
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  Project Info:  https://wiki.met.no/fimex/start
+
+  This library is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+  USA.
+*/
+
+#ifndef FIMEX_PACKEDDATA_H
+#define FIMEX_PACKEDDATA_H
+
+#include "fimex/Data.h"
+
+#include <cstdint>
+
+namespace MetNoFimex {
+
+/**
+ * This is a private header file, use createPackedData() from Data.h.
+ *
+ * Float or double values stored with 16 bits per value, either as integers with
+ * scale and offset (DATA_PACKING_INT16) or as IEEE half precision floats
+ * (DATA_PACKING_FP16). NaN and the fill value are kept exactly. DATA_PACKING_INT16
+ * stores infinite values as fill value.
+ *
+ * The packed array is never modified, so clone() shares it. Values are unpacked
+ * when read; getDataPtr() and the functions changing values unpack all values into
+ * an own DataImpl first.
+ */
+class PackedData : public Data
+{
+public:
+    /**
+     * Pack the values of data, which must be CDM_FLOAT or CDM_DOUBLE.
+     */
+    PackedData(const Data& data, DataPacking packing, double fillValue);
+
+    size_t size() const override { return length_; }
+    int bytes_for_one() const override;
+    void* getDataPtr() override { return materialize()->getDataPtr(); }
+    void toStream(std::ostream& os, const std::string& separator = "") const override;
+
+    shared_array<char> asChar() const override;
+    shared_array<short> asShort() const override;
+    shared_array<int> asInt() const override;
+    shared_array<long long> asInt64() const override;
+    shared_array<unsigned char> asUChar() const override;
+    shared_array<unsigned short> asUShort() const override;
+    shared_array<unsigned int> asUInt() const override;
+    shared_array<unsigned long long> asUInt64() const override;
+    shared_array<float> asFloat() const override;
+    shared_array<double> asDouble() const override;
+    shared_array<std::string> asStrings() const override;
+    std::string asString(const std::string& separator = "") const override;
+
+    double getDouble(size_t pos) override;
+    long long getLongLong(size_t pos) override;
+    void setValue(size_t pos, double val) override { materialize()->setValue(pos, val); }
+    void setValues(size_t startPos, const Data& data, size_t first = 0, size_t last = -1) override { materialize()->setValues(startPos, data, first, last); }
+    void setAllValues(double val) override { materialize()->setAllValues(val); }
+    DataPtr clone() const override;
+    DataPtr slice(const std::vector<size_t>& orgDimSize, const std::vector<size_t>& startDims, const std::vector<size_t>& outputDimSize) override
+    {
+        return values()->slice(orgDimSize, startDims, outputDimSize);
+    }
+    DataPtr convertDataType(double oldFill, double oldScale, double oldOffset, CDMDataType newType, double newFill, double newScale, double newOffset) override
+    {
+        return values()->convertDataType(oldFill, oldScale, oldOffset, newType, newFill, newScale, newOffset);
+    }
+    DataPtr convertDataType(double oldFill, double oldScale, double oldOffset, UnitsConverter_p unitConverter, CDMDataType newType, double newFill,
+                            double newScale, double newOffset) override
+    {
+        return values()->convertDataType(oldFill, oldScale, oldOffset, unitConverter, newType, newFill, newScale, newOffset);
+    }
+    CDMDataType getDataType() const override { return dataType_; }
+
+    DataPacking getPacking() const { return packing_; }
+
+private:
+    PackedData(const PackedData& other) = default;
+
+    double unpack(size_t pos) const;
+
+    template <typename T>
+    shared_array<T> unpackAll() const;
+
+    /// all values in the original type, unpacked or the materialized data
+    DataPtr values() const;
+
+    DataPtr materialize();
+
+    DataPacking packing_;
+    CDMDataType dataType_;
+    size_t length_;
+    double fillValue_;
+    double scale_;
+    double offset_;
+    shared_array<std::uint16_t> packed_;
+    DataPtr data_;
+};
+
+} // namespace MetNoFimex
+
+#endif // FIMEX_PACKEDDATA_H
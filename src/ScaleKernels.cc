@@ -0,0 +1,223 @@
+/*
+  Fimex, src/ScaleKernels.cc
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  Project Info:  https://wiki.met.no/fimex/start
+
+  This library is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+  USA.
+*/
+
+#include "ScaleKernels.h"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FIMEX_SCALE_X86 1
+#define FIMEX_SCALE_INLINE inline __attribute__((always_inline))
+#define FIMEX_SCALE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define FIMEX_SCALE_INLINE inline
+#endif
+
+namespace MetNoFimex {
+
+namespace {
+
+/**
+ * Round half away from zero like lround, but without a library call so that
+ * loops using it can be vectorized. x - trunc(x) is exact.
+ */
+FIMEX_SCALE_INLINE double roundHalfAway(double x)
+{
+    const double t = std::trunc(x);
+    const double d = x - t;
+    return t + static_cast<double>(d >= 0.5) - static_cast<double>(d <= -0.5);
+}
+
+template <typename OUT, bool isInteger = std::numeric_limits<OUT>::is_integer>
+struct ScaleCast
+{
+    // clamped to the range of OUT before rounding, the conversion of values out of range, including inf, is undefined
+    static FIMEX_SCALE_INLINE OUT cast(double v)
+    {
+        const double lo = static_cast<double>(std::numeric_limits<OUT>::lowest());
+        const double hi = static_cast<double>(std::numeric_limits<OUT>::max());
+        return static_cast<OUT>(roundHalfAway(v < lo ? lo : (v > hi ? hi : v)));
+    }
+};
+
+template <typename OUT>
+struct ScaleCast<OUT, false>
+{
+    static FIMEX_SCALE_INLINE OUT cast(double v) { return static_cast<OUT>(v); }
+};
+
+/**
+ * The kernel, written branch-free such that the compiler vectorizes it for
+ * the instruction set of the calling function. Not restrict-qualified, as in
+ * and out may be the same array; the compiler checks for overlap at runtime.
+ */
+template <typename IN, typename OUT>
+FIMEX_SCALE_INLINE void scaleLoop(const IN* in, OUT* out, size_t n, IN inFill, double scale, double offset, OUT outFill)
+{
+    for (size_t i = 0; i < n; ++i) {
+        const IN v = in[i];
+        // computed unconditionally to allow if-conversion, but fill-values
+        // and nan results are not converted
+        const double s = scale * v + offset;
+        const bool fill = (v == inFill) | (s != s); // s != s: nan, also for nan input; no short-circuit to avoid branches
+        const OUT o = ScaleCast<OUT>::cast(fill ? 0. : s);
+        out[i] = fill ? outFill : o;
+    }
+}
+
+template <typename IN, typename OUT>
+void scaleDefault(const IN* in, OUT* out, size_t n, IN inFill, double scale, double offset, OUT outFill)
+{
+    scaleLoop(in, out, n, inFill, scale, offset, outFill);
+}
+
+#ifdef FIMEX_SCALE_X86
+template <typename IN, typename OUT>
+FIMEX_SCALE_TARGET("sse4.2")
+void scaleSSE4(const IN* in, OUT* out, size_t n, IN inFill, double scale, double offset, OUT outFill)
+{
+    scaleLoop(in, out, n, inFill, scale, offset, outFill);
+}
+
+template <typename IN, typename OUT>
+FIMEX_SCALE_TARGET("avx2,fma")
+void scaleAVX2(const IN* in, OUT* out, size_t n, IN inFill, double scale, double offset, OUT outFill)
+{
+    scaleLoop(in, out, n, inFill, scale, offset, outFill);
+}
+
+template <typename IN, typename OUT>
+FIMEX_SCALE_TARGET("avx512f,avx512bw,avx512vl,avx512dq")
+void scaleAVX512(const IN* in, OUT* out, size_t n, IN inFill, double scale, double offset, OUT outFill)
+{
+    scaleLoop(in, out, n, inFill, scale, offset, outFill);
+}
+#endif // FIMEX_SCALE_X86
+
+ScaleKernelIsa bestSupportedIsa(ScaleKernelIsa wanted)
+{
+#ifdef FIMEX_SCALE_X86
+    __builtin_cpu_init();
+    if (wanted >= SCALE_ISA_AVX512 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") &&
+        __builtin_cpu_supports("avx512dq"))
+        return SCALE_ISA_AVX512;
+    if (wanted >= SCALE_ISA_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SCALE_ISA_AVX2;
+    if (wanted >= SCALE_ISA_SSE4 && __builtin_cpu_supports("sse4.2"))
+        return SCALE_ISA_SSE4;
+#else
+    (void)wanted;
+#endif
+    return SCALE_ISA_DEFAULT;
+}
+
+std::atomic<int>& currentIsa()
+{
+    static std::atomic<int> isa(bestSupportedIsa(SCALE_ISA_AVX512));
+    return isa;
+}
+
+template <typename IN, typename OUT>
+void scaleTyped(const void* in, size_t n, double inFill, double scale, double offset, void* out, double outFill)
+{
+    const IN* i = static_cast<const IN*>(in);
+    OUT* o = static_cast<OUT*>(out);
+    const IN inF = static_cast<IN>(inFill);
+    const OUT outF = static_cast<OUT>(outFill);
+    switch (currentIsa().load(std::memory_order_relaxed)) {
+#ifdef FIMEX_SCALE_X86
+    case SCALE_ISA_AVX512:
+        scaleAVX512(i, o, n, inF, scale, offset, outF);
+        break;
+    case SCALE_ISA_AVX2:
+        scaleAVX2(i, o, n, inF, scale, offset, outF);
+        break;
+    case SCALE_ISA_SSE4:
+        scaleSSE4(i, o, n, inF, scale, offset, outF);
+        break;
+#endif
+    default:
+        scaleDefault(i, o, n, inF, scale, offset, outF);
+        break;
+    }
+}
+
+template <typename IN>
+bool scaleFrom(const void* in, size_t n, double inFill, double scale, double offset, CDMDataType outType, void* out, double outFill)
+{
+    // clang-format off
+    switch (outType) {
+    case CDM_CHAR:   scaleTyped<IN, char>          (in, n, inFill, scale, offset, out, outFill); return true;
+    case CDM_UCHAR:  scaleTyped<IN, unsigned char> (in, n, inFill, scale, offset, out, outFill); return true;
+    case CDM_SHORT:  scaleTyped<IN, short>         (in, n, inFill, scale, offset, out, outFill); return true;
+    case CDM_USHORT: scaleTyped<IN, unsigned short>(in, n, inFill, scale, offset, out, outFill); return true;
+    case CDM_INT:    scaleTyped<IN, int>           (in, n, inFill, scale, offset, out, outFill); return true;
+    case CDM_UINT:   scaleTyped<IN, unsigned int>  (in, n, inFill, scale, offset, out, outFill); return true;
+    case CDM_FLOAT:  scaleTyped<IN, float>         (in, n, inFill, scale, offset, out, outFill); return true;
+    case CDM_DOUBLE: scaleTyped<IN, double>        (in, n, inFill, scale, offset, out, outFill); return true;
+    default: return false;
+    }
+    // clang-format on
+}
+
+} // namespace
+
+bool scaleValues(CDMDataType inType, const void* in, size_t n, double inFill, double scale, double offset, CDMDataType outType, void* out, double outFill)
+{
+    // clang-format off
+    switch (inType) {
+    case CDM_CHAR:   return scaleFrom<char>          (in, n, inFill, scale, offset, outType, out, outFill);
+    case CDM_UCHAR:  return scaleFrom<unsigned char> (in, n, inFill, scale, offset, outType, out, outFill);
+    case CDM_SHORT:  return scaleFrom<short>         (in, n, inFill, scale, offset, outType, out, outFill);
+    case CDM_USHORT: return scaleFrom<unsigned short>(in, n, inFill, scale, offset, outType, out, outFill);
+    case CDM_INT:    return scaleFrom<int>           (in, n, inFill, scale, offset, outType, out, outFill);
+    case CDM_UINT:   return scaleFrom<unsigned int>  (in, n, inFill, scale, offset, outType, out, outFill);
+    case CDM_FLOAT:  return scaleFrom<float>         (in, n, inFill, scale, offset, outType, out, outFill);
+    case CDM_DOUBLE: return scaleFrom<double>        (in, n, inFill, scale, offset, outType, out, outFill);
+    default: return false;
+    }
+    // clang-format on
+}
+
+ScaleKernelIsa getScaleKernelIsa()
+{
+    return static_cast<ScaleKernelIsa>(currentIsa().load());
+}
+
+ScaleKernelIsa setScaleKernelIsa(ScaleKernelIsa isa)
+{
+    const ScaleKernelIsa used = bestSupportedIsa(isa);
+    currentIsa() = used;
+    return used;
+}
+
+} // namespace MetNoFimex
@@ -0,0 +1,106 @@
+/*
+  Fimex, src/ScaleKernels.h
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  Project Info:  https://wiki.met.no/fimex/start
+
+  This library is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+  USA.
+*/
+
+#ifndef FIMEX_SCALEKERNELS_H
+#define FIMEX_SCALEKERNELS_H
+
+#include "fimex/CDMDataType.h"
+
+#include <cstddef>
+
+namespace MetNoFimex {
+
+/**
+ * This is a private header file, used by DataImpl::convertDataType().
+ *
+ * Vectorized conversion of arrays with fill-value, scale and offset.
+ * The kernels are compiled for several instruction sets, the best
+ * one supported by the cpu is selected at runtime.
+ */
+
+enum ScaleKernelIsa {
+    SCALE_ISA_DEFAULT, ///< compiler default, e.g. SSE2 on x86_64
+    SCALE_ISA_SSE4,
+    SCALE_ISA_AVX2,
+    SCALE_ISA_AVX512
+};
+
+/**
+ * CDMDataType of the types supported by scaleValues(), CDM_NAT for others.
+ */
+template <typename T>
+struct ScaleKernelType
+{
+    static const CDMDataType type = CDM_NAT;
+};
+
+// clang-format off
+template <> struct ScaleKernelType<char>           { static const CDMDataType type = CDM_CHAR; };
+template <> struct ScaleKernelType<unsigned char>  { static const CDMDataType type = CDM_UCHAR; };
+template <> struct ScaleKernelType<short>          { static const CDMDataType type = CDM_SHORT; };
+template <> struct ScaleKernelType<unsigned short> { static const CDMDataType type = CDM_USHORT; };
+template <> struct ScaleKernelType<int>            { static const CDMDataType type = CDM_INT; };
+template <> struct ScaleKernelType<unsigned int>   { static const CDMDataType type = CDM_UINT; };
+template <> struct ScaleKernelType<float>          { static const CDMDataType type = CDM_FLOAT; };
+template <> struct ScaleKernelType<double>         { static const CDMDataType type = CDM_DOUBLE; };
+// clang-format on
+
+/**
+ * Convert n values in a single pass:
+ * out = (in == inFill || isnan(in)) ? outFill : scale * in + offset,
+ * rounded like data_caster if the output type is an integer type. Values out
+ * of the range of an integer output type, including inf, are clamped to the
+ * range, and nan results, e.g. from inf * 0, become outFill.
+ *
+ * Combine the conversion of the input with scale_factor/add_offset, a linear
+ * unit conversion and the packing with the output scale_factor/add_offset
+ * into one scale and offset. in and out may be the same array if the types
+ * are the same, but must not overlap otherwise.
+ *
+ * @return false if one of the types is not supported, out is unchanged then
+ */
+bool scaleValues(CDMDataType inType, const void* in, size_t n, double inFill, double scale, double offset, CDMDataType outType, void* out, double outFill);
+
+/**
+ * @return the instruction set currently used by scaleValues()
+ */
+ScaleKernelIsa getScaleKernelIsa();
+
+/**
+ * Change the instruction set used by scaleValues(), for tests and benchmarks.
+ * Instruction sets not supported by the cpu are replaced by the best supported one.
+ *
+ * @return the instruction set used now
+ */
+ScaleKernelIsa setScaleKernelIsa(ScaleKernelIsa isa);
+
+} // namespace MetNoFimex
+
+#endif // FIMEX_SCALEKERNELS_H
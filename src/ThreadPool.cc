@@ -25,13 +25,21 @@
  */
 
 #include "fimex/ThreadPool.h"
+
+#include "fimex/WorkerPool.h"
+#include "fimex/mifi_constants.h"
+
 #ifdef _OPENMP
 #include <omp.h>
 #endif
-#include "fimex/mifi_constants.h"
+
+using MetNoFimex::WorkerPool;
 
 int mifi_setNumThreads(int n)
 {
+    if (WorkerPool::isWorkerThread()) {
+        return MIFI_ERROR;
+    }
 #ifdef _OPENMP
     if (omp_in_parallel() != 0) {
         return MIFI_ERROR;
@@ -42,6 +50,11 @@ int mifi_setNumThreads(int n)
         omp_set_num_threads(omp_get_num_procs());
     }
 #endif
+    WorkerPool::shared().resize((n > 0) ? n : 0);
     return MIFI_OK;
 }
 
+int mifi_getNumThreads()
+{
+    return static_cast<int>(WorkerPool::shared().size());
+}
@@ -0,0 +1,148 @@
+/*
+ * Fimex, WeightMatrix.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "fimex/WeightMatrix.h"
+
+#include "fimex/CDMException.h"
+#include "fimex/Type2String.h"
+#include "fimex/WorkerPool.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace MetNoFimex {
+
+namespace {
+
+// output points per task of apply
+const size_t ROW_BLOCK = 16384;
+
+} // namespace
+
+WeightMatrix::WeightMatrix(size_t columns)
+    : columns_(columns)
+    , rowStart_(1, 0)
+{
+    if (columns > std::numeric_limits<std::uint32_t>::max())
+        throw CDMException("too many columns for weight matrix: " + type2string(columns));
+}
+
+void WeightMatrix::addWeight(size_t column, float weight)
+{
+    if (column >= columns_)
+        throw CDMException("weight matrix column " + type2string(column) + " out of range " + type2string(columns_));
+    if (columnIndex_.size() >= std::numeric_limits<std::uint32_t>::max())
+        throw CDMException("too many weights for weight matrix");
+    if (weight != 1 && weights_.empty())
+        weights_.resize(columnIndex_.size(), 1);
+    columnIndex_.push_back(static_cast<std::uint32_t>(column));
+    if (!weights_.empty())
+        weights_.push_back(weight);
+}
+
+void WeightMatrix::endRow()
+{
+    rowStart_.push_back(static_cast<std::uint32_t>(columnIndex_.size()));
+}
+
+template <typename T>
+void WeightMatrix::applyRows(const T* in, T* out, size_t begin, size_t end) const
+{
+    const T undefined = std::numeric_limits<T>::quiet_NaN();
+    const std::uint32_t* rs = rowStart_.data();
+    const std::uint32_t* col = columnIndex_.data();
+    if (weights_.empty()) {
+        for (size_t r = begin; r < end; ++r) {
+            const size_t kEnd = rs[r + 1];
+            size_t k = rs[r];
+            if (k == kEnd) {
+                out[r] = undefined;
+            } else if (k + 1 == kEnd) {
+                out[r] = in[col[k]]; // exact copy for nearest neighbor
+            } else {
+                double sum = 0;
+                for (; k < kEnd; ++k)
+                    sum += in[col[k]];
+                out[r] = static_cast<T>(sum);
+            }
+        }
+        return;
+    }
+    const float* w = weights_.data();
+    for (size_t r = begin; r < end; ++r) {
+        const size_t kEnd = rs[r + 1];
+        size_t k = rs[r];
+        if (k == kEnd) {
+            out[r] = undefined;
+        } else {
+            double sum = 0;
+            for (; k < kEnd; ++k)
+                sum += w[k] * static_cast<double>(in[col[k]]);
+            out[r] = static_cast<T>(sum);
+        }
+    }
+}
+
+template <typename T>
+void WeightMatrix::applyLayers(const T* in, T* out, size_t nLayers) const
+{
+    const size_t nRows = rows();
+    const size_t nBlocks = std::max(size_t(1), (nRows + ROW_BLOCK - 1) / ROW_BLOCK);
+    WorkerPool::shared().parallelFor(0, nLayers * nBlocks, [&](size_t task) {
+        const size_t z = task / nBlocks;
+        const size_t block = task % nBlocks;
+        applyRows(in + z * columns_, out + z * nRows, block * ROW_BLOCK, std::min(nRows, (block + 1) * ROW_BLOCK));
+    });
+}
+
+template <typename T>
+shared_array<T> WeightMatrix::applyArray(shared_array<T> inData, size_t size, size_t& newSize) const
+{
+    const size_t nLayers = (columns_ > 0) ? size / columns_ : 0;
+    newSize = nLayers * rows();
+    shared_array<T> outData = make_shared_array<T>(newSize);
+    applyLayers(inData.get(), outData.get(), nLayers);
+    return outData;
+}
+
+void WeightMatrix::apply(const float* in, float* out, size_t nLayers) const
+{
+    applyLayers(in, out, nLayers);
+}
+
+void WeightMatrix::apply(const double* in, double* out, size_t nLayers) const
+{
+    applyLayers(in, out, nLayers);
+}
+
+shared_array<float> WeightMatrix::apply(shared_array<float> inData, size_t size, size_t& newSize) const
+{
+    return applyArray(inData, size, newSize);
+}
+
+shared_array<double> WeightMatrix::apply(shared_array<double> inData, size_t size, size_t& newSize) const
+{
+    return applyArray(inData, size, newSize);
+}
+
+} // namespace MetNoFimex
@@ -0,0 +1,520 @@
+/*
+ * Fimex, WorkerPool.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "fimex/WorkerPool.h"
+
+#include "fimex/Logger.h"
+#include "fimex/MemoryBudget.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#endif
+
+namespace MetNoFimex {
+
+static Logger_p logger = getLogger("fimex.WorkerPool");
+
+namespace {
+
+// submit group of the helper tasks of parallelFor, never run by WorkerPool::wait()
+const size_t NO_GROUP = 0;
+
+std::atomic<size_t> nextGroup(NO_GROUP + 1);
+
+// submit group of the code running in this thread, see WorkerPool::wait()
+thread_local size_t currentGroup = nextGroup++;
+
+/**
+ * Run the code of a task or parallelFor chunk in a new submit group, such that
+ * only the tasks it submits itself are run while it waits.
+ */
+class GroupScope
+{
+public:
+    GroupScope()
+        : previous_(currentGroup)
+    {
+        currentGroup = nextGroup++;
+    }
+    ~GroupScope() { currentGroup = previous_; }
+
+private:
+    size_t previous_;
+};
+
+struct Task
+{
+    std::function<void()> run;
+    size_t group;
+};
+
+struct TaskQueue
+{
+    std::mutex mutex;
+    std::deque<Task> tasks;
+};
+
+/**
+ * State of a parallelFor call, shared by the calling thread and the helper tasks.
+ */
+struct ParallelFor
+{
+    const std::function<void(size_t)>* body;
+    size_t begin;
+    size_t end;
+    size_t chunkSize;
+    size_t nChunks;
+    std::atomic<size_t> nextChunk;
+    std::atomic<bool> failed;
+    bool throttle; // each chunk is a MemoryBudget::Scope
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t doneChunks;
+    std::exception_ptr error;
+
+    ParallelFor(const std::function<void(size_t)>& body, size_t begin, size_t end, size_t chunkSize, bool throttle)
+        : body(&body)
+        , begin(begin)
+        , end(end)
+        , chunkSize(chunkSize)
+        , nChunks((end - begin + chunkSize - 1) / chunkSize)
+        , nextChunk(0)
+        , failed(false)
+        , throttle(throttle)
+        , doneChunks(0)
+    {
+    }
+
+    void run();
+};
+
+void ParallelFor::run()
+{
+    // body is only used while there are chunks left, i.e. while parallelFor has not returned
+    for (size_t c = nextChunk++; c < nChunks; c = nextChunk++) {
+        if (!failed) {
+            try {
+                std::unique_ptr<MemoryBudget::Scope> scope;
+                if (throttle)
+                    scope.reset(new MemoryBudget::Scope); // waits while memory is short
+                GroupScope group;
+                const size_t cEnd = std::min(end, begin + (c + 1) * chunkSize);
+                for (size_t i = begin + c * chunkSize; i < cEnd; ++i)
+                    (*body)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+                failed = true;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (++doneChunks == nChunks)
+            cond.notify_all();
+    }
+}
+
+#ifdef __linux__
+/**
+ * Parse a cpu list of sysfs, e.g. "0-3,8-11".
+ */
+std::vector<int> parseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::istringstream in(list);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        if (range.empty())
+            continue;
+        const size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+        for (int c = first; c <= last; ++c)
+            cpus.push_back(c);
+    }
+    return cpus;
+}
+
+/**
+ * @return the cpus this process may run on, grouped by NUMA node
+ */
+std::vector<std::vector<int>> numaNodeCpus(const cpu_set_t& allowed)
+{
+    std::vector<std::vector<int>> nodes;
+    for (int node = 0;; ++node) {
+        std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!cpulist)
+            break;
+        std::string line;
+        std::getline(cpulist, line);
+        std::vector<int> cpus;
+        for (int c : parseCpuList(line)) {
+            if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed))
+                cpus.push_back(c);
+        }
+        if (!cpus.empty())
+            nodes.push_back(cpus);
+    }
+    if (nodes.empty()) {
+        // no NUMA information, all cpus on one node
+        std::vector<int> cpus;
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &allowed))
+                cpus.push_back(c);
+        }
+        nodes.push_back(cpus);
+    }
+    return nodes;
+}
+
+/**
+ * @return the cpus in the order workers should be pinned to them
+ */
+std::vector<int> cpuOrder(WorkerPool::Affinity affinity, const cpu_set_t& allowed)
+{
+    const std::vector<std::vector<int>> nodes = numaNodeCpus(allowed);
+    std::vector<int> order;
+    if (affinity == WorkerPool::AFFINITY_COMPACT) {
+        for (const std::vector<int>& cpus : nodes)
+            order.insert(order.end(), cpus.begin(), cpus.end());
+    } else {
+        size_t maxCpus = 0;
+        for (const std::vector<int>& cpus : nodes)
+            maxCpus = std::max(maxCpus, cpus.size());
+        for (size_t i = 0; i < maxCpus; ++i) {
+            for (const std::vector<int>& cpus : nodes) {
+                if (i < cpus.size())
+                    order.push_back(cpus[i]);
+            }
+        }
+    }
+    return order;
+}
+#endif // __linux__
+
+} // namespace
+
+struct WorkerPool::Impl
+{
+    std::mutex mutex; // protects tasks and stop, and is used for idle workers
+    std::condition_variable cond;
+    std::deque<Task> tasks; // tasks submitted from outside of the pool
+    std::vector<std::unique_ptr<TaskQueue>> queues; // one queue per worker
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending; // number of queued tasks in all queues
+    bool stop;
+    Affinity affinity;
+    bool pinned;
+
+    // pool and queue of the worker running in the current thread
+    static thread_local Impl* current;
+    static thread_local size_t currentIndex;
+
+    Impl()
+        : pending(0)
+        , stop(false)
+        , affinity(AFFINITY_NONE)
+        , pinned(false)
+    {
+    }
+
+    void start(size_t nThreads);
+    void applyAffinity();
+    void join();
+    void push(Task task);
+    bool pop(Task& task);
+    bool popGroup(size_t group, Task& task);
+    void run(Task& task);
+    void work(size_t index);
+};
+
+thread_local WorkerPool::Impl* WorkerPool::Impl::current = nullptr;
+thread_local size_t WorkerPool::Impl::currentIndex = 0;
+
+void WorkerPool::Impl::start(size_t nThreads)
+{
+    if (nThreads == 0)
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+    LOG4FIMEX(logger, Logger::DEBUG, "starting worker pool with " << nThreads << " threads");
+    for (size_t i = 0; i < nThreads; ++i)
+        queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue));
+    for (size_t i = 0; i < nThreads; ++i)
+        workers.push_back(std::thread(&Impl::work, this, i));
+    applyAffinity();
+}
+
+void WorkerPool::Impl::applyAffinity()
+{
+#ifdef __linux__
+    if (affinity == AFFINITY_NONE && !pinned)
+        return;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        LOG4FIMEX(logger, Logger::WARN, "cannot determine the cpus of this process, not pinning worker threads");
+        return;
+    }
+    std::vector<int> order;
+    if (affinity != AFFINITY_NONE)
+        order = cpuOrder(affinity, allowed);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        cpu_set_t cpus = allowed; // unpinned, all cpus of the process
+        if (!order.empty()) {
+            CPU_ZERO(&cpus);
+            CPU_SET(order[i % order.size()], &cpus);
+        }
+        if (pthread_setaffinity_np(workers[i].native_handle(), sizeof(cpus), &cpus) != 0)
+            LOG4FIMEX(logger, Logger::WARN, "cannot set the affinity of worker " << i);
+    }
+    pinned = !order.empty();
+#else
+    if (affinity != AFFINITY_NONE)
+        LOG4FIMEX(logger, Logger::WARN, "pinning of worker threads is not supported on this platform");
+#endif
+}
+
+void WorkerPool::Impl::join()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond.notify_all();
+    for (std::thread& w : workers)
+        w.join();
+    workers.clear();
+    queues.clear();
+    stop = false;
+}
+
+void WorkerPool::Impl::push(Task task)
+{
+    const bool local = (current == this);
+    {
+        // count before queueing, idle workers check pending while holding the mutex
+        std::lock_guard<std::mutex> lock(mutex);
+        ++pending;
+        if (!local)
+            tasks.push_back(std::move(task));
+    }
+    if (local) {
+        TaskQueue& q = *queues[currentIndex];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(std::move(task));
+    }
+    cond.notify_one();
+}
+
+bool WorkerPool::Impl::pop(Task& task)
+{
+    const size_t n = queues.size();
+    if (current == this) {
+        // newest task of the own queue first, its data is most likely still in cache
+        TaskQueue& q = *queues[currentIndex];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            --pending;
+            return true;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!tasks.empty()) {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            --pending;
+            return true;
+        }
+    }
+    // steal the oldest task of another worker
+    const size_t first = (current == this) ? currentIndex + 1 : 0;
+    for (size_t i = 0; i < n; ++i) {
+        TaskQueue& q = *queues[(first + i) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            --pending;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkerPool::Impl::popGroup(size_t group, Task& task)
+{
+    // the tasks of a group are all queued by one thread, in its own queue or the common one
+    const bool local = (current == this);
+    std::lock_guard<std::mutex> lock(local ? queues[currentIndex]->mutex : mutex);
+    std::deque<Task>& q = local ? queues[currentIndex]->tasks : tasks;
+    // oldest first, usually the one waited for
+    for (std::deque<Task>::iterator it = q.begin(); it != q.end(); ++it) {
+        if (it->group == group) {
+            task = std::move(*it);
+            q.erase(it);
+            --pending;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::Impl::run(Task& task)
+{
+    GroupScope group;
+    task.run(); // packaged_task or ParallelFor, exceptions are handled there
+}
+
+void WorkerPool::Impl::work(size_t index)
+{
+    current = this;
+    currentIndex = index;
+    while (true) {
+        Task task;
+        if (pop(task)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]() { return stop || pending > 0; });
+        if (stop && pending == 0)
+            return; // stop and nothing left to do
+    }
+}
+
+WorkerPool::WorkerPool(size_t nThreads)
+    : p_(new Impl)
+{
+    p_->start(nThreads);
+}
+
+WorkerPool::~WorkerPool()
+{
+    p_->join();
+}
+
+size_t WorkerPool::size() const
+{
+    return p_->workers.size();
+}
+
+void WorkerPool::resize(size_t nThreads)
+{
+    p_->join();
+    p_->start(nThreads);
+}
+
+void WorkerPool::push(std::function<void()> task)
+{
+    p_->push(Task{std::move(task), currentGroup});
+}
+
+bool WorkerPool::runGroupTask()
+{
+    Task task;
+    if (!p_->popGroup(currentGroup, task))
+        return false;
+    p_->run(task);
+    return true;
+}
+
+void WorkerPool::parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& body, size_t grain)
+{
+    if (end <= begin)
+        return;
+    const size_t nWorkers = size();
+    // a few chunks per worker to balance uneven work
+    const size_t chunkSize = std::max(std::max(grain, size_t(1)), (end - begin) / (4 * nWorkers));
+    // only outermost loops of the application are throttled: loops nested in a
+    // throttled chunk or running in tasks of the pool might be waited for by one
+    const bool throttle = MemoryBudget::getLimit() > 0 && !MemoryBudget::inScope() && !isWorkerThread();
+    auto state = std::make_shared<ParallelFor>(body, begin, end, chunkSize, throttle);
+    if (state->nChunks == 1 || nWorkers == 1) {
+        for (size_t i = begin; i < end; ++i)
+            body(i);
+        return;
+    }
+
+    // the calling thread is one of the threads of the budget
+    const size_t nHelpers = std::min(state->nChunks, nWorkers) - 1;
+    for (size_t i = 0; i < nHelpers; ++i)
+        p_->push(Task{[state]() { state->run(); }, NO_GROUP});
+    state->run();
+    // all chunks are claimed, only wait for those still running in other threads;
+    // running unrelated tasks here might re-enter the caller of the loop
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cond.wait(lock, [&state]() { return state->doneChunks == state->nChunks; });
+    }
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
+
+void WorkerPool::setAffinity(Affinity affinity)
+{
+    p_->affinity = affinity;
+    p_->applyAffinity();
+}
+
+WorkerPool::Affinity WorkerPool::getAffinity() const
+{
+    return p_->affinity;
+}
+
+bool WorkerPool::isWorkerThread()
+{
+    return Impl::current != nullptr;
+}
+
+WorkerPool& WorkerPool::shared()
+{
+    // serial unless asked for more threads by mifi_setNumThreads() or OpenMP, readers
+    // and callbacks of applications are then not called concurrently behind their back
+#ifdef _OPENMP
+    static WorkerPool pool(std::max(1, omp_get_max_threads()));
+#else
+    static WorkerPool pool(1);
+#endif
+    return pool;
+}
+
+} // namespace MetNoFimex
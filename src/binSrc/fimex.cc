@@ -21,6 +21,7 @@
  * USA.
  */
 
+#include "fimex/BufferPool.h"
 #include "fimex/CDM.h"
 #include "fimex/CDMException.h"
 #include "fimex/CDMExtractor.h"
@@ -37,6 +38,7 @@
 #include "fimex/CDMconstants.h"
 #include "fimex/FillWriter.h"
 #include "fimex/Logger.h"
+#include "fimex/MemoryBudget.h"
 #ifdef HAVE_MPI
 #include "fimex/mifi_mpi.h"
 #endif
@@ -47,6 +49,7 @@
 #include "fimex/ThreadPool.h"
 #include "fimex/TimeUnit.h"
 #include "fimex/TokenizeDotted.h"
+#include "fimex/WorkerPool.h"
 #include "fimex/XMLInputFile.h"
 #include "fimex/coordSys/CoordinateSystem.h"
 #include "fimex/interpolation.h"
@@ -82,6 +85,9 @@ const po::option op_log4cpp = po::option("log4cpp", "log4cpp property file (- =
 const po::option op_print_options = po::option("print-options", "print all options").set_narg(0);
 const po::option op_config = po::option("config", "configuration file").set_shortkey("c").set_composing();
 const po::option op_num_threads = po::option("num_threads", "number of threads").set_shortkey("n");
+const po::option op_thread_affinity = po::option("thread_affinity", "pinning of threads to cores: none, compact or spread (over NUMA nodes)");
+const po::option op_memory_limit = po::option("memory.limit", "throttle parallel work while arrays use more memory, e.g. 4G or 512M");
+const po::option op_memory_pool = po::option("memory.pool", "keep freed large arrays up to this size for reuse, e.g. 512M, default a quarter of memory.limit");
 
 // options for command line and config file
 const po::option op_input_file = po::option("input.file", "input file");
@@ -122,6 +128,8 @@ const po::option op_process_rotateVector_all = po::option("process.rotateVector.
         "rotate all known vectors (e.g. standard_name) to given direction").set_narg(0);
 const po::option op_process_addVerticalVelocity = po::option("process.addVerticalVelocity",
         "calculate upward_air_velocity_ml");
+const po::option op_process_cachePacking = po::option("process.cachePacking",
+        "store slices cached for accumulation as 'none', 'int16' or 'fp16', the latter lose precision");
 const po::option op_process_printNcML = po::option("process.printNcML",
         "print NcML description of process").set_implicit_value("-");
 const po::option op_process_printCS = po::option("process.printCS", "print CoordinateSystems of process").set_narg(0);
@@ -164,8 +172,8 @@ const po::option op_interpolate_yAxisType = po::option("interpolate.yAxisType",
 const po::option op_interpolate_distanceOfInterest = po::option("interpolate.distanceOfInterest", "optional distance of interest used differently depending on method");
 const po::option op_interpolate_latitudeName = po::option("interpolate.latitudeName", "name for auto-generated projection coordinate latitude");
 const po::option op_interpolate_longitudeName = po::option("interpolate.longitudeName", "name for auto-generated projection coordinate longitude");
-const po::option op_interpolate_preprocess = po::option("interpolate.preprocess", "add a 2d preprocess before the interpolation, e.g. \"fill2d(critx=0.01,cor=1.6,maxLoop=100)\" or \"creepfill2d(repeat=20,weight=2[,defaultValue=0.0])\"");
-const po::option op_interpolate_postprocess = po::option("interpolate.postprocess", "add a 2d postprocess after the interpolation, e.g. \"fill2d(critx=0.01,cor=1.6,maxLoop=100)\" or \"creepfill2d(repeat=20,weight=2[,defaultValue=0.0])\"");
+const po::option op_interpolate_preprocess = po::option("interpolate.preprocess", "add a 2d preprocess before the interpolation, e.g. \"fill2d(critx=0.01,cor=1.6,maxLoop=100)\" or \"creepfill2d(repeat=20,weight=2[,defaultValue=0.0])\"; fill2d_redblack and fill2d_multigrid, or creepfill2d_tiled, run in parallel");
+const po::option op_interpolate_postprocess = po::option("interpolate.postprocess", "add a 2d postprocess after the interpolation, e.g. \"fill2d(critx=0.01,cor=1.6,maxLoop=100)\" or \"creepfill2d(repeat=20,weight=2[,defaultValue=0.0])\"; fill2d_redblack and fill2d_multigrid, or creepfill2d_tiled, run in parallel");
 const po::option op_interpolate_latitudeValues = po::option("interpolate.latitudeValues",
         "latitude values, in degrees north, of a list of points to interpolate to, e.g. 60.5,70,90"
         " (use with 'longitudeValues' -- to produce a grid, use 'projString', 'xAxisValues', 'yAxisValues', ...)");
@@ -175,6 +183,10 @@ const po::option op_interpolate_longitudeValues = po::option("interpolate.longit
 const po::option op_interpolate_vcrossNames = po::option("interpolate.vcrossNames", "string with comma-separated names for vertical cross sections");
 const po::option op_interpolate_vcrossNoPoints = po::option("interpolate.vcrossNoPoints", "string with comma-separated number of lat/lon values for each vertical cross sections");
 const po::option op_interpolate_template = po::option("interpolate.template", "netcdf file containing lat/lon list used in interpolation");
+const po::option op_interpolate_cacheDirectory =
+    po::option("interpolate.cacheDirectory", "existing directory to store interpolation positions, reused by later runs with the same grids");
+const po::option op_interpolate_cacheMemory =
+    po::option("interpolate.cacheMemory", "memory to keep interpolation positions for reuse within this run, e.g. 1G, default 256M, 0 disables");
 const po::option op_interpolate_printNcML = po::option("interpolate.printNcML", "print NcML description of extractor").set_implicit_value("-");
 const po::option op_interpolate_printCS = po::option("interpolate.printCS", "print CoordinateSystems of interpolator").set_narg(0);
 const po::option op_interpolate_printSize = po::option("interpolate.printSize", "print size estimate").set_narg(0);
@@ -231,13 +243,38 @@ po::option_set config_file_options;
 
 CDMReader_p applyFimexStreamTasks(const po::value_set& vm, CDMReader_p dataReader);
 
+/**
+ * Parse a size in bytes with an optional suffix k, M or G (powers of 1024).
+ */
+bool parseMemorySize(const std::string& text, size_t& bytes)
+{
+    static const std::regex re("\\s*(\\d+(\\.\\d*)?)\\s*([kKmMgG]?)[bB]?\\s*");
+    std::smatch m;
+    if (!std::regex_match(text, m, re))
+        return false;
+    double value = string2type<double>(m.str(1));
+    const std::string unit = m.str(3);
+    switch (unit.empty() ? 0 : std::tolower(unit[0])) {
+    case 'g':
+        value *= 1024;
+        // fall through
+    case 'm':
+        value *= 1024;
+        // fall through
+    case 'k':
+        value *= 1024;
+    }
+    bytes = static_cast<size_t>(value);
+    return true;
+}
+
 void writeUsage(ostream& out, const po::option_set& config)
 {
     out << "usage: fimex --input.file  FILENAME [--input.type  INPUT_TYPE]" << endl;
     out << "             [--output.file FILENAME | --output.fillFile [--output.type OUTPUT_TYPE]]" << endl;
     out << "             [--input.config CFGFILENAME] [--output.config CFGFILENAME]" << endl;
     out << "             [--input.optional OPT1 --input.optional OPT2 ...]" << endl;
-    out << "             [--num_threads ...]" << endl;
+    out << "             [--num_threads ...] [--thread_affinity none|compact|spread] [--memory.limit SIZE] [--memory.pool SIZE]" << endl;
     out << "             [--process....]" << endl;
     out << "             [--qualityExtract....]" << endl;
     out << "             [--extract....]" << endl;
@@ -467,6 +504,19 @@ CDMReader_p getCDMProcessor(const po::value_set& vm, CDMReader_p dataReader)
     if (vm.is_set(op_process_addVerticalVelocity)) {
         processor->addVerticalVelocity();
     }
+    if (vm.is_set(op_process_cachePacking)) {
+        const string& packing = vm.value(op_process_cachePacking);
+        if (packing == "none") {
+            processor->setCachePacking(DATA_PACKING_NONE);
+        } else if (packing == "int16") {
+            processor->setCachePacking(DATA_PACKING_INT16);
+        } else if (packing == "fp16") {
+            processor->setCachePacking(DATA_PACKING_FP16);
+        } else {
+            LOG4FIMEX(logger, Logger::FATAL, "process.cachePacking != 'none', 'int16' or 'fp16' : " << packing << " invalid");
+            exit(1);
+        }
+    }
     return processor;
 }
 
@@ -657,27 +707,36 @@ CDMReader_p getCDMVerticalInterpolator(const po::value_set& vm, CDMReader_p data
 std::shared_ptr<InterpolatorProcess2d> parseProcess(const string& procString, const string& logProcess)
 {
     std::smatch what;
-    if (std::regex_match(procString, what, std::regex("\\s*fill2d\\(([^, ]+), *([^, ]+), *([^ )]+)\\).*"))) {
-        double critx = string2type<double>(what[1]);
-        double cor = string2type<double>(what[2]);
-        size_t maxLoop = string2type<size_t>(what[3]);
-        LOG4FIMEX(logger, Logger::DEBUG, "running interpolate " << logProcess << ": fill2d(" << critx << "," << cor << "," << maxLoop << ")");
-        return std::make_shared<InterpolatorFill2d>(critx, cor, maxLoop);
-    } else if (std::regex_match(procString, what, std::regex("\\s*creepfill2d\\((.+)\\).*"))) {
-        vector<string> vals = tokenize(what[1], ",");
+    if (std::regex_match(procString, what, std::regex("\\s*fill2d(_redblack|_multigrid)?\\(([^, ]+), *([^, ]+), *([^ )]+)\\).*"))) {
+        const string variant = what[1];
+        double critx = string2type<double>(what[2]);
+        double cor = string2type<double>(what[3]);
+        size_t maxLoop = string2type<size_t>(what[4]);
+        InterpolatorFill2d::Method method = InterpolatorFill2d::FILL2D_SERIAL;
+        if (variant == "_redblack")
+            method = InterpolatorFill2d::FILL2D_REDBLACK;
+        else if (variant == "_multigrid")
+            method = InterpolatorFill2d::FILL2D_MULTIGRID;
+        LOG4FIMEX(logger, Logger::DEBUG, "running interpolate " << logProcess << ": fill2d" << variant << "(" << critx << "," << cor << "," << maxLoop << ")");
+        return std::make_shared<InterpolatorFill2d>(critx, cor, maxLoop, method);
+    } else if (std::regex_match(procString, what, std::regex("\\s*creepfill2d(_tiled)?\\((.+)\\).*"))) {
+        const bool tiled = what[1].matched;
+        const char* variant = tiled ? "_tiled" : "";
+        vector<string> vals = tokenize(what[2], ",");
         if (vals.size() == 2) {
             unsigned short repeat = string2type<unsigned short>(vals.at(0));
             char setWeight = string2type<char>(vals.at(1));
-            LOG4FIMEX(logger, Logger::DEBUG, "running interpolate " << logProcess << ": creepfill2d(" << repeat << "," << setWeight << ")");
-            return std::make_shared<InterpolatorCreepFill2d>(repeat, setWeight);
+            LOG4FIMEX(logger, Logger::DEBUG, "running interpolate " << logProcess << ": creepfill2d" << variant << "(" << repeat << "," << setWeight << ")");
+            return std::make_shared<InterpolatorCreepFill2d>(repeat, setWeight, tiled);
         } else if (vals.size() == 3) {
             unsigned short repeat = string2type<unsigned short>(vals.at(0));
             char setWeight = string2type<char>(vals.at(1));
             float defVal = string2type<float>(vals.at(2));
-            LOG4FIMEX(logger, Logger::DEBUG, "running interpolate " << logProcess << ": creepfillval2d(" << repeat << "," << setWeight << "," << defVal << ")");
-            return std::make_shared<InterpolatorCreepFillVal2d>(repeat, setWeight, defVal);
+            LOG4FIMEX(logger, Logger::DEBUG,
+                      "running interpolate " << logProcess << ": creepfillval2d" << variant << "(" << repeat << "," << setWeight << "," << defVal << ")");
+            return std::make_shared<InterpolatorCreepFillVal2d>(repeat, setWeight, defVal, tiled);
         } else {
-            throw CDMException("creepfill requires two or three arguments, got " + what[1].str());
+            throw CDMException("creepfill requires two or three arguments, got " + what[2].str());
         }
      }
      throw CDMException("undefined interpolate."+logProcess+": " + procString);
@@ -921,6 +980,7 @@ int run(int argc, char* args[])
         << op_process_rotateVector_stdNameY
         << op_process_rotateVector_all
         << op_process_addVerticalVelocity
+        << op_process_cachePacking
         << op_process_printNcML
         << op_process_printCS
         << op_process_printSize
@@ -967,6 +1027,8 @@ int run(int argc, char* args[])
         << op_interpolate_vcrossNames
         << op_interpolate_vcrossNoPoints
         << op_interpolate_template
+        << op_interpolate_cacheDirectory
+        << op_interpolate_cacheMemory
         << op_interpolate_printNcML
         << op_interpolate_printCS
         << op_interpolate_printSize
@@ -1026,6 +1088,9 @@ int run(int argc, char* args[])
         << op_print_options
         << op_config
         << op_num_threads
+        << op_thread_affinity
+        << op_memory_limit
+        << op_memory_pool
         ;
 
     std::vector<std::string> positional;
@@ -1072,6 +1137,49 @@ int run(int argc, char* args[])
     if (vm.is_set(op_num_threads))
         num_threads = string2type<int>(vm.value(op_num_threads));
     mifi_setNumThreads(num_threads);
+    if (vm.is_set(op_thread_affinity)) {
+        const std::string affinity = vm.value(op_thread_affinity);
+        if (affinity == "compact") {
+            WorkerPool::shared().setAffinity(WorkerPool::AFFINITY_COMPACT);
+        } else if (affinity == "spread") {
+            WorkerPool::shared().setAffinity(WorkerPool::AFFINITY_SPREAD);
+        } else if (affinity != "none") {
+            LOG4FIMEX(logger, Logger::FATAL, "unknown thread_affinity '" << affinity << "'");
+            return 1;
+        }
+    }
+
+    if (vm.is_set(op_memory_limit)) {
+        const std::string limit = vm.value(op_memory_limit);
+        size_t bytes = 0;
+        if (!parseMemorySize(limit, bytes)) {
+            LOG4FIMEX(logger, Logger::FATAL, "invalid memory.limit '" << limit << "'");
+            return 1;
+        }
+        MemoryBudget::setLimit(bytes);
+    }
+    if (vm.is_set(op_memory_pool)) {
+        const std::string pool = vm.value(op_memory_pool);
+        size_t bytes = 0;
+        if (!parseMemorySize(pool, bytes)) {
+            LOG4FIMEX(logger, Logger::FATAL, "invalid memory.pool '" << pool << "'");
+            return 1;
+        }
+        BufferPool::setMaxCachedBytes(bytes);
+    }
+    if (vm.is_set(op_interpolate_cacheDirectory)) {
+        // process-wide, also for the interpolators created by merge
+        CDMInterpolator::setCacheDirectory(vm.value(op_interpolate_cacheDirectory));
+    }
+    if (vm.is_set(op_interpolate_cacheMemory)) {
+        const std::string cacheMemory = vm.value(op_interpolate_cacheMemory);
+        size_t bytes = 0;
+        if (!parseMemorySize(cacheMemory, bytes)) {
+            LOG4FIMEX(logger, Logger::FATAL, "invalid interpolate.cacheMemory '" << cacheMemory << "'");
+            return 1;
+        }
+        CDMInterpolator::setCacheMemoryLimit(bytes);
+    }
 
     if (vm.is_set(op_print_options)) {
         cmdline_options.dump(cout, vm);
@@ -1094,6 +1202,8 @@ int run(int argc, char* args[])
     dataReader = applyFimexStreamTasks(vm, dataReader);
     fillWriteCDM(dataReader, vm);
     writeCDM(dataReader, vm);
+    BufferPool::logStatistics();
+    MemoryBudget::logStatistics();
 
     return 0;
 }
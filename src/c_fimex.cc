@@ -39,15 +39,23 @@
 #include "fimex/Logger.h"
 #include "fimex/NcmlCDMReader.h"
 #include "fimex/Null_CDMWriter.h"
+#include "fimex/MathUtils.h"
+#include "fimex/SliceBuilder.h"
 #include "fimex/TimeUnit.h"
+#include "fimex/Units.h"
+#include "fimex/UnitsConverter.h"
 #include "fimex/XMLInputFile.h"
 #include "fimex/mifi_cdm_reader.h"
 #include "fimex/mifi_constants.h"
 
+#include "DataImpl.h"
+
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
+#include <numeric>
 #include <vector>
 
 using namespace MetNoFimex;
@@ -432,22 +440,56 @@ int mifi_slicebuilder_set_dim_start_size(mifi_slicebuilder* sb, const char* dimN
 
 
 
+/**
+ * Read the values of sb with CDMReader::readInto directly into data and scale them in place,
+ * as CDMReader::getScaledDataSliceInUnit, but without intermediate Data.
+ *
+ * @param unit the unit of the values, empty for the unit of the variable
+ * @return the number of values read
+ */
+static size_t readScaledInto(CDMReader& reader, const std::string& varName, const SliceBuilder& sb, const std::string& unit, double* data)
+{
+    const size_t size = reader.readInto(varName, sb, CDM_DOUBLE, data);
+    const CDM& cdm = reader.getCDM();
+    UnitsConverter_p uc;
+    if (!unit.empty())
+        uc = Units().getConverter(cdm.getUnits(varName), unit);
+    // the fill value as stored in the datatype of the variable, as compared by Data::convertDataType
+    double fill = cdm.getFillValue(varName);
+    if (cdm.getVariable(varName).getDataType() == CDM_FLOAT)
+        fill = static_cast<float>(fill);
+    // in place, with the kernels of Data::convertDataType
+    convertArrayInto(data, size, data, fill, cdm.getScaleFactor(varName), cdm.getAddOffset(varName), uc, MIFI_UNDEFINED_D, 1, 0);
+    return size;
+}
+
 int mifi_get_double_dataslice(mifi_cdm_reader* reader, const char* varName, size_t unLimDimPos, double** data, size_t* size)
 {
+    *data = 0;
     try {
-        DataPtr vData = reader->reader_->getScaledDataSlice(varName, unLimDimPos);
-        *size = vData->size();
-        *data = (double*) malloc(*size * sizeof(double));
+        const CDM& cdm = reader->reader_->getCDM();
+        SliceBuilder sb(cdm, varName);
+        if (const CDMDimension* unlimDim = cdm.getUnlimitedDim()) {
+            if (cdm.hasUnlimitedDim(cdm.getVariable(varName)))
+                sb.setStartAndSize(unlimDim->getName(), unLimDimPos, 1);
+        }
+        const vector<size_t>& dimSizes = sb.getDimensionSizes();
+        const size_t sbSize = std::accumulate(dimSizes.begin(), dimSizes.end(), size_t(1), std::multiplies<size_t>());
+        *data = (double*) malloc(std::max(sbSize, size_t(1)) * sizeof(double));
         if (*data == 0) {
             LOG4FIMEX(logger, Logger::WARN, "error in mifi_get_double_dataslize: Cannot allocate data");
             *size = 0;
             return -1;
         }
-        auto vArray = vData->asDouble();
-        copy(&vArray[0], &vArray[*size], *data);
+        *size = readScaledInto(*reader->reader_, varName, sb, "", *data);
         return 0;
     } catch (exception& ex) {
         LOG4FIMEX(logger, Logger::WARN, "error in mifi_get_double_dataslize: " << ex.what());
+        if (*data != 0) {
+            free(*data);
+            *data = 0;
+        }
+        *size = 0;
     }
     return -1;
 }
@@ -480,16 +522,7 @@ int mifi_fill_scaled_double_dataslice(mifi_cdm_reader* reader, const char* varNa
         return -1;
     }
     try {
-        DataPtr vData;
-        string unitStr(units);
-        if (unitStr != "") {
-            vData = reader->reader_->getScaledDataSliceInUnit(varName, unitStr, *(sb->sb_));
-        } else {
-            vData = reader->reader_->getScaledDataSlice(varName, *(sb->sb_));
-        }
-        *size = vData->size();
-        auto vArray = vData->asDouble();
-        copy(&vArray[0], &vArray[*size], data);
+        *size = readScaledInto(*reader->reader_, varName, *(sb->sb_), units, data);
         return 0;
     } catch (exception& ex) {
         LOG4FIMEX(logger, Logger::WARN, "error in mifi_fill_scaled_double_dataslice: " << ex.what());
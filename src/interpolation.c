@@ -1071,6 +1071,16 @@ size_t mifi_bad2nanf(float* posPtr, float* endPtr, float badVal) {
     return 0;
 }
 
+size_t mifi_bad2nand(double* posPtr, double* endPtr, double badVal) {
+    if (!isnan(badVal)) {
+        while (posPtr != endPtr) {
+            *posPtr = (*posPtr == badVal) ? MIFI_UNDEFINED_D : *posPtr;
+            posPtr++;
+        }
+    }
+    return 0;
+}
+
 size_t mifi_nanf2bad(float* posPtr, float* endPtr, float badVal) {
     if (!isnan(badVal)) {
         while (posPtr != endPtr) {
@@ -657,6 +657,11 @@ void FeltCDMReader2::initAddVariablesFromXML(const XMLDoc& doc, const string& pr
     }
 }
 
+bool FeltCDMReader2::supportsConcurrentReading() const
+{
+    return true; // reading the felt file is serialized by mutex_
+}
+
 DataPtr FeltCDMReader2::getDataSlice(const string& varName, size_t unLimDimPos)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "reading var: " << varName << " slice: " << unLimDimPos);
@@ -66,6 +66,7 @@ public:
 
     using CDMReader::getDataSlice;
     virtual DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos);
+    bool supportsConcurrentReading() const override;
 
 private:
     const std::string filename;
@@ -30,6 +30,7 @@
 #include "fimex/CoordinateSystemSliceBuilder.h"
 #include "fimex/Data.h"
 #include "fimex/Logger.h"
+#include "fimex/MemoryBudget.h"
 #include "fimex/String2Type.h"
 #include "fimex/StringUtils.h"
 #include "fimex/TimeUnit.h"
@@ -48,7 +49,9 @@
 #include <cerrno>
 #include <cmath>
 #include <cstring>
+#include <deque>
 #include <functional>
+#include <future>
 
 namespace MetNoFimex {
 
@@ -87,6 +90,7 @@ GribApiCDMWriter_ImplAbstract::GribApiCDMWriter_ImplAbstract(int gribVersion, CD
     , configFile(configFile)
     , xmlConfig(new XMLDoc(configFile))
     , omitEmptyFields(true)
+    , readAhead(0)
 {
     {
         std::string templXPath("/cdm_gribwriter_config/template_file");
@@ -154,6 +158,19 @@ GribApiCDMWriter_ImplAbstract::GribApiCDMWriter_ImplAbstract(int gribVersion, CD
                 LOG4FIMEX(logger, Logger::WARN, "ignoring unknown value '" << omitEmpty << "' for processing option 'omitEmptyFields'");
         }
     }
+    {
+        std::string templXPath("/cdm_gribwriter_config/processing_options/readAhead");
+        xmlXPathObject_p xPObj = xmlConfig->getXPathObject(templXPath);
+        xmlNodeSetPtr nodes = xPObj->nodesetval;
+        int size = (nodes) ? nodes->nodeNr : 0;
+        if (size > 0) {
+            readAhead = string2type<size_t>(getXmlContent(nodes->nodeTab[0]));
+        }
+    }
+    if (readAhead > 0 && !cdmReader->supportsConcurrentReading()) {
+        LOG4FIMEX(logger, Logger::INFO, "reader does not support concurrent reading, ignoring readAhead");
+        readAhead = 0;
+    }
 }
 
 GribApiCDMWriter_ImplAbstract::~GribApiCDMWriter_ImplAbstract() {}
@@ -298,37 +315,66 @@ void GribApiCDMWriter_ImplAbstract::run()
                     if (vTimes.size() > 1) {
                         sb.setTimeStartAndSize(vtPos, 1);
                     }
-                    for (vector<string>::iterator var = csVars.begin(); var != csVars.end(); ++var) {
-                        setTime(*var, rTime, *vTime, stepUnit);
-                        for (size_t levelPos = 0; levelPos < levels.size(); ++levelPos) {
-                            if (zAxis.get() != 0) {
-                                sb.setStartAndSize(zAxis, levelPos, 1);
-                            }
-                            double levelVal = levels.at(levelPos);
-                            try {
-                                // level and var are dependent due to splitting possibilities
-                                setLevel(*var, levelVal);
-                                setParameter(*var, levelVal);
-                                DataPtr data = cdmReader->getDataSlice(*var, sb);
-                                if (data->size() != 0) {
-                                    auto da = data->asDouble();
-                                    bool writeData = true;
-                                    if (omitEmptyFields) {
-                                        const size_t countMissing = count(&da[0], &da[0] + data->size(), cdm.getFillValue(*var));
-                                        writeData = (countMissing < data->size());
+                    // all slices of this time, in the order of writing
+                    vector<pair<size_t, SliceBuilder>> slices;
+                    for (size_t levelPos = 0; levelPos < levels.size(); ++levelPos) {
+                        if (zAxis.get() != 0) {
+                            sb.setStartAndSize(zAxis, levelPos, 1);
+                        }
+                        slices.push_back(make_pair(levelPos, SliceBuilder(sb)));
+                    }
+                    deque<future<DataPtr>> inFlight;
+                    size_t nextRead = 0;
+                    try {
+                        for (vector<string>::iterator var = csVars.begin(); var != csVars.end(); ++var) {
+                            setTime(*var, rTime, *vTime, stepUnit);
+                            const size_t varPos = var - csVars.begin();
+                            for (const auto& levelSlice : slices) {
+                                const size_t levelPos = levelSlice.first;
+                                const size_t readPos = varPos * slices.size() + levelPos;
+                                // read up to readAhead slices beyond the current one, requests must be consumed in order,
+                                // only the current one while memory is short
+                                for (; readAhead > 0 && nextRead < csVars.size() * slices.size() && nextRead <= readPos + readAhead &&
+                                       (nextRead <= readPos || !MemoryBudget::exceeded());
+                                     ++nextRead) {
+                                    inFlight.push_back(cdmReader->getDataSliceAsync(csVars.at(nextRead / slices.size()), slices.at(nextRead % slices.size()).second));
+                                }
+                                double levelVal = levels.at(levelPos);
+                                try {
+                                    future<DataPtr> request;
+                                    if (readAhead > 0) {
+                                        request = std::move(inFlight.front());
+                                        inFlight.pop_front();
                                     }
-                                    if (writeData) {
-                                        data = handleTypeScaleAndMissingData(*var, levelVal, data);
-                                        setData(data);
-                                        writeGribHandleToFile();
-                                    } else {
-                                        LOG4FIMEX(logger, Logger::DEBUG, "all vals invalid, dropping " << *var << " level " << levelVal << " time " << *vTime);
+                                    // level and var are dependent due to splitting possibilities
+                                    setLevel(*var, levelVal);
+                                    setParameter(*var, levelVal);
+                                    DataPtr data = (readAhead > 0) ? request.get() : cdmReader->getDataSlice(*var, levelSlice.second);
+                                    if (data->size() != 0) {
+                                        auto da = data->asDouble();
+                                        bool writeData = true;
+                                        if (omitEmptyFields) {
+                                            const size_t countMissing = count(&da[0], &da[0] + data->size(), cdm.getFillValue(*var));
+                                            writeData = (countMissing < data->size());
+                                        }
+                                        if (writeData) {
+                                            data = handleTypeScaleAndMissingData(*var, levelVal, data);
+                                            setData(data);
+                                            writeGribHandleToFile();
+                                        } else {
+                                            LOG4FIMEX(logger, Logger::DEBUG, "all vals invalid, dropping " << *var << " level " << levelVal << " time " << *vTime);
+                                        }
                                     }
+                                } catch (CDMException& ex) {
+                                    variableWarnings[*var] = ex.what();
                                 }
-                            } catch (CDMException& ex) {
-                                variableWarnings[*var] = ex.what();
                             }
                         }
+                    } catch (...) {
+                        // do not leave requests reading from cdmReader running after errors
+                        for (future<DataPtr>& f : inFlight)
+                            f.wait();
+                        throw;
                     }
                 }
             }
@@ -118,6 +118,8 @@ protected:
     const std::string configFile;
     const XMLDoc_p xmlConfig;
     bool omitEmptyFields;
+    /** number of slices read beyond the one being written, 0 reads synchronously, as for readers not supporting concurrent reading */
+    size_t readAhead;
     std::shared_ptr<grib_handle> gribHandle;
 
 private:
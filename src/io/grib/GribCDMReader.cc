@@ -1292,18 +1292,8 @@ vector<size_t> createVector(size_t id, const vector<size_t>& dimStart, const vec
     return retVal;
 }
 
-DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& sb)
+vector<GribFileMessage> GribCDMReader::getSliceMessages(const string& varName, const SliceBuilder& sb) const
 {
-    LOG4FIMEX(logger, Logger::DEBUG, "fetching slicebuilder for variable " << varName);
-    const CDMVariable& variable = cdm_->getVariable(varName);
-
-    if (variable.getDataType() == CDM_NAT) {
-        return createData(CDM_INT, 0); // empty
-    }
-
-    if (DataPtr mem = getDataSliceFromMemory(variable, sb))
-        return mem;
-
     // map<string, map<size_t, map<long, map<size_t, size_t> > > > varTimeLevelEnsembleGFIBox;
     const auto gmIt = p_->varTimeLevelEnsembleGFIBox.find(varName);
     if (gmIt == p_->varTimeLevelEnsembleGFIBox.end()) {
@@ -1316,11 +1306,9 @@ DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& s
     assert(dimNames.at(0) != p_->timeDimName);
     const vector<size_t>& dimSizes = sb.getDimensionSizes();
     const vector<size_t>& dimStart = sb.getDimensionStartPositions();
-    const vector<size_t>& maxSizes = sb.getMaxDimensionSizes();
 
     // x/y = dimNames/Size 0,1
-    const size_t xySliceSize = dimSizes.at(0) * dimSizes.at(1);
-    size_t sliceSize = xySliceSize;
+    size_t sliceSize = dimSizes.at(0) * dimSizes.at(1);
     size_t levelId = std::numeric_limits<size_t>::max();    // undefined
     size_t timeId = std::numeric_limits<size_t>::max();     // undefined
     size_t ensembleId = std::numeric_limits<size_t>::max(); // undefined
@@ -1376,24 +1364,20 @@ DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& s
             }
         }
     }
+    return slices;
+}
 
-    // read data from file
-    if (slices.empty())
-        return createData(variable.getDataType(), 0);
+void GribCDMReader::readSliceMessages(const string& varName, const vector<GribFileMessage>& slices, const SliceBuilder& sb, double missingValue, double* out)
+{
+    const vector<size_t>& dimSizes = sb.getDimensionSizes();
+    const vector<size_t>& dimStart = sb.getDimensionStartPositions();
+    const vector<size_t>& maxSizes = sb.getMaxDimensionSizes();
 
+    const size_t xySliceSize = dimSizes.at(0) * dimSizes.at(1);
     const size_t maxXySize = maxSizes.at(0) * maxSizes.at(1);
 
-    // storage for complete data
-    auto doubleArray = make_shared_array<double>(sliceSize);
     // prefill with missing values
-
-    double missingValue = cdm_->getFillValue(varName);
-    if (p_->varPrecision.find(varName) != p_->varPrecision.end()) {
-        // varPrecision used, use default missing
-        missingValue = MIFI_FILL_DOUBLE;
-    }
-    fill(&doubleArray[0], &doubleArray[sliceSize], missingValue);
-    DataPtr data = createData(sliceSize, doubleArray);
+    fill(out, out + slices.size() * xySliceSize, missingValue);
     size_t dataCurrentPos = 0;
 
     const bool xyslice = (maxXySize != xySliceSize);
@@ -1414,7 +1398,7 @@ DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& s
     for (const auto& gfm : slices) {
         // join the data of the different levels
         if (gfm.isValid()) {
-            double* data_out = &doubleArray[dataCurrentPos];
+            double* data_out = out + dataCurrentPos;
             double* grib_out = xyslice ? full_data_array.get() : data_out;
             LOG4FIMEX(logger, Logger::DEBUG,
                       "start reading variable " << gfm.getShortName() << ", level " << gfm.getLevelNumber() << ", store at " << dataCurrentPos);
@@ -1439,6 +1423,38 @@ DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& s
         }
         dataCurrentPos += xySliceSize; // always forward a complete slice
     }
+}
+
+DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& sb)
+{
+    LOG4FIMEX(logger, Logger::DEBUG, "fetching slicebuilder for variable " << varName);
+    const CDMVariable& variable = cdm_->getVariable(varName);
+
+    if (variable.getDataType() == CDM_NAT) {
+        return createData(CDM_INT, 0); // empty
+    }
+
+    if (DataPtr mem = getDataSliceFromMemory(variable, sb))
+        return mem;
+
+    const vector<GribFileMessage> slices = getSliceMessages(varName, sb);
+
+    // read data from file
+    if (slices.empty())
+        return createData(variable.getDataType(), 0);
+
+    // storage for complete data
+    const size_t sliceSize = slices.size() * sb.getDimensionSizes().at(0) * sb.getDimensionSizes().at(1);
+    auto doubleArray = make_shared_array<double>(sliceSize);
+
+    double missingValue = cdm_->getFillValue(varName);
+    if (p_->varPrecision.find(varName) != p_->varPrecision.end()) {
+        // varPrecision used, use default missing
+        missingValue = MIFI_FILL_DOUBLE;
+    }
+    readSliceMessages(varName, slices, sb, missingValue, doubleArray.get());
+    DataPtr data = createData(sliceSize, doubleArray);
+
     std::map<string, std::pair<double, double>>::const_iterator it = p_->varPrecision.find(varName);
     if (it != p_->varPrecision.end()) {
         const double scale = it->second.first;
@@ -1456,6 +1472,24 @@ DataPtr GribCDMReader::getDataSlice(const string& varName, const SliceBuilder& s
     return data;
 }
 
+size_t GribCDMReader::readInto(const string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst)
+{
+    const CDMVariable& variable = cdm_->getVariable(varName);
+
+    // grib values are decoded as double, only plain double-reads can go directly to dst
+    if (dataType != CDM_DOUBLE || variable.getDataType() == CDM_NAT || variable.hasData() || p_->varPrecision.find(varName) != p_->varPrecision.end()) {
+        return CDMReader::readInto(varName, sb, dataType, dst);
+    }
+
+    LOG4FIMEX(logger, Logger::DEBUG, "reading slicebuilder for variable " << varName << " into buffer");
+    const vector<GribFileMessage> slices = getSliceMessages(varName, sb);
+    if (slices.empty())
+        return 0;
+
+    readSliceMessages(varName, slices, sb, cdm_->getFillValue(varName), reinterpret_cast<double*>(dst));
+    return slices.size() * sb.getDimensionSizes().at(0) * sb.getDimensionSizes().at(1);
+}
+
 DataPtr GribCDMReader::getDataSlice(const string& varName, size_t unLimDimPos)
 {
     LOG4FIMEX(logger, Logger::DEBUG, "fetching unlim-slice " << unLimDimPos << " for variable " << varName);
@@ -64,6 +64,7 @@ public:
     ~GribCDMReader();
     DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos) override;
     DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override;
+    size_t readInto(const std::string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst) override;
 
     /**
      * Read a initialized cdmGribReader xml-document
@@ -122,6 +123,16 @@ private:
 
     size_t getVariableMaxEnsembles(const std::string& varName) const;
 
+    /**
+     * find the messages of all xy-layers of a slice, missing layers are invalid messages
+     */
+    std::vector<GribFileMessage> getSliceMessages(const std::string& varName, const SliceBuilder& sb) const;
+    /**
+     * decode the messages of getSliceMessages() to out, one xy-layer per message
+     * @param out array of at least slices.size() xy-layers of sb
+     */
+    void readSliceMessages(const std::string& varName, const std::vector<GribFileMessage>& slices, const SliceBuilder& sb, double missingValue, double* out);
+
     void initAddTimeDimension();
     void initAddGlobalAttributes();
     void initCreateGFIBoxes();
@@ -36,6 +36,8 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <functional>
+#include <numeric>
 
 namespace MetNoFimex {
 
@@ -170,7 +172,7 @@ DataPtr NetCDF_CDMReader::getDataSlice(const std::string& varName, const SliceBu
 {
     const CDMVariable& var = cdm_->getVariable(varName);
     if (var.hasData()) {
-        return var.getData()->slice(sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
+        return createDataView(var.getData(), sb.getMaxDimensionSizes(), sb.getDimensionStartPositions(), sb.getDimensionSizes());
     }
 
     ncFile->reopen_if_forked();
@@ -197,6 +199,50 @@ DataPtr NetCDF_CDMReader::getDataSlice(const std::string& varName, const SliceBu
     return ncGetValues(ncFile->ncId, varid, dtype, static_cast<size_t>(dimLen), &start[0], &count[0]);
 }
 
+bool NetCDF_CDMReader::supportsConcurrentReading() const
+{
+    return true; // all netcdf calls are serialized by Nc::getMutex()
+}
+
+size_t NetCDF_CDMReader::readInto(const std::string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst)
+{
+    const CDMVariable& var = cdm_->getVariable(varName);
+    if (var.hasData()) {
+        return CDMReader::readInto(varName, sb, dataType, dst);
+    }
+
+    ncFile->reopen_if_forked();
+
+    int varid, dimLen;
+    nc_type dtype;
+    {
+        OmpScopedLock lock(Nc::getMutex());
+        ncCheck(nc_inq_varid(ncFile->ncId, var.getName().c_str(), &varid));
+        ncCheck(nc_inq_vartype(ncFile->ncId, varid, &dtype));
+        ncCheck(nc_inq_varndims(ncFile->ncId, varid, &dimLen));
+    }
+
+    const vector<size_t> start(sb.getDimensionStartPositions().rbegin(), sb.getDimensionStartPositions().rend());
+    assert(start.size() == static_cast<size_t>(dimLen));
+
+    const vector<size_t> count(sb.getDimensionSizes().rbegin(), sb.getDimensionSizes().rend());
+    assert(count.size() == static_cast<size_t>(dimLen));
+
+    LOG4FIMEX(logger, Logger::DEBUG,
+              "ncGetValuesInto SB for " << varName << ": (" << join(start.begin(), start.end()) << ") size (" << join(count.begin(), count.end()) << ")");
+
+    bool done;
+    {
+        OmpScopedLock lock(Nc::getMutex());
+        done = ncGetValuesInto(ncFile->ncId, varid, dtype, dataType, static_cast<size_t>(dimLen), start.data(), count.data(), dst);
+    }
+    if (!done) {
+        // conversion not supported by netcdf
+        return CDMReader::readInto(varName, sb, dataType, dst);
+    }
+    return std::accumulate(count.begin(), count.end(), size_t(1), std::multiplies<size_t>());
+}
+
 void NetCDF_CDMReader::sync()
 {
     OmpScopedLock lock(Nc::getMutex());
@@ -53,6 +53,8 @@ public:
     ~NetCDF_CDMReader();
     DataPtr getDataSlice(const std::string& varName, size_t unLimDimPos) override;
     DataPtr getDataSlice(const std::string& varName, const SliceBuilder& sb) override;
+    size_t readInto(const std::string& varName, const SliceBuilder& sb, CDMDataType dataType, void* dst) override;
+    bool supportsConcurrentReading() const override;
     void sync() override;
     void putDataSlice(const std::string& varName, size_t unLimDimPos, const DataPtr data) override;
     void putDataSlice(const std::string& varName, const SliceBuilder& sb, const DataPtr data) override;
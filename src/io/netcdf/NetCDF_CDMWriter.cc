@@ -27,20 +27,27 @@
 #include "fimex/Data.h"
 #include "fimex/Logger.h"
 #include "fimex/MathUtils.h"
+#include "fimex/MemoryBudget.h"
 #include "fimex/NcmlCDMReader.h"
+#include "fimex/SliceBuilder.h"
 #include "fimex/String2Type.h"
 #include "fimex/StringUtils.h"
+#include "fimex/Type2String.h"
 #include "fimex/Units.h"
 #include "fimex/UnitsException.h"
+#include "fimex/WorkerPool.h"
 #include "fimex/XMLDoc.h"
 #include "fimex/XMLInputFile.h"
 #include "fimex/mifi_constants.h"
 
 #include "NetCDF_Utils.h"
 
+#include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <numeric>
+#include <vector>
 
 #include <libxml/tree.h>
 #include <libxml/xpath.h>
@@ -51,6 +58,19 @@ namespace {
 
 Logger_p logger = getLogger("fimex.NetCDF_CDMWriter");
 
+/// a variable slice to write in one unlimited step
+struct WriteSlice
+{
+    size_t vi;
+    int varId;
+    int n_dims;
+    std::vector<size_t> start;
+    std::vector<size_t> count;
+    int unLimDimIdx;
+    bool no_unlim;
+    bool with_unlim;
+};
+
 int getNcVersion(int version, std::unique_ptr<XMLDoc>& doc)
 {
     int retVal = NC_CLOBBER;
@@ -116,11 +136,30 @@ void checkDoc(std::unique_ptr<XMLDoc>& doc, const std::string& filename)
 NetCDF_CDMWriter::NetCDF_CDMWriter(CDMReader_p reader, const std::string& outputFile, std::string configFile, int version)
     : CDMWriter(reader, outputFile)
     , ncFile(new Nc())
+    , readAhead(0)
+    , readBatch(0)
 {
     std::unique_ptr<XMLDoc> doc;
     if (!configFile.empty()) {
         doc.reset(new XMLDoc(configFile));
         checkDoc(doc, configFile);
+
+        // number of variables read ahead while writing the current one
+        xmlXPathObject_p xpathObj = doc->getXPathObject("/cdm_ncwriter_config/default[@readAhead]");
+        xmlNodeSetPtr nodes = xpathObj->nodesetval;
+        if (nodes && nodes->nodeNr) {
+            readAhead = string2type<size_t>(getXmlProp(nodes->nodeTab[0], "readAhead"));
+        }
+        // number of variables requested together
+        xpathObj = doc->getXPathObject("/cdm_ncwriter_config/default[@readBatch]");
+        nodes = xpathObj->nodesetval;
+        if (nodes && nodes->nodeNr) {
+            readBatch = string2type<size_t>(getXmlProp(nodes->nodeTab[0], "readBatch"));
+        }
+    }
+    if (readAhead > 0 && !cdmReader->supportsConcurrentReading()) {
+        LOG4FIMEX(logger, Logger::INFO, "reader does not support concurrent reading, ignoring readAhead");
+        readAhead = 0;
     }
     const int ncVersion = getNcVersion(version, doc);
     ncFile->filename = outputFile;
@@ -585,8 +624,64 @@ void NetCDF_CDMWriter::writeAttributes(const NcVarIdMap& ncVarMap)
     }
 }
 
+std::future<DataPtr> NetCDF_CDMWriter::readDataAsync(const std::string& varName, bool complete, long long unLimDimPos)
+{
+    if (complete) {
+        CDMReader_p reader = cdmReader;
+        return WorkerPool::shared().submit([reader, varName]() { return reader->getData(varName); });
+    } else {
+        return cdmReader->getDataSliceAsync(varName, unLimDimPos);
+    }
+}
+
+DataPtr NetCDF_CDMWriter::readData(const CDMVariable& var, bool complete, long long unLimDimPos)
+{
+    const std::string& varName = var.getName();
+    const CDMDataType dataType = var.getDataType();
+    if (dataType == CDM_NAT || dataType == CDM_STRING || dataType == CDM_STRINGS || needsConversion(var)) {
+        DataPtr data = complete ? cdmReader->getData(varName) : cdmReader->getDataSlice(varName, unLimDimPos);
+        return data ? convertData(var, data) : data;
+    }
+
+    const CDM& readerCdm = cdmReader->getCDM();
+    SliceBuilder sb(readerCdm, varName);
+    if (!complete) {
+        if (const CDMDimension* unlimDim = readerCdm.getUnlimitedDim()) {
+            if (readerCdm.hasUnlimitedDim(readerCdm.getVariable(varName)))
+                sb.setStartAndSize(unlimDim->getName(), unLimDimPos, 1);
+        }
+    }
+    const std::vector<size_t>& dimSizes = sb.getDimensionSizes();
+    const size_t size = std::accumulate(dimSizes.begin(), dimSizes.end(), size_t(1), std::multiplies<size_t>());
+    DataPtr data = createData(dataType, size);
+    const size_t read = cdmReader->readInto(varName, sb, dataType, data->getDataPtr());
+    if (read == 0)
+        return createData(dataType, 0);
+    if (read != size)
+        throw CDMException("read " + type2string(read) + " values of " + varName + ", expected " + type2string(size));
+    return data;
+}
+
+bool NetCDF_CDMWriter::needsConversion(const CDMVariable& var) const
+{
+    const std::string& varName = var.getName();
+
+    const CDMDataType oldType = var.getDataType();
+    const std::map<std::string, CDMDataType>::const_iterator it = variableTypeChanges.find(varName);
+    const CDMDataType newType = (it != variableTypeChanges.end()) ? it->second : oldType;
+    if (newType == CDM_NAT || oldType == CDM_NAT)
+        return false;
+
+    const CDM& readerCdm = cdmReader->getCDM();
+    return newType != oldType || readerCdm.getUnits(varName) != cdm.getUnits(varName) || readerCdm.getFillValue(varName) != cdm.getFillValue(varName) ||
+           readerCdm.getScaleFactor(varName) != cdm.getScaleFactor(varName) || readerCdm.getAddOffset(varName) != cdm.getAddOffset(varName);
+}
+
 DataPtr NetCDF_CDMWriter::convertData(const CDMVariable& var, DataPtr data)
 {
+    if (!needsConversion(var))
+        return data;
+
     const std::string& varName = var.getName();
 
     const std::string oldUnit = cdmReader->getCDM().getUnits(varName);
@@ -603,20 +698,17 @@ DataPtr NetCDF_CDMWriter::convertData(const CDMVariable& var, DataPtr data)
     const double newScale = cdm.getScaleFactor(varName);
     const double newOffset = cdm.getAddOffset(varName);
 
-    if ((newType != CDM_NAT && oldType != CDM_NAT) &&
-        (newType != oldType || newUnit != oldUnit || oldFill != newFill || oldScale != newScale || oldOffset != newOffset)) {
-        try {
-            UnitsConverter_p uc;
-            if (oldUnit != newUnit) { // changes of the units
-                Units units;
-                uc = units.getConverter(oldUnit, newUnit);
-            }
-            data = data->convertDataType(oldFill, oldScale, oldOffset, uc, newType, newFill, newScale, newOffset);
-        } catch (UnitException& e) {
-            LOG4FIMEX(logger, Logger::WARN, "unable to convert data-units for variable " << var.getName() << ": " << e.what());
-        } catch (CDMException& e) {
-            // units not defined, do nothing
+    try {
+        UnitsConverter_p uc;
+        if (oldUnit != newUnit) { // changes of the units
+            Units units;
+            uc = units.getConverter(oldUnit, newUnit);
         }
+        data = data->convertDataType(oldFill, oldScale, oldOffset, uc, newType, newFill, newScale, newOffset);
+    } catch (UnitException& e) {
+        LOG4FIMEX(logger, Logger::WARN, "unable to convert data-units for variable " << var.getName() << ": " << e.what());
+    } catch (CDMException& e) {
+        // units not defined, do nothing
     }
     return data;
 }
@@ -637,31 +729,27 @@ void NetCDF_CDMWriter::writeData(const NcVarIdMap& ncVarMap)
     // see http://www.unidata.ucar.edu/support/help/MailArchives/netcdf/msg10905.html
     // use unLimDimPos = -1 for variables without unlimited dimension
 
-    bool exceptions = false;
-#ifdef _OPENMP
-#if (defined(__GNUC__) && __GNUC__ >= 9) || defined(__clang__)
-#pragma omp parallel for default(none) shared(logger, cdmVars, ncVarMap, maxUnLim, unLimDimId, exceptions)
-#elif !defined(__INTEL_COMPILER) || (__INTEL_COMPILER >= 1800)
-#pragma omp parallel for default(none) shared(logger, cdmVars, ncVarMap, exceptions)
-#endif // __INTEL_COMPILER
-#endif // _OPENMP
-    for (long long unLimDimPos = -1; unLimDimPos < maxUnLim; ++unLimDimPos) {
+    // readers not supporting concurrent reading are read by this thread only
+    const size_t grain = cdmReader->supportsConcurrentReading() ? 1 : maxUnLim + 1;
+    std::atomic<bool> exceptions(false);
+    WorkerPool::shared().parallelFor(0, maxUnLim + 1, [&](size_t step) {
+        const long long unLimDimPos = static_cast<long long>(step) - 1;
 #ifdef HAVE_MPI
         if (using_mpi) {
             if (sliceAlongUnlimited) { // MPI-slices along unlimited dimension
                 // only work on variables which belong to this mpi-process (modulo-base)
                 if ((unLimDimPos % mifi_mpi_size) != mifi_mpi_rank) {
                     LOG4FIMEX(logger, Logger::DEBUG, "processor " << mifi_mpi_rank << " skipping unLimDimPos " << unLimDimPos);
-                    continue;
+                    return;
                 } else {
                     LOG4FIMEX(logger, Logger::DEBUG, "processor " << mifi_mpi_rank << " working on unLimDimPos " << unLimDimPos);
                 }
             }
         }
 #endif
+        // collect the slices to write in this step
+        std::vector<WriteSlice> writeSlices;
         for (size_t vi = 0; vi < cdmVars.size(); ++vi) {
-            if (exceptions)
-                continue;
             const CDMVariable& cdmVar = cdmVars[vi];
             const std::string& varName = cdmVar.getName();
             const int varId = ncVarMap.find(varName)->second;
@@ -679,50 +767,82 @@ void NetCDF_CDMWriter::writeData(const NcVarIdMap& ncVarMap)
                 }
             }
 #endif
-            int n_dims;
+            WriteSlice ws;
+            ws.vi = vi;
+            ws.varId = varId;
+            ws.unLimDimIdx = -1;
             std::unique_ptr<int[]> dim_ids;
-            std::unique_ptr<size_t[]> count;
-            std::unique_ptr<size_t[]> start;
-            int unLimDimIdx = -1;
             {
                 OmpScopedLock ncLock(Nc::getMutex());
 
-                ncCheck(nc_inq_varndims(ncFile->ncId, varId, &n_dims));
+                ncCheck(nc_inq_varndims(ncFile->ncId, varId, &ws.n_dims));
 
-                dim_ids.reset(new int[n_dims]);
+                dim_ids.reset(new int[ws.n_dims]);
                 ncCheck(nc_inq_vardimid(ncFile->ncId, varId, dim_ids.get()));
 
-                start.reset(new size_t[n_dims]);
-                count.reset(new size_t[n_dims]);
-                for (int i = 0; i < n_dims; ++i) {
+                ws.start.resize(ws.n_dims);
+                ws.count.resize(ws.n_dims);
+                for (int i = 0; i < ws.n_dims; ++i) {
                     if (dim_ids[i] == unLimDimId)
-                        unLimDimIdx = i;
+                        ws.unLimDimIdx = i;
 
                     size_t dim_len;
                     ncCheck(nc_inq_dimlen(ncFile->ncId, dim_ids[i], &dim_len));
-                    start[i] = 0;
-                    count[i] = dim_len;
+                    ws.start[i] = 0;
+                    ws.count[i] = dim_len;
                 }
             }
-            LOG4FIMEX(logger, Logger::DEBUG, "dimids of " << varName << ": " << join(&dim_ids[0], &dim_ids[0] + n_dims));
+            LOG4FIMEX(logger, Logger::DEBUG, "dimids of " << varName << ": " << join(&dim_ids[0], &dim_ids[0] + ws.n_dims));
+
+            ws.no_unlim = (unLimDimPos == -1 && ws.unLimDimIdx == -1 && !cdm.hasUnlimitedDim(cdmVar));
+            ws.with_unlim = (unLimDimPos != -1 && ws.unLimDimIdx >= 0 && cdm.hasUnlimitedDim(cdmVar));
+            if (ws.no_unlim || ws.with_unlim) // FIXME
+                writeSlices.push_back(std::move(ws));
+        }
+
+        // read up to readAhead slices beyond the current one while converting and writing,
+        // only the current one while memory is short
+        std::deque<std::future<DataPtr>> inFlight;
+        size_t nextRead = 0;
+        // or request readBatch slices of the unlimited dimension together
+        const bool batched = (readBatch > 1 && unLimDimPos >= 0);
+        std::vector<DataPtr> batch;
+        size_t batchBegin = 0;
+        for (size_t wi = 0; wi < writeSlices.size(); ++wi) {
+            if (exceptions)
+                break;
+            WriteSlice& ws = writeSlices[wi];
+            const CDMVariable& cdmVar = cdmVars[ws.vi];
+            const std::string& varName = cdmVar.getName();
 
-            const bool no_unlim = (unLimDimPos == -1 && unLimDimIdx == -1 && !cdm.hasUnlimitedDim(cdmVar));
-            const bool with_unlim = (unLimDimPos != -1 && unLimDimIdx >= 0 && cdm.hasUnlimitedDim(cdmVar));
             DataPtr data;
             try {
-                if (no_unlim) {
-                    data = cdmReader->getData(varName);
-                } else if (with_unlim) {
-                    data = cdmReader->getDataSlice(varName, unLimDimPos);
+                if (batched) {
+                    if (wi == batchBegin + batch.size()) {
+                        // only the current slice while memory is short, as for readAhead
+                        const size_t batchSize = MemoryBudget::exceeded() ? 1 : readBatch;
+                        std::vector<std::string> batchNames;
+                        for (size_t bi = wi; bi < std::min(writeSlices.size(), wi + batchSize); ++bi)
+                            batchNames.push_back(cdmVars[writeSlices[bi].vi].getName());
+                        batch = cdmReader->getDataSlices(batchNames, unLimDimPos);
+                        batchBegin = wi;
+                    }
+                    data = std::move(batch[wi - batchBegin]);
+                } else if (readAhead > 0) {
+                    for (; nextRead < writeSlices.size() && nextRead <= wi + readAhead && (nextRead <= wi || !MemoryBudget::exceeded()); ++nextRead)
+                        inFlight.push_back(readDataAsync(cdmVars[writeSlices[nextRead].vi].getName(), writeSlices[nextRead].no_unlim, unLimDimPos));
+                    std::future<DataPtr> f = std::move(inFlight.front());
+                    inFlight.pop_front();
+                    data = WorkerPool::shared().get(f);
                 } else {
-                    continue; // FIXME
+                    data = readData(cdmVar, ws.no_unlim, unLimDimPos);
                 }
-                if (data)
+                if (data && (batched || readAhead > 0))
                     data = convertData(cdmVar, data);
             } catch (std::exception& ex) {
                 std::ostringstream msg;
                 msg << "exception while reading variable '" << varName << "'";
-                if (!no_unlim)
+                if (!ws.no_unlim)
                     msg << " at unlimited dim position " << unLimDimPos;
                 msg << "; will stop writing data";
                 msg << "; message: " << ex.what();
@@ -732,7 +852,7 @@ void NetCDF_CDMWriter::writeData(const NcVarIdMap& ncVarMap)
             } catch (...) {
                 std::ostringstream msg;
                 msg << "exception while reading variable '" << varName << "'";
-                if (!no_unlim)
+                if (!ws.no_unlim)
                     msg << " at unlimited dim position " << unLimDimPos;
                 msg << "; will stop writing data";
                 LOG4FIMEX(logger, Logger::ERROR, msg.str());
@@ -740,27 +860,27 @@ void NetCDF_CDMWriter::writeData(const NcVarIdMap& ncVarMap)
                 exceptions = true;
             }
             if (exceptions)
-                continue;
+                break;
 
             if ((!data || data->size() == 0) && ncFile->format < 3) {
                 // need to write data with _FillValue,
                 // since we are using NC_NOFILL for nc3 format files = NC_FORMAT_CLASSIC(1) NC_FORMAT_64BIT(2))
-                if (with_unlim)
-                    count[unLimDimIdx] = 1; // just one slice
-                size_t size = (n_dims > 0) ? std::accumulate(count.get(), count.get() + n_dims, 1, std::multiplies<size_t>()) : 1;
+                if (ws.with_unlim)
+                    ws.count[ws.unLimDimIdx] = 1; // just one slice
+                size_t size = (ws.n_dims > 0) ? std::accumulate(ws.count.begin(), ws.count.end(), 1, std::multiplies<size_t>()) : 1;
                 data = createData(cdmVar.getDataType(), size, cdm.getFillValue(varName));
             }
             if (data && data->size() > 0) {
-                if (with_unlim) {
-                    count[unLimDimIdx] = 1;
-                    start[unLimDimIdx] = unLimDimPos;
+                if (ws.with_unlim) {
+                    ws.count[ws.unLimDimIdx] = 1;
+                    ws.start[ws.unLimDimIdx] = unLimDimPos;
                 }
                 LOG4FIMEX(logger, Logger::DEBUG,
-                          "writing variable " << varName << " dimLen= " << n_dims << " start=" << join(&start[0], &start[0] + n_dims)
-                                              << " count=" << join(&count[0], &count[0] + n_dims));
+                          "writing variable " << varName << " dimLen= " << ws.n_dims << " start=" << join(ws.start.begin(), ws.start.end())
+                                              << " count=" << join(ws.count.begin(), ws.count.end()));
                 OmpScopedLock ncLock(Nc::getMutex());
                 try {
-                    ncPutValues(data, ncFile->ncId, varId, cdmDataType2ncType(cdmVar.getDataType()), n_dims, start.get(), count.get());
+                    ncPutValues(data, ncFile->ncId, ws.varId, cdmDataType2ncType(cdmVar.getDataType()), ws.n_dims, ws.start.data(), ws.count.data());
                 } catch (std::exception& ex) {
                     OmpScopedUnlock ncUnlock(Nc::getMutex());
                     LOG4FIMEX(logger, Logger::ERROR, "exception " << ex.what() << " while writing variable " << varName);
@@ -770,12 +890,15 @@ void NetCDF_CDMWriter::writeData(const NcVarIdMap& ncVarMap)
                 }
             }
         }
+        // do not leave requests running after errors
+        for (std::future<DataPtr>& f : inFlight)
+            WorkerPool::shared().wait(f);
 #ifndef HAVE_MPI
         if (unLimDimPos >= 0) {
             NCMUTEX_LOCKED(ncCheck(nc_sync(ncFile->ncId))); // sync every 'time/unlimited' step (does not work with MPI)
         }
 #endif
-    }
+    }, grain);
     if (exceptions)
         throw CDMException("netcdf writing failed with ERRORs");
 }
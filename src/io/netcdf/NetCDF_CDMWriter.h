@@ -27,6 +27,7 @@
 #include "fimex/CDM.h"
 #include "fimex/CDMWriter.h"
 
+#include <future>
 #include <map>
 #include <string>
 
@@ -84,6 +85,12 @@ private:
     void writeAttributes(const NcVarIdMap& varMap);
     void writeData(const NcVarIdMap& varMap);
 
+    /** read a variable on the shared WorkerPool, the complete variable or one unlimited-dimension slice */
+    std::future<DataPtr> readDataAsync(const std::string& varName, bool complete, long long unLimDimPos);
+    /** read and convert a variable, with CDMReader::readInto directly into the values written if no conversion is required */
+    DataPtr readData(const CDMVariable& var, bool complete, long long unLimDimPos);
+    /** @return true if the values of var change by datatype, units, fill-value or packing */
+    bool needsConversion(const CDMVariable& var) const;
     DataPtr convertData(const CDMVariable& var, DataPtr data);
 
 private:
@@ -94,6 +101,10 @@ private:
     std::map<std::string, unsigned int> variableCompression;
     std::map<std::string, unsigned int> dimensionChunkSize;
     std::map<std::string, std::string> dimensionNameChanges;
+    /** number of slices read beyond the one being written, 0 reads synchronously, as for readers not supporting concurrent reading */
+    size_t readAhead;
+    /** number of variables of one unlimited-dimension step requested together, 0 or 1 requests each variable, 1 while MemoryBudget::exceeded() */
+    size_t readBatch;
 };
 
 } // namespace MetNoFimex
@@ -354,6 +354,48 @@ DataPtr ncGetValues(int ncId, int varId, nc_type dt, size_t dimLen, const size_t
     }
 }
 
+bool ncGetValuesInto(int ncId, int varId, nc_type dt, CDMDataType dataType, size_t dimLen, const size_t* start, const size_t* count, void* dst)
+{
+    if (dimLen == 0) {
+        // scalar
+        start = &zero;
+        count = &one;
+    }
+
+    switch (dt) {
+    case NC_BYTE:
+    case NC_SHORT:
+    case NC_INT:
+    case NC_FLOAT:
+    case NC_DOUBLE:
+#ifdef NC_NETCDF4
+    case NC_UBYTE:
+    case NC_USHORT:
+    case NC_UINT:
+    case NC_INT64:
+    case NC_UINT64:
+#endif
+        break;
+    default:
+        return false; // strings, chars and unknown types
+    }
+
+    if (cdmDataType2ncType(dataType) == dt) {
+        ncCheck(nc_get_vara(ncId, varId, start, count, dst));
+    } else if (dataType == CDM_DOUBLE) {
+        ncCheck(nc_get_vara_double(ncId, varId, start, count, reinterpret_cast<double*>(dst)));
+    } else if (dataType == CDM_FLOAT && dt != NC_DOUBLE
+#ifdef NC_NETCDF4
+               && dt != NC_INT64 && dt != NC_UINT64
+#endif
+    ) {
+        ncCheck(nc_get_vara_float(ncId, varId, start, count, reinterpret_cast<float*>(dst)));
+    } else {
+        return false;
+    }
+    return true;
+}
+
 void ncPutValues(DataPtr data, int ncId, int varId, nc_type type, size_t dimLen, const size_t* start, const size_t* count)
 {
     if (data->size() == 0)
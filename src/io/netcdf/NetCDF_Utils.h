@@ -110,6 +110,24 @@ DataPtr ncGetAttValues(int ncId, int varId, const std::string& attName, nc_type
  */
 DataPtr ncGetValues(int ncId, int varId, nc_type type, size_t dimLen, const size_t* start, const size_t* count);
 
+/**
+ * read value-slices from a variable directly into a caller-provided array
+ *
+ * Only conversions which cannot fail are done by netcdf, i.e. reading the variable
+ * in its own type, or widening to float/double.
+ *
+ * @param ncId netcdf file id
+ * @param varId variable id
+ * @param type variable datatype (in netcdf-notation)
+ * @param dataType datatype of dst
+ * @param dimLen number of dimensions
+ * @param start start-point for each dimension
+ * @param count size in each dimension
+ * @param dst destination, must be able to hold the product of count values of dataType
+ * @return false if the conversion from type to dataType is not supported, nothing has been read then
+ */
+bool ncGetValuesInto(int ncId, int varId, nc_type type, CDMDataType dataType, size_t dimLen, const size_t* start, const size_t* count, void* dst);
+
 /**
  * write value-slices from a variable to disk
  * @param data the data to put
@@ -23,14 +23,24 @@
 
 #include "fimex/reproject.h"
 
+#include "AnalyticProjection.h"
+#include "AxisLookup.h"
+
 #include "fimex/CDMException.h"
 #include "fimex/CDMconstants.h"
 #include "fimex/Logger.h"
+#include "fimex/WorkerPool.h"
 #include "fimex/interpolation.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
+#include <vector>
 
 #include "fimex_config.h"
 #ifdef HAVE_PROJ_H
@@ -49,19 +59,13 @@ namespace {
 
 Logger_p logger = getLogger("fimex.reproject");
 
+// points per task of crs2crs::transform
+const size_t TRANSFORM_CHUNK = 65536;
+
 #ifdef HAVE_PROJ_H
 #define DEG_TO_RAD (M_PI / 180)
 #define RAD_TO_DEG (180 / M_PI)
 
-PJ_CONTEXT* crs2crs_ctx()
-{
-    static PJ_CONTEXT* pj_ctx = 0;
-    if (!pj_ctx) {
-        pj_ctx = proj_context_create();
-    }
-    return pj_ctx;
-}
-
 void throw_proj_error(int pe)
 {
     std::ostringstream out;
@@ -70,20 +74,113 @@ void throw_proj_error(int pe)
 }
 
 typedef std::shared_ptr<PJ> PJ_p;
+typedef std::pair<std::string, std::string> crs_pair; //! source and destination crs
 
-PJ_p make_PJ(const std::string& src, const std::string& dst)
+/**
+ * Process-wide cache of the PJ objects created from a pair of crs.
+ *
+ * PJ objects and their contexts must not be used by several threads at the same
+ * time, so the cached objects are only cloned into the context of each thread
+ * (see thread_PJ()), while holding the lock.
+ */
+class PJCache
 {
-    PJ_p pj(proj_create_crs_to_crs(crs2crs_ctx(), src.c_str(), dst.c_str(), 0), proj_destroy);
-    int pe = proj_context_errno(crs2crs_ctx());
+public:
+    static PJCache& shared()
+    {
+        static PJCache cache;
+        return cache;
+    }
+
+    /** @return a copy of the PJ for key, created in ctx */
+    PJ_p clone(const crs_pair& key, PJ_CONTEXT* ctx);
+
+private:
+    PJCache()
+        : ctx_(proj_context_create())
+    {
+    }
+    ~PJCache()
+    {
+        pjs_.clear();
+        proj_context_destroy(ctx_);
+    }
+
+    std::mutex mutex_;
+    PJ_CONTEXT* ctx_;
+    std::map<crs_pair, PJ_p> pjs_;
+};
+
+/** @return the PJ transforming key.first to key.second in ctx, throws if proj reports an error */
+PJ_p make_PJ(PJ_CONTEXT* ctx, const crs_pair& key)
+{
+    PJ_p pj(proj_create_crs_to_crs(ctx, key.first.c_str(), key.second.c_str(), 0), proj_destroy);
+    int pe = proj_context_errno(ctx);
     if (!pj || pe != 0)
         throw_proj_error(pe);
     return pj;
 }
 
-class crs2crs
+PJ_p PJCache::clone(const crs_pair& key, PJ_CONTEXT* ctx)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pjs_.find(key);
+    if (it == pjs_.end())
+        it = pjs_.insert(std::make_pair(key, make_PJ(ctx_, key))).first; // only cached if created without error
+    PJ_p pj(proj_clone(ctx, it->second.get()), proj_destroy);
+    if (!pj) {
+        // proj < 7.2 cannot clone crs-to-crs objects with several alternative operations
+        pj = make_PJ(ctx, key);
+    }
+    return pj;
+}
+
+/**
+ * The proj context of a thread, with its copies of the cached PJ objects.
+ */
+class ThreadPJs
 {
 public:
-    crs2crs(const std::string& proj_input, const std::string& proj_output);
+    ThreadPJs()
+        : ctx_(proj_context_create())
+    {
+    }
+    ~ThreadPJs()
+    {
+        pjs_.clear();
+        proj_context_destroy(ctx_);
+    }
+
+    PJ* get(const crs_pair& key)
+    {
+        PJ_p& pj = pjs_[key];
+        if (!pj) {
+            try {
+                pj = PJCache::shared().clone(key, ctx_);
+            } catch (...) {
+                pjs_.erase(key);
+                throw;
+            }
+        }
+        return pj.get();
+    }
+
+private:
+    PJ_CONTEXT* ctx_;
+    std::map<crs_pair, PJ_p> pjs_;
+};
+
+/** @return the PJ transforming key.first to key.second, for use in the calling thread only */
+PJ* thread_PJ(const crs_pair& key)
+{
+    static thread_local ThreadPJs pjs;
+    return pjs.get(key);
+}
+
+class proj_crs2crs
+{
+public:
+    proj_crs2crs(const std::string& proj_input, const std::string& proj_output);
 
     bool src_is_latlon() const { return src_is_latlon_; }
     bool dst_is_latlon() const { return dst_is_latlon_; }
@@ -95,24 +192,32 @@ private:
     void transform(PJ_DIRECTION direction, size_t count, double* x, double* y);
 
 private:
-    PJ_p pj_;
+    crs_pair crs_;
     bool src_is_latlon_;
     bool dst_is_latlon_;
 };
 
-crs2crs::crs2crs(const std::string& proj_input, const std::string& proj_output)
-    : pj_(make_PJ(proj_input, proj_output))
-    , src_is_latlon_(proj_degree_input(pj_.get(), PJ_FWD))
-    , dst_is_latlon_(proj_degree_output(pj_.get(), PJ_FWD))
+proj_crs2crs::proj_crs2crs(const std::string& proj_input, const std::string& proj_output)
+    : crs_(proj_input, proj_output)
 {
+    PJ* pj = thread_PJ(crs_);
+    src_is_latlon_ = proj_degree_input(pj, PJ_FWD);
+    dst_is_latlon_ = proj_degree_output(pj, PJ_FWD);
 }
 
-void crs2crs::transform(PJ_DIRECTION direction, size_t count, double* x, double* y)
+void proj_crs2crs::transform(PJ_DIRECTION direction, size_t count, double* x, double* y)
 {
-    const size_t stride = sizeof(double);
-    const size_t completed = proj_trans_generic(pj_.get(), direction, x, stride, count, y, stride, count, 0, 0, 0, 0, 0, 0);
-    if (completed != count)
-        throw_proj_error(proj_errno(pj_.get()));
+    // chunks on the worker pool, each thread with its own context and PJ
+    const size_t nChunks = (count + TRANSFORM_CHUNK - 1) / TRANSFORM_CHUNK;
+    WorkerPool::shared().parallelFor(0, nChunks, [&](size_t chunk) {
+        const size_t offset = chunk * TRANSFORM_CHUNK;
+        const size_t n = std::min(TRANSFORM_CHUNK, count - offset);
+        PJ* pj = thread_PJ(crs_);
+        const size_t stride = sizeof(double);
+        const size_t completed = proj_trans_generic(pj, direction, x + offset, stride, n, y + offset, stride, n, 0, 0, 0, 0, 0, 0);
+        if (completed != n)
+            throw_proj_error(proj_errno(pj));
+    });
 }
 
 #else // !HAVE_PROJ_H
@@ -154,10 +259,10 @@ void scale_x_y(size_t count, double* x, double* y, double factor)
     }
 }
 
-class crs2crs
+class proj_crs2crs
 {
 public:
-    crs2crs(const std::string& proj_input, const std::string& proj_output);
+    proj_crs2crs(const std::string& proj_input, const std::string& proj_output);
 
     bool src_is_latlon() const { return src_is_latlon_; }
     bool dst_is_latlon() const { return dst_is_latlon_; }
@@ -177,7 +282,7 @@ private:
     bool dst_is_latlon_;
 };
 
-crs2crs::crs2crs(const std::string& proj_input, const std::string& proj_output)
+proj_crs2crs::proj_crs2crs(const std::string& proj_input, const std::string& proj_output)
     : src_(make_PJ(proj_input))
     , dst_(make_PJ(proj_output))
     , src_is_angular_(proj_is_angular(src_, proj_input))
@@ -187,7 +292,7 @@ crs2crs::crs2crs(const std::string& proj_input, const std::string& proj_output)
 {
 }
 
-void crs2crs::transform(projPJ_p src, projPJ_p dst, size_t count, double* x, double* y)
+void proj_crs2crs::transform(projPJ_p src, projPJ_p dst, size_t count, double* x, double* y)
 {
     std::unique_ptr<double[]> z(new double[count]); // z currently of no interest, no height attached to values
     std::fill(&z[0], &z[count], 0);
@@ -195,7 +300,7 @@ void crs2crs::transform(projPJ_p src, projPJ_p dst, size_t count, double* x, dou
         throw_proj_error();
 }
 
-void crs2crs::fwd(size_t count, double* x, double* y)
+void proj_crs2crs::fwd(size_t count, double* x, double* y)
 {
     if (src_is_angular_)
         scale_x_y(count, x, y, DEG_TO_RAD);
@@ -204,7 +309,7 @@ void crs2crs::fwd(size_t count, double* x, double* y)
         scale_x_y(count, x, y, RAD_TO_DEG);
 }
 
-void crs2crs::inv(size_t count, double* x, double* y)
+void proj_crs2crs::inv(size_t count, double* x, double* y)
 {
     if (dst_is_angular_)
         scale_x_y(count, x, y, DEG_TO_RAD);
@@ -215,6 +320,184 @@ void crs2crs::inv(size_t count, double* x, double* y)
 
 #endif
 
+// points of each chunk of crs2crs::transform compared between AnalyticTransform and proj
+const size_t ANALYTIC_CHECK_POINTS = 16;
+
+/** @return true if x, y cannot be a result of AnalyticTransform for a regular point */
+bool analytic_failed(bool angular, double x, double y)
+{
+    // very large values only come from (nearly) singular points
+    const double huge = angular ? 1e6 : 1e15;
+    return !(std::fabs(x) < huge && std::fabs(y) < huge);
+}
+
+/**
+ * @return true if the coordinate a from proj and b from AnalyticTransform agree,
+ * also if b failed as this point is then transformed by proj
+ */
+bool analytic_agrees(bool angular, double ax, double ay, double bx, double by)
+{
+    if (analytic_failed(angular, bx, by))
+        return true;
+    if (analytic_failed(angular, ax, ay))
+        return false;
+    if (angular) {
+        const double tolerance = 1e-7; // degree
+        if (std::fabs(ay - by) > tolerance)
+            return false;
+        // longitude is arbitrary at the poles
+        return (std::fabs(ay) > 90 - tolerance) || std::fabs(std::remainder(ax - bx, 360.)) <= tolerance;
+    }
+    const double tolerance = 1e-3; // m
+    return std::fabs(ax - bx) <= tolerance + 1e-9 * std::fabs(ax) && std::fabs(ay - by) <= tolerance + 1e-9 * std::fabs(ay);
+}
+
+typedef std::pair<std::string, std::string> analytic_pair; //! proj_input and proj_output
+
+std::mutex analyticRejectedMutex;
+
+/** crs pairs for which AnalyticTransform did not agree with proj, not used again in this process */
+std::set<analytic_pair>& analyticRejected()
+{
+    static std::set<analytic_pair> rejected;
+    return rejected;
+}
+
+bool analytic_rejected(const analytic_pair& key)
+{
+    std::lock_guard<std::mutex> lock(analyticRejectedMutex);
+    return analyticRejected().count(key) != 0;
+}
+
+void reject_analytic(const analytic_pair& key)
+{
+    std::lock_guard<std::mutex> lock(analyticRejectedMutex);
+    if (analyticRejected().insert(key).second)
+        LOG4FIMEX(logger, Logger::WARN, "analytic transform from '" << key.first << "' to '" << key.second << "' differs from proj, using proj");
+}
+
+/**
+ * Coordinate transformation with proj, or, if enabled, with AnalyticTransform for
+ * supported crs pairs. A fixed subset of the points of each chunk is also
+ * transformed by proj; if any of them differs, the chunk is transformed by proj,
+ * and AnalyticTransform is not used again for this crs pair.
+ */
+class crs2crs
+{
+public:
+    crs2crs(const std::string& proj_input, const std::string& proj_output);
+
+    bool src_is_latlon() const { return proj_.src_is_latlon(); }
+    bool dst_is_latlon() const { return proj_.dst_is_latlon(); }
+
+    void fwd(size_t count, double* x, double* y) { transform(true, count, x, y); }
+    void inv(size_t count, double* x, double* y) { transform(false, count, x, y); }
+
+private:
+    void transform(bool forward, size_t count, double* x, double* y);
+    void transform_proj(bool forward, size_t count, double* x, double* y);
+    void transform_analytic(bool forward, size_t count, double* x, double* y);
+
+private:
+    proj_crs2crs proj_;
+    const analytic_pair key_;
+    std::unique_ptr<AnalyticTransform> analytic_;
+    std::atomic<bool> analytic_ok_;
+};
+
+crs2crs::crs2crs(const std::string& proj_input, const std::string& proj_output)
+    : proj_(proj_input, proj_output)
+    , key_(proj_input, proj_output)
+    , analytic_ok_(false)
+{
+    if (analyticTransformsEnabled() && !analytic_rejected(key_)) {
+        analytic_ = AnalyticTransform::create(proj_input, proj_output);
+        if (analytic_) {
+            analytic_ok_ = true;
+            LOG4FIMEX(logger, Logger::DEBUG, "analytic transform from '" << proj_input << "' to '" << proj_output << "'");
+        }
+    }
+}
+
+void crs2crs::transform_proj(bool forward, size_t count, double* x, double* y)
+{
+    if (forward)
+        proj_.fwd(count, x, y);
+    else
+        proj_.inv(count, x, y);
+}
+
+void crs2crs::transform_analytic(bool forward, size_t count, double* x, double* y)
+{
+    if (!analytic_ok_) {
+        transform_proj(forward, count, x, y);
+        return;
+    }
+
+    // first, last and evenly spaced points in between, the same for each call with this count
+    const size_t nCheck = std::min(count, ANALYTIC_CHECK_POINTS);
+    std::vector<size_t> checkPos(nCheck);
+    std::vector<double> checkX(nCheck), checkY(nCheck);
+    for (size_t k = 0; k < nCheck; ++k) {
+        checkPos[k] = (nCheck > 1) ? k * (count - 1) / (nCheck - 1) : 0;
+        checkX[k] = x[checkPos[k]];
+        checkY[k] = y[checkPos[k]];
+    }
+    transform_proj(forward, nCheck, &checkX[0], &checkY[0]);
+
+    const std::vector<double> inX(x, x + count), inY(y, y + count);
+    if (forward)
+        analytic_->fwd(count, x, y);
+    else
+        analytic_->inv(count, x, y);
+
+    const bool angular = forward ? analytic_->dst_is_angular() : analytic_->src_is_angular();
+    bool agrees = true;
+    for (size_t k = 0; agrees && k < nCheck; ++k)
+        agrees = analytic_agrees(angular, checkX[k], checkY[k], x[checkPos[k]], y[checkPos[k]]);
+    if (!agrees) {
+        analytic_ok_ = false;
+        reject_analytic(key_);
+        std::copy(inX.begin(), inX.end(), x);
+        std::copy(inY.begin(), inY.end(), y);
+        transform_proj(forward, count, x, y);
+        return;
+    }
+
+    // points at or close to a singularity of the analytic formulas are left to proj
+    std::vector<size_t> failed;
+    std::vector<double> failedX, failedY;
+    for (size_t i = 0; i < count; ++i) {
+        if (analytic_failed(angular, x[i], y[i])) {
+            failed.push_back(i);
+            failedX.push_back(inX[i]);
+            failedY.push_back(inY[i]);
+        }
+    }
+    if (failed.empty())
+        return;
+
+    transform_proj(forward, failed.size(), &failedX[0], &failedY[0]);
+    for (size_t k = 0; k < failed.size(); ++k) {
+        x[failed[k]] = failedX[k];
+        y[failed[k]] = failedY[k];
+    }
+}
+
+void crs2crs::transform(bool forward, size_t count, double* x, double* y)
+{
+    if (analytic_ && analytic_ok_ && analyticTransformsEnabled()) {
+        const size_t nChunks = (count + TRANSFORM_CHUNK - 1) / TRANSFORM_CHUNK;
+        WorkerPool::shared().parallelFor(0, nChunks, [&](size_t chunk) {
+            const size_t offset = chunk * TRANSFORM_CHUNK;
+            const size_t n = std::min(TRANSFORM_CHUNK, count - offset);
+            transform_analytic(forward, n, x + offset, y + offset);
+        });
+    } else {
+        transform_proj(forward, count, x, y);
+    }
+}
+
 inline int mifi_3d_array_pos(int x, int y, int z, int ix, int iy, int iz)
 {
     (void)iz; // suppress compiler warning
@@ -277,8 +560,8 @@ void interpolate_f_functional(int (*func)(const float* infield, float* outvalues
     std::unique_ptr<double[]> pointsY(new double[ox * oy]);
     reproject_axes(proj_output, proj_input, out_x_axis, out_y_axis, ox, oy, pointsX.get(), pointsY.get());
 
-    mifi_points2position(pointsX.get(), ox * oy, in_x_axis, ix, in_x_axis_type);
-    mifi_points2position(pointsY.get(), ox * oy, in_y_axis, iy, in_y_axis_type);
+    AxisLookup(in_x_axis, ix, in_x_axis_type).positions(pointsX.get(), ox * oy);
+    AxisLookup(in_y_axis, iy, in_y_axis_type).positions(pointsY.get(), ox * oy);
 
     // LOG4FIMEX(logger, Logger::DEBUG, "projection: (" << out_x_axis[0] << "," << out_y_axis[0] << ") <- (" << pointsX[0] << "," << pointsY[0]);
 
@@ -405,6 +688,13 @@ Matrix::Matrix(int sizex, int sizey)
 {
 }
 
+Matrix::Matrix(int sizex, int sizey, MetNoFimex::shared_array<double> matrix)
+    : size_x(sizex)
+    , size_y(sizey)
+    , matrix(matrix)
+{
+}
+
 void reproject_f(const int method, const std::string& proj_input, const float* infield, const double* in_x_axis, const double* in_y_axis,
                  const int in_x_axis_type, const int in_y_axis_type, const int ix, const int iy, const int iz, const std::string& proj_output, float* outfield,
                  const double* out_x_axis, const double* out_y_axis, const int out_x_axis_type, const int out_y_axis_type, const int ox, const int oy)
@@ -540,10 +830,10 @@ void vector_reproject_values_f(const std::string& proj_input, const std::string&
 void reproject_point_from_lonlat(const std::string& proj_output, double* lon_x, double* lat_y)
 {
 #ifdef HAVE_PROJ_H
-    PJ_p P = make_PJ("EPSG:4326", proj_output);
+    PJ* P = thread_PJ(crs_pair("EPSG:4326", proj_output));
 
     PJ_COORD uv = proj_coord(*lat_y, *lon_x, 0, 0); // EPSG:4326 here needs lat first, lon second
-    PJ_COORD xy = proj_trans(P.get(), PJ_FWD, uv);
+    PJ_COORD xy = proj_trans(P, PJ_FWD, uv);
     *lon_x = xy.enu.e;
     *lat_y = xy.enu.n;
 #else  /* !HAVE_PROJ_H*/
@@ -585,5 +875,14 @@ void reproject_axes(const std::string& proj_input, const std::string& proj_outpu
     c2c.fwd(ix * iy, out_xproj_axis, out_yproj_axis);
 }
 
+std::string proj_version()
+{
+#ifdef HAVE_PROJ_H
+    return proj_info().version;
+#else
+    return pj_get_release();
+#endif
+}
+
 } // namespace reproject
 } // namespace MetNoFimex
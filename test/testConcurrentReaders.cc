@@ -0,0 +1,273 @@
+/*
+ * Fimex, testConcurrentReaders.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+/*
+ * Stress test for the thread-safety contract of CDMReader: many threads
+ * read random slices from the same reader chain and compare them to the
+ * sequentially read values. The test testConcurrentReaders_tsan runs it
+ * in a build with -DENABLE_THREAD_SANITIZER=ON.
+ */
+
+#include "testinghelpers.h"
+
+#include "fimex/CDM.h"
+#include "fimex/CDMDimension.h"
+#include "fimex/CDMExtractor.h"
+#include "fimex/CDMFileReaderFactory.h"
+#include "fimex/CDMInterpolator.h"
+#include "fimex/CDMProcessor.h"
+#include "fimex/Data.h"
+#include "fimex/MathUtils.h"
+#include "fimex/SliceBuilder.h"
+#include "fimex/Type2String.h"
+#include "fimex/WorkerPool.h"
+#include "fimex/interpolation.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace MetNoFimex;
+
+namespace {
+
+const size_t N_THREADS = 8;
+const size_t N_READS = 40;
+
+bool sameValues(const DataPtr& expected, const shared_array<double>& values, size_t size)
+{
+    if (expected->size() != size)
+        return false;
+    auto ev = expected->asDouble();
+    for (size_t i = 0; i < size; ++i) {
+        if (!(ev[i] == values[i] || (mifi_isnan(ev[i]) && mifi_isnan(values[i]))))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Read random unlimited-dimension slices of varName with getDataSlice, readInto and
+ * getDataSliceAsync from several threads at once.
+ *
+ * @return number of slices differing from the sequential reference
+ */
+size_t readConcurrently(CDMReader_p reader, const string& varName)
+{
+    const CDM& cdm = reader->getCDM();
+    const CDMDimension* unlimDim = cdm.getUnlimitedDim();
+    const size_t nSlices = unlimDim ? unlimDim->getLength() : 1;
+
+    // sequential reference
+    vector<DataPtr> expected;
+    for (size_t t = 0; t < nSlices; ++t)
+        expected.push_back(reader->getDataSlice(varName, t));
+
+    atomic<size_t> errors(0);
+    vector<thread> threads;
+    for (size_t n = 0; n < N_THREADS; ++n) {
+        threads.push_back(thread([&, n]() {
+            minstd_rand rng(static_cast<minstd_rand::result_type>(n + 1));
+            uniform_int_distribution<size_t> slicePos(0, nSlices - 1);
+            for (size_t r = 0; r < N_READS; ++r) {
+                const size_t t = slicePos(rng);
+                try {
+                    switch (rng() % 3) {
+                    case 0: {
+                        DataPtr data = reader->getDataSlice(varName, t);
+                        if (!sameValues(expected[t], data->asDouble(), data->size()))
+                            ++errors;
+                        // callers own the returned data, this must not leak into other slices
+                        if (data->size() > 0)
+                            data->setValue(0, -12345);
+                        break;
+                    }
+                    case 1: {
+                        SliceBuilder sb(cdm, varName);
+                        if (unlimDim && cdm.hasUnlimitedDim(cdm.getVariable(varName)))
+                            sb.setStartAndSize(unlimDim->getName(), t, 1);
+                        auto values = make_shared_array<double>(expected[t]->size());
+                        const size_t size = reader->readInto(varName, sb, CDM_DOUBLE, values.get());
+                        if (!sameValues(expected[t], values, size))
+                            ++errors;
+                        break;
+                    }
+                    default: {
+                        DataPtr data = reader->getDataSliceAsync(varName, t).get();
+                        if (!sameValues(expected[t], data->asDouble(), data->size()))
+                            ++errors;
+                        break;
+                    }
+                    }
+                } catch (exception&) {
+                    ++errors;
+                }
+            }
+        }));
+    }
+    for (thread& th : threads)
+        th.join();
+    return errors;
+}
+
+/**
+ * Reader of a variable "v", not declaring concurrent reading, and counting
+ * the threads reading at the same time.
+ */
+class CountingReader : public CDMReader
+{
+public:
+    CountingReader()
+        : active(0)
+        , maxActive(0)
+    {
+        cdm_->addDimension(CDMDimension("x", 16));
+        cdm_->addVariable(CDMVariable("v", CDM_FLOAT, vector<string>(1, "x")));
+    }
+
+    using CDMReader::getDataSlice;
+    DataPtr getDataSlice(const string&, size_t) override
+    {
+        const size_t now = ++active;
+        size_t seen = maxActive.load();
+        while (now > seen && !maxActive.compare_exchange_weak(seen, now)) {
+        }
+        this_thread::sleep_for(chrono::milliseconds(5));
+        --active;
+        return createData(CDM_FLOAT, 16, 1.);
+    }
+
+    atomic<size_t> active;
+    atomic<size_t> maxActive;
+};
+
+} // namespace
+
+TEST4FIMEX_TEST_CASE(test_serial_reader)
+{
+    const size_t nThreads = WorkerPool::shared().size();
+    WorkerPool::shared().resize(4);
+
+    std::shared_ptr<CountingReader> reader = std::make_shared<CountingReader>();
+    TEST4FIMEX_CHECK(!reader->supportsConcurrentReading());
+    std::shared_ptr<CDMExtractor> extract = std::make_shared<CDMExtractor>(reader);
+    TEST4FIMEX_CHECK(!extract->supportsConcurrentReading());
+
+    const vector<string> varNames(8, "v");
+    TEST4FIMEX_CHECK_EQ(reader->getDataSlices(varNames, 0).size(), varNames.size());
+    TEST4FIMEX_CHECK_EQ(extract->getDataSlices(varNames, 0).size(), varNames.size());
+    TEST4FIMEX_CHECK_EQ(reader->maxActive.load(), 1);
+
+    WorkerPool::shared().resize(nThreads);
+}
+
+#ifdef HAVE_FELT
+TEST4FIMEX_TEST_CASE(test_concurrent_felt)
+{
+    CDMReader_p feltReader = getFLTH00Reader();
+    if (!feltReader)
+        return;
+    TEST4FIMEX_CHECK(feltReader->supportsConcurrentReading());
+    TEST4FIMEX_CHECK_EQ(readConcurrently(feltReader, "air_temperature"), 0);
+}
+
+TEST4FIMEX_TEST_CASE(test_concurrent_extractor)
+{
+    CDMReader_p feltReader = getFLTH00Reader();
+    if (!feltReader)
+        return;
+    std::shared_ptr<CDMExtractor> extract = std::make_shared<CDMExtractor>(feltReader);
+    std::set<size_t> slices;
+    slices.insert(10); slices.insert(11); slices.insert(13); slices.insert(16);
+    extract->reduceDimension("y", slices);
+    extract->reduceDimension("x", 80, 50);
+    TEST4FIMEX_CHECK(extract->supportsConcurrentReading());
+    TEST4FIMEX_CHECK_EQ(readConcurrently(extract, "air_temperature"), 0);
+}
+
+TEST4FIMEX_TEST_CASE(test_concurrent_interpolator)
+{
+    CDMReader_p feltReader = getFLTH00Reader();
+    if (!feltReader)
+        return;
+    CDMInterpolator_p interpolator = std::make_shared<CDMInterpolator>(feltReader);
+    vector<double> xAxis, yAxis;
+    for (int i = -100; i < 10; i++) {
+        xAxis.push_back(i * 50000);
+        yAxis.push_back(i * 50000);
+    }
+    interpolator->changeProjection(MIFI_INTERPOL_BILINEAR,
+                                   "+proj=stere +lat_0=90 +lon_0=-32 +lat_ts=60 +ellps=sphere +a=" + type2string(MIFI_EARTH_RADIUS_M) + " +e=0", xAxis,
+                                   yAxis, "m", "m", CDM_DOUBLE, CDM_DOUBLE);
+    TEST4FIMEX_CHECK(interpolator->supportsConcurrentReading());
+    TEST4FIMEX_CHECK_EQ(readConcurrently(interpolator, "air_temperature"), 0);
+    TEST4FIMEX_CHECK_EQ(readConcurrently(interpolator, "x_wind_10m"), 0);
+}
+#endif // HAVE_FELT
+
+#ifdef HAVE_NETCDF_H
+TEST4FIMEX_TEST_CASE(test_concurrent_processor)
+{
+    CDMReader_p nc = CDMFileReaderFactory::create("netcdf", pathTest("coordTest.nc"));
+    TEST4FIMEX_CHECK_EQ(readConcurrently(nc, "x_wind_10m"), 0);
+
+    std::shared_ptr<CDMProcessor> proc = std::make_shared<CDMProcessor>(nc);
+    proc->accumulate("x_wind_10m");
+    proc->rotateAllVectorsToLatLon(true);
+    TEST4FIMEX_CHECK(proc->supportsConcurrentReading());
+    TEST4FIMEX_CHECK_EQ(readConcurrently(proc, "x_wind_10m"), 0);
+    TEST4FIMEX_CHECK_EQ(readConcurrently(proc, "y_wind_10m"), 0);
+}
+#endif // HAVE_NETCDF_H
+
+TEST4FIMEX_TEST_CASE(test_concurrent_data_view)
+{
+    // the first asInt() copies the strided view, all threads must see the complete copy
+    const size_t nx = 64, ny = 48;
+    DataPtr data = createData(CDM_INT, nx * ny);
+    for (size_t i = 0; i < nx * ny; ++i)
+        data->setValue(i, i);
+    const vector<size_t> orgDims{nx, ny}, start{3, 5}, size{40, 30};
+    for (size_t round = 0; round < N_READS; ++round) {
+        DataPtr view = createDataView(data, orgDims, start, size);
+        atomic<size_t> errors(0);
+        vector<thread> threads;
+        for (size_t n = 0; n < N_THREADS; ++n) {
+            threads.push_back(thread([&, n]() {
+                for (size_t i = 0; i < view->size(); ++i) {
+                    const size_t expected = (start[1] + i / size[0]) * nx + start[0] + i % size[0];
+                    const double value = (n % 2 == 0) ? view->asInt()[i] : view->getDouble(i);
+                    if (value != expected)
+                        errors += 1;
+                }
+            }));
+        }
+        for (thread& th : threads)
+            th.join();
+        TEST4FIMEX_CHECK_EQ(errors.load(), 0);
+    }
+}
@@ -22,9 +22,15 @@
  */
 
 #include "testinghelpers.h"
+#include "fimex/BufferPool.h"
 #include "fimex/Data.h"
+#include "fimex/MemoryBudget.h"
 #include "../src/DataImpl.h"
+#include "../src/ScaleKernels.h"
 #include "fimex/IndexedData.h"
+#include "fimex/mifi_constants.h"
+#include <cmath>
+#include <limits>
 
 using namespace std;
 using namespace MetNoFimex;
@@ -233,3 +239,255 @@ TEST4FIMEX_TEST_CASE(test_rounding)
         TEST4FIMEX_CHECK_MESSAGE(asI[j] == expect, "int:   i=" << i << " have == " << asI[j] << " expected " << expect);
     }
 }
+
+TEST4FIMEX_TEST_CASE(test_data_buffer_pool)
+{
+    const size_t size = 100000;
+    const BufferPool::Statistics before = BufferPool::statistics();
+    for (int i = 0; i < 5; i++) {
+        DataPtr data = createData(CDM_FLOAT, size, 1.5);
+        TEST4FIMEX_CHECK_EQ(data->asFloat()[size - 1], 1.5f);
+        data->setValue(size - 1, 2.5);
+    }
+    const BufferPool::Statistics after = BufferPool::statistics();
+    TEST4FIMEX_CHECK_EQ(after.requests - before.requests, 5);
+    TEST4FIMEX_CHECK(after.reused - before.reused >= 4);
+
+    // small arrays are not pooled
+    DataPtr small = createData(CDM_FLOAT, 10, 0.);
+    TEST4FIMEX_CHECK_EQ(BufferPool::statistics().requests, after.requests);
+
+    BufferPool::setMaxCachedBytes(0);
+    TEST4FIMEX_CHECK_EQ(BufferPool::statistics().cachedBytes, 0);
+    createData(CDM_DOUBLE, size, 0.);
+    TEST4FIMEX_CHECK_EQ(BufferPool::statistics().cachedBytes, 0);
+
+    // by default, the limit grows with the largest arrays
+    BufferPool::setMaxCachedBytes(BufferPool::AUTO_MAX_CACHED_BYTES);
+    const size_t large = 12 * 1024 * 1024; // 48MB of floats, beyond the minimum of 32MB
+    make_shared_array<float>(large);
+    TEST4FIMEX_CHECK(BufferPool::getMaxCachedBytes() >= 4 * large * sizeof(float));
+    TEST4FIMEX_CHECK(BufferPool::statistics().cachedBytes >= large * sizeof(float));
+    // or is a quarter of the memory limit
+    MemoryBudget::setLimit(size_t(400) * 1024 * 1024);
+    TEST4FIMEX_CHECK_EQ(BufferPool::getMaxCachedBytes(), size_t(100) * 1024 * 1024);
+    MemoryBudget::setLimit(0);
+    BufferPool::clear();
+
+    // arrays for first-touch placement are never reused
+    const size_t reusedBefore = BufferPool::statistics().reused;
+    make_shared_array<float>(size);
+    make_shared_array_fresh<float>(size);
+    TEST4FIMEX_CHECK_EQ(BufferPool::statistics().reused, reusedBefore);
+}
+
+TEST4FIMEX_TEST_CASE(test_data_view)
+{
+    // 4x3 array, value = 10*y + x
+    DataPtr data = createData(CDM_INT, 12);
+    for (int y = 0; y < 3; y++)
+        for (int x = 0; x < 4; x++)
+            data->setValue(y * 4 + x, 10 * y + x);
+
+    vector<size_t> orgDims{4, 3}, start{1, 1}, size{2, 2};
+    DataPtr view = createDataView(data, orgDims, start, size);
+    DataPtr sliced = data->slice(orgDims, start, size);
+    TEST4FIMEX_REQUIRE_EQ(view->size(), 4);
+    TEST4FIMEX_CHECK_EQ(view->getDataType(), CDM_INT);
+    TEST4FIMEX_CHECK_EQ(view->getDouble(3), 22);
+    TEST4FIMEX_CHECK_EQ(view->asString(","), sliced->asString(","));
+    TEST4FIMEX_CHECK_EQ(view->asDouble()[1], 12);
+
+    // slice of a view is a view on the same array
+    DataPtr viewSlice = view->slice(size, vector<size_t>{1, 0}, vector<size_t>{1, 2});
+    TEST4FIMEX_CHECK_EQ(viewSlice->asString(","), "12,22");
+    DataPtr flat = createDataView(view, 1, 2);
+    TEST4FIMEX_CHECK_EQ(flat->asString(","), "12,21");
+
+    // converting keeps the viewed data
+    DataPtr converted = view->convertDataType(-1, 1, 0, CDM_FLOAT, -1, 0.5, 0);
+    TEST4FIMEX_CHECK_EQ(converted->asFloat()[0], 22.f);
+
+    // modifying the view does not modify the viewed data
+    view->setValue(0, -5);
+    TEST4FIMEX_CHECK_EQ(view->getDouble(0), -5);
+    TEST4FIMEX_CHECK_EQ(data->getDouble(5), 11);
+    TEST4FIMEX_CHECK_EQ(viewSlice->getDouble(0), 12);
+
+    // arrays of the own type are writable, like for DataImpl
+    DataPtr view2 = createDataView(data, 4, 4);
+    view2->asInt()[0] = 99;
+    TEST4FIMEX_CHECK_EQ(view2->getLongLong(0), 99);
+    TEST4FIMEX_CHECK_EQ(data->getLongLong(4), 10);
+
+    // strings cannot be viewed, but are copied
+    DataPtr strings = createData("abcdef");
+    TEST4FIMEX_CHECK_EQ(createDataView(strings, 0, strings->size())->asString(), "abcdef");
+}
+
+namespace {
+template <typename IN, typename OUT>
+void checkScaleKernel(const vector<double>& values, double oldFill, double oldScale, double oldOffset, double newFill, double newScale, double newOffset)
+{
+    vector<IN> in(values.size());
+    for (size_t i = 0; i < values.size(); i++)
+        in[i] = static_cast<IN>(values[i]);
+
+    vector<OUT> expected(in.size());
+    std::transform(in.begin(), in.end(), expected.begin(), ScaleValue<IN, OUT>(oldFill, oldScale, oldOffset, newFill, newScale, newOffset));
+
+    const ScaleKernelIsa isas[] = {SCALE_ISA_DEFAULT, SCALE_ISA_SSE4, SCALE_ISA_AVX2, SCALE_ISA_AVX512};
+    const ScaleKernelIsa original = getScaleKernelIsa();
+    for (ScaleKernelIsa isa : isas) {
+        const ScaleKernelIsa used = setScaleKernelIsa(isa);
+        vector<OUT> out(in.size());
+        TEST4FIMEX_REQUIRE(scaleValues(ScaleKernelType<IN>::type, &in[0], in.size(), oldFill, oldScale / newScale, (oldOffset - newOffset) / newScale,
+                                       ScaleKernelType<OUT>::type, &out[0], newFill));
+        for (size_t i = 0; i < in.size(); i++) {
+            TEST4FIMEX_CHECK_MESSAGE(out[i] == expected[i] || (mifi_isnan(out[i]) && mifi_isnan(expected[i])),
+                                     "isa " << used << " i=" << i << ": " << out[i] << " != " << expected[i]);
+        }
+    }
+    setScaleKernelIsa(original);
+}
+} // namespace
+
+TEST4FIMEX_TEST_CASE(test_scale_kernels)
+{
+    vector<double> values;
+    for (int i = -200; i < 200; i++)
+        values.push_back(i * 0.25); // includes .5 for rounding
+    values.push_back(-999);
+    values.push_back(MIFI_UNDEFINED_D);
+
+    // unpacking
+    checkScaleKernel<short, float>(values, -999, 0.1, 273.15, MIFI_UNDEFINED_F, 1, 0);
+    checkScaleKernel<short, double>(values, -999, 0.1, 273.15, MIFI_UNDEFINED_D, 1, 0);
+    checkScaleKernel<unsigned char, float>(values, 255, 2, -10, MIFI_UNDEFINED_F, 1, 0);
+    // packing, with rounding
+    checkScaleKernel<float, short>(values, -999, 1, 0, -32767, 0.5, 0);
+    checkScaleKernel<double, int>(values, MIFI_UNDEFINED_D, 1, 0, -1, 0.25, 1);
+    checkScaleKernel<float, char>(values, -999, 1, 0, -128, 0.5, 0);
+    // type change only, e.g. with units
+    checkScaleKernel<double, float>(values, MIFI_UNDEFINED_D, 1.8, 32, MIFI_UNDEFINED_F, 1, 0);
+    checkScaleKernel<int, double>(values, -999, 1, 0, MIFI_UNDEFINED_D, 1, 0);
+
+    // types without kernel
+    long long l = 1;
+    double d = 0;
+    TEST4FIMEX_CHECK(!scaleValues(CDM_INT64, &l, 1, 0, 1, 0, CDM_DOUBLE, &d, 0));
+}
+
+TEST4FIMEX_TEST_CASE(test_scale_kernels_range)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    const vector<double> in = {1e6, -1e6, 32767.4, 32767.6, -32768.6, inf, -inf, MIFI_UNDEFINED_D, -999, 12.5};
+    const vector<short> expectedShort = {32767, -32768, 32767, 32767, -32768, 32767, -32768, -1, -1, 13};
+    const vector<unsigned char> expectedUChar = {255, 0, 255, 255, 0, 255, 0, 7, 7, 13};
+    const ScaleKernelIsa isas[] = {SCALE_ISA_DEFAULT, SCALE_ISA_SSE4, SCALE_ISA_AVX2, SCALE_ISA_AVX512};
+    const ScaleKernelIsa original = getScaleKernelIsa();
+    for (ScaleKernelIsa isa : isas) {
+        const ScaleKernelIsa used = setScaleKernelIsa(isa);
+        vector<short> outShort(in.size());
+        TEST4FIMEX_REQUIRE(scaleValues(CDM_DOUBLE, &in[0], in.size(), -999, 1, 0, CDM_SHORT, &outShort[0], -1));
+        vector<unsigned char> outUChar(in.size());
+        TEST4FIMEX_REQUIRE(scaleValues(CDM_DOUBLE, &in[0], in.size(), -999, 1, 0, CDM_UCHAR, &outUChar[0], 7));
+        for (size_t i = 0; i < in.size(); i++) {
+            TEST4FIMEX_CHECK_MESSAGE(outShort[i] == expectedShort[i], "isa " << used << " i=" << i << ": " << outShort[i] << " != " << expectedShort[i]);
+            TEST4FIMEX_CHECK_MESSAGE(outUChar[i] == expectedUChar[i], "isa " << used << " i=" << i << ": " << int(outUChar[i]) << " != " << int(expectedUChar[i]));
+        }
+
+        // inf * 0 is nan
+        const float infF = std::numeric_limits<float>::infinity();
+        int outInt = 0;
+        TEST4FIMEX_REQUIRE(scaleValues(CDM_FLOAT, &infF, 1, -999, 0, 0, CDM_INT, &outInt, -5));
+        TEST4FIMEX_CHECK_EQ(outInt, -5);
+    }
+    setScaleKernelIsa(original);
+}
+
+TEST4FIMEX_TEST_CASE(test_packed_data)
+{
+    const size_t n = 50000; // more than one unpack block
+    auto values = make_shared_array<float>(n);
+    for (size_t i = 0; i < n; i++)
+        values[i] = 200 + 100 * std::sin(i * 0.001);
+    values[7] = MIFI_UNDEFINED_F;
+    values[8] = -999;
+    DataPtr data = createData(n, values);
+
+    // int16: error at most half a step, 65533 steps for the range of 200
+    DataPtr i16 = createPackedData(*data, DATA_PACKING_INT16, -999);
+    TEST4FIMEX_CHECK_EQ(i16->getDataType(), CDM_FLOAT);
+    TEST4FIMEX_CHECK_EQ(i16->size(), n);
+    shared_array<double> u16 = i16->asDouble();
+    for (size_t i = 0; i < n; i++) {
+        if (i == 7 || i == 8)
+            continue;
+        TEST4FIMEX_CHECK(std::abs(u16[i] - values[i]) <= 200. / 65533);
+    }
+    TEST4FIMEX_CHECK(mifi_isnan(u16[7]));
+    TEST4FIMEX_CHECK_EQ(u16[8], -999);
+    TEST4FIMEX_CHECK_EQ(i16->getDouble(8), -999);
+
+    // fp16: 11 significant bits, values below 512
+    DataPtr f16 = createPackedData(*data, DATA_PACKING_FP16, -999);
+    shared_array<float> uf = f16->asFloat();
+    for (size_t i = 0; i < n; i++) {
+        if (i == 7 || i == 8)
+            continue;
+        TEST4FIMEX_CHECK(std::abs(uf[i] - values[i]) <= 0.125);
+    }
+    TEST4FIMEX_CHECK(mifi_isnan(uf[7]));
+    TEST4FIMEX_CHECK_EQ(uf[8], -999);
+    TEST4FIMEX_CHECK_EQ(f16->getLongLong(1), 200);
+
+    // changing a clone does not change the packed values
+    DataPtr f16c = f16->clone();
+    f16c->setValue(1, 5);
+    TEST4FIMEX_CHECK_EQ(f16c->getDouble(1), 5);
+    TEST4FIMEX_CHECK_EQ(f16->getDouble(1), uf[1]);
+    TEST4FIMEX_CHECK_EQ(static_cast<float*>(f16c->getDataPtr())[1], 5);
+
+    // slicing unpacks
+    DataPtr sl = i16->slice({n}, {10}, {3});
+    TEST4FIMEX_CHECK_EQ(sl->size(), 3);
+    TEST4FIMEX_CHECK_EQ(sl->getDouble(0), u16[10]);
+
+    // other types and no packing are copied
+    DataPtr ints = createData(CDM_INT, 5, 3.);
+    DataPtr pInts = createPackedData(*ints, DATA_PACKING_INT16, -1);
+    TEST4FIMEX_CHECK_EQ(pInts->getDataType(), CDM_INT);
+    TEST4FIMEX_CHECK_EQ(pInts->getLongLong(4), 3);
+    TEST4FIMEX_CHECK_EQ(createPackedData(*data, DATA_PACKING_NONE, -999)->getDouble(0), values[0]);
+}
+
+TEST4FIMEX_TEST_CASE(test_packed_data_range)
+{
+    // infinite values become the fill value of int16, values beyond the float range infinite fp16
+    const double inf = std::numeric_limits<double>::infinity();
+    const double big = 1e300;
+    auto values = make_shared_array<double>(6);
+    values[0] = -big;
+    values[1] = 0;
+    values[2] = big;
+    values[3] = inf;
+    values[4] = -inf;
+    values[5] = MIFI_UNDEFINED_D;
+    DataPtr data = createData(6, values);
+
+    shared_array<double> u16 = createPackedData(*data, DATA_PACKING_INT16, -999)->asDouble();
+    TEST4FIMEX_CHECK(std::abs(u16[0] + big) <= big / 32766);
+    TEST4FIMEX_CHECK(std::abs(u16[1]) <= big / 32766);
+    TEST4FIMEX_CHECK(std::abs(u16[2] - big) <= big / 32766);
+    TEST4FIMEX_CHECK_EQ(u16[3], -999);
+    TEST4FIMEX_CHECK_EQ(u16[4], -999);
+    TEST4FIMEX_CHECK(mifi_isnan(u16[5]));
+
+    shared_array<double> f16 = createPackedData(*data, DATA_PACKING_FP16, -999)->asDouble();
+    TEST4FIMEX_CHECK_EQ(f16[0], -inf);
+    TEST4FIMEX_CHECK_EQ(f16[1], 0);
+    TEST4FIMEX_CHECK_EQ(f16[2], inf);
+    TEST4FIMEX_CHECK_EQ(f16[3], inf);
+    TEST4FIMEX_CHECK(mifi_isnan(f16[5]));
+}
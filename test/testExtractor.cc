@@ -191,4 +191,32 @@ TEST4FIMEX_TEST_CASE(test_extract)
     TEST4FIMEX_CHECK(extract->getCDM().hasVariable("relative_humidity"));
     TEST4FIMEX_CHECK_EQ(false, extract->getCDM().hasVariable("precipitation_amount"));
 }
+
+TEST4FIMEX_TEST_CASE(test_extract_readInto)
+{
+    CDMReader_p feltReader = getFLTH00Reader();
+    if (!feltReader)
+        return;
+    std::shared_ptr<CDMExtractor> extract = std::make_shared<CDMExtractor>(feltReader);
+    std::set<size_t> slices;
+    slices.insert(10); slices.insert(11); slices.insert(13); slices.insert(16);
+    extract->reduceDimension("y", slices);
+    extract->reduceDimension("x", 80, 50);
+
+    SliceBuilder sb(extract->getCDM(), "air_temperature");
+    sb.setStartAndSize("time", 2, 3);
+    DataPtr expected = extract->getDataSlice("air_temperature", sb);
+    TEST4FIMEX_REQUIRE_EQ(expected->size(), 4 * 50 * 3);
+
+    std::vector<float> values(expected->size());
+    TEST4FIMEX_CHECK_EQ(extract->readInto("air_temperature", sb, CDM_FLOAT, &values[0]), expected->size());
+    auto expectedValues = expected->asFloat();
+    for (size_t i = 0; i < values.size(); i++) {
+        TEST4FIMEX_CHECK_EQ(expectedValues[i], values[i]);
+    }
+
+    std::vector<double> dvalues(expected->size());
+    TEST4FIMEX_CHECK_EQ(extract->readInto("air_temperature", sb, CDM_DOUBLE, &dvalues[0]), expected->size());
+    TEST4FIMEX_CHECK_EQ(expected->asDouble()[17], dvalues[17]);
+}
 #endif // HAVE_FELT
@@ -25,16 +25,28 @@
 #include "fimex/interpolation.h"
 
 #include "fimex/CDMAttribute.h"
+#include "fimex/CachedInterpolation.h"
+#include "fimex/CachedVectorReprojection.h"
 #include "fimex/Data.h"
+#include "fimex/FindNeighborElements.h"
 #include "fimex/MathUtils.h"
+#include "fimex/WeightMatrix.h"
 
 #include "fimex/reproject.h"
 
+#include "../src/AnalyticProjection.h"
+#include "../src/AxisLookup.h"
+#include "../src/CachedForwardInterpolation.h"
+#include "../src/Fill2d.h"
+
+#include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <numeric>
 #include <string>
+#include <vector>
 
-using MetNoFimex::pathTest;
+using namespace MetNoFimex;
 using namespace MetNoFimex::reproject;
 
 namespace {
@@ -42,6 +54,74 @@ inline bool near(float a, float b, float eps)
 {
     return std::fabs(a - b) < eps;
 }
+
+/**
+ * Input and output positions shared by the tests of the cached interpolations:
+ * inZ layers of 23x17 smooth values with a nan at (4, 3), and outX*outY
+ * scattered positions covering the input and beyond its borders. The first
+ * position is next to the nan, the second exactly on the upper border.
+ */
+struct CachedInterpolationFixture
+{
+    CachedInterpolationFixture(size_t inZ, size_t outX, size_t outY);
+
+    size_t inSize() const { return inX * inY * inZ; }
+    size_t nanPos() const { return 3 * inX + 4; }
+    /// smooth input values without nan
+    shared_array<float> values(double scale, double phase = 0) const;
+    /// integer input values with bad at the nan position
+    shared_array<short> shortValues(short bad) const;
+    CachedInterpolationInterface_p create(int method) const;
+
+    const size_t inX, inY, inZ, outX, outY;
+    shared_array<float> inData;
+    shared_array<double> pointsX, pointsY;
+};
+
+CachedInterpolationFixture::CachedInterpolationFixture(size_t inZ, size_t outX, size_t outY)
+    : inX(23)
+    , inY(17)
+    , inZ(inZ)
+    , outX(outX)
+    , outY(outY)
+    , inData(values(100))
+    , pointsX(make_shared_array<double>(outX * outY))
+    , pointsY(make_shared_array<double>(outX * outY))
+{
+    inData[nanPos()] = MIFI_UNDEFINED_F;
+    for (size_t xy = 0; xy < outX * outY; ++xy) {
+        pointsX[xy] = -1.5 + (inX + 2.) * ((xy * 7919) % 1000) / 1000.;
+        pointsY[xy] = -1.5 + (inY + 0.9) * ((xy * 104729) % 1000) / 1000.; // lround(y) < inY
+    }
+    pointsX[0] = 4.25;
+    pointsY[0] = 3;
+    pointsX[1] = inX - 1;
+    pointsY[1] = inY - 1;
+}
+
+shared_array<float> CachedInterpolationFixture::values(double scale, double phase) const
+{
+    auto data = make_shared_array<float>(inSize());
+    for (size_t i = 0; i < inSize(); ++i)
+        data[i] = std::sin(0.37 * i + phase) * scale;
+    return data;
+}
+
+shared_array<short> CachedInterpolationFixture::shortValues(short bad) const
+{
+    auto data = make_shared_array<short>(inSize());
+    for (size_t i = 0; i < inSize(); ++i)
+        data[i] = (i * 37) % 1000;
+    data[nanPos()] = bad;
+    return data;
+}
+
+CachedInterpolationInterface_p CachedInterpolationFixture::create(int method) const
+{
+    return createCachedInterpolation("x", "y", method, pointsX, pointsY, inX, inY, outX, outY);
+}
+
+const int CACHED_METHODS[] = {MIFI_INTERPOL_BILINEAR, MIFI_INTERPOL_BICUBIC, MIFI_INTERPOL_NEAREST_NEIGHBOR};
 } // namespace
 
 TEST4FIMEX_TEST_CASE(mifi_points2position)
@@ -66,6 +146,111 @@ TEST4FIMEX_TEST_CASE(mifi_points2position_reverse)
     }
 }
 
+TEST4FIMEX_TEST_CASE(axis_lookup_positions)
+{
+    std::vector<std::vector<double>> axes;
+    std::vector<int> types;
+    std::vector<double> axis;
+    for (int i = 0; i < 50; ++i)
+        axis.push_back(-10 + 2 * i);
+    axes.push_back(axis); // regular
+    types.push_back(MIFI_PROJ_AXIS);
+    std::reverse(axis.begin(), axis.end());
+    axes.push_back(axis); // regular, descending
+    types.push_back(MIFI_PROJ_AXIS);
+    axis.clear();
+    for (int i = 0; i < 50; ++i)
+        axis.push_back(static_cast<float>(60 + 0.1f * i));
+    axes.push_back(axis); // regular with rounding errors
+    types.push_back(MIFI_LATITUDE);
+    axis.clear();
+    for (int i = 0; i < 50; ++i)
+        axis.push_back(0.05 * i * i - 3);
+    axes.push_back(axis); // irregular
+    types.push_back(MIFI_PROJ_AXIS);
+    std::reverse(axis.begin(), axis.end());
+    axes.push_back(axis); // irregular, descending
+    types.push_back(MIFI_PROJ_AXIS);
+    axis.clear();
+    for (int i = 0; i < 72; ++i)
+        axis.push_back(5 * i);
+    axes.push_back(axis); // circular 0..355
+    types.push_back(MIFI_LONGITUDE);
+    axis.clear();
+    for (int i = 0; i < 72; ++i)
+        axis.push_back(175 - 5 * i);
+    axes.push_back(axis); // circular descending 175..-180
+    types.push_back(MIFI_LONGITUDE);
+    axis.clear();
+    for (int i = 0; i < 20; ++i)
+        axis.push_back(-30 + 3 * i + (i % 3));
+    axes.push_back(axis); // irregular longitude, not circular
+    types.push_back(MIFI_LONGITUDE);
+    axes.push_back({3, 1, 2, 4}); // not monotonic
+    types.push_back(MIFI_PROJ_AXIS);
+
+    for (size_t a = 0; a < axes.size(); ++a) {
+        const std::vector<double>& ax = axes[a];
+        // sorted points, grid rows of sorted points, and shuffled points, including exact axis values and undefined points
+        std::vector<double> sorted;
+        for (int i = 0; i <= 400; ++i)
+            sorted.push_back(-400 + 2 * i + 0.37);
+        sorted.insert(sorted.end(), ax.begin(), ax.end());
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<double> rows;
+        for (int r = 0; r < 5; ++r)
+            rows.insert(rows.end(), sorted.begin(), sorted.end());
+        std::vector<double> shuffled = sorted;
+        unsigned int seed = 17;
+        for (size_t i = shuffled.size() - 1; i > 0; --i) {
+            seed = seed * 1103515245 + 12345;
+            std::swap(shuffled[i], shuffled[(seed >> 8) % (i + 1)]);
+        }
+        shuffled.push_back(std::nan(""));
+        shuffled.push_back(HUGE_VAL);
+        shuffled.push_back(-HUGE_VAL);
+
+        for (std::vector<double> points : {sorted, rows, shuffled}) {
+            std::vector<double> expected = points;
+            mifi_points2position(&expected[0], expected.size(), &ax[0], ax.size(), types[a]);
+            AxisLookup(&ax[0], ax.size(), types[a]).positions(&points[0], points.size());
+            size_t differences = 0;
+            for (size_t i = 0; i < points.size(); ++i)
+                differences += (points[i] != expected[i]);
+            TEST4FIMEX_CHECK_EQ(differences, 0);
+        }
+    }
+    TEST4FIMEX_CHECK(AxisLookup(&axes[0][0], axes[0].size()).isRegular());
+    TEST4FIMEX_CHECK(AxisLookup(&axes[2][0], axes[2].size()).isRegular());
+    TEST4FIMEX_CHECK(!AxisLookup(&axes[3][0], axes[3].size()).isRegular());
+    TEST4FIMEX_CHECK(!AxisLookup(&axes.back()[0], axes.back().size()).isMonotonic());
+}
+
+TEST4FIMEX_TEST_CASE(axis_lookup_neighbors)
+{
+    const std::vector<float> pressure = {1000, 925, 850, 700, 500, 300, 250, 200, 100, 50};
+    std::vector<float> height = {2, 10, 20, 50, 100, 200, 300, 400, 500};
+    std::vector<float> regular;
+    for (int i = 0; i < 30; ++i)
+        regular.push_back(100 + 25 * i);
+    for (const std::vector<float>& levels : {pressure, height, regular}) {
+        const std::vector<double> dlevels(levels.begin(), levels.end());
+        const AxisLookup lookup(&dlevels[0], dlevels.size());
+        TEST4FIMEX_REQUIRE(lookup.isMonotonic());
+        std::vector<double> xs = dlevels;
+        for (int i = -40; i <= 1200; ++i)
+            xs.push_back(i + 0.5);
+        xs.push_back(std::nan(""));
+        size_t differences = 0;
+        for (double x : xs) {
+            const std::pair<size_t, size_t> pos = lookup.neighbors(x);
+            const std::pair<size_t, size_t> expected = find_closest_neighbor_distinct_elements(levels.begin(), levels.end(), x);
+            differences += (pos != expected);
+        }
+        TEST4FIMEX_CHECK_EQ(differences, 0);
+    }
+}
+
 TEST4FIMEX_TEST_CASE(mifi_get_values_bilinear_f)
 {
     float infield[4] = {1., 2., 2., 1+std::sqrt(2.0f)}; // (0,0), (0,1), (1,0), (1,1) #(y,x)
@@ -139,6 +324,378 @@ TEST4FIMEX_TEST_CASE(mifi_get_values_bicubic_f)
     TEST4FIMEX_CHECK(std::isnan(outvalues[0]));
 }
 
+TEST4FIMEX_TEST_CASE(cached_interpolation_weights)
+{
+    // the precomputed weights must give the same values as the mifi-functions, including borders,
+    // bicubic up to the rounding of the weights to float
+    const CachedInterpolationFixture f(5, 11, 13);
+    const size_t outXY = f.outX * f.outY;
+    for (int method : {MIFI_INTERPOL_BILINEAR, MIFI_INTERPOL_BICUBIC}) {
+        CachedInterpolation ci("x", "y", method, f.pointsX, f.pointsY, f.inX, f.inY, f.outX, f.outY);
+        TEST4FIMEX_REQUIRE_EQ(ci.getInX(), f.inX);
+        TEST4FIMEX_REQUIRE_EQ(ci.getInY(), f.inY);
+        size_t newSize = 0;
+        shared_array<float> outData = ci.interpolateValues(f.inData, f.inSize(), newSize);
+        TEST4FIMEX_REQUIRE_EQ(newSize, outXY * f.inZ);
+
+        // the test cases hide the mifi-functions of the same name
+        int (*func)(const float*, float*, const double, const double, const int, const int, const int) = ::mifi_get_values_bicubic_f;
+        if (method == MIFI_INTERPOL_BILINEAR)
+            func = ::mifi_get_values_bilinear_f;
+        const float eps = (method == MIFI_INTERPOL_BICUBIC) ? 1e-4 : 0;
+        std::vector<float> expected(f.inZ);
+        for (size_t xy = 0; xy < outXY; ++xy) {
+            func(f.inData.get(), &expected[0], f.pointsX[xy], f.pointsY[xy], f.inX, f.inY, f.inZ);
+            for (size_t z = 0; z < f.inZ; ++z) {
+                const float v = outData[z * outXY + xy];
+                TEST4FIMEX_CHECK_MESSAGE(std::abs(v - expected[z]) <= eps || (std::isnan(v) && std::isnan(expected[z])),
+                                         "method " << method << " xy=" << xy << " z=" << z << ": " << v << " != " << expected[z]);
+            }
+        }
+    }
+}
+
+TEST4FIMEX_TEST_CASE(weight_matrix_apply)
+{
+    const float nan = MIFI_UNDEFINED_F;
+    WeightMatrix unit(3);
+    unit.addWeight(1, 1);
+    unit.endRow();
+    unit.endRow(); // empty
+    unit.addWeight(2, 1);
+    unit.addWeight(0, 1);
+    unit.endRow();
+    TEST4FIMEX_REQUIRE_EQ(unit.rows(), 3);
+    TEST4FIMEX_REQUIRE_EQ(unit.nonZeros(), 3);
+    TEST4FIMEX_CHECK(unit.weights().empty());
+
+    WeightMatrix m(3);
+    m.addWeight(0, 1);
+    m.endRow();
+    m.addWeight(0, .25);
+    m.addWeight(1, .75);
+    m.endRow();
+    m.endRow(); // empty
+    TEST4FIMEX_REQUIRE_EQ(m.rows(), 3);
+    TEST4FIMEX_REQUIRE_EQ(m.weights().size(), 3);
+
+    // two layers, the second has a nan in column 1
+    const float in[] = {4, 8, 2, 8, nan, 4};
+    float outUnit[6], out[6];
+    unit.apply(in, outUnit, 2);
+    m.apply(in, out, 2);
+
+    TEST4FIMEX_CHECK_EQ(outUnit[0], 8);
+    TEST4FIMEX_CHECK(std::isnan(outUnit[1]));
+    TEST4FIMEX_CHECK_EQ(outUnit[2], 6);
+    TEST4FIMEX_CHECK(std::isnan(outUnit[3]));
+    TEST4FIMEX_CHECK_EQ(outUnit[5], 12);
+    TEST4FIMEX_CHECK_EQ(out[0], 4);
+    TEST4FIMEX_CHECK_EQ(out[1], 7);
+    TEST4FIMEX_CHECK(std::isnan(out[2]));
+    TEST4FIMEX_CHECK_EQ(out[3], 8);
+    TEST4FIMEX_CHECK(std::isnan(out[4]));
+}
+
+TEST4FIMEX_TEST_CASE(cached_interpolation_weight_matrix)
+{
+    // nearest neighbor interpolates by applying its weight matrix, compare with mifi_get_values_f
+    const CachedInterpolationFixture f(3, 11, 13);
+    const size_t outXY = f.outX * f.outY;
+    CachedNNInterpolation ci("x", "y", f.pointsX, f.pointsY, f.inX, f.inY, f.outX, f.outY);
+    TEST4FIMEX_REQUIRE_EQ(ci.getInX(), f.inX);
+    WeightMatrix_cp m = ci.weightMatrix();
+    TEST4FIMEX_REQUIRE(m);
+    TEST4FIMEX_REQUIRE_EQ(m->rows(), outXY);
+    TEST4FIMEX_REQUIRE_EQ(m->columns(), f.inX * f.inY);
+
+    size_t newSize = 0;
+    shared_array<float> outData = ci.interpolateValues(f.inData, f.inSize(), newSize);
+    TEST4FIMEX_REQUIRE_EQ(newSize, outXY * f.inZ);
+    std::vector<float> expected(f.inZ);
+    for (size_t xy = 0; xy < outXY; ++xy) {
+        ::mifi_get_values_f(f.inData.get(), &expected[0], f.pointsX[xy], f.pointsY[xy], f.inX, f.inY, f.inZ);
+        for (size_t z = 0; z < f.inZ; ++z) {
+            const float v = outData[z * outXY + xy], e = expected[z];
+            TEST4FIMEX_CHECK_MESSAGE(v == e || (std::isnan(v) && std::isnan(e)), "xy=" << xy << " z=" << z << ": " << v << " != " << e);
+        }
+    }
+}
+
+TEST4FIMEX_TEST_CASE(cached_interpolation_double)
+{
+    // double values are interpolated like float values, but without losing precision
+    const CachedInterpolationFixture f(2, 11, 13);
+    const double offset = 1e9;
+    auto inDataD = make_shared_array<double>(f.inSize());
+    for (size_t i = 0; i < f.inSize(); ++i)
+        inDataD[i] = offset + f.inData[i];
+    for (int method : CACHED_METHODS) {
+        CachedInterpolationInterface_p ci = f.create(method);
+        size_t newSize = 0, newSizeD = 0;
+        shared_array<float> expected = ci->interpolateValues(f.inData, f.inSize(), newSize);
+        shared_array<double> outData = ci->interpolateValues(inDataD, f.inSize(), newSizeD);
+        TEST4FIMEX_REQUIRE_EQ(newSizeD, newSize);
+        for (size_t i = 0; i < newSize; ++i) {
+            const double v = outData[i] - offset, e = expected[i];
+            TEST4FIMEX_CHECK_MESSAGE((std::isnan(v) && std::isnan(e)) || std::abs(v - e) <= 1e-3,
+                                     "method " << method << " i=" << i << ": " << v << " != " << e);
+        }
+    }
+}
+
+TEST4FIMEX_TEST_CASE(cached_interpolation_vector_values)
+{
+    // interpolating and rotating both components together must give the results of the separate passes
+    const CachedInterpolationFixture f(3, 41, 37);
+    shared_array<float> uData = f.values(10);
+    shared_array<float> vData = f.values(10, 1);
+    vData[f.nanPos()] = MIFI_UNDEFINED_F;
+
+    auto matrix = std::make_shared<Matrix>(f.outX, f.outY);
+    for (size_t xy = 0; xy < f.outX * f.outY; ++xy) {
+        const double angle = 0.001 * xy;
+        matrix->mtx()[xy * Matrix::stride + 0] = std::cos(angle);
+        matrix->mtx()[xy * Matrix::stride + 1] = std::sin(angle);
+        matrix->mtx()[xy * Matrix::stride + 2] = rad_to_deg(angle);
+    }
+    const CachedVectorReprojection cvr(matrix);
+
+    for (int method : CACHED_METHODS) {
+        CachedInterpolationInterface_p ci = f.create(method);
+        size_t newSize = 0, vectorSize = 0;
+        shared_array<float> uExpected = ci->interpolateValues(uData, f.inSize(), newSize);
+        shared_array<float> vExpected = ci->interpolateValues(vData, f.inSize(), newSize);
+        cvr.reprojectValues(uExpected, vExpected, newSize);
+
+        shared_array<float> uOut, vOut;
+        ci->interpolateVectorValues(uData, vData, f.inSize(), cvr, uOut, vOut, vectorSize);
+        TEST4FIMEX_REQUIRE_EQ(vectorSize, newSize);
+        for (size_t i = 0; i < newSize; ++i) {
+            TEST4FIMEX_CHECK_MESSAGE((std::isnan(uOut[i]) && std::isnan(uExpected[i])) || uOut[i] == uExpected[i],
+                                     "method " << method << " u i=" << i << ": " << uOut[i] << " != " << uExpected[i]);
+            TEST4FIMEX_CHECK_MESSAGE((std::isnan(vOut[i]) && std::isnan(vExpected[i])) || vOut[i] == vExpected[i],
+                                     "method " << method << " v i=" << i << ": " << vOut[i] << " != " << vExpected[i]);
+        }
+    }
+}
+
+TEST4FIMEX_TEST_CASE(cached_interpolation_batch)
+{
+    // interpolating several fields in one pass must give the results of interpolateValues
+    const CachedInterpolationFixture f(3, 41, 37);
+    const size_t nFields = 4;
+    std::vector<shared_array<float>> inData;
+    for (size_t field = 0; field < nFields; ++field)
+        inData.push_back(f.values(10, field));
+    inData[1][f.nanPos()] = MIFI_UNDEFINED_F;
+
+    for (int method : CACHED_METHODS) {
+        CachedInterpolationInterface_p ci = f.create(method);
+        size_t batchSize = 0;
+        std::vector<shared_array<float>> outData = ci->interpolateBatch(inData, f.inSize(), batchSize);
+        TEST4FIMEX_REQUIRE_EQ(outData.size(), nFields);
+        for (size_t field = 0; field < nFields; ++field) {
+            size_t newSize = 0;
+            shared_array<float> expected = ci->interpolateValues(inData[field], f.inSize(), newSize);
+            TEST4FIMEX_REQUIRE_EQ(batchSize, newSize);
+            for (size_t i = 0; i < newSize; ++i) {
+                const float v = outData[field][i], e = expected[i];
+                TEST4FIMEX_CHECK_MESSAGE((std::isnan(v) && std::isnan(e)) || v == e,
+                                         "method " << method << " field " << field << " i=" << i << ": " << v << " != " << e);
+            }
+        }
+    }
+}
+
+TEST4FIMEX_TEST_CASE(cached_interpolation_native_datatype)
+{
+    // nearest neighbor copies values in their own datatype
+    const CachedInterpolationFixture f(2, 11, 13);
+    const short bad = -32767;
+    shared_array<short> inShort = f.shortValues(bad);
+    auto inFloat = make_shared_array<float>(f.inSize());
+    for (size_t i = 0; i < f.inSize(); ++i)
+        inFloat[i] = (inShort[i] == bad) ? MIFI_UNDEFINED_F : inShort[i];
+
+    CachedInterpolationInterface_p nn = f.create(MIFI_INTERPOL_NEAREST_NEIGHBOR);
+    size_t newSize = 0, newSizeNative = 0;
+    shared_array<float> expected = nn->interpolateValues(inFloat, f.inSize(), newSize);
+    DataPtr outData = nn->interpolateData(createData(f.inSize(), inShort), bad, newSizeNative);
+    TEST4FIMEX_REQUIRE(outData);
+    TEST4FIMEX_REQUIRE_EQ(outData->getDataType(), CDM_SHORT);
+    TEST4FIMEX_REQUIRE_EQ(newSizeNative, newSize);
+    TEST4FIMEX_REQUIRE_EQ(outData->size(), newSize);
+    auto outShort = outData->asShort();
+    TEST4FIMEX_CHECK_EQ(outShort[0], bad);
+    for (size_t i = 0; i < newSize; ++i) {
+        if (std::isnan(expected[i]))
+            TEST4FIMEX_CHECK_EQ(outShort[i], bad);
+        else
+            TEST4FIMEX_CHECK_EQ(outShort[i], expected[i]);
+    }
+
+    // bilinear needs arithmetic
+    CachedInterpolationInterface_p bl = f.create(MIFI_INTERPOL_BILINEAR);
+    TEST4FIMEX_CHECK(!bl->interpolateData(createData(f.inSize(), inShort), bad, newSizeNative));
+}
+
+TEST4FIMEX_TEST_CASE(cached_separable_interpolation)
+{
+    // positions per column and row must give the same results as all positions; only the input of the fixture is used
+    const CachedInterpolationFixture f(3, 29, 19);
+    const size_t inX = f.inX, inY = f.inY, inZ = f.inZ, outX = f.outX, outY = f.outY;
+    const short bad = -32767;
+    shared_array<float> inFloat = f.inData;
+    shared_array<short> inShort = f.shortValues(bad);
+    auto inDouble = make_shared_array<double>(f.inSize());
+    std::copy(&inFloat[0], &inFloat[0] + f.inSize(), &inDouble[0]);
+
+    for (int reduced = 0; reduced < 2; ++reduced) {
+        // all of the input and beyond the border, or a part of the input
+        const double x0 = reduced ? 6.2 : -1.7, dx = reduced ? 0.3 : (inX + 2.5) / outX;
+        const double y0 = reduced ? 12.9 : -1.4, dy = reduced ? -0.25 : (inY + 1.7) / outY;
+        auto columns = make_shared_array<double>(outX);
+        auto rows = make_shared_array<double>(outY);
+        for (size_t c = 0; c < outX; ++c)
+            columns[c] = x0 + c * dx;
+        for (size_t r = 0; r < outY; ++r)
+            rows[r] = y0 + r * dy;
+        columns[5] = MIFI_UNDEFINED_D;
+        rows[3] = 3; // next to the nan
+        for (int method : CACHED_METHODS) {
+            auto pointsX = make_shared_array<double>(outX * outY);
+            auto pointsY = make_shared_array<double>(outX * outY);
+            for (size_t r = 0; r < outY; ++r) {
+                for (size_t c = 0; c < outX; ++c) {
+                    pointsX[r * outX + c] = columns[c];
+                    pointsY[r * outX + c] = rows[r];
+                }
+            }
+            CachedInterpolationInterface_p ci = createCachedInterpolation("x", "y", method, pointsX, pointsY, inX, inY, outX, outY);
+            CachedSeparableInterpolation si("x", "y", method, columns, rows, inX, inY, outX, outY);
+            TEST4FIMEX_REQUIRE_EQ(si.getInX(), ci->getInX());
+            TEST4FIMEX_REQUIRE_EQ(si.getInY(), ci->getInY());
+            TEST4FIMEX_REQUIRE_EQ(!si.reducedDomain(), !ci->reducedDomain());
+            if (ci->reducedDomain()) {
+                TEST4FIMEX_CHECK_EQ(si.reducedDomain()->xMin, ci->reducedDomain()->xMin);
+                TEST4FIMEX_CHECK_EQ(si.reducedDomain()->yMin, ci->reducedDomain()->yMin);
+            }
+            // the input of the (reduced) domain
+            const size_t rInX = ci->getInX(), rInY = ci->getInY();
+            const size_t xMin = ci->reducedDomain() ? ci->reducedDomain()->xMin : 0, yMin = ci->reducedDomain() ? ci->reducedDomain()->yMin : 0;
+            const size_t size = rInX * rInY * inZ;
+            auto rFloat = make_shared_array<float>(size);
+            auto rDouble = make_shared_array<double>(size);
+            auto rShort = make_shared_array<short>(size);
+            for (size_t z = 0; z < inZ; ++z) {
+                for (size_t y = 0; y < rInY; ++y) {
+                    for (size_t x = 0; x < rInX; ++x) {
+                        const size_t i = (z * inY + y + yMin) * inX + x + xMin, ri = (z * rInY + y) * rInX + x;
+                        rFloat[ri] = inFloat[i];
+                        rDouble[ri] = inDouble[i];
+                        rShort[ri] = inShort[i];
+                    }
+                }
+            }
+
+            size_t newSize = 0, newSizeSeparable = 0;
+            shared_array<float> expectedFloat = ci->interpolateValues(rFloat, size, newSize);
+            shared_array<float> outFloat = si.interpolateValues(rFloat, size, newSizeSeparable);
+            TEST4FIMEX_REQUIRE_EQ(newSizeSeparable, newSize);
+            shared_array<double> expectedDouble = ci->interpolateValues(rDouble, size, newSize);
+            shared_array<double> outDouble = si.interpolateValues(rDouble, size, newSizeSeparable);
+            TEST4FIMEX_REQUIRE_EQ(newSizeSeparable, newSize);
+            size_t defined = 0;
+            for (size_t i = 0; i < newSize; ++i) {
+                const float e = expectedFloat[i], v = outFloat[i];
+                TEST4FIMEX_CHECK_MESSAGE(v == e || (std::isnan(v) && std::isnan(e)), "method " << method << " i=" << i << ": " << v << " != " << e);
+                const double ed = expectedDouble[i], vd = outDouble[i];
+                TEST4FIMEX_CHECK_MESSAGE(vd == ed || (std::isnan(vd) && std::isnan(ed)), "method " << method << " i=" << i << ": " << vd << " != " << ed);
+                if (!std::isnan(e))
+                    defined += 1;
+            }
+            TEST4FIMEX_CHECK(defined > newSize / 2);
+
+            DataPtr expectedShort = ci->interpolateData(createData(size, rShort), bad, newSize);
+            DataPtr outShort = si.interpolateData(createData(size, rShort), bad, newSizeSeparable);
+            TEST4FIMEX_CHECK_EQ(!outShort, !expectedShort);
+            if (expectedShort && outShort) {
+                TEST4FIMEX_REQUIRE_EQ(newSizeSeparable, newSize);
+                auto e = expectedShort->asShort();
+                auto v = outShort->asShort();
+                for (size_t i = 0; i < newSize; ++i)
+                    TEST4FIMEX_CHECK_EQ(v[i], e[i]);
+            }
+        }
+    }
+}
+
+TEST4FIMEX_TEST_CASE(cached_forward_interpolation)
+{
+    // input points 2x2 each to one output point, some outside, with nan values; checked against a brute-force aggregation
+    const size_t inX = 8, inY = 6, inZ = 3, outX = 4, outY = 3, inLayer = inX * inY;
+    auto pointsX = make_shared_array<double>(inLayer);
+    auto pointsY = make_shared_array<double>(inLayer);
+    for (size_t iy = 0; iy < inY; ++iy) {
+        for (size_t ix = 0; ix < inX; ++ix) {
+            pointsX[iy * inX + ix] = ix / 2;
+            pointsY[iy * inX + ix] = (iy == 0) ? -5. : iy / 2;
+        }
+    }
+    auto inData = make_shared_array<float>(inLayer * inZ);
+    for (size_t i = 0; i < inLayer * inZ; ++i)
+        inData[i] = std::fmod(i * 7.3, 11.) - 3;
+    inData[1 * inX + 2] = inData[1 * inX + 3] = MIFI_UNDEFINED_F;
+    inData[inLayer + 3 * inX + 5] = MIFI_UNDEFINED_F;
+
+    const int methods[] = {MIFI_INTERPOL_FORWARD_SUM,       MIFI_INTERPOL_FORWARD_MEAN,       MIFI_INTERPOL_FORWARD_MEDIAN,
+                           MIFI_INTERPOL_FORWARD_MAX,       MIFI_INTERPOL_FORWARD_MIN,        MIFI_INTERPOL_FORWARD_UNDEF_SUM,
+                           MIFI_INTERPOL_FORWARD_UNDEF_MEAN, MIFI_INTERPOL_FORWARD_UNDEF_MEDIAN, MIFI_INTERPOL_FORWARD_UNDEF_MAX,
+                           MIFI_INTERPOL_FORWARD_UNDEF_MIN};
+    for (int method : methods) {
+        const bool undef = (method >= MIFI_INTERPOL_FORWARD_UNDEF_SUM);
+        CachedForwardInterpolation ci("x", "y", method, pointsX, pointsY, inX, inY, outX, outY);
+        // the unused first row is within the extension for pre/postprocessing, the domain is not reduced
+        TEST4FIMEX_REQUIRE_EQ(ci.getInX(), inX);
+        TEST4FIMEX_REQUIRE_EQ(ci.getInY(), inY);
+
+        size_t newSize = 0;
+        shared_array<float> outData = ci.interpolateValues(inData, inLayer * inZ, newSize);
+        TEST4FIMEX_REQUIRE_EQ(newSize, outX * outY * inZ);
+        for (size_t z = 0; z < inZ; ++z) {
+            for (size_t o = 0; o < outX * outY; ++o) {
+                std::vector<float> values;
+                for (size_t i = inX; i < inLayer; ++i) {
+                    const float v = inData[z * inLayer + i];
+                    if (pointsY[i] * outX + pointsX[i] == o && (undef || !std::isnan(v)))
+                        values.push_back(v);
+                }
+                float expected = MIFI_UNDEFINED_F;
+                if (!values.empty()) {
+                    std::sort(values.begin(), values.end());
+                    const double sum = std::accumulate(values.begin(), values.end(), 0.);
+                    if (method == MIFI_INTERPOL_FORWARD_SUM || method == MIFI_INTERPOL_FORWARD_UNDEF_SUM)
+                        expected = sum;
+                    else if (method == MIFI_INTERPOL_FORWARD_MEAN || method == MIFI_INTERPOL_FORWARD_UNDEF_MEAN)
+                        expected = sum / values.size();
+                    else if (std::any_of(values.begin(), values.end(), [](float v) { return std::isnan(v); }))
+                        continue; // order of nan in median, min and max is not defined
+                    else if (method == MIFI_INTERPOL_FORWARD_MEDIAN || method == MIFI_INTERPOL_FORWARD_UNDEF_MEDIAN)
+                        expected = values[values.size() / 2];
+                    else if (method == MIFI_INTERPOL_FORWARD_MAX || method == MIFI_INTERPOL_FORWARD_UNDEF_MAX)
+                        expected = values.back();
+                    else
+                        expected = values.front();
+                }
+                const float v = outData[z * outX * outY + o];
+                TEST4FIMEX_CHECK_MESSAGE((std::isnan(v) && std::isnan(expected)) || std::abs(v - expected) < 1e-5,
+                                         "method " << method << " z=" << z << " o=" << o << ": " << v << " != " << expected);
+            }
+        }
+    }
+}
+
 TEST4FIMEX_TEST_CASE(mifi_get_values_linear_f)
 {
     const int nr = 4;
@@ -246,6 +803,93 @@ namespace {
 const std::string latlongProj = "+proj=latlong +a=6370 +e=0";
 } // namespace
 
+namespace {
+// a linear field, undefined in an inner disc across three tiles of creepfill2dTiled, and in a corner
+const size_t FILL_NX = 97, FILL_NY = 83;
+bool inFillDisc(size_t x, size_t y)
+{
+    const double dx = x - 48.5, dy = y - 41.2;
+    return dx * dx + dy * dy < 30 * 30;
+}
+std::vector<float> fillTestField(bool withHoles)
+{
+    std::vector<float> field(FILL_NX * FILL_NY);
+    for (size_t y = 0; y < FILL_NY; ++y) {
+        for (size_t x = 0; x < FILL_NX; ++x) {
+            const bool hole = inFillDisc(x, y) || (x > 80 && y < 8);
+            field[y * FILL_NX + x] = (withHoles && hole) ? MIFI_UNDEFINED_F : 5 + 0.3 * x - 0.2 * y;
+        }
+    }
+    return field;
+}
+} // namespace
+
+TEST4FIMEX_TEST_CASE(fill2d_parallel)
+{
+    const std::vector<float> exact = fillTestField(false);
+    const std::vector<float> input = fillTestField(true);
+    // inner holes of a linear, i.e. harmonic, field are filled with the field itself
+    for (int method = 0; method < 4; ++method) {
+        std::vector<float> field = input;
+        size_t nChanged = 0;
+        if (method == 0)
+            mifi_fill2d_f(FILL_NX, FILL_NY, &field[0], 1e-4, 1.6, 2000, &nChanged);
+        else if (method == 1)
+            nChanged = fill2dRedBlack(FILL_NX, FILL_NY, &field[0], 1e-4, 1.6, 2000);
+        else if (method == 2)
+            nChanged = fill2dMultigrid(FILL_NX, FILL_NY, &field[0], 1e-4, 1.6, 2000);
+        else
+            nChanged = fill2dMultigrid(FILL_NX, FILL_NY, &field[0], 1e-4, 1.6, 30); // few sweeps are enough
+        TEST4FIMEX_CHECK(nChanged > 2500);
+        float maxInnerError = 0;
+        size_t changedDefined = 0, undefined = 0;
+        for (size_t y = 0; y < FILL_NY; ++y) {
+            for (size_t x = 0; x < FILL_NX; ++x) {
+                const size_t i = y * FILL_NX + x;
+                changedDefined += (!mifi_isnan(input[i]) && field[i] != input[i]);
+                undefined += mifi_isnan(field[i]);
+                if (inFillDisc(x, y))
+                    maxInnerError = std::max(maxInnerError, std::fabs(field[i] - exact[i]));
+            }
+        }
+        TEST4FIMEX_CHECK_EQ(changedDefined, 0);
+        TEST4FIMEX_CHECK_EQ(undefined, 0);
+        // the multigrid fill converges further before the convergence test stops it
+        TEST4FIMEX_CHECK_MESSAGE(maxInnerError < (method < 2 ? 0.2 : 0.1), "method " << method << " error " << maxInnerError);
+    }
+
+    // like mifi_fill2d_f, fewer than 5 loops never test for convergence
+    std::vector<float> loose = input, strict = input;
+    fill2dRedBlack(FILL_NX, FILL_NY, &loose[0], 1e3, 1.6, 3);
+    fill2dRedBlack(FILL_NX, FILL_NY, &strict[0], 1e-9, 1.6, 3);
+    TEST4FIMEX_CHECK(std::equal(loose.begin(), loose.end(), strict.begin(), [](float a, float b) { return a == b || (mifi_isnan(a) && mifi_isnan(b)); }));
+}
+
+TEST4FIMEX_TEST_CASE(creepfill2d_tiled)
+{
+    const std::vector<float> input = fillTestField(true);
+    for (int withDefault = 0; withDefault < 2; ++withDefault) {
+        std::vector<float> serial = input, tiled = input;
+        size_t nChanged = 0;
+        if (withDefault) {
+            mifi_creepfillval2d_f(FILL_NX, FILL_NY, &serial[0], 10, 20, 2, &nChanged);
+            TEST4FIMEX_CHECK_EQ(creepfillval2dTiled(FILL_NX, FILL_NY, &tiled[0], 10, 20, 2), nChanged);
+        } else {
+            mifi_creepfill2d_f(FILL_NX, FILL_NY, &serial[0], 20, 2, &nChanged);
+            TEST4FIMEX_CHECK_EQ(creepfill2dTiled(FILL_NX, FILL_NY, &tiled[0], 20, 2), nChanged);
+        }
+        // the tiles change the order of the updates only
+        float maxDiff = 0;
+        size_t changedDefined = 0;
+        for (size_t i = 0; i < input.size(); ++i) {
+            changedDefined += (!mifi_isnan(input[i]) && tiled[i] != input[i]);
+            maxDiff = std::max(maxDiff, std::fabs(tiled[i] - serial[i]));
+        }
+        TEST4FIMEX_CHECK_EQ(changedDefined, 0);
+        TEST4FIMEX_CHECK_MESSAGE(maxDiff < 0.5, "difference to serial creepfill " << maxDiff);
+    }
+}
+
 TEST4FIMEX_TEST_CASE(mifi_project_axes)
 {
     const std::string emepProj = "+proj=stere +a=127.4 +lat_0=90 +lon_0=-32 +lat_ts=60 +x_0=7 +y_0=109";
@@ -260,6 +904,91 @@ TEST4FIMEX_TEST_CASE(mifi_project_axes)
             TEST4FIMEX_CHECK(MetNoFimex::rad_to_deg(outY[j + 3 * i]) > 89);
 }
 
+TEST4FIMEX_TEST_CASE(analytic_projection_support)
+{
+    const std::string wgs84 = "+proj=latlong +datum=WGS84 +towgs84=0,0,0 +no_defs";
+    TEST4FIMEX_CHECK(AnalyticTransform::create(wgs84, "+proj=stere +lat_0=90 +lon_0=-32 +lat_ts=60 +ellps=WGS84 +no_defs"));
+    TEST4FIMEX_CHECK(AnalyticTransform::create(wgs84, "+proj=lcc +lat_0=63 +lon_0=15 +lat_1=63 +lat_2=63 +R=6371000 +no_defs"));
+    TEST4FIMEX_CHECK(AnalyticTransform::create(wgs84, "+proj=ob_tran +o_proj=longlat +lon_0=-40 +o_lat_p=22 +a=6367470 +e=0 +no_defs"));
+    TEST4FIMEX_CHECK(!AnalyticTransform::create(wgs84, "+proj=merc +datum=WGS84 +no_defs"));
+    TEST4FIMEX_CHECK(!AnalyticTransform::create(wgs84, "+proj=stere +lat_0=90 +lon_0=0 +ellps=intl +towgs84=-87,-98,-121 +no_defs"));
+    TEST4FIMEX_CHECK(!AnalyticTransform::create(wgs84, "+proj=stere +lat_0=90 +lon_0=0 +ellps=WGS84 +units=km +no_defs"));
+}
+
+TEST4FIMEX_TEST_CASE(analytic_projection_matches_proj)
+{
+    const std::string wgs84 = "+proj=latlong +datum=WGS84 +towgs84=0,0,0 +no_defs";
+    const char* projs[] = {"+proj=stere +lat_0=90 +lon_0=-32 +lat_ts=60 +a=6371000 +e=0 +x_0=100000 +y_0=200000 +no_defs",
+                           "+proj=stere +lat_0=90 +lon_0=0 +lat_ts=70 +ellps=WGS84 +no_defs",
+                           "+proj=stere +lat_0=-90 +lon_0=0 +k=0.994 +ellps=WGS84 +no_defs",
+                           "+proj=lcc +lat_0=63 +lon_0=15 +lat_1=63 +lat_2=63 +a=6371000 +e=0 +no_defs",
+                           "+proj=lcc +lat_0=40 +lon_0=-96 +lat_1=33 +lat_2=45 +datum=WGS84 +no_defs",
+                           "+proj=ob_tran +o_proj=longlat +lon_0=-40 +o_lat_p=22 +a=6367470 +e=0 +no_defs",
+                           "+proj=latlong +a=6371000 +e=0 +no_defs"};
+
+    const size_t n = 4096;
+    std::vector<double> lon(n), lat(n);
+    for (size_t i = 0; i < n; ++i) {
+        lon[i] = -179.5 + 359. * (i % 64) / 63;
+        lat[i] = 20 + 65. * (i / 64) / 63;
+    }
+    for (const char* proj : projs) {
+        const double sign = (std::string(proj).find("lat_0=-90") != std::string::npos) ? -1 : 1;
+        std::vector<double> x[2], y[2];
+        for (int analytic = 0; analytic < 2; ++analytic) {
+            const bool enabled = setAnalyticTransformsEnabled(analytic);
+            x[analytic] = lon;
+            y[analytic] = lat;
+            for (size_t i = 0; i < n; ++i)
+                y[analytic][i] *= sign;
+            reproject_values(wgs84, proj, &x[analytic][0], &y[analytic][0], n);
+            setAnalyticTransformsEnabled(enabled);
+        }
+        // a small call gives the same results as the large one
+        {
+            const bool enabled = setAnalyticTransformsEnabled(true);
+            const size_t m = 17;
+            std::vector<double> sx(lon.begin(), lon.begin() + m), sy(m);
+            for (size_t i = 0; i < m; ++i)
+                sy[i] = sign * lat[i];
+            reproject_values(wgs84, proj, &sx[0], &sy[0], m);
+            setAnalyticTransformsEnabled(enabled);
+            for (size_t i = 0; i < m; ++i) {
+                TEST4FIMEX_CHECK_EQ(sx[i], x[1][i]);
+                TEST4FIMEX_CHECK_EQ(sy[i], y[1][i]);
+            }
+        }
+
+        // also AnalyticTransform directly, without the checks in reproject
+        std::vector<double> ax = lon, ay(n);
+        for (size_t i = 0; i < n; ++i)
+            ay[i] = sign * lat[i];
+        std::unique_ptr<AnalyticTransform> at = AnalyticTransform::create(wgs84, proj);
+        TEST4FIMEX_CHECK(at);
+        if (at)
+            at->fwd(n, &ax[0], &ay[0]);
+        for (size_t i = 0; i < n; ++i) {
+            TEST4FIMEX_CHECK_CLOSE(x[0][i], x[1][i], 1e-3);
+            TEST4FIMEX_CHECK_CLOSE(y[0][i], y[1][i], 1e-3);
+            TEST4FIMEX_CHECK_CLOSE(x[0][i], ax[i], 1e-3);
+            TEST4FIMEX_CHECK_CLOSE(y[0][i], ay[i], 1e-3);
+        }
+
+        // and back
+        for (int analytic = 0; analytic < 2; ++analytic) {
+            const bool enabled = setAnalyticTransformsEnabled(analytic);
+            reproject_values(proj, wgs84, &x[analytic][0], &y[analytic][0], n);
+            setAnalyticTransformsEnabled(enabled);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            TEST4FIMEX_CHECK_CLOSE(x[0][i], x[1][i], 1e-7);
+            TEST4FIMEX_CHECK_CLOSE(y[0][i], y[1][i], 1e-7);
+            TEST4FIMEX_CHECK_CLOSE(lon[i], x[1][i], 1e-6);
+            TEST4FIMEX_CHECK_CLOSE(sign * lat[i], y[1][i], 1e-6);
+        }
+    }
+}
+
 TEST4FIMEX_TEST_CASE(mifi_interpolate_f)
 {
     const int iSize = 170;
@@ -34,11 +34,104 @@
 
 #include "testinghelpers.h"
 
+#include "../src/InterpolationCache.h"
+#include "../src/LatLonBuckets.h"
+
 using namespace std;
 using namespace MetNoFimex;
 
 static const int DEBUG = 0;
 
+TEST4FIMEX_TEST_CASE(interpolation_cache)
+{
+    const std::vector<double> axis = {1, 2, 3.5};
+    const std::string key = InterpolationCacheKey().add("test").add(axis).add(7LL).str();
+    TEST4FIMEX_CHECK_EQ(key.size(), 32);
+    TEST4FIMEX_CHECK_EQ(key, InterpolationCacheKey().add("test").add(axis).add(7LL).str());
+    TEST4FIMEX_CHECK_NE(key, InterpolationCacheKey().add("test").add(axis).add(8LL).str());
+    TEST4FIMEX_CHECK_NE(key, InterpolationCacheKey().add("tes").add(axis).add(7LL).str());
+
+    InterpolationCache& cache = InterpolationCache::shared();
+    cache.setMemoryLimit(size_t(1) << 20);
+    shared_array<double> x = make_shared_array<double>(4), y = make_shared_array<double>(4);
+    for (size_t i = 0; i < 4; ++i) {
+        x[i] = 0.5 + i;
+        y[i] = -1. - i;
+    }
+    std::vector<shared_array<double>> found;
+    TEST4FIMEX_CHECK(!cache.find(key, found, 2, 4));
+    cache.insert(key, {x, y}, 4);
+    TEST4FIMEX_CHECK(!cache.find(key, found, 2, 3));
+    TEST4FIMEX_CHECK(!cache.find(key, found, 1, 4));
+    TEST4FIMEX_REQUIRE(cache.find(key, found, 2, 4));
+    TEST4FIMEX_REQUIRE_EQ(found.size(), 2);
+    // shared, not copied
+    TEST4FIMEX_CHECK(found[0] == x);
+    TEST4FIMEX_CHECK(found[1] == y);
+
+    // least recently used entries are removed first
+    const std::string key2 = InterpolationCacheKey().add("test2").str();
+    cache.setMemoryLimit(10 * sizeof(double));
+    cache.insert(key2, {x}, 4);
+    TEST4FIMEX_CHECK(cache.find(key2, found, 1, 4));
+    TEST4FIMEX_CHECK(!cache.find(key, found, 2, 4));
+
+    // stored in a directory, found after clearing the memory
+    cache.setDirectory(".");
+    cache.insert(key, {x, y}, 4);
+    cache.clear();
+    TEST4FIMEX_REQUIRE(cache.find(key, found, 2, 4));
+    TEST4FIMEX_CHECK(found[1] != y);
+    for (size_t i = 0; i < 4; ++i)
+        TEST4FIMEX_CHECK_EQ(found[1][i], y[i]);
+
+    // a limit of 0 disables the memory cache
+    cache.setDirectory("");
+    cache.setMemoryLimit(0);
+    cache.clear();
+    cache.insert(key2, {x}, 4);
+    TEST4FIMEX_CHECK(!cache.find(key2, found, 1, 4));
+    cache.setMemoryLimit(InterpolationCache::DEFAULT_MEMORY_LIMIT);
+}
+
+TEST4FIMEX_TEST_CASE(latlon_buckets)
+{
+    // curvilinear grid crossing the date-line and reaching the north-pole, with undefined points
+    const size_t nx = 60, ny = 40, size = nx * ny;
+    std::vector<double> lon(size), lat(size);
+    for (size_t iy = 0; iy < ny; ++iy) {
+        for (size_t ix = 0; ix < nx; ++ix) {
+            lon[ix + iy * nx] = 150 + ix * 1.5 + iy * 0.3;
+            lat[ix + iy * nx] = 40 + iy * 1.2 + 0.05 * ix;
+        }
+    }
+    lon[7] = lat[77] = MIFI_UNDEFINED_D;
+
+    const double maxDist = deg_to_rad(2.);
+    const LatLonBuckets buckets(&lon[0], &lat[0], size, maxDist);
+    TEST4FIMEX_CHECK_EQ(buckets.size(), size - 2);
+
+    for (double qlat = 35; qlat <= 90; qlat += 0.7) {
+        for (double qlon = -200; qlon <= 300; qlon += 3.1) {
+            // brute force
+            const double qlatR = deg_to_rad(qlat), qlonR = deg_to_rad(qlon);
+            size_t expected = LatLonBuckets::NOT_FOUND;
+            double maxCos = cos(maxDist);
+            for (size_t i = 0; i < size; ++i) {
+                const double latR = deg_to_rad(lat[i]), lonR = deg_to_rad(lon[i]);
+                const double cosD = cos(latR) * cos(qlatR) * cos(lonR - qlonR) + sin(latR) * sin(qlatR);
+                if (cosD > maxCos + 1e-12) {
+                    maxCos = cosD;
+                    expected = i;
+                }
+            }
+            const size_t found = buckets.closest(qlon, qlat, maxDist);
+            TEST4FIMEX_CHECK_MESSAGE(found == expected, "lon=" << qlon << " lat=" << qlat << ": " << found << " != " << expected);
+        }
+    }
+    TEST4FIMEX_CHECK_EQ(buckets.closest(MIFI_UNDEFINED_D, 50, maxDist), LatLonBuckets::NOT_FOUND);
+}
+
 #if defined(HAVE_FELT)
 TEST4FIMEX_TEST_CASE(interpolator)
 {
@@ -108,6 +201,62 @@ TEST4FIMEX_TEST_CASE(interpolatorRelative)
     TEST4FIMEX_CHECK_EQ(interpolator->getDataSlice("x")->size(), 297);
     TEST4FIMEX_CHECK_EQ(interpolator->getDataSlice("y")->size(), 286);
 }
+
+TEST4FIMEX_TEST_CASE(interpolatorLazy)
+{
+    CDMReader_p feltReader = getFLTH00Reader();
+    if (!feltReader)
+        return;
+    CDMInterpolator_p interpolator = std::make_shared<CDMInterpolator>(feltReader);
+    interpolator->changeProjection(MIFI_INTERPOL_BILINEAR,
+                                   "+proj=stere +lat_0=90 +lon_0=-32 +lat_ts=60 +ellps=sphere +a=" + type2string(MIFI_EARTH_RADIUS_M) + " +e=0",
+                                   "0,50000,...,x;relativeStart=0", "0,50000,...,x;relativeStart=0", "m", "m");
+
+    // lat/lon are defined, but computed only when read
+    const CDM& cdm = interpolator->getCDM();
+    TEST4FIMEX_REQUIRE(cdm.hasVariable("lat"));
+    TEST4FIMEX_CHECK(!cdm.getVariable("lat").hasData());
+    TEST4FIMEX_CHECK_EQ(cdm.getUnits("lat"), "degree_north");
+
+    DataPtr latData = interpolator->getDataSlice("lat");
+    TEST4FIMEX_CHECK_EQ(latData->size(), 297 * 286);
+    // the values are kept by the interpolator, the CDM is not changed by reading
+    TEST4FIMEX_CHECK(!cdm.getVariable("lat").hasData());
+    TEST4FIMEX_CHECK_EQ(interpolator->getDataSlice("lon")->size(), 297 * 286);
+    auto latArray = latData->asDouble();
+    TEST4FIMEX_CHECK(*std::min_element(latArray.get(), latArray.get() + latData->size()) > -90);
+    TEST4FIMEX_CHECK(*std::max_element(latArray.get(), latArray.get() + latData->size()) < 90);
+
+    // the interpolation is set up by the first read
+    TEST4FIMEX_CHECK_EQ(interpolator->getDataSlice("altitude")->size(), 297 * 286);
+}
+
+TEST4FIMEX_TEST_CASE(interpolatorBatch)
+{
+    CDMReader_p feltReader = getFLTH00Reader();
+    if (!feltReader)
+        return;
+    CDMInterpolator_p interpolator = std::make_shared<CDMInterpolator>(feltReader);
+    interpolator->changeProjection(MIFI_INTERPOL_BILINEAR,
+                                   "+proj=stere +lat_0=90 +lon_0=-32 +lat_ts=60 +ellps=sphere +a=" + type2string(MIFI_EARTH_RADIUS_M) + " +e=0",
+                                   "0,50000,...,x;relativeStart=0", "0,50000,...,x;relativeStart=0", "m", "m");
+
+    // variables interpolated together must give the same values as one by one
+    const vector<string> varNames = {"air_temperature", "x", "relative_humidity", "x_wind_10m", "altitude", "y_wind_10m"};
+    const vector<DataPtr> batch = interpolator->getDataSlices(varNames, 1);
+    TEST4FIMEX_REQUIRE_EQ(batch.size(), varNames.size());
+    for (size_t i = 0; i < varNames.size(); ++i) {
+        DataPtr single = interpolator->getDataSlice(varNames[i], 1);
+        TEST4FIMEX_REQUIRE(batch[i]);
+        TEST4FIMEX_REQUIRE_EQ(batch[i]->size(), single->size());
+        TEST4FIMEX_CHECK_EQ(batch[i]->getDataType(), single->getDataType());
+        auto b = batch[i]->asDouble();
+        auto s = single->asDouble();
+        for (size_t j = 0; j < single->size(); ++j) {
+            TEST4FIMEX_CHECK_MESSAGE(b[j] == s[j] || (std::isnan(b[j]) && std::isnan(s[j])), varNames[i] << "[" << j << "]: " << b[j] << " != " << s[j]);
+        }
+    }
+}
 #endif // HAVE_FELT
 
 #if defined(HAVE_NETCDF_H)
@@ -0,0 +1,117 @@
+/*
+  Fimex, test/testPerformanceNuma.cc
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  Project Info:  https://wiki.met.no/fimex/start
+
+  This library is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+  USA.
+*/
+
+/*
+  Benchmark of the scaling of CachedInterpolation::interpolateValues with the
+  number of worker threads, for the different thread placements and with input
+  data first touched by one thread or by all workers.
+
+  usage: testPerformanceNuma [nx [nz [repeat]]]
+
+  On a multi-socket machine, "serial" input should stop scaling once the
+  memory bandwidth of one socket is used up, while "parallel" input with
+  spread placement should keep scaling across the sockets.
+*/
+
+#include "fimex/CachedInterpolation.h"
+#include "fimex/WorkerPool.h"
+#include "fimex/interpolation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    using namespace std;
+    using namespace MetNoFimex;
+
+    const size_t nx = (argc > 1) ? atoi(argv[1]) : 2000;
+    const size_t nz = (argc > 2) ? atoi(argv[2]) : 30;
+    const int repeat = (argc > 3) ? atoi(argv[3]) : 5;
+
+    // output grid shifted by half a cell, all points are interpolated
+    auto pointsOnX = make_shared_array<double>(nx * nx);
+    auto pointsOnY = make_shared_array<double>(nx * nx);
+    for (size_t y = 0; y < nx; ++y) {
+        for (size_t x = 0; x < nx; ++x) {
+            pointsOnX[y * nx + x] = std::min(x + 0.5, nx - 1.);
+            pointsOnY[y * nx + x] = std::min(y + 0.5, nx - 1.);
+        }
+    }
+    CachedInterpolation ci("x", "y", MIFI_INTERPOL_BILINEAR, pointsOnX, pointsOnY, nx, nx, nx, nx);
+
+    const size_t size = nx * nx * nz;
+    vector<size_t> nThreads;
+    const size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t n = 1; n < maxThreads; n *= 2)
+        nThreads.push_back(n);
+    nThreads.push_back(maxThreads);
+
+    const char* affinityNames[] = {"none", "compact", "spread"};
+    const WorkerPool::Affinity affinities[] = {WorkerPool::AFFINITY_NONE, WorkerPool::AFFINITY_COMPACT, WorkerPool::AFFINITY_SPREAD};
+
+    cout << "field " << nx << "x" << nx << "x" << nz << ", " << repeat << " repetitions" << endl;
+    cout << setw(8) << "threads" << setw(10) << "affinity" << setw(10) << "input" << setw(12) << "seconds" << setw(10) << "speedup" << endl;
+    for (int a = 0; a < 3; ++a) {
+        for (int parallelInput = 0; parallelInput < 2; ++parallelInput) {
+            double t1 = 0;
+            for (size_t n : nThreads) {
+                WorkerPool::shared().resize(n);
+                WorkerPool::shared().setAffinity(affinities[a]);
+
+                shared_array<float> input;
+                if (parallelInput) {
+                    input = make_shared_array_parallel<float>(size, 1.f);
+                } else {
+                    // not a buffer of the previous run, already placed by the parallel fill
+                    input = make_shared_array_fresh<float>(size);
+                    std::fill(input.get(), input.get() + size, 1.f);
+                }
+
+                size_t newSize = 0;
+                ci.interpolateValues(input, size, newSize); // warm up, first touch of the output
+                const auto start = chrono::steady_clock::now();
+                for (int r = 0; r < repeat; ++r)
+                    ci.interpolateValues(input, size, newSize);
+                const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count() / repeat;
+                if (n == 1)
+                    t1 = seconds;
+                cout << setw(8) << n << setw(10) << affinityNames[a] << setw(10) << (parallelInput ? "parallel" : "serial") << setw(12) << fixed
+                     << setprecision(4) << seconds << setw(10) << setprecision(2) << (t1 / seconds) << endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+  Fimex, test/testPerformanceProjection.cc
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  Project Info:  https://wiki.met.no/fimex/start
+
+  This library is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+  USA.
+*/
+
+/*
+  Benchmark of reproject::reproject_values with proj and with the analytic
+  transforms, from latitude/longitude to the common projections and back.
+
+  usage: testPerformanceProjection [points [isa]]
+
+  isa is one of default, sse4, avx2, avx512 and selects the instruction set
+  of the analytic kernels, as for the scale kernels. The maximum difference
+  is in m for projected output and in degree for latitude/longitude output.
+*/
+
+#include "fimex/reproject.h"
+
+#include "../src/AnalyticProjection.h"
+#include "../src/ScaleKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+double reprojectSeconds(const std::string& from, const std::string& to, std::vector<double>& x, std::vector<double>& y)
+{
+    const auto start = std::chrono::steady_clock::now();
+    MetNoFimex::reproject::reproject_values(from, to, &x[0], &y[0], x.size());
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    using namespace std;
+    using namespace MetNoFimex;
+
+    const size_t n = (argc > 1) ? atoi(argv[1]) : 1000000;
+    if (argc > 2) {
+        const char* isaNames[] = {"default", "sse4", "avx2", "avx512"};
+        const ScaleKernelIsa isas[] = {SCALE_ISA_DEFAULT, SCALE_ISA_SSE4, SCALE_ISA_AVX2, SCALE_ISA_AVX512};
+        for (int i = 0; i < 4; ++i)
+            if (strcmp(argv[2], isaNames[i]) == 0)
+                setScaleKernelIsa(isas[i]);
+    }
+
+    const string latlon = "+proj=latlong +datum=WGS84 +towgs84=0,0,0 +no_defs";
+    const char* projNames[] = {"stere sphere", "stere ellps", "lcc sphere", "lcc ellps", "rotated"};
+    const char* projs[] = {"+proj=stere +lat_0=90 +lon_0=-32 +lat_ts=60 +a=6371000 +e=0 +no_defs",
+                           "+proj=stere +lat_0=90 +lon_0=0 +lat_ts=70 +ellps=WGS84 +no_defs",
+                           "+proj=lcc +lat_0=63 +lon_0=15 +lat_1=63 +lat_2=63 +a=6371000 +e=0 +no_defs",
+                           "+proj=lcc +lat_0=63.3 +lon_0=15 +lat_1=63.3 +lat_2=63.3 +ellps=WGS84 +no_defs",
+                           "+proj=ob_tran +o_proj=longlat +lon_0=-40 +o_lat_p=22 +a=6367470 +e=0 +no_defs"};
+
+    // points on the northern hemisphere, valid for all projections
+    vector<double> lon(n), lat(n);
+    const size_t side = max<size_t>(1, sqrt(double(n)));
+    for (size_t i = 0; i < n; ++i) {
+        lon[i] = -180 + 360. * (i % side) / side;
+        lat[i] = 20 + 60. * (i / side) / ((n + side - 1) / side);
+    }
+
+    cout << n << " points" << endl;
+    cout << setw(14) << "projection" << setw(10) << "direction" << setw(12) << "proj [s]" << setw(14) << "analytic [s]" << setw(10) << "speedup"
+         << setw(12) << "max diff" << endl;
+    const bool enabled = reproject::analyticTransformsEnabled();
+    for (int p = 0; p < 5; ++p) {
+        for (int inverse = 0; inverse < 2; ++inverse) {
+            const string from = inverse ? projs[p] : latlon;
+            const string to = inverse ? latlon : projs[p];
+            vector<double> x0 = lon, y0 = lat;
+            if (inverse)
+                reproject::reproject_values(latlon, projs[p], &x0[0], &y0[0], n);
+
+            double seconds[2];
+            vector<double> x[2], y[2];
+            for (int analytic = 0; analytic < 2; ++analytic) {
+                reproject::setAnalyticTransformsEnabled(analytic);
+                x[analytic] = x0;
+                y[analytic] = y0;
+                seconds[analytic] = reprojectSeconds(from, to, x[analytic], y[analytic]);
+            }
+            double maxDiff = 0;
+            for (size_t i = 0; i < n; ++i)
+                maxDiff = max(maxDiff, max(fabs(x[0][i] - x[1][i]), fabs(y[0][i] - y[1][i])));
+
+            cout << setw(14) << projNames[p] << setw(10) << (inverse ? "to ll" : "from ll") << setw(12) << fixed << setprecision(4) << seconds[0]
+                 << setw(14) << seconds[1] << setw(10) << setprecision(2) << (seconds[0] / seconds[1]) << setw(12) << scientific << setprecision(1)
+                 << maxDiff << endl;
+        }
+    }
+    reproject::setAnalyticTransformsEnabled(enabled);
+    return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Fimex, testWorkerPool.cc
+ *
+ * (C) Copyright 2026, met.no
+ *
+ * Project Info:  https://wiki.met.no/fimex/start
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include "testinghelpers.h"
+
+#include "fimex/CDMException.h"
+#include "fimex/CDMReader.h"
+#include "fimex/Data.h"
+#include "fimex/MemoryBudget.h"
+#include "fimex/SliceBuilder.h"
+#include "fimex/ThreadPool.h"
+#include "fimex/WorkerPool.h"
+#include "fimex/mifi_constants.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace MetNoFimex;
+
+TEST4FIMEX_TEST_CASE(test_workerpool_submit)
+{
+    WorkerPool pool(3);
+    TEST4FIMEX_CHECK_EQ(pool.size(), 3);
+
+    vector<future<int>> results;
+    for (int i = 0; i < 20; ++i)
+        results.push_back(pool.submit([i]() { return i * i; }));
+    for (int i = 0; i < 20; ++i)
+        TEST4FIMEX_CHECK_EQ(results[i].get(), i * i);
+}
+
+TEST4FIMEX_TEST_CASE(test_workerpool_exception)
+{
+    future<int> result = WorkerPool::shared().submit([]() -> int { throw CDMException("expected"); });
+    TEST4FIMEX_CHECK_THROW(result.get(), CDMException);
+}
+
+TEST4FIMEX_TEST_CASE(test_workerpool_parallelFor)
+{
+    WorkerPool pool(4);
+    std::atomic<size_t> sum(0);
+    pool.parallelFor(0, 100, [&](size_t i) {
+        // nested loop, uses the workers left over by the outer loop
+        pool.parallelFor(0, 100, [&](size_t j) { sum += i * j; });
+    });
+    TEST4FIMEX_CHECK_EQ(sum.load(), 4950 * 4950);
+
+    TEST4FIMEX_CHECK_THROW(pool.parallelFor(0, 1000, [](size_t i) {
+        if (i == 500)
+            throw CDMException("expected");
+    }),
+                           CDMException);
+
+    pool.resize(2);
+    TEST4FIMEX_CHECK_EQ(pool.size(), 2);
+    sum = 0;
+    pool.parallelFor(0, 1000, [&](size_t i) { sum += i; });
+    TEST4FIMEX_CHECK_EQ(sum.load(), 999 * 1000 / 2);
+}
+
+TEST4FIMEX_TEST_CASE(test_workerpool_wait)
+{
+    // a task waiting for another task must not block the only worker
+    WorkerPool pool(1);
+    future<int> result = pool.submit([&pool]() {
+        future<int> inner = pool.submit([]() { return 42; });
+        return pool.get(inner);
+    });
+    TEST4FIMEX_CHECK_EQ(pool.get(result), 42);
+}
+
+TEST4FIMEX_TEST_CASE(test_workerpool_wait_group)
+{
+    // waiting runs the tasks submitted by the waiting thread, not unrelated ones
+    WorkerPool pool(1);
+    std::atomic<bool> started(false), release(false);
+    future<void> blocker = pool.submit([&]() {
+        started = true;
+        while (!release)
+            this_thread::yield();
+    });
+    while (!started)
+        this_thread::yield();
+
+    future<thread::id> unrelated;
+    thread other([&]() { unrelated = pool.submit([]() { return this_thread::get_id(); }); });
+    other.join();
+
+    future<thread::id> own = pool.submit([]() { return this_thread::get_id(); });
+    TEST4FIMEX_CHECK(pool.get(own) == this_thread::get_id());
+    TEST4FIMEX_CHECK(unrelated.wait_for(chrono::seconds(0)) != future_status::ready);
+
+    release = true;
+    pool.wait(blocker);
+    TEST4FIMEX_CHECK(pool.get(unrelated) != this_thread::get_id());
+}
+
+TEST4FIMEX_TEST_CASE(test_setNumThreads)
+{
+#ifndef _OPENMP
+    // serial until asked for more threads
+    TEST4FIMEX_CHECK_EQ(WorkerPool::shared().size(), 1);
+#endif
+    TEST4FIMEX_CHECK_EQ(mifi_setNumThreads(3), MIFI_OK);
+    TEST4FIMEX_CHECK_EQ(mifi_getNumThreads(), 3);
+    TEST4FIMEX_CHECK_EQ(WorkerPool::shared().size(), 3);
+    future<int> fromWorker = WorkerPool::shared().submit([]() { return mifi_setNumThreads(2); });
+    TEST4FIMEX_CHECK_EQ(fromWorker.get(), MIFI_ERROR);
+}
+
+TEST4FIMEX_TEST_CASE(test_memory_budget)
+{
+    const size_t mb = 1024 * 1024;
+    const size_t live = MemoryBudget::liveBytes();
+    MemoryBudget::resetPeak();
+    {
+        DataPtr data = createData(CDM_DOUBLE, mb / sizeof(double));
+        TEST4FIMEX_CHECK_EQ(MemoryBudget::liveBytes(), live + mb);
+        auto small = make_shared_array<short>(10);
+        TEST4FIMEX_CHECK_EQ(MemoryBudget::liveBytes(), live + mb + 20);
+    }
+    TEST4FIMEX_CHECK_EQ(MemoryBudget::liveBytes(), live);
+    TEST4FIMEX_CHECK_EQ(MemoryBudget::peakBytes(), live + mb + 20);
+
+    // over the limit, iterations of the outer loop run one by one
+    WorkerPool pool(4);
+    auto held = make_shared_array<char>(mb);
+    MemoryBudget::setLimit(MemoryBudget::liveBytes() - 1);
+    TEST4FIMEX_CHECK(MemoryBudget::exceeded());
+    std::atomic<int> running(0), maxRunning(0);
+    std::atomic<size_t> sum(0);
+    pool.parallelFor(0, 16, [&](size_t i) {
+        int r = ++running;
+        for (int m = maxRunning; r > m && !maxRunning.compare_exchange_weak(m, r);) {
+        }
+        auto slice = make_shared_array<float>(mb);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2)); // give other workers a chance to start
+        // nested loops are not throttled
+        pool.parallelFor(0, 10, [&](size_t j) { sum += i * j; });
+        --running;
+    });
+    TEST4FIMEX_CHECK_EQ(maxRunning.load(), 1);
+    TEST4FIMEX_CHECK_EQ(sum.load(), 120 * 45);
+    TEST4FIMEX_CHECK(MemoryBudget::statistics().throttled > 0);
+
+    // within the limit, iterations run in parallel again
+    held.reset();
+    MemoryBudget::setLimit(0);
+    TEST4FIMEX_CHECK(!MemoryBudget::exceeded());
+    sum = 0;
+    pool.parallelFor(0, 1000, [&](size_t i) { sum += i; });
+    TEST4FIMEX_CHECK_EQ(sum.load(), 999 * 1000 / 2);
+}
+
+#ifdef HAVE_FELT
+TEST4FIMEX_TEST_CASE(test_getDataSliceAsync)
+{
+    CDMReader_p feltReader = getFLTH00Reader();
+    if (!feltReader)
+        return;
+
+    vector<future<DataPtr>> slices;
+    for (size_t t = 0; t < 4; ++t)
+        slices.push_back(feltReader->getDataSliceAsync("air_temperature", t));
+    for (size_t t = 0; t < 4; ++t) {
+        DataPtr async = slices[t].get();
+        DataPtr sync = feltReader->getDataSlice("air_temperature", t);
+        TEST4FIMEX_REQUIRE_EQ(async->size(), sync->size());
+        auto asyncValues = async->asFloat();
+        auto syncValues = sync->asFloat();
+        for (size_t i = 0; i < sync->size(); i += 97)
+            TEST4FIMEX_CHECK_EQ(asyncValues[i], syncValues[i]);
+    }
+
+    SliceBuilder sb(feltReader->getCDM(), "air_temperature");
+    sb.setStartAndSize("time", 1, 2);
+    TEST4FIMEX_CHECK_EQ(feltReader->getDataSliceAsync("air_temperature", sb).get()->size(), feltReader->getDataSlice("air_temperature", sb)->size());
+}
+#endif // HAVE_FELT